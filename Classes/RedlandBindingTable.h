@@ -0,0 +1,50 @@
+//
+//  RedlandBindingTable.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import <Foundation/Foundation.h>
+#import <redland.h>
+
+@class RedlandNode;
+
+
+/**
+ *  An immutable table of variable bindings, as returned by -[RedlandModel bindingsMatchingPatterns:].
+ *
+ *  The bindings are kept as a flat C array of librdf nodes with one column per variable; RedlandNode instances are only created when a binding is
+ *  asked for.
+ */
+@interface RedlandBindingTable : NSObject
+
+@property (nonatomic, readonly, copy) NSArray *variables;					///< The variable names, in column order
+@property (nonatomic, readonly, assign) NSUInteger count;					///< The number of rows
+
+- (id)initWithVariables:(NSArray *)variables nodes:(librdf_node **)nodes count:(NSUInteger)count;
+
+- (NSUInteger)columnOfVariable:(NSString *)name;
+- (librdf_node *)wrappedNodeAtRow:(NSUInteger)row column:(NSUInteger)column;
+- (RedlandNode *)nodeAtRow:(NSUInteger)row column:(NSUInteger)column;
+- (RedlandNode *)nodeForVariable:(NSString *)name atRow:(NSUInteger)row;
+- (NSDictionary *)dictionaryAtRow:(NSUInteger)row;
+
+
+@end
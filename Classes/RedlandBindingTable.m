@@ -0,0 +1,125 @@
+//
+//  RedlandBindingTable.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandBindingTable.h"
+#import "RedlandNode.h"
+
+
+@interface RedlandBindingTable () {
+	librdf_node **nodes;								///< count * [variables count] nodes, row by row
+}
+
+@end
+
+
+@implementation RedlandBindingTable
+
+
+/**
+ *  Designated initializer.
+ *
+ *  The receiver takes ownership of the nodes array, which must have been allocated with malloc, and of the node references in it.
+ *  @param variables The variable names
+ *  @param rowNodes The bindings, row by row, with one node per variable; unbound variables may be NULL
+ *  @param count The number of rows
+ */
+- (id)initWithVariables:(NSArray *)variables nodes:(librdf_node **)rowNodes count:(NSUInteger)count
+{
+	if ((self = [super init])) {
+		_variables = [variables copy];
+		_count = count;
+		nodes = rowNodes;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	NSUInteger total = _count * [_variables count];
+	for (NSUInteger i = 0; i < total; i++) {
+		if (nodes[i]) {
+			librdf_free_node(nodes[i]);
+		}
+	}
+	free(nodes);
+}
+
+
+
+#pragma mark - Accessors
+/**
+ *  @return The column of the given variable, NSNotFound if the receiver has no such variable
+ */
+- (NSUInteger)columnOfVariable:(NSString *)name
+{
+	return [_variables indexOfObject:name];
+}
+
+/**
+ *  @return The librdf node bound in the given row and column, owned by the receiver; NULL if the variable is not bound in this row
+ */
+- (librdf_node *)wrappedNodeAtRow:(NSUInteger)row column:(NSUInteger)column
+{
+	NSUInteger width = [_variables count];
+	if (row >= _count || column >= width) {
+		[NSException raise:NSRangeException format:@"Row %lu, column %lu is out of bounds", (unsigned long)row, (unsigned long)column];
+	}
+	return nodes[row * width + column];
+}
+
+/**
+ *  @return The node bound in the given row and column, nil if the variable is not bound in this row
+ */
+- (RedlandNode *)nodeAtRow:(NSUInteger)row column:(NSUInteger)column
+{
+	librdf_node *node = [self wrappedNodeAtRow:row column:column];
+	return node ? [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(node)] : nil;
+}
+
+/**
+ *  @return The node bound to the named variable in the given row, nil if there is no such variable or it is not bound in this row
+ */
+- (RedlandNode *)nodeForVariable:(NSString *)name atRow:(NSUInteger)row
+{
+	NSUInteger column = [self columnOfVariable:name];
+	return (NSNotFound == column) ? nil : [self nodeAtRow:row column:column];
+}
+
+/**
+ *  @return A dictionary mapping the variable names to the nodes bound in the given row, like the rows of RedlandQueryResults
+ */
+- (NSDictionary *)dictionaryAtRow:(NSUInteger)row
+{
+	NSUInteger width = [_variables count];
+	NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:width];
+	for (NSUInteger column = 0; column < width; column++) {
+		RedlandNode *node = [self nodeAtRow:row column:column];
+		if (node) {
+			[dictionary setObject:node forKey:[_variables objectAtIndex:column]];
+		}
+	}
+	return dictionary;
+}
+
+
+@end
@@ -0,0 +1,56 @@
+//
+//  RedlandCancellationToken.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import <Foundation/Foundation.h>
+#import <redland.h>
+
+
+/**
+ *  Cooperative cancellation and deadlines for long running operations.
+ *
+ *  A token can be passed to -[RedlandQuery executeOnModel:cancellationToken:], the parsing and serialization methods taking a token and
+ *  -[RedlandModel addStatementsFromStream:withContext:cancellationToken:]. These check the token between statements or result rows and raise a
+ *  RedlandException named RedlandCancellationExceptionName once it was cancelled or its deadline has passed; statements added by an interrupted
+ *  operation are removed again, so the model is left as it was. Query results remember the token, -[RedlandQueryResults next] raises once it
+ *  fires. The work librdf does inside a single call (e.g. sorting all results of an ORDER BY query) can not be interrupted.
+ *
+ *  Tokens may be cancelled from any thread.
+ */
+@interface RedlandCancellationToken : NSObject
+
+@property (nonatomic, readonly, strong) NSDate *deadline;						///< The time after which the token counts as cancelled, nil for none
+@property (nonatomic, readonly, assign, getter=isCancelled) BOOL cancelled;		///< YES once cancel was called or the deadline has passed
+
++ (id)token;
++ (id)tokenWithTimeout:(NSTimeInterval)timeout;
+
+- (id)initWithDeadline:(NSDate *)deadline;
+
+- (void)cancel;
+- (BOOL)isDeadlineExceeded;
+- (void)throwIfCancelled;
+
+
+@end
+
+
+extern librdf_stream *RedlandNewCancellableStream(librdf_stream *stream, RedlandCancellationToken *token);
@@ -0,0 +1,196 @@
+//
+//  RedlandCancellationToken.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandCancellationToken.h"
+#import "RedlandWorld.h"
+#import "RedlandException.h"
+
+
+@interface RedlandCancellationToken () {
+	volatile int32_t cancelFlag;
+	BOOL hasDeadline;
+	CFAbsoluteTime deadlineTime;						///< Only meaningful if hasDeadline, may be 0 or negative for deadlines at or before 2001
+}
+
+@end
+
+
+@implementation RedlandCancellationToken
+
+
+/**
+ *  Returns a token without a deadline that is only cancelled by calling cancel.
+ */
++ (id)token
+{
+	return [[self alloc] initWithDeadline:nil];
+}
+
+/**
+ *  Returns a token that counts as cancelled once the given number of seconds has passed.
+ *  @param timeout The number of seconds from now after which operations should stop
+ */
++ (id)tokenWithTimeout:(NSTimeInterval)timeout
+{
+	return [[self alloc] initWithDeadline:[NSDate dateWithTimeIntervalSinceNow:timeout]];
+}
+
+- (id)init
+{
+	return [self initWithDeadline:nil];
+}
+
+/**
+ *  Designated initializer.
+ *  @param deadline The time after which operations should stop, nil for none
+ */
+- (id)initWithDeadline:(NSDate *)deadline
+{
+	if ((self = [super init])) {
+		_deadline = deadline;
+		hasDeadline = (nil != deadline);
+		deadlineTime = deadline ? [deadline timeIntervalSinceReferenceDate] : 0;
+	}
+	return self;
+}
+
+
+
+#pragma mark - Cancelling
+/**
+ *  Cancels all operations observing the receiver; they stop at their next check.
+ */
+- (void)cancel
+{
+	__sync_lock_test_and_set(&cancelFlag, 1);
+}
+
+- (BOOL)isCancelled
+{
+	return (0 != cancelFlag || [self isDeadlineExceeded]);
+}
+
+/**
+ *  Returns YES if the receiver has a deadline and it has passed.
+ */
+- (BOOL)isDeadlineExceeded
+{
+	return (hasDeadline && CFAbsoluteTimeGetCurrent() >= deadlineTime);
+}
+
+/**
+ *  Raises a RedlandException named RedlandCancellationExceptionName if the receiver was cancelled or its deadline has passed.
+ *
+ *  The userInfo of the exception holds the token under "token" and an NSNumber telling whether the deadline was exceeded under "deadlineExceeded".
+ */
+- (void)throwIfCancelled
+{
+	if (0 != cancelFlag) {
+		@throw [RedlandException exceptionWithName:RedlandCancellationExceptionName
+											reason:@"The operation was cancelled"
+										  userInfo:@{ @"token": self, @"deadlineExceeded": @NO }];
+	}
+	if ([self isDeadlineExceeded]) {
+		@throw [RedlandException exceptionWithName:RedlandCancellationExceptionName
+											reason:[NSString stringWithFormat:@"The operation ran past its deadline %@", _deadline]
+										  userInfo:@{ @"token": self, @"deadlineExceeded": @YES }];
+	}
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p> cancelled: %d, deadline: %@", NSStringFromClass([self class]), self, [self isCancelled], _deadline];
+}
+
+
+@end
+
+
+
+#pragma mark - Cancellable Streams
+typedef struct {
+	librdf_stream *stream;
+	CFTypeRef token;									///< The retained RedlandCancellationToken
+	BOOL stopped;
+} RedlandCancellableStreamContext;
+
+static int RedlandCancellableStreamIsEnd(void *context)
+{
+	RedlandCancellableStreamContext *cancellable = context;
+	if (!cancellable->stopped && [(__bridge RedlandCancellationToken *)cancellable->token isCancelled]) {
+		cancellable->stopped = YES;
+	}
+	return (cancellable->stopped || librdf_stream_end(cancellable->stream));
+}
+
+static int RedlandCancellableStreamNext(void *context)
+{
+	RedlandCancellableStreamContext *cancellable = context;
+	return librdf_stream_next(cancellable->stream);
+}
+
+static void *RedlandCancellableStreamGet(void *context, int flags)
+{
+	RedlandCancellableStreamContext *cancellable = context;
+	if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags) {
+		return librdf_stream_get_context2(cancellable->stream);
+	}
+	return librdf_stream_get_object(cancellable->stream);
+}
+
+static void RedlandCancellableStreamFree(void *context)
+{
+	RedlandCancellableStreamContext *cancellable = context;
+	librdf_free_stream(cancellable->stream);
+	CFRelease(cancellable->token);
+	free(cancellable);
+}
+
+/**
+ *  Returns a stream that passes on the statements of the given stream and ends early once the token is cancelled.
+ *
+ *  Useful to interrupt librdf functions consuming a whole stream, like serializers; check the token after the function returns to find out whether the
+ *  stream was cut short.
+ *  @param stream The stream to wrap, owned by the returned stream
+ *  @param token The token to check before every statement
+ *  @return A new librdf_stream, NULL on failure (the given stream is freed in that case)
+ */
+librdf_stream *RedlandNewCancellableStream(librdf_stream *stream, RedlandCancellationToken *token)
+{
+	NSCParameterAssert(token != nil);
+	if (NULL == stream) {
+		return NULL;
+	}
+	RedlandCancellableStreamContext *cancellable = calloc(1, sizeof(RedlandCancellableStreamContext));
+	if (NULL == cancellable) {
+		librdf_free_stream(stream);
+		return NULL;
+	}
+	cancellable->stream = stream;
+	cancellable->token = CFBridgingRetain(token);
+	librdf_stream *wrapper = librdf_new_stream([RedlandWorld defaultWrappedWorld], cancellable, &RedlandCancellableStreamIsEnd,
+											   &RedlandCancellableStreamNext, &RedlandCancellableStreamGet, &RedlandCancellableStreamFree);
+	if (!wrapper) {
+		RedlandCancellableStreamFree(cancellable);
+	}
+	return wrapper;
+}
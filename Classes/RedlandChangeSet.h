@@ -0,0 +1,52 @@
+//
+//  RedlandChangeSet.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandStatement, RedlandNode;
+
+typedef void (^RedlandChangeEnumerationBlock)(RedlandStatement *statement, RedlandNode *context, BOOL added, BOOL *stop);
+
+
+/**
+ *  The statements added to and removed from a model by one mutation or one batch of mutations, in the order the changes were made.
+ *
+ *  Change sets are delivered to the observers registered with -[RedlandModel addChangeObserverWithQueue:usingBlock:]. Only statements that were
+ *  actually added (not already present) or actually removed are recorded.
+ */
+@interface RedlandChangeSet : NSObject <NSCopying>
+
+@property (nonatomic, readonly, assign) NSUInteger count;			///< The total number of changes
+
+- (NSArray *)addedStatements;
+- (NSArray *)removedStatements;
+- (NSSet *)affectedSubjects;
+- (NSSet *)affectedContexts;
+
+- (void)enumerateChangesUsingBlock:(RedlandChangeEnumerationBlock)block;
+
+- (void)addStatement:(RedlandStatement *)statement context:(RedlandNode *)context;
+- (void)removeStatement:(RedlandStatement *)statement context:(RedlandNode *)context;
+
+
+@end
@@ -0,0 +1,150 @@
+//
+//  RedlandChangeSet.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandChangeSet.h"
+#import "RedlandStatement.h"
+#import "RedlandNode.h"
+
+
+@interface RedlandChangeSet () {
+	NSMutableArray *statements;
+	NSMutableArray *contexts;							///< The context of each statement, NSNull if it has none
+	NSMutableIndexSet *addedIndexes;					///< The indexes of statements that were added; all others were removed
+}
+
+@end
+
+
+@implementation RedlandChangeSet
+
+
+- (id)init
+{
+	if ((self = [super init])) {
+		statements = [NSMutableArray new];
+		contexts = [NSMutableArray new];
+		addedIndexes = [NSMutableIndexSet new];
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	RedlandChangeSet *copy = [[[self class] allocWithZone:zone] init];
+	[copy->statements setArray:statements];
+	[copy->contexts setArray:contexts];
+	[copy->addedIndexes addIndexes:addedIndexes];
+	return copy;
+}
+
+- (NSUInteger)count
+{
+	return [statements count];
+}
+
+
+
+#pragma mark - Recording
+/**
+ *  Records that the statement was added, in the given context (may be nil).
+ */
+- (void)addStatement:(RedlandStatement *)statement context:(RedlandNode *)context
+{
+	NSParameterAssert(statement != nil);
+	[addedIndexes addIndex:[statements count]];
+	[statements addObject:statement];
+	[contexts addObject:(context ?: (id)[NSNull null])];
+}
+
+/**
+ *  Records that the statement was removed, from the given context (may be nil).
+ */
+- (void)removeStatement:(RedlandStatement *)statement context:(RedlandNode *)context
+{
+	NSParameterAssert(statement != nil);
+	[statements addObject:statement];
+	[contexts addObject:(context ?: (id)[NSNull null])];
+}
+
+
+
+#pragma mark - Accessors
+/**
+ *  @return The added statements, in the order they were added
+ */
+- (NSArray *)addedStatements
+{
+	return [statements objectsAtIndexes:addedIndexes];
+}
+
+/**
+ *  @return The removed statements, in the order they were removed
+ */
+- (NSArray *)removedStatements
+{
+	NSIndexSet *removed = [statements indexesOfObjectsPassingTest:^BOOL(id obj, NSUInteger idx, BOOL *stop) {
+		return ![addedIndexes containsIndex:idx];
+	}];
+	return [statements objectsAtIndexes:removed];
+}
+
+/**
+ *  @return The subjects of all added and removed statements
+ */
+- (NSSet *)affectedSubjects
+{
+	return [NSSet setWithArray:[statements valueForKey:@"subject"]];
+}
+
+/**
+ *  @return The contexts of all added and removed statements; statements without context are not represented
+ */
+- (NSSet *)affectedContexts
+{
+	NSMutableSet *affected = [NSMutableSet setWithArray:contexts];
+	[affected removeObject:[NSNull null]];
+	return affected;
+}
+
+/**
+ *  Calls the block with every change, in the order the changes were made.
+ */
+- (void)enumerateChangesUsingBlock:(RedlandChangeEnumerationBlock)block
+{
+	NSParameterAssert(block != nil);
+	NSUInteger count = [statements count];
+	BOOL stop = NO;
+	for (NSUInteger i = 0; i < count && !stop; i++) {
+		id context = [contexts objectAtIndex:i];
+		block([statements objectAtIndex:i], ([NSNull null] == context) ? nil : context, [addedIndexes containsIndex:i], &stop);
+	}
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p> %lu added, %lu removed", NSStringFromClass([self class]), self,
+			(unsigned long)[addedIndexes count], (unsigned long)([statements count] - [addedIndexes count])];
+}
+
+
+@end
@@ -22,17 +22,20 @@
 //  the most recent version, see <http://librdf.org/>.
 //
 
-#import <Cocoa/Cocoa.h>
+#import <Foundation/Foundation.h>
 
 @class RedlandModel, RedlandNode;
 
 
 /**
  *  An NSEnumerator subclass to enable fast-enumeration over a collection.
+ *
+ *  The members are read with -[RedlandModel contentsOfCollectionNode:] when the enumerator is created, so it is not affected by later changes to the
+ *  model.
  */
 @interface RedlandCollectionEnumerator : NSEnumerator {
-    RedlandModel *model;										///< The model to iterate over
-    RedlandNode *currentNode;									///< current node
+    NSArray *contents;											///< The members of the collection
+    NSUInteger nextIndex;										///< Index of the next member to return
 }
 
 + (id)enumeratorWithModel:(RedlandModel *)aModel collectionNode:(RedlandNode *)collectionNode;
@@ -26,7 +26,7 @@
 
 #import "RedlandNode.h"
 #import "RedlandModel.h"
-#import "RedlandNamespace.h"
+#import "RedlandModel-Convenience.h"
 
 @implementation RedlandCollectionEnumerator
 
@@ -48,44 +48,30 @@
 - (id)initWithModel:(RedlandModel *)aModel collectionNode:(RedlandNode *)collectionNode
 {
     if ((self = [super init])) {
-        model = [aModel retain];
-        currentNode = [collectionNode retain];
+        contents = [aModel contentsOfCollectionNode:collectionNode];
     }
     return self;
 }
 
-- (void)dealloc
-{
-    [model release];
-    [currentNode release];
-    [super dealloc];
-}
-
 /**
  *  Retrieve the next object
  */
 - (id)nextObject
 {
-    RedlandNode *value;
-    static RedlandNode *RDFFirstNode = nil;
-    static RedlandNode *RDFRestNode = nil;
-    static RedlandNode *RDFNilNode = nil;
-    
-    if (!RDFFirstNode)
-        RDFFirstNode = [[RDFSyntaxNS node:@"first"] retain];
-    if (!RDFRestNode)
-        RDFRestNode = [[RDFSyntaxNS node:@"rest"] retain];
-    if (!RDFNilNode)
-        RDFNilNode = [[RDFSyntaxNS node:@"nil"] retain];
-    
-    if (currentNode) {
-        value = [model targetWithSource:currentNode arc:RDFFirstNode];
-        currentNode = [model targetWithSource:currentNode arc:RDFRestNode];
-        if ([currentNode isEqualToNode:RDFNilNode])
-            currentNode = nil;
-        return value;
+    if (nextIndex < [contents count]) {
+        return [contents objectAtIndex:nextIndex++];
     }
-    else return nil;
+    return nil;
+}
+
+/**
+ *  Returns the members that have not yet been enumerated
+ */
+- (NSArray *)allObjects
+{
+    NSRange rest = NSMakeRange(nextIndex, [contents count] - nextIndex);
+    nextIndex = [contents count];
+    return [contents subarrayWithRange:rest];
 }
 
 
@@ -0,0 +1,56 @@
+//
+//  RedlandCompactStorage.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import <Foundation/Foundation.h>
+#import <redland.h>
+
+extern NSString * const RedlandCompactStorageFactoryName;		///< The factory name of the compact in-memory storage, "compact"
+
+
+/**
+ *  A dictionary-encoded in-memory storage module.
+ *
+ *  Every distinct node is interned exactly once and statements are stored as quads of 32-bit term identifiers (subject, predicate, object, context).
+ *  The quads are kept in four sorted arrays, ordered SPOG, POSG, OSPG and GSPO, so every triple pattern resolves to one contiguous range of one of these
+ *  arrays which is then scanned sequentially. New statements go to a small unsorted delta buffer first which is merged into the sorted arrays once it fills
+ *  up, removed statements are compacted away lazily.
+ *
+ *  The storage supports contexts and is selected with:
+ *
+ *      [[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil]
+ *
+ *  Interned terms are only released when the storage is freed, so the storage is best suited for data that mostly grows.
+ */
+extern void RedlandCompactStorageRegisterFactory(librdf_world *world);
+extern BOOL RedlandStorageIsCompact(librdf_storage *storage);
+extern NSUInteger RedlandCompactStorageCount(librdf_storage *storage, librdf_statement *statement, librdf_node *context, BOOL estimate);
+extern uint64_t RedlandCompactStorageScannedCount(librdf_storage *storage);
+extern uint64_t RedlandCompactStorageIdentifier(librdf_storage *storage);
+extern BOOL RedlandCompactStorageGetPosition(librdf_storage *storage, librdf_statement *statement, librdf_node *context, uint32_t position[4]);
+extern librdf_stream *RedlandCompactStorageFindStatementsAfter(librdf_storage *storage, librdf_statement *statement, librdf_node *context, const uint32_t position[4]);
+extern size_t RedlandCompactStorageCopyContextCounts(librdf_storage *storage, librdf_node ***contexts, size_t **counts);
+extern int RedlandCompactStorageReplaceContext(librdf_storage *storage, librdf_node *context, librdf_statement **statements, size_t count,
+											   librdf_statement ***removed, size_t *removedCount, librdf_statement ***added, size_t *addedCount);
+extern size_t RedlandCompactStorageFindPositions(librdf_storage *storage, librdf_statement *statement, librdf_node *context, const uint32_t after[4],
+												 uint32_t positions[][4], size_t limit);
+extern librdf_node *RedlandCompactStorageGetTerm(librdf_storage *storage, uint32_t termID);
+extern int RedlandCompactStorageAddStatements(librdf_storage *storage, librdf_statement **statements, size_t count, librdf_node *context, BOOL merge);
@@ -0,0 +1,1647 @@
+//
+//  RedlandCompactStorage.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandCompactStorage.h"
+#import "RedlandWorld.h"
+#import "RedlandNode.h"
+#import <pthread.h>
+
+NSString * const RedlandCompactStorageFactoryName = @"compact";
+
+#define REDLAND_COMPACT_DELTA_MINIMUM 4096				// number of buffered quads that triggers a merge into small sorted indexes
+#define REDLAND_COMPACT_DELTA_FRACTION 16				// on large storages a merge is triggered once the buffer reaches this fraction of the indexes
+
+
+typedef struct {
+	uint32_t t[4];										// subject, predicate, object and context term ID; a context of 0 means "no context"
+} RedlandCompactQuad;
+
+enum {
+	RedlandCompactSPOG = 0,
+	RedlandCompactPOSG,
+	RedlandCompactOSPG,
+	RedlandCompactGSPO,
+	RedlandCompactIndexCount
+};
+
+/// The quad positions in the sort order of each index
+static const int RedlandCompactOrders[RedlandCompactIndexCount][4] = {
+	{ 0, 1, 2, 3 },
+	{ 1, 2, 0, 3 },
+	{ 2, 0, 1, 3 },
+	{ 3, 0, 1, 2 }
+};
+
+typedef struct {
+	RedlandCompactQuad *quads;
+	size_t count;
+	size_t capacity;
+} RedlandCompactQuadArray;
+
+typedef struct {
+	RedlandCompactQuad *slots;							// open addressing; a subject of 0 marks a free slot, UINT32_MAX a deleted one
+	size_t capacity;									// always a power of two
+	size_t count;
+	size_t used;										// live plus deleted slots
+} RedlandCompactQuadSet;
+
+typedef struct {
+	pthread_rwlock_t lock;
+	librdf_world *world;
+	CFMutableDictionaryRef termIDs;						// librdf_node -> term ID
+	librdf_node **terms;								// term ID -> librdf_node, slot 0 is unused
+	uint32_t termCount;
+	uint32_t termCapacity;
+	size_t *contextCounts;								// term ID -> number of live quads in that context, kept up to date on every change
+	RedlandCompactQuadSet live;							// all quads currently in the storage
+	RedlandCompactQuadArray indexes[RedlandCompactIndexCount];
+	RedlandCompactQuadArray delta;						// quads added since the last merge, unsorted
+	size_t removedCount;								// quads still present in the sorted indexes but no longer in the live set
+	uint64_t generation;								// increased whenever the sorted indexes are rewritten
+	BOOL defersMerges;									// set during bulk adds, which merge the delta buffer only once at the end
+	volatile uint64_t scannedCount;						// quads examined by scans, updated atomically as scans hold only the read lock
+	uint64_t identifier;								// distinguishes instances, so positions are not resumed on another storage
+} RedlandCompactStorageInstance;
+
+
+static pthread_mutex_t RedlandCompactRegistryLock = PTHREAD_MUTEX_INITIALIZER;
+static CFMutableSetRef RedlandCompactRegistry = NULL;	// all live instances, used to tell compact storages apart from others
+static volatile uint32_t RedlandCompactInstanceCounter = 0;
+
+
+#pragma mark - Quad Comparison
+static inline int RedlandCompactCompare(const RedlandCompactQuad *a, const RedlandCompactQuad *b, int order, int length)
+{
+	const int *positions = RedlandCompactOrders[order];
+	for (int i = 0; i < length; i++) {
+		uint32_t x = a->t[positions[i]];
+		uint32_t y = b->t[positions[i]];
+		if (x != y) {
+			return (x < y) ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+static int RedlandCompactCompareSPOG(const void *a, const void *b) { return RedlandCompactCompare(a, b, RedlandCompactSPOG, 4); }
+static int RedlandCompactComparePOSG(const void *a, const void *b) { return RedlandCompactCompare(a, b, RedlandCompactPOSG, 4); }
+static int RedlandCompactCompareOSPG(const void *a, const void *b) { return RedlandCompactCompare(a, b, RedlandCompactOSPG, 4); }
+static int RedlandCompactCompareGSPO(const void *a, const void *b) { return RedlandCompactCompare(a, b, RedlandCompactGSPO, 4); }
+
+static int (* const RedlandCompactComparators[RedlandCompactIndexCount])(const void *, const void *) = {
+	RedlandCompactCompareSPOG,
+	RedlandCompactComparePOSG,
+	RedlandCompactCompareOSPG,
+	RedlandCompactCompareGSPO
+};
+
+static inline BOOL RedlandCompactMatches(const RedlandCompactQuad *quad, const RedlandCompactQuad *pattern)
+{
+	for (int i = 0; i < 4; i++) {
+		if (pattern->t[i] && pattern->t[i] != quad->t[i]) {
+			return NO;
+		}
+	}
+	return YES;
+}
+
+/**
+ *  Picks the index whose sort order starts with the longest run of bound positions of the pattern.
+ */
+static int RedlandCompactChooseOrder(const RedlandCompactQuad *pattern, int *prefixLength)
+{
+	int best = RedlandCompactSPOG;
+	int bestLength = 0;
+	for (int order = 0; order < RedlandCompactIndexCount; order++) {
+		int length = 0;
+		while (length < 4 && pattern->t[RedlandCompactOrders[order][length]]) {
+			length++;
+		}
+		if (length > bestLength) {
+			best = order;
+			bestLength = length;
+		}
+	}
+	*prefixLength = bestLength;
+	return best;
+}
+
+/**
+ *  Binary search over a sorted index.
+ *  @return The first position whose first "length" keys compare greater or equal (or greater if "upper" is set) to those of the key
+ */
+static size_t RedlandCompactSearch(const RedlandCompactQuadArray *array, const RedlandCompactQuad *key, int order, int length, BOOL upper)
+{
+	size_t low = 0;
+	size_t high = array->count;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		int result = RedlandCompactCompare(&array->quads[mid], key, order, length);
+		if (result < 0 || (upper && 0 == result)) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static BOOL RedlandCompactArrayReserve(RedlandCompactQuadArray *array, size_t capacity)
+{
+	if (capacity <= array->capacity) {
+		return YES;
+	}
+	size_t newCapacity = MAX(array->capacity * 2, MAX(capacity, 64));
+	RedlandCompactQuad *quads = realloc(array->quads, newCapacity * sizeof(RedlandCompactQuad));
+	if (!quads) {
+		return NO;
+	}
+	array->quads = quads;
+	array->capacity = newCapacity;
+	return YES;
+}
+
+
+
+#pragma mark - Quad Set
+static inline size_t RedlandCompactQuadHash(const RedlandCompactQuad *quad)
+{
+	uint64_t hash = 0;
+	for (int i = 0; i < 4; i++) {
+		hash = (hash ^ quad->t[i]) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 32;
+	}
+	return (size_t)hash;
+}
+
+/**
+ *  Looks up a quad in the set, which must have a capacity.
+ *  @return YES if the quad was found; "slot" receives its position or the position where it should be inserted
+ */
+static BOOL RedlandCompactSetLookup(const RedlandCompactQuadSet *set, const RedlandCompactQuad *quad, size_t *slot)
+{
+	size_t mask = set->capacity - 1;
+	size_t i = RedlandCompactQuadHash(quad) & mask;
+	size_t insertAt = SIZE_MAX;
+	for (;;) {
+		const RedlandCompactQuad *candidate = &set->slots[i];
+		if (0 == candidate->t[0]) {
+			*slot = (SIZE_MAX != insertAt) ? insertAt : i;
+			return NO;
+		}
+		if (UINT32_MAX == candidate->t[0]) {
+			if (SIZE_MAX == insertAt) {
+				insertAt = i;
+			}
+		}
+		else if (0 == memcmp(candidate, quad, sizeof(RedlandCompactQuad))) {
+			*slot = i;
+			return YES;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static inline BOOL RedlandCompactSetContains(const RedlandCompactQuadSet *set, const RedlandCompactQuad *quad)
+{
+	size_t slot;
+	return (set->count > 0 && RedlandCompactSetLookup(set, quad, &slot));
+}
+
+static BOOL RedlandCompactSetRehash(RedlandCompactQuadSet *set, size_t capacity)
+{
+	RedlandCompactQuad *slots = calloc(capacity, sizeof(RedlandCompactQuad));
+	if (!slots) {
+		return NO;
+	}
+	size_t mask = capacity - 1;
+	for (size_t i = 0; i < set->capacity; i++) {
+		const RedlandCompactQuad *quad = &set->slots[i];
+		if (0 == quad->t[0] || UINT32_MAX == quad->t[0]) {
+			continue;
+		}
+		size_t j = RedlandCompactQuadHash(quad) & mask;
+		while (0 != slots[j].t[0]) {
+			j = (j + 1) & mask;
+		}
+		slots[j] = *quad;
+	}
+	free(set->slots);
+	set->slots = slots;
+	set->capacity = capacity;
+	set->used = set->count;
+	return YES;
+}
+
+/**
+ *  @return 1 if the quad was added, 0 if it already was in the set and -1 if memory ran out
+ */
+static int RedlandCompactSetAdd(RedlandCompactQuadSet *set, const RedlandCompactQuad *quad)
+{
+	if ((set->used + 1) * 4 > set->capacity * 3) {
+		size_t capacity = (set->capacity > 0) ? set->capacity : 64;
+		while ((set->count + 1) * 2 > capacity) {
+			capacity *= 2;
+		}
+		if (!RedlandCompactSetRehash(set, capacity)) {
+			return -1;
+		}
+	}
+	size_t slot;
+	if (RedlandCompactSetLookup(set, quad, &slot)) {
+		return 0;
+	}
+	if (0 == set->slots[slot].t[0]) {
+		set->used++;
+	}
+	set->slots[slot] = *quad;
+	set->count++;
+	return 1;
+}
+
+static BOOL RedlandCompactSetRemove(RedlandCompactQuadSet *set, const RedlandCompactQuad *quad)
+{
+	size_t slot;
+	if (0 == set->count || !RedlandCompactSetLookup(set, quad, &slot)) {
+		return NO;
+	}
+	set->slots[slot].t[0] = UINT32_MAX;
+	set->count--;
+	return YES;
+}
+
+
+
+#pragma mark - Terms
+static uint32_t RedlandCompactLookupTerm(RedlandCompactStorageInstance *instance, librdf_node *node)
+{
+	const void *value = NULL;
+	if (node && CFDictionaryGetValueIfPresent(instance->termIDs, node, &value)) {
+		return (uint32_t)(uintptr_t)value;
+	}
+	return 0;
+}
+
+/**
+ *  Returns the ID of the given node, adding it to the term table if necessary.
+ *  @return The term ID or 0 on failure
+ */
+static uint32_t RedlandCompactInternTerm(RedlandCompactStorageInstance *instance, librdf_node *node)
+{
+	uint32_t termID = RedlandCompactLookupTerm(instance, node);
+	if (termID || !node) {
+		return termID;
+	}
+	if (instance->termCount + 1 >= instance->termCapacity) {
+		if (instance->termCapacity >= UINT32_MAX / 2) {
+			return 0;
+		}
+		uint32_t capacity = MAX(instance->termCapacity * 2, 256);
+		librdf_node **terms = realloc(instance->terms, capacity * sizeof(librdf_node *));
+		if (!terms) {
+			return 0;
+		}
+		instance->terms = terms;
+		size_t *contextCounts = realloc(instance->contextCounts, capacity * sizeof(size_t));
+		if (!contextCounts) {
+			return 0;
+		}
+		memset(contextCounts + instance->termCapacity, 0, (capacity - instance->termCapacity) * sizeof(size_t));
+		instance->contextCounts = contextCounts;
+		instance->termCapacity = capacity;
+	}
+	librdf_node *copy = librdf_new_node_from_node(node);
+	if (!copy) {
+		return 0;
+	}
+	termID = ++instance->termCount;
+	instance->terms[termID] = copy;
+	CFDictionarySetValue(instance->termIDs, copy, (const void *)(uintptr_t)termID);
+	return termID;
+}
+
+/**
+ *  Fills a pattern quad with the IDs of the statement's (and context's) nodes; missing nodes are 0 and match anything.
+ *  @return NO if one of the nodes is not known to the storage, in which case nothing can match the pattern
+ */
+static BOOL RedlandCompactResolvePattern(RedlandCompactStorageInstance *instance, librdf_statement *statement, librdf_node *context, RedlandCompactQuad *pattern)
+{
+	librdf_node *nodes[4] = {
+		statement ? librdf_statement_get_subject(statement) : NULL,
+		statement ? librdf_statement_get_predicate(statement) : NULL,
+		statement ? librdf_statement_get_object(statement) : NULL,
+		context
+	};
+	for (int i = 0; i < 4; i++) {
+		pattern->t[i] = 0;
+		if (nodes[i]) {
+			pattern->t[i] = RedlandCompactLookupTerm(instance, nodes[i]);
+			if (0 == pattern->t[i]) {
+				return NO;
+			}
+		}
+	}
+	return YES;
+}
+
+
+
+#pragma mark - Quads
+/**
+ *  The number of buffered (or removed) quads that triggers a merge. It grows with the indexes, so that each merge, which rewrites all four indexes,
+ *  is paid for by a proportional number of changes and loading N statements one by one costs O(N log N) rather than O(N²). Scans read the buffer
+ *  linearly, so it is kept to a small fraction of the indexes.
+ */
+static size_t RedlandCompactDeltaLimit(RedlandCompactStorageInstance *instance)
+{
+	return MAX((size_t)REDLAND_COMPACT_DELTA_MINIMUM, instance->indexes[RedlandCompactSPOG].count / REDLAND_COMPACT_DELTA_FRACTION);
+}
+
+/**
+ *  Merges the delta buffer into the sorted indexes and drops removed quads from them. The indexes are grown in place and merged from the back, so
+ *  no second copy of the indexes is needed. Expects the write lock to be held.
+ */
+static BOOL RedlandCompactMerge(RedlandCompactStorageInstance *instance)
+{
+	RedlandCompactQuadArray *delta = &instance->delta;
+	if (0 == delta->count && 0 == instance->removedCount) {
+		return YES;
+	}
+	for (int order = 0; order < RedlandCompactIndexCount; order++) {
+		if (!RedlandCompactArrayReserve(&instance->indexes[order], instance->indexes[order].count + delta->count)) {
+			return NO;
+		}
+	}
+	
+	BOOL filter = (instance->removedCount > 0);
+	for (int order = 0; order < RedlandCompactIndexCount; order++) {
+		RedlandCompactQuadArray *index = &instance->indexes[order];
+		qsort(delta->quads, delta->count, sizeof(RedlandCompactQuad), RedlandCompactComparators[order]);
+		
+		size_t i = index->count;
+		size_t j = delta->count;
+		size_t k = index->count + delta->count;
+		while (j > 0) {
+			if (i > 0 && RedlandCompactCompare(&index->quads[i - 1], &delta->quads[j - 1], order, 4) > 0) {
+				index->quads[--k] = index->quads[--i];
+			}
+			else {
+				index->quads[--k] = delta->quads[--j];
+			}
+		}
+		index->count += delta->count;
+		
+		if (filter) {
+			size_t kept = 0;
+			for (size_t n = 0; n < index->count; n++) {
+				if (RedlandCompactSetContains(&instance->live, &index->quads[n])) {
+					index->quads[kept++] = index->quads[n];
+				}
+			}
+			index->count = kept;
+		}
+	}
+	delta->count = 0;
+	instance->removedCount = 0;
+	instance->generation++;
+	return YES;
+}
+
+/**
+ *  Adds a quad, expects the write lock to be held.
+ *  @return 0 on success (including the quad already being present), non-zero on failure
+ */
+static int RedlandCompactAddQuad(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *quad)
+{
+	int added = RedlandCompactSetAdd(&instance->live, quad);
+	if (added <= 0) {
+		return (added < 0) ? 1 : 0;
+	}
+	instance->contextCounts[quad->t[3]]++;
+	
+	// a removed quad that has not been compacted away yet only needs to be revived
+	if (instance->removedCount > 0) {
+		RedlandCompactQuadArray *spog = &instance->indexes[RedlandCompactSPOG];
+		size_t position = RedlandCompactSearch(spog, quad, RedlandCompactSPOG, 4, NO);
+		if (position < spog->count && 0 == RedlandCompactCompare(&spog->quads[position], quad, RedlandCompactSPOG, 4)) {
+			instance->removedCount--;
+			return 0;
+		}
+	}
+	
+	if (!RedlandCompactArrayReserve(&instance->delta, instance->delta.count + 1)) {
+		RedlandCompactSetRemove(&instance->live, quad);
+		instance->contextCounts[quad->t[3]]--;
+		return 1;
+	}
+	instance->delta.quads[instance->delta.count++] = *quad;
+	if (instance->delta.count >= RedlandCompactDeltaLimit(instance) && !instance->defersMerges) {
+		RedlandCompactMerge(instance);
+	}
+	return 0;
+}
+
+/**
+ *  Removes a quad, expects the write lock to be held. Quads in the sorted indexes are only marked as removed and compacted away once enough of them
+ *  have accumulated.
+ */
+static void RedlandCompactRemoveQuad(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *quad)
+{
+	if (!RedlandCompactSetRemove(&instance->live, quad)) {
+		return;
+	}
+	instance->contextCounts[quad->t[3]]--;
+	
+	RedlandCompactQuadArray *spog = &instance->indexes[RedlandCompactSPOG];
+	size_t position = RedlandCompactSearch(spog, quad, RedlandCompactSPOG, 4, NO);
+	if (position < spog->count && 0 == RedlandCompactCompare(&spog->quads[position], quad, RedlandCompactSPOG, 4)) {
+		instance->removedCount++;
+		if (instance->removedCount >= RedlandCompactDeltaLimit(instance) && instance->removedCount * 8 >= spog->count) {
+			RedlandCompactMerge(instance);
+		}
+		return;
+	}
+	
+	RedlandCompactQuadArray *delta = &instance->delta;
+	for (size_t i = 0; i < delta->count; i++) {
+		if (0 == memcmp(&delta->quads[i], quad, sizeof(RedlandCompactQuad))) {
+			delta->quads[i] = delta->quads[--delta->count];
+			break;
+		}
+	}
+}
+
+/**
+ *  Appends all live quads matching the pattern to the given array, expects at least a read lock to be held.
+ */
+static BOOL RedlandCompactCollect(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *pattern, RedlandCompactQuadArray *result)
+{
+	int prefixLength = 0;
+	int order = RedlandCompactChooseOrder(pattern, &prefixLength);
+	RedlandCompactQuadArray *index = &instance->indexes[order];
+	size_t start = RedlandCompactSearch(index, pattern, order, prefixLength, NO);
+	size_t end = RedlandCompactSearch(index, pattern, order, prefixLength, YES);
+	BOOL filter = (instance->removedCount > 0);
+	
+	for (size_t i = start; i < end; i++) {
+		const RedlandCompactQuad *quad = &index->quads[i];
+		if (RedlandCompactMatches(quad, pattern) && (!filter || RedlandCompactSetContains(&instance->live, quad))) {
+			if (!RedlandCompactArrayReserve(result, result->count + 1)) {
+				return NO;
+			}
+			result->quads[result->count++] = *quad;
+		}
+	}
+	for (size_t i = 0; i < instance->delta.count; i++) {
+		const RedlandCompactQuad *quad = &instance->delta.quads[i];
+		if (RedlandCompactMatches(quad, pattern)) {
+			if (!RedlandCompactArrayReserve(result, result->count + 1)) {
+				return NO;
+			}
+			result->quads[result->count++] = *quad;
+		}
+	}
+	return YES;
+}
+
+/**
+ *  Whether any live quad matches the pattern, expects at least a read lock to be held.
+ */
+static BOOL RedlandCompactContainsPattern(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *pattern)
+{
+	if (pattern->t[0] && pattern->t[1] && pattern->t[2] && pattern->t[3]) {
+		return RedlandCompactSetContains(&instance->live, pattern);
+	}
+	
+	int prefixLength = 0;
+	int order = RedlandCompactChooseOrder(pattern, &prefixLength);
+	RedlandCompactQuadArray *index = &instance->indexes[order];
+	size_t end = RedlandCompactSearch(index, pattern, order, prefixLength, YES);
+	BOOL filter = (instance->removedCount > 0);
+	for (size_t i = RedlandCompactSearch(index, pattern, order, prefixLength, NO); i < end; i++) {
+		const RedlandCompactQuad *quad = &index->quads[i];
+		if (RedlandCompactMatches(quad, pattern) && (!filter || RedlandCompactSetContains(&instance->live, quad))) {
+			return YES;
+		}
+	}
+	for (size_t i = 0; i < instance->delta.count; i++) {
+		if (RedlandCompactMatches(&instance->delta.quads[i], pattern)) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+
+
+#pragma mark - Scans
+/**
+ *  The context of the streams and iterators returned by the storage.
+ *
+ *  A scan walks the range of one sorted index and merges in a sorted copy of the matching buffered quads, so results come out in index order. The scan
+ *  remembers the last quad it returned; if the indexes are rewritten while the scan is in progress it seeks to the first quad after that one and
+ *  continues from there, which makes it safe to modify the storage while iterating.
+ */
+typedef struct {
+	RedlandCompactStorageInstance *instance;
+	RedlandCompactQuad pattern;							// term IDs to match, 0 matches anything
+	int order;
+	int prefixLength;
+	uint64_t generation;
+	size_t position;									// next candidate in the sorted index
+	size_t end;
+	RedlandCompactQuad *delta;							// sorted copy of the matching buffered quads
+	size_t deltaCount;
+	size_t deltaPosition;
+	RedlandCompactQuad current;
+	BOOL hasCurrent;
+	BOOL finished;
+	int nodePosition;									// for node iterators, the quad position to return; -1 for statement streams
+	librdf_statement statement;							// embedded and set up with librdf_statement_init, so copies handed out are deep copies
+	BOOL statementIsCurrent;
+} RedlandCompactScan;
+
+static void RedlandCompactScanSeek(RedlandCompactScan *scan)
+{
+	RedlandCompactQuadArray *index = &scan->instance->indexes[scan->order];
+	scan->end = RedlandCompactSearch(index, &scan->pattern, scan->order, scan->prefixLength, YES);
+	scan->position = RedlandCompactSearch(index, &scan->pattern, scan->order, scan->prefixLength, NO);
+	if (scan->hasCurrent) {
+		size_t next = RedlandCompactSearch(index, &scan->current, scan->order, 4, YES);
+		scan->position = MAX(scan->position, next);
+	}
+	scan->generation = scan->instance->generation;
+}
+
+/**
+ *  Moves the scan to the next matching quad. Node iterators skip consecutive quads that would return the same node.
+ */
+static void RedlandCompactScanAdvance(RedlandCompactScan *scan)
+{
+	RedlandCompactStorageInstance *instance = scan->instance;
+	pthread_rwlock_rdlock(&instance->lock);
+	
+	// a merge moved all buffered quads into the indexes
+	if (scan->generation != instance->generation) {
+		free(scan->delta);
+		scan->delta = NULL;
+		scan->deltaCount = 0;
+		scan->deltaPosition = 0;
+		RedlandCompactScanSeek(scan);
+	}
+	
+	RedlandCompactQuadArray *index = &instance->indexes[scan->order];
+	BOOL filter = (instance->removedCount > 0);
+	uint64_t examined = 0;
+	for (;;) {
+		const RedlandCompactQuad *candidate = NULL;
+		while (scan->position < scan->end) {
+			const RedlandCompactQuad *quad = &index->quads[scan->position];
+			examined++;
+			if (RedlandCompactMatches(quad, &scan->pattern) && (!filter || RedlandCompactSetContains(&instance->live, quad))) {
+				candidate = quad;
+				break;
+			}
+			scan->position++;
+		}
+		while (scan->deltaPosition < scan->deltaCount && !RedlandCompactSetContains(&instance->live, &scan->delta[scan->deltaPosition])) {
+			scan->deltaPosition++;
+			examined++;
+		}
+		
+		const RedlandCompactQuad *buffered = (scan->deltaPosition < scan->deltaCount) ? &scan->delta[scan->deltaPosition] : NULL;
+		if (buffered && (!candidate || RedlandCompactCompare(buffered, candidate, scan->order, 4) < 0)) {
+			candidate = buffered;
+			scan->deltaPosition++;
+		}
+		else if (candidate) {
+			scan->position++;
+		}
+		else {
+			scan->finished = YES;
+			break;
+		}
+		
+		BOOL duplicate = (scan->hasCurrent && scan->nodePosition >= 0 && candidate->t[scan->nodePosition] == scan->current.t[scan->nodePosition]);
+		scan->current = *candidate;
+		scan->hasCurrent = YES;
+		if (!duplicate) {
+			break;
+		}
+	}
+	scan->statementIsCurrent = NO;
+	__sync_fetch_and_add(&instance->scannedCount, examined);
+	
+	pthread_rwlock_unlock(&instance->lock);
+}
+
+static void RedlandCompactScanFree(void *context)
+{
+	RedlandCompactScan *scan = context;
+	free(scan->delta);
+	librdf_statement_clear(&scan->statement);
+	free(scan);
+}
+
+/**
+ *  Creates a scan over the quads matching the pattern; with "after" set, the scan starts right behind that quad in index order.
+ */
+static RedlandCompactScan *RedlandCompactScanCreate(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *pattern, const RedlandCompactQuad *after, int nodePosition)
+{
+	RedlandCompactScan *scan = calloc(1, sizeof(RedlandCompactScan));
+	if (!scan) {
+		return NULL;
+	}
+	scan->instance = instance;
+	scan->pattern = *pattern;
+	scan->nodePosition = nodePosition;
+	scan->order = RedlandCompactChooseOrder(pattern, &scan->prefixLength);
+	if (after) {
+		scan->current = *after;
+		scan->hasCurrent = YES;
+	}
+	
+	pthread_rwlock_rdlock(&instance->lock);
+	if (instance->delta.count > 0) {
+		scan->delta = malloc(instance->delta.count * sizeof(RedlandCompactQuad));
+		if (!scan->delta) {
+			pthread_rwlock_unlock(&instance->lock);
+			free(scan);
+			return NULL;
+		}
+		for (size_t i = 0; i < instance->delta.count; i++) {
+			if (RedlandCompactMatches(&instance->delta.quads[i], pattern)) {
+				scan->delta[scan->deltaCount++] = instance->delta.quads[i];
+			}
+		}
+		qsort(scan->delta, scan->deltaCount, sizeof(RedlandCompactQuad), RedlandCompactComparators[scan->order]);
+		__sync_fetch_and_add(&instance->scannedCount, instance->delta.count);
+		while (after && scan->deltaPosition < scan->deltaCount && RedlandCompactCompare(&scan->delta[scan->deltaPosition], after, scan->order, 4) <= 0) {
+			scan->deltaPosition++;
+		}
+	}
+	RedlandCompactScanSeek(scan);
+	pthread_rwlock_unlock(&instance->lock);
+	
+	RedlandCompactScanAdvance(scan);
+	return scan;
+}
+
+static int RedlandCompactScanIsEnd(void *context)
+{
+	return ((RedlandCompactScan *)context)->finished;
+}
+
+static int RedlandCompactScanNext(void *context)
+{
+	RedlandCompactScan *scan = context;
+	if (!scan->finished) {
+		RedlandCompactScanAdvance(scan);
+	}
+	return scan->finished;
+}
+
+static void *RedlandCompactStreamGet(void *context, int flags)
+{
+	RedlandCompactScan *scan = context;
+	if (scan->finished) {
+		return NULL;
+	}
+	
+	void *result = NULL;
+	pthread_rwlock_rdlock(&scan->instance->lock);
+	librdf_node **terms = scan->instance->terms;
+	if (LIBRDF_STREAM_GET_METHOD_GET_OBJECT == flags) {
+		if (!scan->statementIsCurrent) {
+			librdf_statement_clear(&scan->statement);
+			librdf_statement_set_subject(&scan->statement, librdf_new_node_from_node(terms[scan->current.t[0]]));
+			librdf_statement_set_predicate(&scan->statement, librdf_new_node_from_node(terms[scan->current.t[1]]));
+			librdf_statement_set_object(&scan->statement, librdf_new_node_from_node(terms[scan->current.t[2]]));
+			scan->statementIsCurrent = YES;
+		}
+		result = &scan->statement;
+	}
+	else if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags && scan->current.t[3]) {
+		result = terms[scan->current.t[3]];
+	}
+	pthread_rwlock_unlock(&scan->instance->lock);
+	return result;
+}
+
+static void *RedlandCompactIteratorGet(void *context, int flags)
+{
+	RedlandCompactScan *scan = context;
+	if (scan->finished) {
+		return NULL;
+	}
+	
+	void *result = NULL;
+	pthread_rwlock_rdlock(&scan->instance->lock);
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT == flags) {
+		result = scan->instance->terms[scan->current.t[scan->nodePosition]];
+	}
+	else if (LIBRDF_ITERATOR_GET_METHOD_GET_CONTEXT == flags && scan->current.t[3]) {
+		result = scan->instance->terms[scan->current.t[3]];
+	}
+	pthread_rwlock_unlock(&scan->instance->lock);
+	return result;
+}
+
+static librdf_stream *RedlandCompactNewStream(RedlandCompactStorageInstance *instance, librdf_statement *statement, librdf_node *context, const RedlandCompactQuad *after)
+{
+	RedlandCompactQuad pattern;
+	pthread_rwlock_rdlock(&instance->lock);
+	BOOL resolved = RedlandCompactResolvePattern(instance, statement, context, &pattern);
+	pthread_rwlock_unlock(&instance->lock);
+	if (!resolved) {
+		return librdf_new_empty_stream(instance->world);
+	}
+	
+	RedlandCompactScan *scan = RedlandCompactScanCreate(instance, &pattern, after, -1);
+	if (!scan) {
+		return NULL;
+	}
+	librdf_statement_init(instance->world, &scan->statement);
+	librdf_stream *stream = librdf_new_stream(instance->world, scan, &RedlandCompactScanIsEnd, &RedlandCompactScanNext, &RedlandCompactStreamGet, &RedlandCompactScanFree);
+	if (!stream) {
+		RedlandCompactScanFree(scan);
+	}
+	return stream;
+}
+
+static librdf_iterator *RedlandCompactNewIterator(RedlandCompactStorageInstance *instance, librdf_node *subject, librdf_node *predicate, librdf_node *object, int nodePosition)
+{
+	librdf_node *nodes[3] = { subject, predicate, object };
+	RedlandCompactQuad pattern = {{ 0, 0, 0, 0 }};
+	BOOL resolved = YES;
+	pthread_rwlock_rdlock(&instance->lock);
+	for (int i = 0; i < 3 && resolved; i++) {
+		if (nodes[i]) {
+			pattern.t[i] = RedlandCompactLookupTerm(instance, nodes[i]);
+			resolved = (0 != pattern.t[i]);
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	if (!resolved) {
+		return librdf_new_empty_iterator(instance->world);
+	}
+	
+	RedlandCompactScan *scan = RedlandCompactScanCreate(instance, &pattern, NULL, nodePosition);
+	if (!scan) {
+		return NULL;
+	}
+	librdf_iterator *iterator = librdf_new_iterator(instance->world, scan, &RedlandCompactScanIsEnd, &RedlandCompactScanNext, &RedlandCompactIteratorGet, &RedlandCompactScanFree);
+	if (!iterator) {
+		RedlandCompactScanFree(scan);
+	}
+	return iterator;
+}
+
+
+
+#pragma mark - Context Iterator
+typedef struct {
+	RedlandCompactStorageInstance *instance;
+	uint32_t *contexts;
+	size_t count;
+	size_t position;
+} RedlandCompactContextList;
+
+static int RedlandCompactCompareTermIDs(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+static int RedlandCompactContextListIsEnd(void *context)
+{
+	RedlandCompactContextList *list = context;
+	return (list->position >= list->count);
+}
+
+static int RedlandCompactContextListNext(void *context)
+{
+	RedlandCompactContextList *list = context;
+	if (list->position < list->count) {
+		list->position++;
+	}
+	return (list->position >= list->count);
+}
+
+static void *RedlandCompactContextListGet(void *context, int flags)
+{
+	RedlandCompactContextList *list = context;
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT != flags || list->position >= list->count) {
+		return NULL;
+	}
+	pthread_rwlock_rdlock(&list->instance->lock);
+	librdf_node *node = list->instance->terms[list->contexts[list->position]];
+	pthread_rwlock_unlock(&list->instance->lock);
+	return node;
+}
+
+static void RedlandCompactContextListFree(void *context)
+{
+	RedlandCompactContextList *list = context;
+	free(list->contexts);
+	free(list);
+}
+
+
+
+#pragma mark - Storage Module
+static RedlandCompactStorageInstance *RedlandCompactInstance(librdf_storage *storage)
+{
+	return (RedlandCompactStorageInstance *)librdf_storage_get_instance(storage);
+}
+
+static int RedlandCompactInit(librdf_storage *storage, const char *name, librdf_hash *options)
+{
+	if (options) {
+		librdf_free_hash(options);
+	}
+	RedlandCompactStorageInstance *instance = calloc(1, sizeof(RedlandCompactStorageInstance));
+	if (!instance) {
+		return 1;
+	}
+	instance->world = librdf_storage_get_world(storage);
+	instance->termIDs = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	if (!instance->termIDs || 0 != pthread_rwlock_init(&instance->lock, NULL)) {
+		if (instance->termIDs) {
+			CFRelease(instance->termIDs);
+		}
+		free(instance);
+		return 1;
+	}
+	instance->identifier = ((uint64_t)arc4random() << 32) | __sync_add_and_fetch(&RedlandCompactInstanceCounter, 1);
+	librdf_storage_set_instance(storage, instance);
+	
+	pthread_mutex_lock(&RedlandCompactRegistryLock);
+	if (!RedlandCompactRegistry) {
+		RedlandCompactRegistry = CFSetCreateMutable(kCFAllocatorDefault, 0, NULL);
+	}
+	CFSetAddValue(RedlandCompactRegistry, instance);
+	pthread_mutex_unlock(&RedlandCompactRegistryLock);
+	return 0;
+}
+
+static void RedlandCompactTerminate(librdf_storage *storage)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	if (!instance) {
+		return;
+	}
+	pthread_mutex_lock(&RedlandCompactRegistryLock);
+	CFSetRemoveValue(RedlandCompactRegistry, instance);
+	pthread_mutex_unlock(&RedlandCompactRegistryLock);
+	
+	for (uint32_t i = 1; i <= instance->termCount; i++) {
+		librdf_free_node(instance->terms[i]);
+	}
+	free(instance->terms);
+	free(instance->contextCounts);
+	CFRelease(instance->termIDs);
+	for (int order = 0; order < RedlandCompactIndexCount; order++) {
+		free(instance->indexes[order].quads);
+	}
+	free(instance->delta.quads);
+	free(instance->live.slots);
+	pthread_rwlock_destroy(&instance->lock);
+	free(instance);
+	librdf_storage_set_instance(storage, NULL);
+}
+
+static int RedlandCompactOpen(librdf_storage *storage, librdf_model *model)
+{
+	return 0;
+}
+
+static int RedlandCompactClose(librdf_storage *storage)
+{
+	return 0;
+}
+
+static int RedlandCompactSize(librdf_storage *storage)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	pthread_rwlock_rdlock(&instance->lock);
+	size_t count = instance->live.count;
+	pthread_rwlock_unlock(&instance->lock);
+	return (count > INT_MAX) ? -1 : (int)count;
+}
+
+static int RedlandCompactContextAddStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	if (!librdf_statement_is_complete(statement)) {
+		return 1;
+	}
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	int result = 1;
+	pthread_rwlock_wrlock(&instance->lock);
+	RedlandCompactQuad quad = {{
+		RedlandCompactInternTerm(instance, librdf_statement_get_subject(statement)),
+		RedlandCompactInternTerm(instance, librdf_statement_get_predicate(statement)),
+		RedlandCompactInternTerm(instance, librdf_statement_get_object(statement)),
+		context ? RedlandCompactInternTerm(instance, context) : 0
+	}};
+	if (quad.t[0] && quad.t[1] && quad.t[2] && (quad.t[3] || !context)) {
+		result = RedlandCompactAddQuad(instance, &quad);
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return result;
+}
+
+static int RedlandCompactAddStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandCompactContextAddStatement(storage, NULL, statement);
+}
+
+static int RedlandCompactContextRemoveStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	if (!librdf_statement_is_complete(statement)) {
+		return 1;
+	}
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad quad;
+	pthread_rwlock_wrlock(&instance->lock);
+	if (RedlandCompactResolvePattern(instance, statement, context, &quad)) {
+		RedlandCompactRemoveQuad(instance, &quad);
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return 0;
+}
+
+static int RedlandCompactRemoveStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandCompactContextRemoveStatement(storage, NULL, statement);
+}
+
+static int RedlandCompactContextRemoveStatements(librdf_storage *storage, librdf_node *context)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad pattern;
+	RedlandCompactQuadArray matches = { NULL, 0, 0 };
+	int result = 0;
+	pthread_rwlock_wrlock(&instance->lock);
+	if (context && RedlandCompactResolvePattern(instance, NULL, context, &pattern)) {
+		if (RedlandCompactCollect(instance, &pattern, &matches)) {
+			for (size_t i = 0; i < matches.count; i++) {
+				RedlandCompactRemoveQuad(instance, &matches.quads[i]);
+			}
+		}
+		else {
+			result = 1;
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	free(matches.quads);
+	return result;
+}
+
+static int RedlandCompactContainsStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad pattern;
+	pthread_rwlock_rdlock(&instance->lock);
+	BOOL contains = (RedlandCompactResolvePattern(instance, statement, NULL, &pattern) && RedlandCompactContainsPattern(instance, &pattern));
+	pthread_rwlock_unlock(&instance->lock);
+	return contains ? 1 : 0;
+}
+
+static int RedlandCompactHasArc(librdf_storage *storage, librdf_node *subject, librdf_node *predicate, librdf_node *object)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	pthread_rwlock_rdlock(&instance->lock);
+	RedlandCompactQuad pattern = {{
+		RedlandCompactLookupTerm(instance, subject),
+		RedlandCompactLookupTerm(instance, predicate),
+		RedlandCompactLookupTerm(instance, object),
+		0
+	}};
+	BOOL resolved = ((pattern.t[0] || !subject) && (pattern.t[1] || !predicate) && (pattern.t[2] || !object));
+	BOOL contains = (resolved && RedlandCompactContainsPattern(instance, &pattern));
+	pthread_rwlock_unlock(&instance->lock);
+	return contains ? 1 : 0;
+}
+
+static int RedlandCompactHasArcIn(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	return RedlandCompactHasArc(storage, NULL, property, node);
+}
+
+static int RedlandCompactHasArcOut(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	return RedlandCompactHasArc(storage, node, property, NULL);
+}
+
+static librdf_stream *RedlandCompactSerialise(librdf_storage *storage)
+{
+	return RedlandCompactNewStream(RedlandCompactInstance(storage), NULL, NULL, NULL);
+}
+
+static librdf_stream *RedlandCompactFindStatements(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandCompactNewStream(RedlandCompactInstance(storage), statement, NULL, NULL);
+}
+
+static librdf_stream *RedlandCompactContextSerialise(librdf_storage *storage, librdf_node *context)
+{
+	return RedlandCompactNewStream(RedlandCompactInstance(storage), NULL, context, NULL);
+}
+
+static librdf_stream *RedlandCompactFindStatementsInContext(librdf_storage *storage, librdf_statement *statement, librdf_node *context)
+{
+	return RedlandCompactNewStream(RedlandCompactInstance(storage), statement, context, NULL);
+}
+
+static librdf_iterator *RedlandCompactFindSources(librdf_storage *storage, librdf_node *arc, librdf_node *target)
+{
+	return RedlandCompactNewIterator(RedlandCompactInstance(storage), NULL, arc, target, 0);
+}
+
+static librdf_iterator *RedlandCompactFindArcs(librdf_storage *storage, librdf_node *source, librdf_node *target)
+{
+	return RedlandCompactNewIterator(RedlandCompactInstance(storage), source, NULL, target, 1);
+}
+
+static librdf_iterator *RedlandCompactFindTargets(librdf_storage *storage, librdf_node *source, librdf_node *arc)
+{
+	return RedlandCompactNewIterator(RedlandCompactInstance(storage), source, arc, NULL, 2);
+}
+
+static librdf_iterator *RedlandCompactGetArcsIn(librdf_storage *storage, librdf_node *node)
+{
+	return RedlandCompactNewIterator(RedlandCompactInstance(storage), NULL, NULL, node, 1);
+}
+
+static librdf_iterator *RedlandCompactGetArcsOut(librdf_storage *storage, librdf_node *node)
+{
+	return RedlandCompactNewIterator(RedlandCompactInstance(storage), node, NULL, NULL, 1);
+}
+
+static librdf_iterator *RedlandCompactGetContexts(librdf_storage *storage)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactContextList *list = calloc(1, sizeof(RedlandCompactContextList));
+	if (!list) {
+		return NULL;
+	}
+	list->instance = instance;
+	
+	pthread_rwlock_rdlock(&instance->lock);
+	RedlandCompactQuadArray *gspo = &instance->indexes[RedlandCompactGSPO];
+	size_t capacity = instance->delta.count + 16;
+	list->contexts = malloc(capacity * sizeof(uint32_t));
+	
+	// the GSPO index groups quads by context; for each context we only need one live quad, then skip to the next context
+	BOOL filter = (instance->removedCount > 0);
+	RedlandCompactQuad key = {{ 0, 0, 0, 1 }};
+	size_t i = RedlandCompactSearch(gspo, &key, RedlandCompactGSPO, 1, NO);
+	while (list->contexts && i < gspo->count) {
+		const RedlandCompactQuad *quad = &gspo->quads[i];
+		if (filter && !RedlandCompactSetContains(&instance->live, quad)) {
+			i++;
+			continue;
+		}
+		if (list->count >= capacity) {
+			capacity *= 2;
+			uint32_t *contexts = realloc(list->contexts, capacity * sizeof(uint32_t));
+			if (!contexts) {
+				free(list->contexts);
+				list->contexts = NULL;
+				break;
+			}
+			list->contexts = contexts;
+		}
+		list->contexts[list->count++] = quad->t[3];
+		i = RedlandCompactSearch(gspo, quad, RedlandCompactGSPO, 1, YES);
+	}
+	for (size_t j = 0; list->contexts && j < instance->delta.count; j++) {
+		uint32_t context = instance->delta.quads[j].t[3];
+		if (context) {
+			if (list->count >= capacity) {
+				capacity *= 2;
+				uint32_t *contexts = realloc(list->contexts, capacity * sizeof(uint32_t));
+				if (!contexts) {
+					free(list->contexts);
+					list->contexts = NULL;
+					break;
+				}
+				list->contexts = contexts;
+			}
+			list->contexts[list->count++] = context;
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	
+	if (!list->contexts) {
+		free(list);
+		return NULL;
+	}
+	
+	// sort and drop duplicates
+	qsort(list->contexts, list->count, sizeof(uint32_t), &RedlandCompactCompareTermIDs);
+	size_t unique = 0;
+	for (size_t j = 0; j < list->count; j++) {
+		if (0 == unique || list->contexts[unique - 1] != list->contexts[j]) {
+			list->contexts[unique++] = list->contexts[j];
+		}
+	}
+	list->count = unique;
+	
+	librdf_iterator *iterator = librdf_new_iterator(instance->world, list, &RedlandCompactContextListIsEnd, &RedlandCompactContextListNext, &RedlandCompactContextListGet, &RedlandCompactContextListFree);
+	if (!iterator) {
+		RedlandCompactContextListFree(list);
+	}
+	return iterator;
+}
+
+static int RedlandCompactSync(librdf_storage *storage)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	pthread_rwlock_wrlock(&instance->lock);
+	int result = RedlandCompactMerge(instance) ? 0 : 1;
+	pthread_rwlock_unlock(&instance->lock);
+	return result;
+}
+
+static void RedlandCompactStorageFactory(librdf_storage_factory *factory)
+{
+	factory->version = LIBRDF_STORAGE_INTERFACE_VERSION;
+	factory->init = &RedlandCompactInit;
+	factory->terminate = &RedlandCompactTerminate;
+	factory->open = &RedlandCompactOpen;
+	factory->close = &RedlandCompactClose;
+	factory->size = &RedlandCompactSize;
+	factory->add_statement = &RedlandCompactAddStatement;
+	factory->remove_statement = &RedlandCompactRemoveStatement;
+	factory->contains_statement = &RedlandCompactContainsStatement;
+	factory->has_arc_in = &RedlandCompactHasArcIn;
+	factory->has_arc_out = &RedlandCompactHasArcOut;
+	factory->serialise = &RedlandCompactSerialise;
+	factory->find_statements = &RedlandCompactFindStatements;
+	factory->find_sources = &RedlandCompactFindSources;
+	factory->find_arcs = &RedlandCompactFindArcs;
+	factory->find_targets = &RedlandCompactFindTargets;
+	factory->get_arcs_in = &RedlandCompactGetArcsIn;
+	factory->get_arcs_out = &RedlandCompactGetArcsOut;
+	factory->context_add_statement = &RedlandCompactContextAddStatement;
+	factory->context_remove_statement = &RedlandCompactContextRemoveStatement;
+	factory->context_remove_statements = &RedlandCompactContextRemoveStatements;
+	factory->context_serialise = &RedlandCompactContextSerialise;
+	factory->find_statements_in_context = &RedlandCompactFindStatementsInContext;
+	factory->get_contexts = &RedlandCompactGetContexts;
+	factory->sync = &RedlandCompactSync;
+}
+
+
+
+#pragma mark - Public Functions
+/**
+ *  Registers the compact storage factory with the given world. The default world does this when it is created.
+ */
+void RedlandCompactStorageRegisterFactory(librdf_world *world)
+{
+	librdf_storage_register_factory(world, [RedlandCompactStorageFactoryName UTF8String], "Dictionary-encoded compact in-memory storage", &RedlandCompactStorageFactory);
+}
+
+/**
+ *  Returns whether the given storage was created by the compact storage factory.
+ */
+BOOL RedlandStorageIsCompact(librdf_storage *storage)
+{
+	if (!storage) {
+		return NO;
+	}
+	void *instance = librdf_storage_get_instance(storage);
+	pthread_mutex_lock(&RedlandCompactRegistryLock);
+	BOOL isCompact = (instance && RedlandCompactRegistry && CFSetContainsValue(RedlandCompactRegistry, instance));
+	pthread_mutex_unlock(&RedlandCompactRegistryLock);
+	return isCompact;
+}
+
+/**
+ *  Counts the statements of a compact storage matching the given statement and context without creating any statements.
+ *
+ *  Patterns that are fully covered by the sort order of one of the indexes are answered by two binary searches. With "estimate" set, all patterns are
+ *  answered that way, which may include statements not matching the positions outside of the index prefix and removed statements that have not yet been
+ *  compacted away.
+ *  @param storage A compact storage
+ *  @param statement The statement to match, NULL nodes act as wildcards; may be NULL to match all statements
+ *  @param context The context to match, may be NULL to match statements in any or no context
+ *  @param estimate Whether an upper bound from the index sizes is good enough
+ */
+NSUInteger RedlandCompactStorageCount(librdf_storage *storage, librdf_statement *statement, librdf_node *context, BOOL estimate)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad pattern;
+	NSUInteger count = 0;
+	pthread_rwlock_rdlock(&instance->lock);
+	if (RedlandCompactResolvePattern(instance, statement, context, &pattern)) {
+		int prefixLength = 0;
+		int order = RedlandCompactChooseOrder(&pattern, &prefixLength);
+		int boundCount = 0;
+		for (int i = 0; i < 4; i++) {
+			boundCount += (pattern.t[i] ? 1 : 0);
+		}
+		
+		// whole contexts are counted as they change
+		if (1 == boundCount && pattern.t[3]) {
+			count = instance->contextCounts[pattern.t[3]];
+		}
+		else {
+			RedlandCompactQuadArray *index = &instance->indexes[order];
+			size_t start = RedlandCompactSearch(index, &pattern, order, prefixLength, NO);
+			size_t end = RedlandCompactSearch(index, &pattern, order, prefixLength, YES);
+			if (estimate || (boundCount == prefixLength && 0 == instance->removedCount)) {
+				count = end - start;
+			}
+			else {
+				BOOL filter = (instance->removedCount > 0);
+				for (size_t i = start; i < end; i++) {
+					const RedlandCompactQuad *quad = &index->quads[i];
+					if (RedlandCompactMatches(quad, &pattern) && (!filter || RedlandCompactSetContains(&instance->live, quad))) {
+						count++;
+					}
+				}
+			}
+			for (size_t i = 0; i < instance->delta.count; i++) {
+				if (RedlandCompactMatches(&instance->delta.quads[i], &pattern)) {
+					count++;
+				}
+			}
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return count;
+}
+
+/**
+ *  Returns the number of quads examined by all scans of a compact storage since it was created.
+ *
+ *  The difference between two readings is the number of statements an operation scanned, including the ones that did not match the pattern.
+ *  @param storage A compact storage
+ */
+uint64_t RedlandCompactStorageScannedCount(librdf_storage *storage)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	return __sync_fetch_and_add(&instance->scannedCount, 0);
+}
+
+/**
+ *  Returns a number identifying a compact storage instance, different for every instance created in any process.
+ *  @param storage A compact storage
+ */
+uint64_t RedlandCompactStorageIdentifier(librdf_storage *storage)
+{
+	return RedlandCompactInstance(storage)->identifier;
+}
+
+/**
+ *  Looks up the position of a statement of a compact storage: the term IDs of its subject, predicate, object and context.
+ *
+ *  Term IDs never change while the storage exists, so a position can be used to resume a scan with RedlandCompactStorageFindStatementsAfter() even
+ *  after the storage was modified.
+ *  @param storage A compact storage
+ *  @param statement A complete statement
+ *  @param context The context of the statement, NULL for none
+ *  @param position Receives the four term IDs
+ *  @return NO if one of the nodes is not known to the storage
+ */
+BOOL RedlandCompactStorageGetPosition(librdf_storage *storage, librdf_statement *statement, librdf_node *context, uint32_t position[4])
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad quad;
+	pthread_rwlock_rdlock(&instance->lock);
+	BOOL resolved = RedlandCompactResolvePattern(instance, statement, context, &quad);
+	pthread_rwlock_unlock(&instance->lock);
+	if (!resolved || !quad.t[0] || !quad.t[1] || !quad.t[2]) {
+		return NO;
+	}
+	memcpy(position, quad.t, sizeof(quad.t));
+	return YES;
+}
+
+/**
+ *  Returns a stream of the statements matching the given statement and context that come after a position, in the order of the index used for the
+ *  pattern.
+ *
+ *  The scan seeks to the position with a binary search, so resuming costs the same no matter how many statements came before. Statements added before
+ *  the position since it was taken are not returned.
+ *  @param storage A compact storage
+ *  @param statement The statement to match, NULL nodes act as wildcards; may be NULL to match all statements
+ *  @param context The context to match, may be NULL to match statements in any or no context
+ *  @param position The position of the last statement already seen (see RedlandCompactStorageGetPosition()), NULL to start at the beginning
+ */
+librdf_stream *RedlandCompactStorageFindStatementsAfter(librdf_storage *storage, librdf_statement *statement, librdf_node *context, const uint32_t position[4])
+{
+	RedlandCompactQuad after;
+	if (position) {
+		memcpy(after.t, position, sizeof(after.t));
+	}
+	return RedlandCompactNewStream(RedlandCompactInstance(storage), statement, context, (position ? &after : NULL));
+}
+
+/**
+ *  Copies the contexts of a compact storage together with the number of statements in each.
+ *
+ *  The counts are kept up to date as statements are added and removed, so this takes time proportional to the number of distinct nodes, not statements.
+ *  @param storage A compact storage
+ *  @param contexts Receives a malloc'ed array of new context nodes; the caller frees the nodes and the array
+ *  @param counts Receives a malloc'ed array with the number of statements of each context; the caller frees it
+ *  @return The number of contexts, 0 on failure
+ */
+size_t RedlandCompactStorageCopyContextCounts(librdf_storage *storage, librdf_node ***contexts, size_t **counts)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	size_t count = 0;
+	*contexts = NULL;
+	*counts = NULL;
+	
+	pthread_rwlock_rdlock(&instance->lock);
+	for (uint32_t i = 1; i <= instance->termCount; i++) {
+		count += (instance->contextCounts[i] > 0) ? 1 : 0;
+	}
+	if (count > 0) {
+		*contexts = malloc(count * sizeof(librdf_node *));
+		*counts = malloc(count * sizeof(size_t));
+		if (*contexts && *counts) {
+			size_t n = 0;
+			for (uint32_t i = 1; i <= instance->termCount; i++) {
+				if (instance->contextCounts[i] > 0) {
+					(*contexts)[n] = librdf_new_node_from_node(instance->terms[i]);
+					(*counts)[n] = instance->contextCounts[i];
+					n++;
+				}
+			}
+		}
+		else {
+			free(*contexts);
+			free(*counts);
+			*contexts = NULL;
+			*counts = NULL;
+			count = 0;
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return count;
+}
+
+/**
+ *  Creates new statements for the given quads, expects at least a read lock to be held.
+ */
+static librdf_statement **RedlandCompactNewStatements(RedlandCompactStorageInstance *instance, const RedlandCompactQuad *quads, size_t count)
+{
+	librdf_statement **statements = calloc(MAX(count, 1), sizeof(librdf_statement *));
+	for (size_t i = 0; statements && i < count; i++) {
+		statements[i] = librdf_new_statement_from_nodes(instance->world,
+														librdf_new_node_from_node(instance->terms[quads[i].t[0]]),
+														librdf_new_node_from_node(instance->terms[quads[i].t[1]]),
+														librdf_new_node_from_node(instance->terms[quads[i].t[2]]));
+	}
+	return statements;
+}
+
+/**
+ *  Replaces all statements of one context of a compact storage with the given statements in a single step.
+ *
+ *  The change is made while holding the write lock, so other threads either see the old or the new statements of the context, never an empty or
+ *  partial context. Only the difference is applied: statements in both the old and the new set stay untouched, which makes refreshing a context that
+ *  changed a little much cheaper than removing and adding it again.
+ *  @param storage A compact storage
+ *  @param context The context to replace
+ *  @param statements The complete statements the context should contain
+ *  @param count The number of statements
+ *  @param removed Receives a malloc'ed array of the statements that were removed, may be NULL; the caller frees the statements and the array
+ *  @param removedCount Receives the number of removed statements, may be NULL if removed is
+ *  @param added Receives a malloc'ed array of the statements that were added, may be NULL; the caller frees the statements and the array
+ *  @param addedCount Receives the number of added statements, may be NULL if added is
+ *  @return 0 on success, non-zero on failure in which case the context is left unchanged
+ */
+int RedlandCompactStorageReplaceContext(librdf_storage *storage, librdf_node *context, librdf_statement **statements, size_t count,
+										librdf_statement ***removed, size_t *removedCount, librdf_statement ***added, size_t *addedCount)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuadArray incoming = { NULL, 0, 0 };
+	RedlandCompactQuadArray existing = { NULL, 0, 0 };
+	if (removed) {
+		*removed = NULL;
+		*removedCount = 0;
+	}
+	if (added) {
+		*added = NULL;
+		*addedCount = 0;
+	}
+	if (!context || !RedlandCompactArrayReserve(&incoming, count)) {
+		return 1;
+	}
+	
+	pthread_rwlock_wrlock(&instance->lock);
+	RedlandCompactQuad pattern = {{ 0, 0, 0, RedlandCompactInternTerm(instance, context) }};
+	BOOL success = (0 != pattern.t[3]);
+	for (size_t i = 0; success && i < count; i++) {
+		librdf_statement *statement = statements[i];
+		if (!librdf_statement_is_complete(statement)) {
+			success = NO;
+			break;
+		}
+		RedlandCompactQuad *quad = &incoming.quads[incoming.count++];
+		quad->t[0] = RedlandCompactInternTerm(instance, librdf_statement_get_subject(statement));
+		quad->t[1] = RedlandCompactInternTerm(instance, librdf_statement_get_predicate(statement));
+		quad->t[2] = RedlandCompactInternTerm(instance, librdf_statement_get_object(statement));
+		quad->t[3] = pattern.t[3];
+		success = (quad->t[0] && quad->t[1] && quad->t[2]);
+	}
+	success = success && RedlandCompactCollect(instance, &pattern, &existing);
+	
+	// walk both sets in SPOG order; existing quads not coming in are moved to the front of "existing", new ones to the front of "incoming"
+	size_t removing = 0;
+	size_t adding = 0;
+	if (success) {
+		if (incoming.count > 1) {
+			qsort(incoming.quads, incoming.count, sizeof(RedlandCompactQuad), RedlandCompactCompareSPOG);
+		}
+		if (existing.count > 1) {
+			qsort(existing.quads, existing.count, sizeof(RedlandCompactQuad), RedlandCompactCompareSPOG);
+		}
+		size_t i = 0;
+		size_t j = 0;
+		while (i < existing.count || j < incoming.count) {
+			if (j > 0 && j < incoming.count && 0 == RedlandCompactCompare(&incoming.quads[j], &incoming.quads[j - 1], RedlandCompactSPOG, 4)) {
+				j++;
+				continue;
+			}
+			int comparison = (i >= existing.count) ? 1 : ((j >= incoming.count) ? -1 : RedlandCompactCompare(&existing.quads[i], &incoming.quads[j], RedlandCompactSPOG, 4));
+			if (comparison < 0) {
+				existing.quads[removing++] = existing.quads[i++];
+			}
+			else if (comparison > 0) {
+				incoming.quads[adding++] = incoming.quads[j++];
+			}
+			else {
+				i++;
+				j++;
+			}
+		}
+		
+		for (size_t k = 0; k < removing; k++) {
+			RedlandCompactRemoveQuad(instance, &existing.quads[k]);
+		}
+		size_t k = 0;
+		for (; k < adding && success; k++) {
+			success = (0 == RedlandCompactAddQuad(instance, &incoming.quads[k]));
+		}
+		
+		// out of memory half way, put the old statements back
+		if (!success) {
+			while (k-- > 0) {
+				RedlandCompactRemoveQuad(instance, &incoming.quads[k]);
+			}
+			for (k = 0; k < removing; k++) {
+				RedlandCompactAddQuad(instance, &existing.quads[k]);
+			}
+		}
+		else {
+			if (removed) {
+				*removed = RedlandCompactNewStatements(instance, existing.quads, removing);
+				*removedCount = *removed ? removing : 0;
+			}
+			if (added) {
+				*added = RedlandCompactNewStatements(instance, incoming.quads, adding);
+				*addedCount = *added ? adding : 0;
+			}
+		}
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	
+	free(incoming.quads);
+	free(existing.quads);
+	return success ? 0 : 1;
+}
+
+/**
+ *  Copies the positions of the next statements matching the given statement and context, in the order of the index used for the pattern.
+ *
+ *  No nodes are created or copied, which makes it safe to call this for different storages on different threads at the same time; turn the term IDs
+ *  of a position back into nodes with RedlandCompactStorageGetTerm().
+ *  @param storage A compact storage
+ *  @param statement The statement to match, NULL nodes act as wildcards; may be NULL to match all statements
+ *  @param context The context to match, may be NULL to match statements in any or no context
+ *  @param after The position of the last statement already seen, NULL to start at the beginning
+ *  @param positions Receives up to "limit" positions
+ *  @param limit The maximum number of positions to copy
+ *  @return The number of positions copied; less than limit once there are no more statements
+ */
+size_t RedlandCompactStorageFindPositions(librdf_storage *storage, librdf_statement *statement, librdf_node *context, const uint32_t after[4],
+										  uint32_t positions[][4], size_t limit)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	RedlandCompactQuad pattern;
+	pthread_rwlock_rdlock(&instance->lock);
+	BOOL resolved = RedlandCompactResolvePattern(instance, statement, context, &pattern);
+	pthread_rwlock_unlock(&instance->lock);
+	if (!resolved || 0 == limit) {
+		return 0;
+	}
+	
+	RedlandCompactQuad start;
+	if (after) {
+		memcpy(start.t, after, sizeof(start.t));
+	}
+	RedlandCompactScan *scan = RedlandCompactScanCreate(instance, &pattern, (after ? &start : NULL), -1);
+	if (!scan) {
+		return 0;
+	}
+	size_t count = 0;
+	while (!scan->finished) {
+		memcpy(positions[count++], scan->current.t, sizeof(scan->current.t));
+		if (count >= limit) {
+			break;
+		}
+		RedlandCompactScanAdvance(scan);
+	}
+	RedlandCompactScanFree(scan);
+	return count;
+}
+
+/**
+ *  Returns the node with the given term ID, as found in positions. The node belongs to the storage and stays valid as long as the storage exists.
+ *  @param storage A compact storage
+ *  @param termID A term ID, 0 returns NULL
+ */
+librdf_node *RedlandCompactStorageGetTerm(librdf_storage *storage, uint32_t termID)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	librdf_node *node = NULL;
+	pthread_rwlock_rdlock(&instance->lock);
+	if (termID > 0 && termID <= instance->termCount) {
+		node = instance->terms[termID];
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return node;
+}
+
+/**
+ *  Adds many statements to a compact storage at once.
+ *
+ *  The statements are appended to the delta buffer without merging it into the sorted indexes in between. With "merge" set, the buffer is merged once at
+ *  the end; otherwise that is left to the next sync, which creates no nodes and can thus run for several storages on different threads at the same time.
+ *  @param storage A compact storage
+ *  @param statements The complete statements to add
+ *  @param count The number of statements
+ *  @param context The context to add the statements to, NULL for none
+ *  @param merge Whether to merge the delta buffer before returning
+ *  @return 0 on success, non-zero if a statement was incomplete or memory ran out; the statements before it have been added
+ */
+int RedlandCompactStorageAddStatements(librdf_storage *storage, librdf_statement **statements, size_t count, librdf_node *context, BOOL merge)
+{
+	RedlandCompactStorageInstance *instance = RedlandCompactInstance(storage);
+	int result = 0;
+	pthread_rwlock_wrlock(&instance->lock);
+	uint32_t contextID = context ? RedlandCompactInternTerm(instance, context) : 0;
+	if (context && !contextID) {
+		result = 1;
+	}
+	instance->defersMerges = YES;
+	for (size_t i = 0; 0 == result && i < count; i++) {
+		librdf_statement *statement = statements[i];
+		if (!librdf_statement_is_complete(statement)) {
+			result = 1;
+			break;
+		}
+		RedlandCompactQuad quad = {{
+			RedlandCompactInternTerm(instance, librdf_statement_get_subject(statement)),
+			RedlandCompactInternTerm(instance, librdf_statement_get_predicate(statement)),
+			RedlandCompactInternTerm(instance, librdf_statement_get_object(statement)),
+			contextID
+		}};
+		result = (quad.t[0] && quad.t[1] && quad.t[2]) ? RedlandCompactAddQuad(instance, &quad) : 1;
+	}
+	instance->defersMerges = NO;
+	if (merge && !RedlandCompactMerge(instance)) {
+		result = 1;
+	}
+	pthread_rwlock_unlock(&instance->lock);
+	return result;
+}
@@ -21,14 +21,19 @@
 //  the most recent version, see <http://librdf.org/>.
 //
 
-#import <Cocoa/Cocoa.h>
+#import <Foundation/Foundation.h>
 
 @class RedlandModel, RedlandNode;
 
+/**
+ *  An NSEnumerator subclass to enumerate the members of a container (rdf:Seq, rdf:Bag or rdf:Alt) in the order of their rdf:_n arcs.
+ *
+ *  The members are read with -[RedlandModel contentsOfContainerNode:] when the enumerator is created, so it is not affected by later changes to the
+ *  model.
+ */
 @interface RedlandContainerEnumerator : NSEnumerator {
-    RedlandModel *model;
-    RedlandNode *containerNode;
-    NSEnumerator *arcEnumerator;
+    NSArray *contents;
+    NSUInteger nextIndex;
 }
 
 + (id)enumeratorWithModel:(RedlandModel *)aModel containerNode:(RedlandNode *)containerNode;
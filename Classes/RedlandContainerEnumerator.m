@@ -27,57 +27,34 @@
 #import "RedlandModel-Convenience.h"
 #import "RedlandNode.h"
 
-static int CompareOrdinalNode(id firstNode, id secondNode, void *context)
-{
-    int firstOrdinalValue = [firstNode ordinalValue];
-    int secondOrdinalValue = [firstNode ordinalValue];
-    
-    if (firstOrdinalValue < secondOrdinalValue)
-        return NSOrderedAscending;
-    else if (firstOrdinalValue > secondOrdinalValue)
-        return NSOrderedDescending;
-    else
-        return NSOrderedSame;
-}
-
 @implementation RedlandContainerEnumerator
 
 + (id)enumeratorWithModel:(RedlandModel *)aModel containerNode:(RedlandNode *)aContainerNode
 {
-    return [[[self alloc] initWithModel:aModel containerNode:aContainerNode] autorelease];
+    return [[self alloc] initWithModel:aModel containerNode:aContainerNode];
 }
 
 - (id)initWithModel:(RedlandModel *)aModel containerNode:(RedlandNode *)aContainerNode
 {
-    NSArray *sortedArcs;
-    if (self = [super init]) {
-        model = [aModel retain];
-        containerNode = [aContainerNode retain];
-        sortedArcs = [[model arcsOut:aContainerNode] sortedArrayUsingFunction:&CompareOrdinalNode context:NULL];
-        arcEnumerator = [[sortedArcs objectEnumerator] retain];
+    if ((self = [super init])) {
+        contents = [aModel contentsOfContainerNode:aContainerNode];
     }
     return self;
 }
 
-- (void)dealloc
+- (id)nextObject
 {
-    [model release];
-    [arcEnumerator release];
-    [super dealloc];
+    if (nextIndex < [contents count]) {
+        return [contents objectAtIndex:nextIndex++];
+    }
+    return nil;
 }
 
-- (id)nextObject
+- (NSArray *)allObjects
 {
-    RedlandNode *nextArc;
-    
-    do {
-        nextArc = [arcEnumerator nextObject];
-    } while (nextArc && ([nextArc ordinalValue] == -1));
-    
-    if (nextArc)
-        return [model targetWithSource:containerNode arc:nextArc];
-    else 
-        return nil;
+    NSRange rest = NSMakeRange(nextIndex, [contents count] - nextIndex);
+    nextIndex = [contents count];
+    return [contents subarrayWithRange:rest];
 }
 
 @end
@@ -0,0 +1,66 @@
+//
+//  RedlandDescriptionCache.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandModel, RedlandNode;
+
+
+/**
+ *  A read-through cache of the outgoing arcs of recently used subjects.
+ *
+ *  Assign an instance to RedlandModel's descriptionCache property to have targetWithSource:arc:, node:hasOutgoingArc:, enumeratorOfArcsOut: and
+ *  enumeratorOfTargetsWithSource:arc: answered from memory. On a miss all statements about the subject are fetched with a single find, later lookups
+ *  for the same subject do not touch the storage. The least recently used descriptions are evicted when either the number of subjects or the total
+ *  number of statements exceeds its limit.
+ *
+ *  The model invalidates the description of a subject whenever a statement about it is added or removed through RedlandModel, RedlandParser or the
+ *  model categories; bulk changes invalidate the whole cache. Changes made to the librdf model directly must be followed by removeAllDescriptions.
+ *  All methods are thread safe.
+ */
+@interface RedlandDescriptionCache : NSObject
+
+@property (nonatomic, assign) NSUInteger countLimit;					///< The maximum number of cached subjects, 0 for no limit
+@property (nonatomic, assign) NSUInteger costLimit;						///< The maximum number of cached statements, 0 for no limit
+
+@property (nonatomic, readonly, assign) NSUInteger count;				///< The number of cached subjects
+@property (nonatomic, readonly, assign) NSUInteger totalCost;			///< The number of cached statements
+@property (nonatomic, readonly, assign) NSUInteger hits;				///< Lookups answered from the cache
+@property (nonatomic, readonly, assign) NSUInteger misses;				///< Lookups that had to fetch a description
+@property (nonatomic, readonly, assign) NSUInteger evictions;			///< Descriptions evicted because of the limits
+@property (nonatomic, readonly, assign) NSUInteger invalidations;		///< Descriptions removed because their subject changed
+@property (nonatomic, readonly, assign) double hitRate;				///< hits / (hits + misses), 0 before the first lookup
+
+- (id)initWithCountLimit:(NSUInteger)countLimit costLimit:(NSUInteger)costLimit;
+
+- (RedlandNode *)targetWithSource:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode inModel:(RedlandModel *)model;
+- (NSArray *)targetsWithSource:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode inModel:(RedlandModel *)model;
+- (NSArray *)arcsOutOfSource:(RedlandNode *)sourceNode inModel:(RedlandModel *)model;
+- (BOOL)source:(RedlandNode *)sourceNode hasArc:(RedlandNode *)arcNode inModel:(RedlandModel *)model;
+
+- (void)removeDescriptionOfSubject:(RedlandNode *)subjectNode;
+- (void)removeAllDescriptions;
+- (void)resetStatistics;
+
+
+@end
@@ -0,0 +1,396 @@
+//
+//  RedlandDescriptionCache.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandDescriptionCache.h"
+#import <pthread.h>
+#import "RedlandModel.h"
+#import "RedlandNode.h"
+#import "RedlandWorld.h"
+#import "RedlandException.h"
+
+/// The outgoing arcs of one subject, linked into the LRU list (most recently used first)
+typedef struct RedlandDescription {
+	librdf_node *subject;
+	librdf_node **pairs;								///< count (arc, target) pairs
+	NSUInteger count;
+	struct RedlandDescription *previous;
+	struct RedlandDescription *next;
+} RedlandDescription;
+
+typedef enum {
+	RedlandDescriptionFirstTarget,
+	RedlandDescriptionAllTargets,
+	RedlandDescriptionArcs,
+	RedlandDescriptionHasArc
+} RedlandDescriptionLookup;
+
+
+static void RedlandDescriptionFree(RedlandDescription *description)
+{
+	for (NSUInteger i = 0; i < 2 * description->count; i++) {
+		librdf_free_node(description->pairs[i]);
+	}
+	free(description->pairs);
+	librdf_free_node(description->subject);
+	free(description);
+}
+
+/**
+ *  Reads all statements about the subject with one find.
+ */
+static RedlandDescription *RedlandDescriptionCreate(librdf_model *model, librdf_node *subject)
+{
+	librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], librdf_new_node_from_node(subject), NULL, NULL);
+	librdf_stream *stream = librdf_model_find_statements(model, pattern);
+	librdf_free_statement(pattern);
+	if (NULL == stream) {
+		return NULL;
+	}
+	
+	RedlandDescription *description = calloc(1, sizeof(RedlandDescription));
+	if (NULL == description) {
+		librdf_free_stream(stream);
+		[NSException raise:NSMallocException format:@"Failed to allocate a subject description"];
+	}
+	NSUInteger capacity = 0;
+	description->subject = librdf_new_node_from_node(subject);
+	while (!librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		if (description->count >= capacity) {
+			capacity = capacity ? 2 * capacity : 8;
+			librdf_node **pairs = realloc(description->pairs, 2 * capacity * sizeof(librdf_node *));
+			if (NULL == pairs) {
+				librdf_free_stream(stream);
+				RedlandDescriptionFree(description);		// still owns the old pairs
+				[NSException raise:NSMallocException format:@"Failed to grow a subject description to %lu arcs", (unsigned long)capacity];
+			}
+			description->pairs = pairs;
+		}
+		description->pairs[2 * description->count] = librdf_new_node_from_node(librdf_statement_get_predicate(statement));
+		description->pairs[2 * description->count + 1] = librdf_new_node_from_node(librdf_statement_get_object(statement));
+		description->count++;
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+	return description;
+}
+
+
+@interface RedlandDescriptionCache () {
+	pthread_mutex_t lock;
+	CFMutableDictionaryRef descriptions;				///< subject librdf_node -> RedlandDescription
+	RedlandDescription *mostRecent;
+	RedlandDescription *leastRecent;
+	NSUInteger generation;								///< Incremented on every invalidation, fetched descriptions are only stored if it did not change
+}
+
+@end
+
+
+@implementation RedlandDescriptionCache
+
+
+- (id)init
+{
+	return [self initWithCountLimit:1024 costLimit:0];
+}
+
+/**
+ *  Designated initializer.
+ *  @param countLimit The maximum number of cached subjects, 0 for no limit
+ *  @param costLimit The maximum number of cached statements, 0 for no limit
+ */
+- (id)initWithCountLimit:(NSUInteger)countLimit costLimit:(NSUInteger)costLimit
+{
+	if ((self = [super init])) {
+		pthread_mutex_init(&lock, NULL);
+		descriptions = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+		_countLimit = countLimit;
+		_costLimit = costLimit;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self removeAllDescriptions];
+	CFRelease(descriptions);
+	pthread_mutex_destroy(&lock);
+}
+
+
+
+#pragma mark - LRU List
+- (void)unlinkDescription:(RedlandDescription *)description
+{
+	if (description->previous) {
+		description->previous->next = description->next;
+	}
+	else {
+		mostRecent = description->next;
+	}
+	if (description->next) {
+		description->next->previous = description->previous;
+	}
+	else {
+		leastRecent = description->previous;
+	}
+	description->previous = description->next = NULL;
+}
+
+- (void)linkDescription:(RedlandDescription *)description
+{
+	description->next = mostRecent;
+	if (mostRecent) {
+		mostRecent->previous = description;
+	}
+	mostRecent = description;
+	if (NULL == leastRecent) {
+		leastRecent = description;
+	}
+}
+
+- (void)discardDescription:(RedlandDescription *)description
+{
+	[self unlinkDescription:description];
+	CFDictionaryRemoveValue(descriptions, description->subject);
+	_count--;
+	_totalCost -= description->count;
+	RedlandDescriptionFree(description);
+}
+
+/**
+ *  Evicts the least recently used descriptions until the limits are met. Must be called with the lock held.
+ */
+- (void)trim
+{
+	while (leastRecent && ((_countLimit > 0 && _count > _countLimit) || (_costLimit > 0 && _totalCost > _costLimit))) {
+		[self discardDescription:leastRecent];
+		_evictions++;
+	}
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit
+{
+	pthread_mutex_lock(&lock);
+	_countLimit = countLimit;
+	[self trim];
+	pthread_mutex_unlock(&lock);
+}
+
+- (void)setCostLimit:(NSUInteger)costLimit
+{
+	pthread_mutex_lock(&lock);
+	_costLimit = costLimit;
+	[self trim];
+	pthread_mutex_unlock(&lock);
+}
+
+
+
+#pragma mark - Lookup
+/**
+ *  Answers a lookup from the cached description of the subject, fetching and caching the description first on a miss.
+ */
+- (id)lookup:(RedlandDescriptionLookup)lookup source:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode inModel:(RedlandModel *)model
+{
+	NSParameterAssert(sourceNode != nil);
+	NSParameterAssert(model != nil);
+	librdf_node *subject = [sourceNode wrappedNode];
+	librdf_node *arc = [arcNode wrappedNode];
+	
+	pthread_mutex_lock(&lock);
+	RedlandDescription *description = (RedlandDescription *)CFDictionaryGetValue(descriptions, subject);
+	RedlandDescription *uncached = NULL;
+	if (description) {
+		_hits++;
+		[self unlinkDescription:description];
+		[self linkDescription:description];
+	}
+	else {
+		_misses++;
+		NSUInteger fetchGeneration = generation;
+		pthread_mutex_unlock(&lock);
+		
+		description = RedlandDescriptionCreate([model wrappedModel], subject);
+		if (NULL == description) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"Failed to create a stream to describe a subject"
+											  userInfo:@{ @"subject": sourceNode }];
+		}
+		
+		pthread_mutex_lock(&lock);
+		RedlandDescription *existing = (RedlandDescription *)CFDictionaryGetValue(descriptions, subject);
+		BOOL fits = (0 == _costLimit || description->count <= _costLimit);
+		if (fetchGeneration == generation && NULL == existing && fits) {
+			CFDictionaryAddValue(descriptions, description->subject, description);
+			[self linkDescription:description];
+			_count++;
+			_totalCost += description->count;
+			[self trim];
+		}
+		else {
+			uncached = description;			// the subject changed while it was being fetched, or the description is too large
+		}
+	}
+	
+	id result = nil;
+	switch (lookup) {
+		case RedlandDescriptionFirstTarget:
+			for (NSUInteger i = 0; i < description->count && !result; i++) {
+				if (librdf_node_equals(description->pairs[2 * i], arc)) {
+					result = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(description->pairs[2 * i + 1])];
+				}
+			}
+			break;
+		case RedlandDescriptionAllTargets:
+		case RedlandDescriptionArcs: {
+			BOOL arcs = (RedlandDescriptionArcs == lookup);
+			NSMutableOrderedSet *nodes = [NSMutableOrderedSet orderedSet];
+			for (NSUInteger i = 0; i < description->count; i++) {
+				if (arcs || librdf_node_equals(description->pairs[2 * i], arc)) {
+					librdf_node *node = description->pairs[arcs ? 2 * i : 2 * i + 1];
+					[nodes addObject:[[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(node)]];
+				}
+			}
+			result = [nodes array];
+			break;
+		}
+		case RedlandDescriptionHasArc:
+			result = @NO;
+			for (NSUInteger i = 0; i < description->count; i++) {
+				if (librdf_node_equals(description->pairs[2 * i], arc)) {
+					result = @YES;
+					break;
+				}
+			}
+			break;
+	}
+	pthread_mutex_unlock(&lock);
+	
+	if (uncached) {
+		RedlandDescriptionFree(uncached);
+	}
+	return result;
+}
+
+/**
+ *  Returns one target of the given source and arc, like -[RedlandModel targetWithSource:arc:].
+ */
+- (RedlandNode *)targetWithSource:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode inModel:(RedlandModel *)model
+{
+	NSParameterAssert(arcNode != nil);
+	return [self lookup:RedlandDescriptionFirstTarget source:sourceNode arc:arcNode inModel:model];
+}
+
+/**
+ *  Returns the distinct targets of the given source and arc.
+ */
+- (NSArray *)targetsWithSource:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode inModel:(RedlandModel *)model
+{
+	NSParameterAssert(arcNode != nil);
+	return [self lookup:RedlandDescriptionAllTargets source:sourceNode arc:arcNode inModel:model];
+}
+
+/**
+ *  Returns the distinct arcs going out of the given source.
+ */
+- (NSArray *)arcsOutOfSource:(RedlandNode *)sourceNode inModel:(RedlandModel *)model
+{
+	return [self lookup:RedlandDescriptionArcs source:sourceNode arc:nil inModel:model];
+}
+
+/**
+ *  Returns YES if the given source has at least one outgoing arc arcNode, like -[RedlandModel node:hasOutgoingArc:].
+ */
+- (BOOL)source:(RedlandNode *)sourceNode hasArc:(RedlandNode *)arcNode inModel:(RedlandModel *)model
+{
+	NSParameterAssert(arcNode != nil);
+	return [[self lookup:RedlandDescriptionHasArc source:sourceNode arc:arcNode inModel:model] boolValue];
+}
+
+
+
+#pragma mark - Invalidation
+/**
+ *  Removes the cached description of the given subject, if there is one.
+ */
+- (void)removeDescriptionOfSubject:(RedlandNode *)subjectNode
+{
+	if (nil == subjectNode) {
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	generation++;
+	RedlandDescription *description = (RedlandDescription *)CFDictionaryGetValue(descriptions, [subjectNode wrappedNode]);
+	if (description) {
+		[self discardDescription:description];
+		_invalidations++;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ *  Removes all cached descriptions.
+ */
+- (void)removeAllDescriptions
+{
+	pthread_mutex_lock(&lock);
+	generation++;
+	while (mostRecent) {
+		[self discardDescription:mostRecent];
+		_invalidations++;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+
+#pragma mark - Statistics
+- (double)hitRate
+{
+	pthread_mutex_lock(&lock);
+	NSUInteger lookups = _hits + _misses;
+	double rate = (lookups > 0) ? (double)_hits / (double)lookups : 0.0;
+	pthread_mutex_unlock(&lock);
+	return rate;
+}
+
+/**
+ *  Sets the hit, miss, eviction and invalidation counters back to zero.
+ */
+- (void)resetStatistics
+{
+	pthread_mutex_lock(&lock);
+	_hits = _misses = _evictions = _invalidations = 0;
+	pthread_mutex_unlock(&lock);
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p> %lu subjects, %lu statements, hit rate %.2f", NSStringFromClass([self class]), self,
+			(unsigned long)_count, (unsigned long)_totalCost, [self hitRate]];
+}
+
+
+@end
@@ -27,6 +27,7 @@
 
 extern NSString * const RedlandExceptionName;				///< The name of a RedlandException
 extern NSString * const RedlandErrorDomain;					///< The error domain of Redland errors
+extern NSString * const RedlandCancellationExceptionName;	///< The name of exceptions raised when an operation was cancelled or ran past its deadline
 
 
 /** 
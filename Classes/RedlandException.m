@@ -26,6 +26,7 @@
 
 NSString * const RedlandExceptionName = @"RedlandExceptionName";
 NSString * const RedlandErrorDomain = @"RedlandErrorDomain";
+NSString * const RedlandCancellationExceptionName = @"RedlandCancellationExceptionName";
 
 @implementation RedlandException
 
@@ -28,7 +28,10 @@
 
 
 /**
- *  An NSEnumerator subclass to enable fast enumeration over a Redland iterator
+ *  An NSEnumerator subclass to enable fast enumeration over a Redland iterator.
+ *
+ *  Fast enumeration pulls objects from the underlying librdf_iterator in batches; allObjects and getWrappedObjects:maxCount: drain the iterator in one
+ *  call.
  */
 @interface RedlandIteratorEnumerator : NSEnumerator {
     Class objectClass;
@@ -38,5 +41,7 @@
 
 - (id)initWithRedlandIterator:(RedlandIterator *)anIterator objectClass:(Class)objectClass;
 
+- (NSUInteger)getWrappedObjects:(void **)buffer maxCount:(NSUInteger)maxCount;
+
 
 @end
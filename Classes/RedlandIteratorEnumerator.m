@@ -28,13 +28,35 @@
 #import "RedlandNode.h"
 #import "RedlandURI.h"
 
+typedef void *(*RedlandIteratorEnumeratorCopyFunction)(void *object);
+
+static void *RedlandIteratorEnumeratorCopyNode(void *object)
+{
+	return librdf_new_node_from_node(object);
+}
+
+static void *RedlandIteratorEnumeratorCopyURI(void *object)
+{
+	return librdf_new_uri_from_uri(object);
+}
+
+
+@interface RedlandIteratorEnumerator () {
+	librdf_iterator *wrappedIterator;
+	RedlandIteratorEnumeratorCopyFunction copyFunction;		///< Copies the objects of the iterator, resolved from the object class at init time
+	NSMutableArray *batch;									///< Keeps the objects handed out by fast enumeration alive
+}
+
+@end
+
+
 @implementation RedlandIteratorEnumerator
 
 
 /**
  *  Desginated initializer.
  *  @param anIterator The iterator to enumerate over
- *  @param aClass The class of the objects we should be iterating over
+ *  @param aClass The class of the objects we should be iterating over, a subclass of RedlandNode or RedlandURI
  */
 - (id)initWithRedlandIterator:(RedlandIterator *)anIterator objectClass:(Class)aClass
 {
@@ -42,37 +64,108 @@
     NSParameterAssert(anIterator != nil);
     if ((self = [super init])) {
         iterator = anIterator;
+        wrappedIterator = [anIterator wrappedIterator];
         firstIteration = YES;
         objectClass = aClass;
+		
+		if ([objectClass isSubclassOfClass:[RedlandNode class]]) {
+			copyFunction = &RedlandIteratorEnumeratorCopyNode;
+		}
+		else if ([objectClass isSubclassOfClass:[RedlandURI class]]) {
+			copyFunction = &RedlandIteratorEnumeratorCopyURI;
+		}
+		else {
+			@throw [NSException exceptionWithName:NSInternalInconsistencyException
+										   reason:[NSString stringWithFormat:@"Inhandled object class %@ in RedlandIteratorEnumerator", objectClass]
+										 userInfo:nil];
+		}
     }
     return self;
 }
 
 
+#pragma mark - Enumeration
+/**
+ *  Advances the iterator and returns its current object, which is owned by the iterator, or NULL at the end.
+ */
+- (void *)nextIteratorObject
+{
+	if (!firstIteration) {
+		librdf_iterator_next(wrappedIterator);
+	}
+	else {
+		firstIteration = NO;
+	}
+	return librdf_iterator_get_object(wrappedIterator);
+}
+
 - (id)nextObject
 {
-    if (!firstIteration)
-        [iterator next];
-    else 
-        firstIteration = NO;
-    
-    void *object = [iterator object];
-    
-    if ([objectClass isSubclassOfClass:[RedlandNode class]]) {
-		if (object)
-			object = librdf_new_node_from_node(object);
-        return [[objectClass alloc] initWithWrappedObject:object];
-    }
-    else if ([objectClass isSubclassOfClass:[RedlandURI class]]) {
-		if (object)
-			object = librdf_new_uri_from_uri(object);
-        return [[objectClass alloc] initWithWrappedObject:object];
-    }
-    else {
-        @throw [NSException exceptionWithName:NSInternalInconsistencyException
-                                       reason:[NSString stringWithFormat:@"Inhandled object class %@ in RedlandIteratorEnumerator", objectClass]
-                                     userInfo:nil];
-    }
+	void *object = [self nextIteratorObject];
+	if (NULL == object) {
+		return nil;
+	}
+	return [[objectClass alloc] initWithWrappedObject:copyFunction(object)];
+}
+
+/**
+ *  Returns all remaining objects, draining the iterator.
+ */
+- (NSArray *)allObjects
+{
+	NSMutableArray *objects = [NSMutableArray array];
+	void *object;
+	while ((object = [self nextIteratorObject])) {
+		id wrapper = [[objectClass alloc] initWithWrappedObject:copyFunction(object)];
+		if (wrapper) {
+			[objects addObject:wrapper];
+		}
+	}
+	return objects;
+}
+
+/**
+ *  Copies up to maxCount of the remaining librdf objects (librdf_node or librdf_uri, depending on the object class) into the buffer without creating any
+ *  Objective-C objects. The caller owns the copies and must free them with librdf_free_node() or librdf_free_uri().
+ *  @param buffer A buffer with room for at least maxCount pointers
+ *  @param maxCount The maximum number of objects to copy
+ *  @return The number of objects copied; less than maxCount only if the iterator has been drained
+ */
+- (NSUInteger)getWrappedObjects:(void **)buffer maxCount:(NSUInteger)maxCount
+{
+	NSUInteger count = 0;
+	void *object;
+	while (count < maxCount && (object = [self nextIteratorObject])) {
+		void *copy = copyFunction(object);
+		if (copy) {
+			buffer[count++] = copy;
+		}
+	}
+	return count;
+}
+
+/**
+ *  Fast enumeration, wrapping as many objects per call as the caller provides room for.
+ */
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])stackbuf count:(NSUInteger)len
+{
+	if (0 == state->state) {
+		state->state = 1;
+		state->mutationsPtr = &state->extra[0];			// the iterator can not be mutated through the receiver
+		batch = [[NSMutableArray alloc] initWithCapacity:len];
+	}
+	
+	[batch removeAllObjects];
+	void *object;
+	while ([batch count] < len && (object = [self nextIteratorObject])) {
+		id wrapper = [[objectClass alloc] initWithWrappedObject:copyFunction(object)];
+		if (wrapper) {
+			stackbuf[[batch count]] = wrapper;
+			[batch addObject:wrapper];
+		}
+	}
+	state->itemsPtr = stackbuf;
+	return [batch count];
 }
 
 @end
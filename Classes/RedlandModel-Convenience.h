@@ -27,6 +27,13 @@
 
 @class RedlandNode, RedlandStatement, RedlandStreamEnumerator;
 
+/// Options for enumerateStatementsLike:context:options:usingBlock:
+typedef enum _RedlandEnumerationOptions {
+	RedlandEnumerationConcurrent = 1 << 0				///< Invoke the block concurrently on partitions of a snapshot of the matching statements
+} RedlandEnumerationOptions;
+
+typedef void (^RedlandStatementEnumerationBlock)(RedlandStatement *statement, RedlandNode *context, BOOL *stop);
+
 
 @interface RedlandModel (Convenience)
 
@@ -53,5 +60,21 @@
 
 - (NSEnumerator *)contextEnumerator;
 
+- (NSDictionary *)targetsForSources:(NSArray *)sourceNodes arcs:(NSArray *)arcNodes;
+- (NSDictionary *)targetsForSources:(NSArray *)sourceNodes arcs:(NSArray *)arcNodes context:(RedlandNode *)contextNode;
+- (NSDictionary *)sourcesForTargets:(NSArray *)targetNodes arcs:(NSArray *)arcNodes;
+- (NSDictionary *)sourcesForTargets:(NSArray *)targetNodes arcs:(NSArray *)arcNodes context:(RedlandNode *)contextNode;
+
+- (void)enumerateStatementsLike:(RedlandStatement *)aStatement context:(RedlandNode *)contextNode options:(RedlandEnumerationOptions)options usingBlock:(RedlandStatementEnumerationBlock)block;
+
+- (NSArray *)contentsOfCollectionNode:(RedlandNode *)collectionNode;
+- (NSArray *)contentsOfCollectionNode:(RedlandNode *)collectionNode context:(RedlandNode *)contextNode;
+- (NSEnumerator *)enumeratorOfCollectionNode:(RedlandNode *)collectionNode;
+- (void)addCollectionNode:(RedlandNode *)collectionNode withContents:(NSArray *)nodeArray;
+- (void)addCollectionNode:(RedlandNode *)collectionNode withContents:(NSArray *)nodeArray context:(RedlandNode *)contextNode;
+
+- (NSArray *)contentsOfContainerNode:(RedlandNode *)containerNode;
+- (NSEnumerator *)enumeratorOfContainerNode:(RedlandNode *)containerNode;
+
 
 @end
@@ -32,6 +32,18 @@
 #import "RedlandStatement.h"
 #import "RedlandSerializer.h"
 #import "RedlandNamespace.h"
+#import "RedlandStream.h"
+#import "RedlandStorage.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandDescriptionCache.h"
+#import "RedlandWorld.h"
+#import "RedlandException.h"
+#import "RedlandCollectionEnumerator.h"
+#import "RedlandContainerEnumerator.h"
+
+#define REDLAND_ENUMERATION_POOL_INTERVAL 256			// number of block invocations between draining the autorelease pool
+#define REDLAND_BATCH_SCAN_RATIO 4						// an arc is scanned once if it has at most this many statements per requested node
+
 
 @implementation RedlandModel (Convenience)
 
@@ -157,6 +169,9 @@
  */
 - (NSEnumerator *)enumeratorOfTargetsWithSource:(RedlandNode *)sourceNode arc:(RedlandNode *)arcNode
 {
+    if ([self descriptionCache]) {
+        return [[[self descriptionCache] targetsWithSource:sourceNode arc:arcNode inModel:self] objectEnumerator];
+    }
     RedlandIterator *iterator = [self iteratorOfTargetsWithSource:sourceNode arc:arcNode];
     return [[RedlandIteratorEnumerator alloc] initWithRedlandIterator:iterator objectClass:[RedlandNode class]];
 }
@@ -209,6 +224,9 @@
  */
 - (NSEnumerator *)enumeratorOfArcsOut:(RedlandNode *)sourceNode
 {
+    if ([self descriptionCache]) {
+        return [[[self descriptionCache] arcsOutOfSource:sourceNode inModel:self] objectEnumerator];
+    }
     RedlandIterator *iterator = [self iteratorOfArcsOut:sourceNode];
     return [[RedlandIteratorEnumerator alloc] initWithRedlandIterator:iterator objectClass:[RedlandNode class]];
 }
@@ -243,80 +261,584 @@
     return [[RedlandStreamEnumerator alloc] initWithRedlandStream:[self streamOfAllStatementsWithContext:contextNode]];
 }
 
-//#pragma mark Collections and Containers
-//
-//- (NSArray *)itemsInContainerNode:(RedlandNode *)subjectNode
-//{
-//    NSParameterAssert(subjectNode != nil);
-//    
-//    NSEnumerator *statementEnum;
-//    RedlandStatement *curStatement;
-//    RedlandStatement *testStatement = [RedlandStatement statementWithSubject:subjectNode
-//                                                                   predicate:nil
-//                                                                      object:nil];
-//    NSMutableArray *results = [NSMutableArray array];
-//    
-//    statementEnum = [self enumeratorOfStatementsLike:testStatement];
-//    while (curStatement = [statementEnum nextObject]) {
-//        if ([[curStatement predicate] ordinalValue] >= 0)
-//            [results addObject:[curStatement object]];
-//    }
-//    
-//    return [NSArray arrayWithArray:results];
-//}
-//
-//- (NSEnumerator *)enumeratorOfCollectionNode:(RedlandNode *)collectionNode
-//{
-//    return [RedlandCollectionEnumerator enumeratorWithModel:self collectionNode:collectionNode];
-//}
-//
-//- (NSArray *)contentsOfCollectionNode:(RedlandNode *)collectionNode
-//{
-//    return [[self enumeratorOfCollectionNode:collectionNode] allObjects];
-//}
-//
-//- (NSEnumerator *)enumeratorOfContainerNode:(RedlandNode *)containerNode
-//{
-//    return [RedlandContainerEnumerator enumeratorWithModel:self containerNode:containerNode];
-//}
-//
-//- (NSArray *)contentsOfContainerNode:(RedlandNode *)containerNode
-//{
-//    return [[self enumeratorOfContainerNode:containerNode] allObjects];
-//}
-//
-//- (void)addCollectionNode:(RedlandNode *)collectionNode withContents:(NSArray *)nodeArray
-//{
-//    NSEnumerator *nodeEnumerator = [nodeArray objectEnumerator];
-//    RedlandNode *currentNode, *nextCollectionNode;
-//    BOOL first = YES;
-//    static RedlandNode *RDFFirstNode = nil;
-//    static RedlandNode *RDFRestNode = nil;
-//    static RedlandNode *RDFNilNode = nil;
-//    
-//    if (!RDFFirstNode)
-//        RDFFirstNode = [[RDFSyntaxNS node:@"first"] retain];
-//    if (!RDFRestNode)
-//        RDFRestNode = [[RDFSyntaxNS node:@"rest"] retain];
-//    if (!RDFNilNode)
-//        RDFNilNode = [[RDFSyntaxNS node:@"nil"] retain];
-//    
-//    while (currentNode = [nodeEnumerator nextObject]) {
-//        if (!first) {
-//            nextCollectionNode = [RedlandNode nodeWithBlankID:nil];
-//            [self addStatement:[RedlandStatement statementWithSubject:collectionNode
-//                                                            predicate:RDFRestNode
-//                                                               object:nextCollectionNode]];
-//            collectionNode = nextCollectionNode;
-//        } 
-//        else first = NO;
-//        [self addStatement:[RedlandStatement statementWithSubject:collectionNode
-//                                                        predicate:RDFFirstNode
-//                                                           object:currentNode]];
-//    }
-//    [self addStatement:[RedlandStatement statementWithSubject:collectionNode
-//                                                    predicate:RDFRestNode
-//                                                       object:RDFNilNode]];
-//}
+
+
+#pragma mark - Batched Lookups
+/**
+ *  Adds the node found for the given lookup node and arc to the results, skipping lookup nodes and arcs that were not asked for.
+ */
+static void RedlandConvenienceBatchAdd(CFDictionaryRef nodeResults, CFDictionaryRef arcs, librdf_node *lookupNode, librdf_node *arc, librdf_node *found)
+{
+	NSMutableDictionary *perArc = (__bridge NSMutableDictionary *)CFDictionaryGetValue(nodeResults, lookupNode);
+	RedlandNode *arcNode = (__bridge RedlandNode *)CFDictionaryGetValue(arcs, arc);
+	if (nil == perArc || nil == arcNode) {
+		return;
+	}
+	NSMutableOrderedSet *nodes = [perArc objectForKey:arcNode];
+	if (nil == nodes) {
+		nodes = [NSMutableOrderedSet orderedSet];
+		[perArc setObject:nodes forKey:arcNode];
+	}
+	[nodes addObject:[[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(found)]];
+}
+
+static void RedlandConvenienceBatchScan(librdf_model *model, librdf_node *context, librdf_node *subject, librdf_node *predicate, librdf_node *object,
+										BOOL inverse, CFDictionaryRef nodeResults, CFDictionaryRef arcs)
+{
+	librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld],
+																subject ? librdf_new_node_from_node(subject) : NULL,
+																predicate ? librdf_new_node_from_node(predicate) : NULL,
+																object ? librdf_new_node_from_node(object) : NULL);
+	librdf_stream *stream = context ? librdf_model_find_statements_in_context(model, pattern, context) : librdf_model_find_statements(model, pattern);
+	librdf_free_statement(pattern);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream for a batched lookup"
+										  userInfo:nil];
+	}
+	while (!librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		librdf_node *from = inverse ? librdf_statement_get_object(statement) : librdf_statement_get_subject(statement);
+		librdf_node *to = inverse ? librdf_statement_get_subject(statement) : librdf_statement_get_object(statement);
+		RedlandConvenienceBatchAdd(nodeResults, arcs, from, librdf_statement_get_predicate(statement), to);
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+}
+
+/**
+ *  Looks up the targets (or, inverse, the sources) of many nodes and arcs at once.
+ *
+ *  Duplicate nodes and arcs are looked up only once. On the compact storage an arc with few statements compared to the number of nodes is read with a
+ *  single scan over the arc; all other arcs are read with one lookup per node, which covers all of these arcs at the same time.
+ */
+static NSDictionary *RedlandConvenienceBatchLookup(RedlandModel *redlandModel, NSArray *nodes, NSArray *arcs, RedlandNode *contextNode, BOOL inverse)
+{
+	NSCParameterAssert(nodes != nil);
+	NSCParameterAssert(arcs != nil);
+	
+	librdf_model *model = [redlandModel wrappedModel];
+	librdf_node *context = [contextNode wrappedNode];
+	NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:[nodes count]];
+	
+	// node -> NSMutableDictionary (retained by results) and arc -> RedlandNode (retained by arcs)
+	CFMutableDictionaryRef nodeResults = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	CFMutableDictionaryRef scannedArcs = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	CFMutableDictionaryRef lookupArcs = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	@try {
+		for (RedlandNode *node in nodes) {
+			if (!CFDictionaryContainsKey(nodeResults, [node wrappedNode])) {
+				NSMutableDictionary *perArc = [NSMutableDictionary dictionary];
+				[results setObject:perArc forKey:node];
+				CFDictionaryAddValue(nodeResults, [node wrappedNode], (__bridge const void *)perArc);
+			}
+		}
+		
+		BOOL compact = RedlandStorageIsCompact(librdf_model_get_storage(model));
+		NSUInteger nodeCount = CFDictionaryGetCount(nodeResults);
+		for (RedlandNode *arc in arcs) {
+			librdf_node *arcNode = [arc wrappedNode];
+			if (CFDictionaryContainsKey(scannedArcs, arcNode) || CFDictionaryContainsKey(lookupArcs, arcNode)) {
+				continue;
+			}
+			RedlandStatement *pattern = [RedlandStatement statementWithSubject:nil predicate:arc object:nil];
+			if (compact && [redlandModel estimatedCountOfStatementsLike:pattern withContext:contextNode] <= nodeCount * REDLAND_BATCH_SCAN_RATIO) {
+				CFDictionaryAddValue(scannedArcs, arcNode, (__bridge const void *)arc);
+			}
+			else {
+				CFDictionaryAddValue(lookupArcs, arcNode, (__bridge const void *)arc);
+			}
+		}
+		
+		// one pass per cheap arc
+		CFIndex scannedCount = CFDictionaryGetCount(scannedArcs);
+		if (scannedCount > 0) {
+			const void **keys = malloc(scannedCount * sizeof(void *));
+			CFDictionaryGetKeysAndValues(scannedArcs, keys, NULL);
+			@try {
+				for (CFIndex i = 0; i < scannedCount; i++) {
+					RedlandConvenienceBatchScan(model, context, NULL, (librdf_node *)keys[i], NULL, inverse, nodeResults, scannedArcs);
+				}
+			}
+			@finally {
+				free(keys);
+			}
+		}
+		
+		// one pass per node for all other arcs
+		CFIndex lookupCount = CFDictionaryGetCount(lookupArcs);
+		if (lookupCount > 0) {
+			librdf_node *singleArc = NULL;
+			if (1 == lookupCount) {
+				CFDictionaryGetKeysAndValues(lookupArcs, (const void **)&singleArc, NULL);
+			}
+			for (RedlandNode *node in results) {
+				librdf_node *lookupNode = [node wrappedNode];
+				if (!inverse && librdf_node_is_literal(lookupNode)) {
+					continue;
+				}
+				RedlandConvenienceBatchScan(model, context, inverse ? NULL : lookupNode, singleArc, inverse ? lookupNode : NULL, inverse, nodeResults, lookupArcs);
+			}
+		}
+	}
+	@finally {
+		CFRelease(nodeResults);
+		CFRelease(scannedArcs);
+		CFRelease(lookupArcs);
+	}
+	
+	for (NSMutableDictionary *perArc in [results allValues]) {
+		for (RedlandNode *arc in [perArc allKeys]) {
+			[perArc setObject:[[perArc objectForKey:arc] array] forKey:arc];
+		}
+	}
+	return results;
+}
+
+/**
+ *  Returns the targets of many sources and arcs, looked up in as few passes over the storage as possible.
+ *  @param sourceNodes An array of RedlandNode instances
+ *  @param arcNodes An array of RedlandNode instances
+ *  @return A dictionary mapping every source to a dictionary, which maps the arcs having targets to arrays of distinct target nodes
+ */
+- (NSDictionary *)targetsForSources:(NSArray *)sourceNodes arcs:(NSArray *)arcNodes
+{
+	return RedlandConvenienceBatchLookup(self, sourceNodes, arcNodes, nil, NO);
+}
+
+/**
+ *  Returns the targets of many sources and arcs in the given context, looked up in as few passes over the storage as possible.
+ *  @param sourceNodes An array of RedlandNode instances
+ *  @param arcNodes An array of RedlandNode instances
+ *  @param contextNode The context to look in, may be nil
+ *  @return A dictionary mapping every source to a dictionary, which maps the arcs having targets to arrays of distinct target nodes
+ */
+- (NSDictionary *)targetsForSources:(NSArray *)sourceNodes arcs:(NSArray *)arcNodes context:(RedlandNode *)contextNode
+{
+	return RedlandConvenienceBatchLookup(self, sourceNodes, arcNodes, contextNode, NO);
+}
+
+/**
+ *  Returns the sources of many targets and arcs, looked up in as few passes over the storage as possible.
+ *  @param targetNodes An array of RedlandNode instances
+ *  @param arcNodes An array of RedlandNode instances
+ *  @return A dictionary mapping every target to a dictionary, which maps the arcs having sources to arrays of distinct source nodes
+ */
+- (NSDictionary *)sourcesForTargets:(NSArray *)targetNodes arcs:(NSArray *)arcNodes
+{
+	return RedlandConvenienceBatchLookup(self, targetNodes, arcNodes, nil, YES);
+}
+
+/**
+ *  Returns the sources of many targets and arcs in the given context, looked up in as few passes over the storage as possible.
+ *  @param targetNodes An array of RedlandNode instances
+ *  @param arcNodes An array of RedlandNode instances
+ *  @param contextNode The context to look in, may be nil
+ *  @return A dictionary mapping every target to a dictionary, which maps the arcs having sources to arrays of distinct source nodes
+ */
+- (NSDictionary *)sourcesForTargets:(NSArray *)targetNodes arcs:(NSArray *)arcNodes context:(RedlandNode *)contextNode
+{
+	return RedlandConvenienceBatchLookup(self, targetNodes, arcNodes, contextNode, YES);
+}
+
+
+
+#pragma mark - Block Enumeration
+/**
+ *  Calls the block for every statement matching the given statement and context.
+ *
+ *  By default the block is called on the calling thread while walking the underlying stream. The statement and context passed to the block are
+ *  lightweight views on the stream's current statement which are only valid during the call; copy them if you need to keep them. An autorelease pool
+ *  is drained every few hundred statements, so memory stays flat no matter how many statements are enumerated.
+ *
+ *  With RedlandEnumerationConcurrent the matching statements are first copied into a snapshot which is then split into partitions that are processed
+ *  concurrently. The statements passed to the block are owned by the snapshot and stay valid until the method returns. Since librdf is not thread safe,
+ *  the block must not modify any model and should only read the values of the statements and nodes it is given; the nodes' values are decoded before
+ *  the block runs. Setting "stop" stops all partitions as soon as possible. The method returns once all blocks have finished.
+ *
+ *  @param aStatement The statement to match, nil nodes act as wildcards; may be nil to enumerate all statements
+ *  @param contextNode The context to enumerate; may be nil to enumerate statements in any context
+ *  @param options A combination of RedlandEnumerationOptions
+ *  @param block The block to call for every statement; set "stop" to YES to end the enumeration
+ */
+- (void)enumerateStatementsLike:(RedlandStatement *)aStatement context:(RedlandNode *)contextNode options:(RedlandEnumerationOptions)options usingBlock:(RedlandStatementEnumerationBlock)block
+{
+	NSParameterAssert(block != nil);
+	
+	RedlandStream *stream = nil;
+	if (aStatement) {
+		stream = contextNode ? [self streamOfStatementsLike:aStatement withContext:contextNode] : [self streamOfStatementsLike:aStatement];
+	}
+	else {
+		stream = contextNode ? [self streamOfAllStatementsWithContext:contextNode] : [self statementStream];
+	}
+	librdf_stream *wrappedStream = [stream wrappedStream];
+	if (NULL == wrappedStream) {
+		return;
+	}
+	
+	// enumerate the stream directly
+	if (!(options & RedlandEnumerationConcurrent)) {
+		BOOL stop = NO;
+		while (!stop && !librdf_stream_end(wrappedStream)) {
+			@autoreleasepool {
+				for (NSUInteger i = 0; i < REDLAND_ENUMERATION_POOL_INTERVAL && !stop && !librdf_stream_end(wrappedStream); i++) {
+					librdf_statement *statement = librdf_stream_get_object(wrappedStream);
+					librdf_node *context = librdf_stream_get_context2(wrappedStream);
+					RedlandStatement *statementView = [[RedlandStatement alloc] initWithWrappedObject:statement owner:NO];
+					RedlandNode *contextView = context ? [[RedlandNode alloc] initWithWrappedObject:context owner:NO] : nil;
+					block(statementView, contextView, &stop);
+					librdf_stream_next(wrappedStream);
+				}
+			}
+		}
+		return;
+	}
+	
+	// take a snapshot, decoding all values up front so the blocks do not need to touch librdf's reference counts
+	NSMutableArray *statements = [NSMutableArray array];
+	NSMutableArray *contexts = [NSMutableArray array];
+	while (!librdf_stream_end(wrappedStream)) {
+		@autoreleasepool {
+			librdf_statement *statement = librdf_new_statement_from_statement(librdf_stream_get_object(wrappedStream));
+			librdf_node *context = librdf_stream_get_context2(wrappedStream);
+			RedlandStatement *copy = [[RedlandStatement alloc] initWithWrappedObject:statement];
+			if (copy) {
+				RedlandNode *nodes[3] = { [copy subject], [copy predicate], [copy object] };
+				for (int n = 0; n < 3; n++) {
+					if ([nodes[n] isResource]) {
+						[nodes[n] URIValue];
+					}
+					else if ([nodes[n] isLiteral]) {
+						[nodes[n] literalDataType];
+					}
+				}
+				[statements addObject:copy];
+				[contexts addObject:context ? [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(context)] : [NSNull null]];
+			}
+			librdf_stream_next(wrappedStream);
+		}
+	}
+	
+	NSUInteger count = [statements count];
+	if (0 == count) {
+		return;
+	}
+	NSUInteger partitionCount = MIN(count, [[NSProcessInfo processInfo] activeProcessorCount] * 4);
+	NSUInteger partitionSize = (count + partitionCount - 1) / partitionCount;
+	__block volatile BOOL stopped = NO;
+	
+	dispatch_apply(partitionCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t partition) {
+		NSUInteger end = MIN(count, (partition + 1) * partitionSize);
+		NSUInteger i = partition * partitionSize;
+		while (!stopped && i < end) {
+			@autoreleasepool {
+				for (NSUInteger n = 0; n < REDLAND_ENUMERATION_POOL_INTERVAL && !stopped && i < end; n++, i++) {
+					BOOL stop = NO;
+					id context = [contexts objectAtIndex:i];
+					block([statements objectAtIndex:i], ([NSNull null] == context) ? nil : context, &stop);
+					if (stop) {
+						stopped = YES;
+					}
+				}
+			}
+		}
+	});
+}
+
+
+
+#pragma mark - Collections and Containers
+static const void *RedlandConvenienceNodeRetain(CFAllocatorRef allocator, const void *value)
+{
+	return librdf_new_node_from_node((librdf_node *)value);
+}
+
+static void RedlandConvenienceNodeRelease(CFAllocatorRef allocator, const void *value)
+{
+	librdf_free_node((librdf_node *)value);
+}
+
+static Boolean RedlandConvenienceNodeEqual(const void *value1, const void *value2)
+{
+	return (0 != librdf_node_equals((librdf_node *)value1, (librdf_node *)value2));
+}
+
+static const CFDictionaryValueCallBacks RedlandConvenienceNodeValueCallBacks = {
+	0,
+	&RedlandConvenienceNodeRetain,
+	&RedlandConvenienceNodeRelease,
+	NULL,
+	&RedlandConvenienceNodeEqual
+};
+
+/**
+ *  Maps the subject to the object of all statements with the given predicate in the context (in any context if NULL), using a single pattern scan. The
+ *  first statement found for a subject wins.
+ */
+static CFMutableDictionaryRef RedlandConvenienceCopyArcMap(librdf_model *model, librdf_node *predicate, librdf_node *context)
+{
+	librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], NULL, librdf_new_node_from_node(predicate), NULL);
+	librdf_stream *stream = context ? librdf_model_find_statements_in_context(model, pattern, context) : librdf_model_find_statements(model, pattern);
+	librdf_free_statement(pattern);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream of list statements"
+										  userInfo:nil];
+	}
+	
+	CFMutableDictionaryRef map = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, &RedlandConvenienceNodeValueCallBacks);
+	while (!librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		CFDictionaryAddValue(map, librdf_statement_get_subject(statement), librdf_statement_get_object(statement));
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+	return map;
+}
+
+/**
+ *  Returns the members of the RDF collection (rdf:List) starting at the given node.
+ *  @param collectionNode The first node of the collection
+ */
+- (NSArray *)contentsOfCollectionNode:(RedlandNode *)collectionNode
+{
+	return [self contentsOfCollectionNode:collectionNode context:nil];
+}
+
+/**
+ *  Returns the members of the RDF collection (rdf:List) starting at the given node.
+ *
+ *  All rdf:first and rdf:rest statements of the context are fetched with one pattern scan per predicate and the list is then walked in memory, without
+ *  going through the description cache. A list node without rdf:first or rdf:rest ends the list.
+ *  @warning Raises a RedlandException if the list contains a cycle.
+ *  @param collectionNode The first node of the collection
+ *  @param contextNode The context to read the list from; may be nil to read from all contexts
+ *  @return An array of RedlandNode instances
+ */
+- (NSArray *)contentsOfCollectionNode:(RedlandNode *)collectionNode context:(RedlandNode *)contextNode
+{
+	NSParameterAssert(collectionNode != nil);
+	
+	RedlandNode *nilNode = [RDFSyntaxNS node:@"nil"];
+	NSMutableArray *contents = [NSMutableArray array];
+	if ([collectionNode isEqualToNode:nilNode]) {
+		return contents;
+	}
+	
+	librdf_model *model = [self wrappedModel];
+	CFMutableDictionaryRef firsts = RedlandConvenienceCopyArcMap(model, [[RDFSyntaxNS node:@"first"] wrappedNode], [contextNode wrappedNode]);
+	CFMutableDictionaryRef rests = NULL;
+	CFMutableSetRef visited = CFSetCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeSetCallBacks);
+	@try {
+		rests = RedlandConvenienceCopyArcMap(model, [[RDFSyntaxNS node:@"rest"] wrappedNode], [contextNode wrappedNode]);
+		
+		librdf_node *node = [collectionNode wrappedNode];
+		while (node && !librdf_node_equals(node, [nilNode wrappedNode])) {
+			if (CFSetContainsValue(visited, node)) {
+				@throw [RedlandException exceptionWithName:RedlandExceptionName
+													reason:@"The collection contains a cycle"
+												  userInfo:@{ @"collection": collectionNode, @"model": self }];
+			}
+			CFSetAddValue(visited, node);
+			
+			librdf_node *member = (librdf_node *)CFDictionaryGetValue(firsts, node);
+			if (NULL == member) {
+				break;
+			}
+			[contents addObject:[[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(member)]];
+			node = (librdf_node *)CFDictionaryGetValue(rests, node);
+		}
+	}
+	@finally {
+		CFRelease(firsts);
+		if (rests) {
+			CFRelease(rests);
+		}
+		CFRelease(visited);
+	}
+	return contents;
+}
+
+/**
+ *  Returns an enumerator over the members of the RDF collection (rdf:List) starting at the given node.
+ *  @param collectionNode The first node of the collection
+ */
+- (NSEnumerator *)enumeratorOfCollectionNode:(RedlandNode *)collectionNode
+{
+	return [RedlandCollectionEnumerator enumeratorWithModel:self collectionNode:collectionNode];
+}
+
+typedef struct {
+	int ordinal;
+	librdf_node *node;
+} RedlandConvenienceContainerMember;
+
+static int RedlandConvenienceCompareMembers(const void *member1, const void *member2)
+{
+	int ordinal1 = ((const RedlandConvenienceContainerMember *)member1)->ordinal;
+	int ordinal2 = ((const RedlandConvenienceContainerMember *)member2)->ordinal;
+	return (ordinal1 < ordinal2) ? -1 : ((ordinal1 > ordinal2) ? 1 : 0);
+}
+
+/**
+ *  Returns the members of the RDF container (rdf:Seq, rdf:Bag or rdf:Alt) with the given node, ordered by their rdf:_n arcs.
+ *
+ *  All statements about the container are fetched with one pattern scan and the members are sorted in memory.
+ *  @param containerNode The container node
+ *  @return An array of RedlandNode instances
+ */
+- (NSArray *)contentsOfContainerNode:(RedlandNode *)containerNode
+{
+	NSParameterAssert(containerNode != nil);
+	
+	librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], librdf_new_node_from_node([containerNode wrappedNode]), NULL, NULL);
+	librdf_stream *stream = librdf_model_find_statements([self wrappedModel], pattern);
+	librdf_free_statement(pattern);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream of container statements"
+										  userInfo:nil];
+	}
+	
+	size_t count = 0;
+	size_t capacity = 64;
+	RedlandConvenienceContainerMember *members = malloc(capacity * sizeof(RedlandConvenienceContainerMember));
+	if (NULL == members) {
+		librdf_free_stream(stream);
+		[NSException raise:NSMallocException format:@"Out of memory reading the members of a container"];
+	}
+	while (!librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		int ordinal = librdf_node_get_li_ordinal(librdf_statement_get_predicate(statement));
+		if (ordinal > 0) {
+			if (count >= capacity) {
+				capacity *= 2;
+				RedlandConvenienceContainerMember *grown = realloc(members, capacity * sizeof(RedlandConvenienceContainerMember));
+				if (!grown) {
+					for (size_t i = 0; i < count; i++) {
+						librdf_free_node(members[i].node);
+					}
+					free(members);
+					librdf_free_stream(stream);
+					[NSException raise:NSMallocException format:@"Out of memory reading the members of a container"];
+				}
+				members = grown;
+			}
+			members[count].ordinal = ordinal;
+			members[count].node = librdf_new_node_from_node(librdf_statement_get_object(statement));
+			count++;
+		}
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+	
+	NSMutableArray *contents = [NSMutableArray arrayWithCapacity:count];
+	qsort(members, count, sizeof(RedlandConvenienceContainerMember), &RedlandConvenienceCompareMembers);
+	for (size_t i = 0; i < count; i++) {
+		[contents addObject:[[RedlandNode alloc] initWithWrappedObject:members[i].node]];
+	}
+	free(members);
+	return contents;
+}
+
+/**
+ *  Returns an enumerator over the members of the RDF container (rdf:Seq, rdf:Bag or rdf:Alt) with the given node.
+ *  @param containerNode The container node
+ */
+- (NSEnumerator *)enumeratorOfContainerNode:(RedlandNode *)containerNode
+{
+	return [RedlandContainerEnumerator enumeratorWithModel:self containerNode:containerNode];
+}
+
+/**
+ *  Adds an RDF collection (rdf:List) with the given members.
+ *  @param collectionNode The first node of the new collection
+ *  @param nodeArray The members, either RedlandNode instances or objects responding to nodeValue
+ */
+- (void)addCollectionNode:(RedlandNode *)collectionNode withContents:(NSArray *)nodeArray
+{
+	[self addCollectionNode:collectionNode withContents:nodeArray context:nil];
+}
+
+/**
+ *  Adds an RDF collection (rdf:List) with the given members.
+ *
+ *  The list nodes after the first one are new blank nodes. All statements are added with a single reused librdf statement, in one transaction if the
+ *  storage supports transactions.
+ *  @warning Raises a RedlandException if a statement can not be added; with transactions none of the list will be added in that case.
+ *  @param collectionNode The first node of the new collection
+ *  @param nodeArray The members, either RedlandNode instances or objects responding to nodeValue; must not be empty
+ *  @param contextNode The context to add the statements to, may be nil
+ */
+- (void)addCollectionNode:(RedlandNode *)collectionNode withContents:(NSArray *)nodeArray context:(RedlandNode *)contextNode
+{
+	NSParameterAssert(collectionNode != nil);
+	NSParameterAssert([nodeArray count] > 0);
+	
+	librdf_world *world = [RedlandWorld defaultWrappedWorld];
+	librdf_model *model = [self wrappedModel];
+	librdf_node *context = [contextNode wrappedNode];
+	librdf_node *first = [[RDFSyntaxNS node:@"first"] wrappedNode];
+	librdf_node *rest = [[RDFSyntaxNS node:@"rest"] wrappedNode];
+	librdf_node *nilNode = [[RDFSyntaxNS node:@"nil"] wrappedNode];
+	
+	librdf_statement *statement = librdf_new_statement(world);
+	librdf_node *listNode = librdf_new_node_from_node([collectionNode wrappedNode]);
+	NSMutableArray *added = [self hasChangeObservers] ? [NSMutableArray array] : nil;
+	BOOL inTransaction = (0 == librdf_model_transaction_start(model));
+	@try {
+		NSUInteger count = [nodeArray count];
+		for (NSUInteger i = 0; i < count; i++) {
+			RedlandNode *member = [RedlandNode nodeWithObject:[nodeArray objectAtIndex:i]];
+			librdf_node *nextNode = (i + 1 < count) ? librdf_new_node_from_blank_identifier(world, NULL) : librdf_new_node_from_node(nilNode);
+			
+			librdf_node *arcs[2] = { first, rest };
+			librdf_node *targets[2] = { [member wrappedNode], nextNode };
+			for (int n = 0; n < 2; n++) {
+				librdf_statement_clear(statement);
+				librdf_statement_set_subject(statement, librdf_new_node_from_node(listNode));
+				librdf_statement_set_predicate(statement, librdf_new_node_from_node(arcs[n]));
+				librdf_statement_set_object(statement, librdf_new_node_from_node(targets[n]));
+				BOOL isNew = (added && 1 != RedlandModelContainsStatementInContext(model, statement, context));
+				int result = context ? librdf_model_context_add_statement(model, context, statement) : librdf_model_add_statement(model, statement);
+				if (0 != result) {
+					librdf_free_node(nextNode);
+					@throw [RedlandException exceptionWithName:RedlandExceptionName
+														reason:@"Failed to add a collection statement"
+													  userInfo:@{ @"collection": collectionNode, @"model": self }];
+				}
+				if (isNew) {
+					// the buffer statement is refilled for every statement, a copy of it would be the same object; build a new one from the nodes
+					librdf_statement *copy = librdf_new_statement_from_nodes(world, librdf_new_node_from_node(listNode), librdf_new_node_from_node(arcs[n]),
+																			 librdf_new_node_from_node(targets[n]));
+					[added addObject:[[RedlandStatement alloc] initWithWrappedObject:copy]];
+				}
+			}
+			librdf_free_node(listNode);
+			listNode = nextNode;
+		}
+		if (inTransaction) {
+			librdf_model_transaction_commit(model);
+			inTransaction = NO;
+		}
+		if ([added count] > 0) {
+			[self performChanges:^{
+				for (RedlandStatement *addedStatement in added) {
+					[self didAddStatement:addedStatement withContext:contextNode];
+				}
+			}];
+		}
+	}
+	@finally {
+		if (inTransaction) {
+			librdf_model_transaction_rollback(model);
+		}
+		librdf_free_node(listNode);
+		librdf_free_statement(statement);
+		[[self descriptionCache] removeDescriptionOfSubject:collectionNode];
+		[self bumpVersion];
+	}
+}
 
 @end
@@ -0,0 +1,45 @@
+//
+//  RedlandModel-GraphPattern.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandModel.h"
+
+@class RedlandNode, RedlandBindingTable;
+
+
+/**
+ *  Matching basic graph patterns without going through SPARQL.
+ *
+ *  A graph pattern is an array of RedlandStatement instances in which variables take the place of nodes; variables are created with
+ *  +[RedlandNode nodeWithVariableName:], nil nodes match anything without binding a variable. The patterns are joined in an order chosen from the
+ *  estimated number of statements matching each pattern, starting with the most selective one and preferring patterns sharing a variable with those
+ *  already joined. Compact storages estimate from their index sizes; on other storages the estimate is derived from the model size and the bound
+ *  positions of the pattern, since counting would scan the model. Each pattern is joined either by looking up the statements for every row found so far (index nested loop) or, when there are many
+ *  rows compared to the statements matching the pattern, by scanning the pattern once and probing a hash table of the rows (hash join).
+ */
+@interface RedlandModel (GraphPattern)
+
+- (RedlandBindingTable *)bindingsMatchingPatterns:(NSArray *)patterns;
+- (RedlandBindingTable *)bindingsMatchingPatterns:(NSArray *)patterns context:(RedlandNode *)contextNode limit:(NSUInteger)limit;
+
+
+@end
@@ -0,0 +1,393 @@
+//
+//  RedlandModel-GraphPattern.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandModel-GraphPattern.h"
+#import "RedlandBindingTable.h"
+#import "RedlandWorld.h"
+#import "RedlandNode.h"
+#import "RedlandNode-Convenience.h"
+#import "RedlandStatement.h"
+#import "RedlandException.h"
+#import "RedlandCompactStorage.h"
+
+/// A pattern is hash joined when the rows found so far times this ratio reach the estimated number of statements matching the pattern
+#define REDLAND_BGP_HASH_JOIN_RATIO 4
+
+/// The model size assumed by the heuristic estimate when the storage cannot tell its size
+#define REDLAND_BGP_UNKNOWN_SIZE 100000
+
+typedef struct {
+	librdf_node *nodes[3];								///< Subject, predicate and object; NULL for variables and wildcards (borrowed)
+	int columns[3];										///< The column of the variable at each position, -1 for constants and wildcards
+	NSUInteger estimate;								///< Estimated number of statements matching the constants of the pattern
+} RedlandBGPPattern;
+
+/// Growable table of binding rows, every row holds width node references (NULL if unbound)
+typedef struct {
+	librdf_node **nodes;
+	size_t width;
+	size_t count;
+	size_t capacity;
+} RedlandBGPRows;
+
+
+#pragma mark - Rows
+static BOOL RedlandBGPRowsAppend(RedlandBGPRows *rows, librdf_node **row)
+{
+	if (rows->width > 0) {
+		if (rows->count >= rows->capacity) {
+			size_t capacity = rows->capacity ? rows->capacity * 2 : 64;
+			librdf_node **grown = realloc(rows->nodes, capacity * rows->width * sizeof(librdf_node *));
+			if (NULL == grown) {
+				return NO;
+			}
+			rows->nodes = grown;
+			rows->capacity = capacity;
+		}
+		librdf_node **target = rows->nodes + rows->count * rows->width;
+		for (size_t i = 0; i < rows->width; i++) {
+			target[i] = row[i] ? librdf_new_node_from_node(row[i]) : NULL;
+		}
+	}
+	rows->count++;
+	return YES;
+}
+
+static void RedlandBGPRowsFree(RedlandBGPRows *rows)
+{
+	size_t total = rows->count * rows->width;
+	for (size_t i = 0; i < total; i++) {
+		if (rows->nodes[i]) {
+			librdf_free_node(rows->nodes[i]);
+		}
+	}
+	free(rows->nodes);
+	rows->nodes = NULL;
+	rows->count = rows->capacity = 0;
+}
+
+static librdf_node *RedlandBGPStatementNode(librdf_statement *statement, int position)
+{
+	switch (position) {
+		case 0:  return librdf_statement_get_subject(statement);
+		case 1:  return librdf_statement_get_predicate(statement);
+		default: return librdf_statement_get_object(statement);
+	}
+}
+
+/**
+ *  Binds the variables of the pattern to the nodes of the statement, starting from the given row, and appends the result.
+ *  Nothing is appended if the statement conflicts with a variable bound before.
+ *  @return NO if memory ran out
+ */
+static BOOL RedlandBGPExtend(const RedlandBGPPattern *pattern, librdf_node **row, librdf_statement *statement, librdf_node **scratch, RedlandBGPRows *output)
+{
+	memcpy(scratch, row, output->width * sizeof(librdf_node *));
+	for (int i = 0; i < 3; i++) {
+		int column = pattern->columns[i];
+		if (column < 0) {
+			continue;
+		}
+		librdf_node *node = RedlandBGPStatementNode(statement, i);
+		if (scratch[column]) {
+			if (scratch[column] != node && !librdf_node_equals(scratch[column], node)) {
+				return YES;
+			}
+		}
+		else {
+			scratch[column] = node;
+		}
+	}
+	return RedlandBGPRowsAppend(output, scratch);
+}
+
+static librdf_stream *RedlandBGPFind(librdf_model *model, librdf_node *context, librdf_node *subject, librdf_node *predicate, librdf_node *object)
+{
+	librdf_statement *query = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld],
+															  subject ? librdf_new_node_from_node(subject) : NULL,
+															  predicate ? librdf_new_node_from_node(predicate) : NULL,
+															  object ? librdf_new_node_from_node(object) : NULL);
+	librdf_stream *stream = context ? librdf_model_find_statements_in_context(model, query, context) : librdf_model_find_statements(model, query);
+	librdf_free_statement(query);
+	return stream;
+}
+
+
+
+#pragma mark - Estimates
+/**
+ *  Estimates the number of statements matching the constants of a pattern from the model size alone, dividing it by a typical selectivity for every
+ *  bound position. Used for storages that cannot answer from their index sizes, where an exact count would scan the model once per pattern.
+ */
+static NSUInteger RedlandBGPHeuristicEstimate(librdf_model *model, librdf_node **nodes)
+{
+	static const double selectivity[3] = { 256.0, 8.0, 32.0 };		// subjects are the most, predicates the least selective
+	int size = librdf_model_size(model);
+	double estimate = (size >= 0) ? (double)size : (double)REDLAND_BGP_UNKNOWN_SIZE;
+	for (int i = 0; i < 3; i++) {
+		if (nodes[i]) {
+			estimate /= selectivity[i];
+		}
+	}
+	return (NSUInteger)MAX(estimate, 1.0);
+}
+
+
+
+#pragma mark - Joins
+/**
+ *  Joins every row with the statements found by a lookup with the row's bindings filled in.
+ */
+static BOOL RedlandBGPNestedLoopJoin(librdf_model *model, librdf_node *context, const RedlandBGPPattern *pattern, RedlandBGPRows *input, RedlandBGPRows *output, size_t limit)
+{
+	librdf_node *scratch[output->width + 1];
+	for (size_t r = 0; r < input->count; r++) {
+		librdf_node **row = input->nodes + r * input->width;
+		librdf_node *bound[3];
+		for (int i = 0; i < 3; i++) {
+			bound[i] = (pattern->columns[i] >= 0) ? row[pattern->columns[i]] : pattern->nodes[i];
+		}
+		librdf_stream *stream = RedlandBGPFind(model, context, bound[0], bound[1], bound[2]);
+		if (NULL == stream) {
+			return NO;
+		}
+		while (!librdf_stream_end(stream)) {
+			if (!RedlandBGPExtend(pattern, row, librdf_stream_get_object(stream), scratch, output)) {
+				librdf_free_stream(stream);
+				return NO;
+			}
+			if (limit > 0 && output->count >= limit) {
+				break;
+			}
+			librdf_stream_next(stream);
+		}
+		librdf_free_stream(stream);
+		if (limit > 0 && output->count >= limit) {
+			break;
+		}
+	}
+	return YES;
+}
+
+/**
+ *  Scans the pattern once and probes a hash table of the input rows, keyed by the node bound to the given position's variable.
+ */
+static BOOL RedlandBGPHashJoin(librdf_model *model, librdf_node *context, const RedlandBGPPattern *pattern, int joinPosition, RedlandBGPRows *input, RedlandBGPRows *output, size_t limit)
+{
+	int joinColumn = pattern->columns[joinPosition];
+	CFMutableDictionaryRef table = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+	for (size_t r = 0; r < input->count; r++) {
+		librdf_node *key = input->nodes[r * input->width + joinColumn];
+		CFMutableArrayRef matches = (CFMutableArrayRef)CFDictionaryGetValue(table, key);
+		if (NULL == matches) {
+			matches = CFArrayCreateMutable(kCFAllocatorDefault, 0, NULL);
+			CFDictionaryAddValue(table, key, matches);
+			CFRelease(matches);
+		}
+		CFArrayAppendValue(matches, (const void *)(uintptr_t)r);
+	}
+	
+	librdf_stream *stream = RedlandBGPFind(model, context, pattern->nodes[0], pattern->nodes[1], pattern->nodes[2]);
+	BOOL success = (NULL != stream);
+	librdf_node *scratch[output->width + 1];
+	while (success && !librdf_stream_end(stream) && !(limit > 0 && output->count >= limit)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		CFArrayRef matches = CFDictionaryGetValue(table, RedlandBGPStatementNode(statement, joinPosition));
+		CFIndex count = matches ? CFArrayGetCount(matches) : 0;
+		for (CFIndex i = 0; i < count && success; i++) {
+			size_t r = (size_t)(uintptr_t)CFArrayGetValueAtIndex(matches, i);
+			success = RedlandBGPExtend(pattern, input->nodes + r * input->width, statement, scratch, output);
+			if (limit > 0 && output->count >= limit) {
+				break;
+			}
+		}
+		librdf_stream_next(stream);
+	}
+	if (stream) {
+		librdf_free_stream(stream);
+	}
+	CFRelease(table);
+	return success;
+}
+
+/**
+ *  Joins the patterns in the given order, one pattern at a time.
+ *  @param rows Receives the resulting rows, width must be set to the number of variables
+ *  @return NO if a stream could not be created or memory ran out
+ */
+static BOOL RedlandBGPExecute(librdf_model *model, librdf_node *context, const RedlandBGPPattern *patterns, size_t patternCount, size_t limit, RedlandBGPRows *rows)
+{
+	size_t width = rows->width;
+	RedlandBGPRows current = { NULL, width, 0, 0 };
+	librdf_node *empty[width + 1];
+	memset(empty, 0, sizeof(empty));
+	if (!RedlandBGPRowsAppend(&current, empty)) {
+		return NO;
+	}
+	
+	BOOL *bound = calloc(width + 1, sizeof(BOOL));
+	BOOL success = (NULL != bound);
+	for (size_t p = 0; p < patternCount && success && current.count > 0; p++) {
+		const RedlandBGPPattern *pattern = &patterns[p];
+		RedlandBGPRows next = { NULL, width, 0, 0 };
+		size_t levelLimit = (p + 1 == patternCount) ? limit : 0;
+		
+		int joinPosition = -1;
+		for (int i = 0; i < 3 && joinPosition < 0; i++) {
+			if (pattern->columns[i] >= 0 && bound[pattern->columns[i]]) {
+				joinPosition = i;
+			}
+		}
+		if (joinPosition >= 0 && current.count > 1 && current.count * REDLAND_BGP_HASH_JOIN_RATIO >= pattern->estimate) {
+			success = RedlandBGPHashJoin(model, context, pattern, joinPosition, &current, &next, levelLimit);
+		}
+		else {
+			success = RedlandBGPNestedLoopJoin(model, context, pattern, &current, &next, levelLimit);
+		}
+		
+		for (int i = 0; i < 3; i++) {
+			if (pattern->columns[i] >= 0) {
+				bound[pattern->columns[i]] = YES;
+			}
+		}
+		RedlandBGPRowsFree(&current);
+		current = next;
+	}
+	free(bound);
+	
+	if (!success) {
+		RedlandBGPRowsFree(&current);
+		return NO;
+	}
+	*rows = current;
+	return YES;
+}
+
+
+@implementation RedlandModel (GraphPattern)
+
+
+/**
+ *  Returns all bindings of the variables in the given patterns that make every pattern match a statement of the receiver.
+ *  @param patterns An array of RedlandStatement instances, which may contain variables
+ */
+- (RedlandBindingTable *)bindingsMatchingPatterns:(NSArray *)patterns
+{
+	return [self bindingsMatchingPatterns:patterns context:nil limit:0];
+}
+
+/**
+ *  Returns all bindings of the variables in the given patterns that make every pattern match a statement of the receiver.
+ *  @param patterns An array of RedlandStatement instances, which may contain variables
+ *  @param contextNode The context all patterns must match in, nil to match in any context
+ *  @param limit The maximum number of rows to return, 0 for no limit
+ *  @return A RedlandBindingTable with one column per variable, in the order the variables first appear in the patterns
+ */
+- (RedlandBindingTable *)bindingsMatchingPatterns:(NSArray *)patterns context:(RedlandNode *)contextNode limit:(NSUInteger)limit
+{
+	NSParameterAssert([patterns count] > 0);
+	
+	// compile the patterns, assigning a column to every variable
+	NSUInteger count = [patterns count];
+	NSMutableArray *variables = [NSMutableArray array];
+	BOOL compact = RedlandStorageIsCompact(librdf_model_get_storage([self wrappedModel]));
+	RedlandBGPPattern *compiled = calloc(count, sizeof(RedlandBGPPattern));
+	for (NSUInteger p = 0; p < count; p++) {
+		RedlandStatement *statement = [patterns objectAtIndex:p];
+		RedlandNode *nodes[3] = { [statement subject], [statement predicate], [statement object] };
+		RedlandNode *constants[3] = { nil, nil, nil };
+		for (int i = 0; i < 3; i++) {
+			NSString *name = [nodes[i] variableName];
+			compiled[p].columns[i] = -1;
+			if (name) {
+				NSUInteger column = [variables indexOfObject:name];
+				if (NSNotFound == column) {
+					column = [variables count];
+					[variables addObject:name];
+				}
+				compiled[p].columns[i] = (int)column;
+			}
+			else if (nodes[i]) {
+				constants[i] = nodes[i];
+				compiled[p].nodes[i] = [nodes[i] wrappedNode];
+			}
+		}
+		if (compact) {
+			RedlandStatement *constantPattern = [RedlandStatement statementWithSubject:constants[0] predicate:constants[1] object:constants[2]];
+			compiled[p].estimate = [self estimatedCountOfStatementsLike:constantPattern withContext:contextNode];
+		}
+		else {
+			compiled[p].estimate = RedlandBGPHeuristicEstimate([self wrappedModel], compiled[p].nodes);
+		}
+	}
+	
+	// greedy join order: the cheapest pattern connected to the variables bound so far, each bound variable making a pattern 16 times more selective
+	RedlandBGPPattern *ordered = calloc(count, sizeof(RedlandBGPPattern));
+	BOOL *used = calloc(count, sizeof(BOOL));
+	NSMutableIndexSet *boundColumns = [NSMutableIndexSet indexSet];
+	for (NSUInteger n = 0; n < count; n++) {
+		NSUInteger best = NSNotFound;
+		BOOL bestConnected = NO;
+		double bestCost = 0.0;
+		for (NSUInteger p = 0; p < count; p++) {
+			if (used[p]) {
+				continue;
+			}
+			int boundPositions = 0;
+			for (int i = 0; i < 3; i++) {
+				if (compiled[p].columns[i] >= 0 && [boundColumns containsIndex:compiled[p].columns[i]]) {
+					boundPositions++;
+				}
+			}
+			BOOL connected = ([boundColumns count] == 0 || boundPositions > 0);
+			double cost = (double)compiled[p].estimate / pow(16.0, boundPositions);
+			if (NSNotFound == best || (connected && !bestConnected) || (connected == bestConnected && cost < bestCost)) {
+				best = p;
+				bestConnected = connected;
+				bestCost = cost;
+			}
+		}
+		used[best] = YES;
+		ordered[n] = compiled[best];
+		for (int i = 0; i < 3; i++) {
+			if (compiled[best].columns[i] >= 0) {
+				[boundColumns addIndex:compiled[best].columns[i]];
+			}
+		}
+	}
+	free(used);
+	
+	RedlandBGPRows rows = { NULL, [variables count], 0, 0 };
+	BOOL success = RedlandBGPExecute([self wrappedModel], [contextNode wrappedNode], ordered, count, limit, &rows);
+	free(ordered);
+	free(compiled);
+	if (!success) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to match the graph pattern"
+										  userInfo:@{ @"patterns": patterns }];
+	}
+	return [[RedlandBindingTable alloc] initWithVariables:variables nodes:rows.nodes count:rows.count];
+}
+
+
+@end
@@ -0,0 +1,50 @@
+//
+//  RedlandModel-Pagination.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel.h"
+
+@class RedlandStatement, RedlandNode;
+
+
+/**
+ *  Reading the statements matching a pattern one page at a time.
+ *
+ *  Every page comes with a cursor, an opaque string to pass in to get the following page; it is nil after the last page. On a compact storage the
+ *  cursor holds the position of the last statement returned, i.e. the term IDs of its subject, predicate, object and context, and the next page seeks
+ *  right behind it in the index used for the pattern. Fetching a page thus takes the same time no matter how deep into the results it is, and pages
+ *  stay consistent while the model changes: statements are never returned twice, and statements that existed all along are never skipped.
+ *
+ *  Other storages have no stable order to seek in, there the cursor identifies the stream of the previous page, which is kept open in a small table of
+ *  recently used streams, and holds the number of statements returned so far. If the stream was closed in the meantime, or the model changed, the next
+ *  page matches the pattern again and skips that many statements; statements added or removed in between can then shift the pages.
+ *
+ *  Cursors are only valid for the model and pattern they were returned for.
+ */
+@interface RedlandModel (Pagination)
+
+- (NSArray *)statementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode limit:(NSUInteger)limit
+					  after:(NSString *)cursor nextCursor:(NSString * __autoreleasing *)nextCursor;
+
++ (void)closeAllCursors;
+
+
+@end
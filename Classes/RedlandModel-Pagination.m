@@ -0,0 +1,257 @@
+//
+//  RedlandModel-Pagination.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel-Pagination.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandStatement.h"
+#import "RedlandNode.h"
+#import "RedlandException.h"
+
+/// The number of statement streams kept open between pages on storages without positions, the least recently used are closed first
+#define REDLAND_STATEMENT_CURSOR_LIMIT 16
+
+/// Prefixes of the two kinds of cursors: positions in a compact storage and statement offsets
+static NSString * const RedlandPaginationPositionPrefix = @"p1";
+static NSString * const RedlandPaginationOffsetPrefix = @"o1";
+
+
+/**
+ *  A number identifying the pattern, so a cursor is not used with a different pattern by accident.
+ */
+static NSUInteger RedlandPaginationPatternHash(RedlandStatement *aStatement, RedlandNode *contextNode)
+{
+	NSString *pattern = [NSString stringWithFormat:@"%@ %@ %@ %@", aStatement.subject, aStatement.predicate, aStatement.object, contextNode];
+	return [pattern hash];
+}
+
+/**
+ *  Splits a cursor into its fields, checking the prefix and the pattern hash.
+ */
+static NSArray *RedlandPaginationCursorFields(NSString *cursor, NSString *prefix, NSUInteger count, NSUInteger patternHash)
+{
+	NSArray *fields = [cursor componentsSeparatedByString:@":"];
+	if ([fields count] != count || ![fields[0] isEqualToString:prefix]
+		|| (NSUInteger)strtoull([fields[1] UTF8String], NULL, 16) != patternHash) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"The cursor was not created for this pattern"
+										  userInfo:@{ @"cursor": cursor }];
+	}
+	return fields;
+}
+
+
+/**
+ *  The open statement stream of a paged pattern on a storage without positions, parked between two pages.
+ */
+@interface RedlandStatementCursor : NSObject {
+	librdf_stream *stream;
+}
+
+@property (nonatomic, strong) RedlandModel *model;
+@property (nonatomic, assign) uint64_t modelVersion;				///< The version of the model when the stream was opened
+@property (nonatomic, assign) unsigned long long offset;			///< The number of statements read from the stream so far
+
+- (id)initWithStream:(librdf_stream *)aStream;
+- (librdf_stream *)stream;
+
+@end
+
+@implementation RedlandStatementCursor
+
+- (id)initWithStream:(librdf_stream *)aStream
+{
+	if ((self = [super init])) {
+		stream = aStream;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if (stream) {
+		librdf_free_stream(stream);
+	}
+}
+
+- (librdf_stream *)stream
+{
+	return stream;
+}
+
+@end
+
+
+static NSMutableDictionary *RedlandStatementCursors = nil;			///< Cursor ID -> RedlandStatementCursor
+static NSMutableArray *RedlandStatementCursorOrder = nil;			///< Cursor IDs, least recently used first
+static unsigned long long RedlandStatementCursorCounter = 0;
+
+
+@implementation RedlandModel (Pagination)
+
+
+/**
+ *  Returns one page of the statements matching the given statement and context.
+ *
+ *  On compact storages the statements come in the order of the index used for the pattern, on other storages in the storage's order. There the stream
+ *  stays open between pages, so the next page continues where this one ended; only if the stream was closed to make room for the streams of newer
+ *  cursors, or the model changed, the pattern is matched again and the statements already returned are skipped.
+ *  @param aStatement The statement to match, nil nodes act as wildcards
+ *  @param contextNode The context to match, nil for statements in any context
+ *  @param limit The maximum number of statements to return, must not be 0
+ *  @param cursor The cursor returned with the previous page, nil to start with the first page
+ *  @param nextCursor Receives the cursor to pass in for the next page, nil if there are no more statements
+ *  @return An array of RedlandStatement instances
+ */
+- (NSArray *)statementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode limit:(NSUInteger)limit
+					  after:(NSString *)cursor nextCursor:(NSString * __autoreleasing *)nextCursor
+{
+	NSParameterAssert(aStatement != nil);
+	NSParameterAssert(limit > 0);
+	
+	librdf_storage *storage = librdf_model_get_storage([self wrappedModel]);
+	BOOL compact = RedlandStorageIsCompact(storage);
+	NSUInteger patternHash = RedlandPaginationPatternHash(aStatement, contextNode);
+	uint64_t storageIdentifier = compact ? RedlandCompactStorageIdentifier(storage) : 0;
+	
+	// open the stream at the cursor
+	librdf_stream *stream = NULL;
+	RedlandStatementCursor *open = nil;
+	NSNumber *cursorID = nil;
+	unsigned long long offset = 0;
+	if (compact) {
+		uint32_t position[4];
+		if (cursor) {
+			NSArray *fields = RedlandPaginationCursorFields(cursor, RedlandPaginationPositionPrefix, 7, patternHash);
+			if (strtoull([fields[2] UTF8String], NULL, 16) != storageIdentifier) {
+				@throw [RedlandException exceptionWithName:RedlandExceptionName
+													reason:@"The cursor was not created for this model"
+												  userInfo:@{ @"cursor": cursor }];
+			}
+			for (int i = 0; i < 4; i++) {
+				position[i] = (uint32_t)strtoul([fields[3 + i] UTF8String], NULL, 16);
+			}
+		}
+		stream = RedlandCompactStorageFindStatementsAfter(storage, [aStatement wrappedStatement], [contextNode wrappedNode], cursor ? position : NULL);
+	}
+	else {
+		if (cursor) {
+			NSArray *fields = RedlandPaginationCursorFields(cursor, RedlandPaginationOffsetPrefix, 4, patternHash);
+			cursorID = @(strtoull([fields[2] UTF8String], NULL, 16));
+			offset = strtoull([fields[3] UTF8String], NULL, 16);
+		}
+		
+		// take the open stream out of the table, so no other thread reads from it at the same time
+		@synchronized([RedlandStatementCursor class]) {
+			if (nil == RedlandStatementCursors) {
+				RedlandStatementCursors = [NSMutableDictionary new];
+				RedlandStatementCursorOrder = [NSMutableArray new];
+			}
+			if (cursorID) {
+				open = RedlandStatementCursors[cursorID];
+				if (open && open.model == self && open.offset == offset && open.modelVersion == self.version) {
+					[RedlandStatementCursors removeObjectForKey:cursorID];
+					[RedlandStatementCursorOrder removeObject:cursorID];
+				}
+				else {
+					open = nil;
+				}
+			}
+			else {
+				cursorID = @(++RedlandStatementCursorCounter);
+			}
+		}
+		
+		if (nil == open) {
+			librdf_stream *found = contextNode ? librdf_model_find_statements_in_context([self wrappedModel], [aStatement wrappedStatement], [contextNode wrappedNode])
+											   : librdf_model_find_statements([self wrappedModel], [aStatement wrappedStatement]);
+			if (found) {
+				open = [[RedlandStatementCursor alloc] initWithStream:found];
+				open.model = self;
+				open.modelVersion = self.version;
+			}
+		}
+		stream = [open stream];
+	}
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream for a page of statements"
+										  userInfo:nil];
+	}
+	
+	// skip to the offset if the stream was opened anew, then read the page
+	for (unsigned long long i = open.offset; i < offset && !librdf_stream_end(stream); i++) {
+		librdf_stream_next(stream);
+	}
+	NSMutableArray *statements = [NSMutableArray arrayWithCapacity:MIN(limit, (NSUInteger)256)];
+	uint32_t last[4];
+	BOOL hasLast = NO;
+	while ([statements count] < limit && !librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		[statements addObject:[[RedlandStatement alloc] initWithWrappedObject:librdf_new_statement_from_statement(statement)]];
+		if (compact) {
+			hasLast = RedlandCompactStorageGetPosition(storage, statement, librdf_stream_get_context2(stream), last);
+		}
+		librdf_stream_next(stream);
+	}
+	BOOL more = !librdf_stream_end(stream);
+	if (compact) {
+		librdf_free_stream(stream);
+	}
+	else if (more) {
+		open.offset = offset + [statements count];
+		@synchronized([RedlandStatementCursor class]) {
+			RedlandStatementCursors[cursorID] = open;
+			[RedlandStatementCursorOrder addObject:cursorID];
+			while ([RedlandStatementCursorOrder count] > REDLAND_STATEMENT_CURSOR_LIMIT) {
+				[RedlandStatementCursors removeObjectForKey:RedlandStatementCursorOrder[0]];
+				[RedlandStatementCursorOrder removeObjectAtIndex:0];
+			}
+		}
+	}
+	
+	if (nextCursor) {
+		*nextCursor = nil;
+		if (more && compact && hasLast) {
+			*nextCursor = [NSString stringWithFormat:@"%@:%lx:%llx:%x:%x:%x:%x", RedlandPaginationPositionPrefix, (unsigned long)patternHash,
+						   (unsigned long long)storageIdentifier, last[0], last[1], last[2], last[3]];
+		}
+		else if (more && !compact) {
+			*nextCursor = [NSString stringWithFormat:@"%@:%lx:%llx:%llx", RedlandPaginationOffsetPrefix, (unsigned long)patternHash,
+						   [cursorID unsignedLongLongValue], offset + [statements count]];
+		}
+	}
+	return [statements copy];
+}
+
+/**
+ *  Closes the statement streams kept open for all cursors. Cursors stay valid, their next page matches the pattern again.
+ */
++ (void)closeAllCursors
+{
+	@synchronized([RedlandStatementCursor class]) {
+		[RedlandStatementCursors removeAllObjects];
+		[RedlandStatementCursorOrder removeAllObjects];
+	}
+}
+
+
+@end
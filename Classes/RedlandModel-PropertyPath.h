@@ -0,0 +1,48 @@
+//
+//  RedlandModel-PropertyPath.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandModel.h"
+
+@class RedlandNode, RedlandPropertyPath;
+
+typedef void (^RedlandNodeEnumerationBlock)(RedlandNode *node, BOOL *stop);
+
+
+/**
+ *  Evaluating property paths natively, without going through SPARQL.
+ *
+ *  The evaluator works on sets of librdf nodes: every step of a path is applied to the whole frontier at once and only the final results are wrapped in
+ *  RedlandNode instances. The repetition operators (*, +) proceed level by level and keep a visited set, so cycles in the graph are harmless. Every
+ *  result is reported only once.
+ */
+@interface RedlandModel (PropertyPath)
+
+- (NSArray *)targetsOfPath:(RedlandPropertyPath *)path fromSource:(RedlandNode *)sourceNode;
+- (void)enumerateTargetsOfPath:(RedlandPropertyPath *)path
+					fromSource:(RedlandNode *)sourceNode
+				  maximumDepth:(NSUInteger)maximumDepth
+						 limit:(NSUInteger)limit
+					usingBlock:(RedlandNodeEnumerationBlock)block;
+
+
+@end
@@ -0,0 +1,299 @@
+//
+//  RedlandModel-PropertyPath.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandModel-PropertyPath.h"
+#import "RedlandPropertyPath.h"
+#import "RedlandWorld.h"
+#import "RedlandNode.h"
+#import "RedlandStorage.h"
+#import "RedlandCompactStorage.h"
+
+/// A frontier at least this fraction of the predicate's statements is joined with a single predicate scan instead of one lookup per node
+#define REDLAND_PATH_SCAN_RATIO 8
+
+typedef struct {
+	librdf_model *model;
+	BOOL compact;										///< Whether the model uses the compact storage, which can estimate pattern sizes
+	NSUInteger maximumDepth;
+	NSUInteger limit;
+	NSUInteger count;
+	BOOL stopped;
+	__unsafe_unretained RedlandNodeEnumerationBlock block;
+} RedlandPathContext;
+
+/// Receives the nodes produced by a step; nodes are only passed on once
+typedef struct {
+	CFMutableSetRef nodes;
+	BOOL reports;										///< Whether new nodes are final results and are reported to the block
+} RedlandPathSink;
+
+static void RedlandPathEvaluate(RedlandPathContext *context, RedlandPropertyPath *path, BOOL inverse, CFSetRef input, RedlandPathSink *sink);
+
+
+static CFMutableSetRef RedlandPathCreateSet(void)
+{
+	return CFSetCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeSetCallBacks);
+}
+
+static void RedlandPathEmit(RedlandPathContext *context, RedlandPathSink *sink, librdf_node *node)
+{
+	if (context->stopped || CFSetContainsValue(sink->nodes, node)) {
+		return;
+	}
+	CFSetAddValue(sink->nodes, node);
+	if (sink->reports) {
+		BOOL stop = NO;
+		context->block([[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(node)], &stop);
+		context->count++;
+		if (stop || (context->limit > 0 && context->count >= context->limit)) {
+			context->stopped = YES;
+		}
+	}
+}
+
+static void RedlandPathEmitAll(RedlandPathContext *context, RedlandPathSink *sink, CFSetRef nodes)
+{
+	CFIndex count = CFSetGetCount(nodes);
+	const void **values = malloc(count * sizeof(void *));
+	CFSetGetValues(nodes, values);
+	for (CFIndex i = 0; i < count && !context->stopped; i++) {
+		RedlandPathEmit(context, sink, (librdf_node *)values[i]);
+	}
+	free(values);
+}
+
+
+#pragma mark - Steps
+/**
+ *  Whether joining the input with one scan over all statements with the predicate is cheaper than looking up every input node.
+ */
+static BOOL RedlandPathShouldScan(RedlandPathContext *context, librdf_node *predicate, CFIndex inputCount)
+{
+	if (!context->compact) {
+		return NO;
+	}
+	librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], NULL, librdf_new_node_from_node(predicate), NULL);
+	NSUInteger estimate = RedlandCompactStorageCount(librdf_model_get_storage(context->model), pattern, NULL, YES);
+	librdf_free_statement(pattern);
+	return ((NSUInteger)inputCount * REDLAND_PATH_SCAN_RATIO >= estimate);
+}
+
+static void RedlandPathPredicateStep(RedlandPathContext *context, librdf_node *predicate, BOOL inverse, CFSetRef input, RedlandPathSink *sink)
+{
+	CFIndex count = CFSetGetCount(input);
+	if (0 == count) {
+		return;
+	}
+	
+	// large frontier: one scan over the predicate, joined with the input set
+	if (RedlandPathShouldScan(context, predicate, count)) {
+		librdf_statement *pattern = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], NULL, librdf_new_node_from_node(predicate), NULL);
+		librdf_stream *stream = librdf_model_find_statements(context->model, pattern);
+		librdf_free_statement(pattern);
+		while (stream && !librdf_stream_end(stream) && !context->stopped) {
+			librdf_statement *statement = librdf_stream_get_object(stream);
+			librdf_node *from = inverse ? librdf_statement_get_object(statement) : librdf_statement_get_subject(statement);
+			if (CFSetContainsValue(input, from)) {
+				RedlandPathEmit(context, sink, inverse ? librdf_statement_get_subject(statement) : librdf_statement_get_object(statement));
+			}
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		return;
+	}
+	
+	// small frontier: one index lookup per node
+	const void **values = malloc(count * sizeof(void *));
+	CFSetGetValues(input, values);
+	for (CFIndex i = 0; i < count && !context->stopped; i++) {
+		librdf_node *node = (librdf_node *)values[i];
+		if (!inverse && librdf_node_is_literal(node)) {
+			continue;
+		}
+		librdf_iterator *iterator = inverse ? librdf_model_get_sources(context->model, predicate, node) : librdf_model_get_targets(context->model, node, predicate);
+		while (iterator && !librdf_iterator_end(iterator) && !context->stopped) {
+			RedlandPathEmit(context, sink, librdf_iterator_get_object(iterator));
+			librdf_iterator_next(iterator);
+		}
+		if (iterator) {
+			librdf_free_iterator(iterator);
+		}
+	}
+	free(values);
+}
+
+static void RedlandPathSequenceStep(RedlandPathContext *context, NSArray *subpaths, BOOL inverse, CFSetRef input, RedlandPathSink *sink)
+{
+	// ^(p1/p2) is ^p2/^p1
+	NSArray *steps = inverse ? [[subpaths reverseObjectEnumerator] allObjects] : subpaths;
+	NSUInteger last = [steps count] - 1;
+	CFSetRef frontier = CFRetain(input);
+	for (NSUInteger i = 0; i < last && !context->stopped && CFSetGetCount(frontier) > 0; i++) {
+		RedlandPathSink next = { RedlandPathCreateSet(), NO };
+		RedlandPathEvaluate(context, [steps objectAtIndex:i], inverse, frontier, &next);
+		CFRelease(frontier);
+		frontier = next.nodes;
+	}
+	if (!context->stopped) {
+		RedlandPathEvaluate(context, [steps objectAtIndex:last], inverse, frontier, sink);
+	}
+	CFRelease(frontier);
+}
+
+/**
+ *  Applies the subpath level by level, passing on every node reached for the first time, until no new nodes are found or the maximum depth is reached.
+ */
+static void RedlandPathRepeatStep(RedlandPathContext *context, RedlandPropertyPath *subpath, BOOL inverse, BOOL includeInput, CFSetRef input, RedlandPathSink *sink)
+{
+	CFMutableSetRef visited = RedlandPathCreateSet();
+	if (includeInput) {
+		RedlandPathEmitAll(context, sink, input);
+		CFIndex count = CFSetGetCount(input);
+		const void **values = malloc(count * sizeof(void *));
+		CFSetGetValues(input, values);
+		for (CFIndex i = 0; i < count; i++) {
+			CFSetAddValue(visited, values[i]);
+		}
+		free(values);
+	}
+	
+	CFSetRef frontier = CFRetain(input);
+	NSUInteger depth = 0;
+	while (!context->stopped && CFSetGetCount(frontier) > 0 && (0 == context->maximumDepth || depth < context->maximumDepth)) {
+		RedlandPathSink next = { RedlandPathCreateSet(), NO };
+		RedlandPathEvaluate(context, subpath, inverse, frontier, &next);
+		CFRelease(frontier);
+		
+		// keep only the nodes not seen before as the next frontier
+		CFMutableSetRef fresh = RedlandPathCreateSet();
+		CFIndex count = CFSetGetCount(next.nodes);
+		const void **values = malloc(count * sizeof(void *));
+		CFSetGetValues(next.nodes, values);
+		for (CFIndex i = 0; i < count && !context->stopped; i++) {
+			if (!CFSetContainsValue(visited, values[i])) {
+				CFSetAddValue(visited, values[i]);
+				CFSetAddValue(fresh, values[i]);
+				RedlandPathEmit(context, sink, (librdf_node *)values[i]);
+			}
+		}
+		free(values);
+		CFRelease(next.nodes);
+		frontier = fresh;
+		depth++;
+	}
+	CFRelease(frontier);
+	CFRelease(visited);
+}
+
+static void RedlandPathEvaluate(RedlandPathContext *context, RedlandPropertyPath *path, BOOL inverse, CFSetRef input, RedlandPathSink *sink)
+{
+	NSArray *subpaths = path.subpaths;
+	switch (path.type) {
+		case RedlandPropertyPathPredicate:
+			RedlandPathPredicateStep(context, [path.predicate wrappedNode], inverse, input, sink);
+			break;
+		case RedlandPropertyPathSequence:
+			RedlandPathSequenceStep(context, subpaths, inverse, input, sink);
+			break;
+		case RedlandPropertyPathAlternative:
+			for (RedlandPropertyPath *subpath in subpaths) {
+				if (context->stopped) {
+					break;
+				}
+				RedlandPathEvaluate(context, subpath, inverse, input, sink);
+			}
+			break;
+		case RedlandPropertyPathInverse:
+			RedlandPathEvaluate(context, [subpaths objectAtIndex:0], !inverse, input, sink);
+			break;
+		case RedlandPropertyPathZeroOrMore:
+			RedlandPathRepeatStep(context, [subpaths objectAtIndex:0], inverse, YES, input, sink);
+			break;
+		case RedlandPropertyPathOneOrMore:
+			RedlandPathRepeatStep(context, [subpaths objectAtIndex:0], inverse, NO, input, sink);
+			break;
+		case RedlandPropertyPathZeroOrOne:
+			RedlandPathEmitAll(context, sink, input);
+			RedlandPathEvaluate(context, [subpaths objectAtIndex:0], inverse, input, sink);
+			break;
+	}
+}
+
+
+@implementation RedlandModel (PropertyPath)
+
+
+/**
+ *  Returns all nodes reachable from the source node via the given path.
+ *  @param path The path to follow
+ *  @param sourceNode The node to start at
+ *  @return An array of distinct RedlandNode instances
+ */
+- (NSArray *)targetsOfPath:(RedlandPropertyPath *)path fromSource:(RedlandNode *)sourceNode
+{
+	NSMutableArray *targets = [NSMutableArray array];
+	[self enumerateTargetsOfPath:path fromSource:sourceNode maximumDepth:0 limit:0 usingBlock:^(RedlandNode *node, BOOL *stop) {
+		[targets addObject:node];
+	}];
+	return targets;
+}
+
+/**
+ *  Calls the block with every node reachable from the source node via the given path.
+ *
+ *  Results are reported as soon as they are found, every node only once; setting the stop flag ends the evaluation.
+ *  @param path The path to follow
+ *  @param sourceNode The node to start at
+ *  @param maximumDepth The maximum number of repetitions of a * or + path, 0 for no limit
+ *  @param limit The maximum number of results to report, 0 for no limit
+ *  @param block The block to call with every result
+ */
+- (void)enumerateTargetsOfPath:(RedlandPropertyPath *)path
+					fromSource:(RedlandNode *)sourceNode
+				  maximumDepth:(NSUInteger)maximumDepth
+						 limit:(NSUInteger)limit
+					usingBlock:(RedlandNodeEnumerationBlock)block
+{
+	NSParameterAssert(path != nil);
+	NSParameterAssert(sourceNode != nil);
+	NSParameterAssert(block != nil);
+	
+	librdf_model *model = [self wrappedModel];
+	RedlandPathContext context = { model, RedlandStorageIsCompact(librdf_model_get_storage(model)), maximumDepth, limit, 0, NO, block };
+	
+	CFMutableSetRef input = RedlandPathCreateSet();
+	CFSetAddValue(input, [sourceNode wrappedNode]);
+	RedlandPathSink results = { RedlandPathCreateSet(), YES };
+	@try {
+		RedlandPathEvaluate(&context, path, NO, input, &results);
+	}
+	@finally {
+		CFRelease(results.nodes);
+		CFRelease(input);
+	}
+}
+
+
+@end
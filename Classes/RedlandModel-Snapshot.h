@@ -0,0 +1,46 @@
+//
+//  RedlandModel-Snapshot.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel.h"
+
+extern const uint32_t RedlandSnapshotVersion;					///< The version of the snapshot format written by this framework
+
+
+/**
+ *  Saving and loading models in a compact binary snapshot format.
+ *
+ *  A snapshot consists of a 64 byte header, a table of quads and a table of terms. Every distinct node is stored only once in the term table, the quads
+ *  reference terms by their 1-based index (0 stands for "no context"). The header carries a format version and CRC-32 checksums over itself and both
+ *  tables, all integers are little endian.
+ *
+ *  Loading a snapshot does not involve any RDF parsing and the file is memory mapped, which makes it a lot faster than re-parsing RDF/XML or Turtle.
+ */
+@interface RedlandModel (Snapshot)
+
+- (NSData *)snapshotData;
+- (void)writeSnapshotToFile:(NSString *)path;
+
+- (void)loadSnapshotData:(NSData *)data;
+- (void)loadSnapshotFromFile:(NSString *)path;
+
+
+@end
@@ -0,0 +1,662 @@
+//
+//  RedlandModel-Snapshot.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel-Snapshot.h"
+#import "RedlandWorld.h"
+#import "RedlandNode.h"
+#import "RedlandStatement.h"
+#import "RedlandException.h"
+#import "RedlandDescriptionCache.h"
+#import "RedlandCompactStorage.h"
+
+const uint32_t RedlandSnapshotVersion = 1;
+
+static const char RedlandSnapshotMagic[8] = { 'R', 'D', 'F', 'S', 'N', 'A', 'P', '\0' };
+
+/*
+ *  Header layout, all integers little endian:
+ *   0  magic (8 bytes)
+ *   8  format version (uint32)
+ *  12  header CRC, computed with this field set to zero (uint32)
+ *  16  number of quads (uint64)
+ *  24  offset of the quad table (uint64)
+ *  32  number of terms (uint64)
+ *  40  offset of the term table (uint64)
+ *  48  length of the term table (uint64)
+ *  56  CRC of the quad table (uint32)
+ *  60  CRC of the term table (uint32)
+ */
+#define REDLAND_SNAPSHOT_HEADER_LENGTH 64
+#define REDLAND_SNAPSHOT_QUAD_LENGTH 16
+#define REDLAND_SNAPSHOT_BATCH_LENGTH 1024				// statements handed to a compact storage at once
+
+typedef enum {
+	RedlandSnapshotTermURI = 1,
+	RedlandSnapshotTermLiteral = 2,
+	RedlandSnapshotTermBlank = 3
+} RedlandSnapshotTermKind;
+
+
+#pragma mark - CRC-32
+static uint32_t RedlandSnapshotCRCTable[256];
+
+static void RedlandSnapshotCRCInit(void)
+{
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+			}
+			RedlandSnapshotCRCTable[i] = c;
+		}
+	});
+}
+
+/**
+ *  Continues a CRC-32 (IEEE) over the given bytes; start with a crc of 0.
+ */
+static uint32_t RedlandSnapshotCRC(uint32_t crc, const void *bytes, size_t length)
+{
+	const uint8_t *p = bytes;
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++) {
+		crc = RedlandSnapshotCRCTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+
+#pragma mark - Byte Order Helpers
+static void RedlandSnapshotPutUInt32(uint8_t *dest, uint32_t value)
+{
+	value = NSSwapHostIntToLittle(value);
+	memcpy(dest, &value, sizeof(value));
+}
+
+static void RedlandSnapshotPutUInt64(uint8_t *dest, uint64_t value)
+{
+	value = NSSwapHostLongLongToLittle(value);
+	memcpy(dest, &value, sizeof(value));
+}
+
+static uint32_t RedlandSnapshotGetUInt32(const uint8_t *src)
+{
+	uint32_t value;
+	memcpy(&value, src, sizeof(value));
+	return NSSwapLittleIntToHost(value);
+}
+
+static uint64_t RedlandSnapshotGetUInt64(const uint8_t *src)
+{
+	uint64_t value;
+	memcpy(&value, src, sizeof(value));
+	return NSSwapLittleLongLongToHost(value);
+}
+
+static void RedlandSnapshotAppendCounted(NSMutableData *data, const void *bytes, size_t length)
+{
+	uint8_t buffer[4];
+	RedlandSnapshotPutUInt32(buffer, (uint32_t)length);
+	[data appendBytes:buffer length:sizeof(buffer)];
+	if (length > 0) {
+		[data appendBytes:bytes length:length];
+	}
+}
+
+
+
+#pragma mark - Writer
+/**
+ *  Streams the statements of a model into a snapshot, either into a file or into memory.
+ *
+ *  Quads are written as they are read from the model, the term table is collected in memory and appended after the last quad. Finally the header is
+ *  written to the beginning of the output.
+ */
+@interface RedlandSnapshotWriter : NSObject {
+	FILE *file;
+	NSMutableData *output;
+	NSMutableData *pending;
+	NSMutableData *terms;
+	CFMutableDictionaryRef termIDs;
+	uint64_t termCount;
+	uint64_t quadCount;
+	uint32_t quadCRC;
+}
+
+- (id)initWithFile:(FILE *)aFile;
+- (id)initWithData:(NSMutableData *)data;
+- (void)writeModel:(librdf_model *)model;
+
+@end
+
+
+@implementation RedlandSnapshotWriter
+
+- (id)initWithFile:(FILE *)aFile
+{
+	if ((self = [super init])) {
+		file = aFile;
+		pending = [NSMutableData dataWithCapacity:1 << 20];
+		terms = [NSMutableData new];
+		termIDs = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	}
+	return self;
+}
+
+- (id)initWithData:(NSMutableData *)data
+{
+	if ((self = [super init])) {
+		output = data;
+		pending = data;
+		terms = [NSMutableData new];
+		termIDs = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeDictionaryKeyCallBacks, NULL);
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if (termIDs) {
+		CFRelease(termIDs);
+	}
+}
+
+
+- (void)flush
+{
+	if (file && [pending length] > 0) {
+		if ([pending length] != fwrite([pending bytes], 1, [pending length], file)) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"Failed to write snapshot"
+											  userInfo:@{ @"errno": @(errno) }];
+		}
+		[pending setLength:0];
+	}
+}
+
+/**
+ *  Returns the term ID of the given node, appending the node to the term table if it has not been seen before.
+ */
+- (uint32_t)termIDOfNode:(librdf_node *)node
+{
+	const void *known = NULL;
+	if (CFDictionaryGetValueIfPresent(termIDs, node, &known)) {
+		return (uint32_t)(uintptr_t)known;
+	}
+
+	uint8_t kind = 0;
+	size_t length = 0;
+	const unsigned char *bytes = NULL;
+	uint32_t datatypeID = 0;
+
+	switch (librdf_node_get_type(node)) {
+		case LIBRDF_NODE_TYPE_RESOURCE:
+			kind = RedlandSnapshotTermURI;
+			bytes = librdf_uri_as_counted_string(librdf_node_get_uri(node), &length);
+			break;
+		case LIBRDF_NODE_TYPE_LITERAL: {
+			kind = RedlandSnapshotTermLiteral;
+			librdf_uri *datatype = librdf_node_get_literal_value_datatype_uri(node);
+			if (datatype) {
+				librdf_node *datatypeNode = librdf_new_node_from_uri([RedlandWorld defaultWrappedWorld], datatype);
+				datatypeID = [self termIDOfNode:datatypeNode];			// must precede the literal in the term table
+				librdf_free_node(datatypeNode);
+			}
+			bytes = librdf_node_get_literal_value_as_counted_string(node, &length);
+			break;
+		}
+		case LIBRDF_NODE_TYPE_BLANK:
+			kind = RedlandSnapshotTermBlank;
+			bytes = librdf_node_get_blank_identifier(node);
+			length = bytes ? strlen((const char *)bytes) : 0;
+			break;
+		default:
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"Cannot write node of unknown type to snapshot"
+											  userInfo:nil];
+	}
+
+	[terms appendBytes:&kind length:1];
+	RedlandSnapshotAppendCounted(terms, bytes, length);
+	if (RedlandSnapshotTermLiteral == kind) {
+		char *language = librdf_node_get_literal_value_language(node);
+		RedlandSnapshotAppendCounted(terms, language, language ? strlen(language) : 0);
+		uint8_t buffer[4];
+		RedlandSnapshotPutUInt32(buffer, datatypeID);
+		[terms appendBytes:buffer length:sizeof(buffer)];
+	}
+
+	termCount++;
+	if (termCount > UINT32_MAX) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Too many distinct nodes for a snapshot"
+										  userInfo:nil];
+	}
+	CFDictionarySetValue(termIDs, node, (const void *)(uintptr_t)termCount);
+	return (uint32_t)termCount;
+}
+
+- (void)writeModel:(librdf_model *)model
+{
+	RedlandSnapshotCRCInit();
+
+	// placeholder for the header, written last
+	uint8_t header[REDLAND_SNAPSHOT_HEADER_LENGTH];
+	memset(header, 0, sizeof(header));
+	[pending appendBytes:header length:sizeof(header)];
+
+	// quads
+	librdf_stream *stream = librdf_model_as_stream(model);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"librdf_model_as_stream failed"
+										  userInfo:nil];
+	}
+	@try {
+		uint8_t quad[REDLAND_SNAPSHOT_QUAD_LENGTH];
+		while (!librdf_stream_end(stream)) {
+			librdf_statement *statement = librdf_stream_get_object(stream);
+			librdf_node *context = librdf_stream_get_context2(stream);
+			RedlandSnapshotPutUInt32(quad, [self termIDOfNode:librdf_statement_get_subject(statement)]);
+			RedlandSnapshotPutUInt32(quad + 4, [self termIDOfNode:librdf_statement_get_predicate(statement)]);
+			RedlandSnapshotPutUInt32(quad + 8, [self termIDOfNode:librdf_statement_get_object(statement)]);
+			RedlandSnapshotPutUInt32(quad + 12, context ? [self termIDOfNode:context] : 0);
+			quadCRC = RedlandSnapshotCRC(quadCRC, quad, sizeof(quad));
+			[pending appendBytes:quad length:sizeof(quad)];
+			quadCount++;
+
+			if ([pending length] >= (1 << 20)) {
+				[self flush];
+			}
+			librdf_stream_next(stream);
+		}
+	}
+	@finally {
+		librdf_free_stream(stream);
+	}
+
+	// terms
+	[pending appendData:terms];
+	[self flush];
+
+	// header
+	memcpy(header, RedlandSnapshotMagic, sizeof(RedlandSnapshotMagic));
+	RedlandSnapshotPutUInt32(header + 8, RedlandSnapshotVersion);
+	RedlandSnapshotPutUInt64(header + 16, quadCount);
+	RedlandSnapshotPutUInt64(header + 24, REDLAND_SNAPSHOT_HEADER_LENGTH);
+	RedlandSnapshotPutUInt64(header + 32, termCount);
+	RedlandSnapshotPutUInt64(header + 40, REDLAND_SNAPSHOT_HEADER_LENGTH + quadCount * REDLAND_SNAPSHOT_QUAD_LENGTH);
+	RedlandSnapshotPutUInt64(header + 48, [terms length]);
+	RedlandSnapshotPutUInt32(header + 56, quadCRC);
+	RedlandSnapshotPutUInt32(header + 60, RedlandSnapshotCRC(0, [terms bytes], [terms length]));
+	RedlandSnapshotPutUInt32(header + 12, RedlandSnapshotCRC(0, header, sizeof(header)));
+
+	if (file) {
+		if (0 != fseek(file, 0, SEEK_SET) || 1 != fwrite(header, sizeof(header), 1, file)) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"Failed to write snapshot header"
+											  userInfo:@{ @"errno": @(errno) }];
+		}
+	}
+	else {
+		[output replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:header];
+	}
+}
+
+@end
+
+
+
+#pragma mark - Reader
+static void RedlandSnapshotRaise(NSString *reason)
+{
+	@throw [RedlandException exceptionWithName:RedlandExceptionName
+										reason:reason
+									  userInfo:nil];
+}
+
+static void RedlandSnapshotFreeTerms(librdf_node **nodes, uint64_t count)
+{
+	if (NULL == nodes) {
+		return;
+	}
+	for (uint64_t i = 1; i <= count; i++) {
+		if (nodes[i]) {
+			librdf_free_node(nodes[i]);
+		}
+	}
+	free(nodes);
+}
+
+/**
+ *  Decodes the term table into an array of nodes indexed by term ID; index 0 is always NULL.
+ *  @return A malloc'ed array the caller must free with RedlandSnapshotFreeTerms, or NULL if the term table is malformed
+ */
+static librdf_node **RedlandSnapshotDecodeTerms(const uint8_t *bytes, uint64_t length, uint64_t count)
+{
+	librdf_world *world = [RedlandWorld defaultWrappedWorld];
+	librdf_node **nodes = calloc((size_t)count + 1, sizeof(librdf_node *));
+	if (NULL == nodes) {
+		return NULL;
+	}
+
+	const uint8_t *p = bytes;
+	const uint8_t *end = bytes + length;
+	for (uint64_t i = 1; i <= count; i++) {
+		if (end - p < 5) {
+			goto fail;
+		}
+		uint8_t kind = *p++;
+		uint32_t valueLength = RedlandSnapshotGetUInt32(p);
+		p += 4;
+		if ((uint64_t)(end - p) < valueLength) {
+			goto fail;
+		}
+		const unsigned char *value = p;
+		p += valueLength;
+
+		switch (kind) {
+			case RedlandSnapshotTermURI:
+				nodes[i] = librdf_new_node_from_counted_uri_string(world, value, valueLength);
+				break;
+			case RedlandSnapshotTermBlank:
+				nodes[i] = librdf_new_node_from_counted_blank_identifier(world, value, valueLength);
+				break;
+			case RedlandSnapshotTermLiteral: {
+				if (end - p < 4) {
+					goto fail;
+				}
+				uint32_t languageLength = RedlandSnapshotGetUInt32(p);
+				p += 4;
+				if ((uint64_t)(end - p) < (uint64_t)languageLength + 4) {
+					goto fail;
+				}
+				const char *language = (const char *)p;
+				p += languageLength;
+				uint32_t datatypeID = RedlandSnapshotGetUInt32(p);
+				p += 4;
+
+				librdf_uri *datatype = NULL;
+				if (datatypeID > 0) {
+					if (datatypeID >= i || !librdf_node_is_resource(nodes[datatypeID])) {
+						goto fail;
+					}
+					datatype = librdf_node_get_uri(nodes[datatypeID]);
+				}
+				nodes[i] = librdf_new_node_from_typed_counted_literal(world,
+																	  value, valueLength,
+																	  (languageLength > 0) ? language : NULL, languageLength,
+																	  datatype);
+				break;
+			}
+			default:
+				goto fail;
+		}
+		if (NULL == nodes[i]) {
+			goto fail;
+		}
+	}
+	return nodes;
+
+fail:
+	RedlandSnapshotFreeTerms(nodes, count);
+	return NULL;
+}
+
+
+
+#pragma mark - Category
+@implementation RedlandModel (Snapshot)
+
+/**
+ *  Returns a binary snapshot of all statements in the receiver, including their contexts.
+ *  @return An NSData instance containing the snapshot
+ */
+- (NSData *)snapshotData
+{
+	NSMutableData *data = [NSMutableData data];
+	RedlandSnapshotWriter *writer = [[RedlandSnapshotWriter alloc] initWithData:data];
+	[writer writeModel:[self wrappedModel]];
+	return data;
+}
+
+/**
+ *  Writes a binary snapshot of all statements in the receiver to the given file.
+ *
+ *  Quads are streamed to the file as they are read from the model, only the table of distinct nodes is kept in memory.
+ *  @warning Raises a RedlandException if the file cannot be written.
+ *  @param path The path of the file to write; an existing file is overwritten
+ */
+- (void)writeSnapshotToFile:(NSString *)path
+{
+	NSParameterAssert(path != nil);
+
+	FILE *file = fopen([path fileSystemRepresentation], "wb");
+	if (NULL == file) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:[NSString stringWithFormat:@"Could not open %@ for writing", path]
+										  userInfo:@{ @"errno": @(errno) }];
+	}
+	@try {
+		RedlandSnapshotWriter *writer = [[RedlandSnapshotWriter alloc] initWithFile:file];
+		[writer writeModel:[self wrappedModel]];
+	}
+	@finally {
+		fclose(file);
+	}
+}
+
+/**
+ *  Adds all statements contained in the given snapshot to the receiver.
+ *
+ *  The snapshot is validated completely (header, checksums and term references) before the first statement is added, so a corrupt snapshot leaves the
+ *  receiver untouched. Statements are added in one transaction if the storage supports transactions. A compact storage receives them in batches and
+ *  merges its sorted indexes once after the last statement instead of once per filled delta buffer.
+ *  @warning Raises a RedlandException if the data is not a valid snapshot or if adding a statement fails.
+ *  @param data The snapshot data, as returned from snapshotData
+ */
+- (void)loadSnapshotData:(NSData *)data
+{
+	NSParameterAssert(data != nil);
+	RedlandSnapshotCRCInit();
+
+	// validate the header
+	const uint8_t *bytes = [data bytes];
+	uint64_t length = [data length];
+	if (length < REDLAND_SNAPSHOT_HEADER_LENGTH || 0 != memcmp(bytes, RedlandSnapshotMagic, sizeof(RedlandSnapshotMagic))) {
+		RedlandSnapshotRaise(@"Not a Redland snapshot");
+	}
+	uint32_t version = RedlandSnapshotGetUInt32(bytes + 8);
+	if (version != RedlandSnapshotVersion) {
+		RedlandSnapshotRaise([NSString stringWithFormat:@"Unsupported snapshot version %u", version]);
+	}
+
+	uint8_t header[REDLAND_SNAPSHOT_HEADER_LENGTH];
+	memcpy(header, bytes, sizeof(header));
+	RedlandSnapshotPutUInt32(header + 12, 0);
+	if (RedlandSnapshotGetUInt32(bytes + 12) != RedlandSnapshotCRC(0, header, sizeof(header))) {
+		RedlandSnapshotRaise(@"Snapshot header checksum mismatch");
+	}
+
+	uint64_t quadCount = RedlandSnapshotGetUInt64(bytes + 16);
+	uint64_t quadOffset = RedlandSnapshotGetUInt64(bytes + 24);
+	uint64_t termCount = RedlandSnapshotGetUInt64(bytes + 32);
+	uint64_t termOffset = RedlandSnapshotGetUInt64(bytes + 40);
+	uint64_t termLength = RedlandSnapshotGetUInt64(bytes + 48);
+	if (termCount > UINT32_MAX
+		|| quadCount > (length / REDLAND_SNAPSHOT_QUAD_LENGTH)
+		|| quadOffset > length || length - quadOffset < quadCount * REDLAND_SNAPSHOT_QUAD_LENGTH
+		|| termOffset > length || length - termOffset < termLength) {
+		RedlandSnapshotRaise(@"Snapshot is truncated");
+	}
+
+	const uint8_t *quads = bytes + quadOffset;
+	if (RedlandSnapshotGetUInt32(bytes + 56) != RedlandSnapshotCRC(0, quads, (size_t)(quadCount * REDLAND_SNAPSHOT_QUAD_LENGTH))
+		|| RedlandSnapshotGetUInt32(bytes + 60) != RedlandSnapshotCRC(0, bytes + termOffset, (size_t)termLength)) {
+		RedlandSnapshotRaise(@"Snapshot checksum mismatch");
+	}
+
+	// check term references before touching the model
+	for (uint64_t i = 0; i < quadCount; i++) {
+		const uint8_t *quad = quads + i * REDLAND_SNAPSHOT_QUAD_LENGTH;
+		for (int k = 0; k < 4; k++) {
+			uint32_t termID = RedlandSnapshotGetUInt32(quad + 4 * k);
+			if (termID > termCount || (0 == termID && k < 3)) {
+				RedlandSnapshotRaise(@"Snapshot references an unknown term");
+			}
+		}
+	}
+
+	librdf_node **nodes = RedlandSnapshotDecodeTerms(bytes + termOffset, termLength, termCount);
+	if (NULL == nodes) {
+		RedlandSnapshotRaise(@"Snapshot term table is malformed");
+	}
+
+	// add the statements; a compact storage takes them in batches per context and merges its indexes only once at the end
+	librdf_model *model = [self wrappedModel];
+	librdf_storage *storage = librdf_model_get_storage(model);
+	BOOL compact = (storage && RedlandStorageIsCompact(storage));
+	librdf_statement *statement = librdf_new_statement([RedlandWorld defaultWrappedWorld]);
+	librdf_statement **batch = compact ? calloc(REDLAND_SNAPSHOT_BATCH_LENGTH, sizeof(librdf_statement *)) : NULL;
+	if (compact && !batch) {
+		librdf_free_statement(statement);
+		RedlandSnapshotFreeTerms(nodes, termCount);
+		[NSException raise:NSMallocException format:@"Failed to allocate snapshot batch"];
+	}
+	__block size_t batchCount = 0;
+	__block librdf_node *batchContext = NULL;
+	BOOL (^flushBatch)(BOOL) = ^(BOOL merge) {
+		int result = RedlandCompactStorageAddStatements(storage, batch, batchCount, batchContext, merge);
+		for (size_t i = 0; i < batchCount; i++) {
+			librdf_free_statement(batch[i]);
+		}
+		batchCount = 0;
+		return (BOOL)(0 == result);
+	};
+	NSMutableArray *added = [self hasChangeObservers] ? [NSMutableArray array] : nil;
+	BOOL inTransaction = (!compact && 0 == librdf_model_transaction_start(model));
+	@try {
+		for (uint64_t i = 0; i < quadCount; i++) {
+			const uint8_t *quad = quads + i * REDLAND_SNAPSHOT_QUAD_LENGTH;
+			uint32_t contextID = RedlandSnapshotGetUInt32(quad + 12);
+
+			librdf_statement_clear(statement);
+			librdf_statement_set_subject(statement, librdf_new_node_from_node(nodes[RedlandSnapshotGetUInt32(quad)]));
+			librdf_statement_set_predicate(statement, librdf_new_node_from_node(nodes[RedlandSnapshotGetUInt32(quad + 4)]));
+			librdf_statement_set_object(statement, librdf_new_node_from_node(nodes[RedlandSnapshotGetUInt32(quad + 8)]));
+
+			// the snapshot holds every quad once, so checking before the pending batch has been added is enough
+			librdf_node *context = (contextID > 0) ? nodes[contextID] : NULL;
+			BOOL isNew = (added && 1 != RedlandModelContainsStatementInContext(model, statement, context));
+			librdf_statement *copy = NULL;
+			if (compact || isNew) {
+				// the buffer statement is refilled for every quad, a copy of it would be the same object; build a new one from the nodes
+				copy = librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld],
+													   librdf_new_node_from_node(librdf_statement_get_subject(statement)),
+													   librdf_new_node_from_node(librdf_statement_get_predicate(statement)),
+													   librdf_new_node_from_node(librdf_statement_get_object(statement)));
+				if (!copy) {
+					[NSException raise:NSMallocException format:@"Failed to copy snapshot statement"];
+				}
+			}
+			if (compact) {
+				if (batchCount > 0 && (context != batchContext || REDLAND_SNAPSHOT_BATCH_LENGTH == batchCount) && !flushBatch(NO)) {
+					if (copy) {
+						librdf_free_statement(copy);
+					}
+					RedlandSnapshotRaise(@"Failed to add snapshot statement to the model");
+				}
+				batchContext = context;
+				batch[batchCount++] = isNew ? librdf_new_statement_from_statement(copy) : copy;
+			}
+			else {
+				int result = context
+					? librdf_model_context_add_statement(model, context, statement)
+					: librdf_model_add_statement(model, statement);
+				if (0 != result) {
+					if (copy) {
+						librdf_free_statement(copy);
+					}
+					RedlandSnapshotRaise(@"Failed to add snapshot statement to the model");
+				}
+			}
+			if (isNew) {
+				RedlandStatement *addedStatement = [[RedlandStatement alloc] initWithWrappedObject:copy];
+				RedlandNode *contextNode = context ? [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(context)] : nil;
+				[added addObject:contextNode ? @[addedStatement, contextNode] : @[addedStatement]];
+			}
+		}
+		if (compact && !flushBatch(YES)) {
+			RedlandSnapshotRaise(@"Failed to add snapshot statement to the model");
+		}
+		if (inTransaction) {
+			librdf_model_transaction_commit(model);
+			inTransaction = NO;
+		}
+		if ([added count] > 0) {
+			[self performChanges:^{
+				for (NSArray *change in added) {
+					[self didAddStatement:change[0] withContext:([change count] > 1) ? change[1] : nil];
+				}
+			}];
+		}
+	}
+	@finally {
+		if (inTransaction) {
+			librdf_model_transaction_rollback(model);
+		}
+		for (size_t i = 0; i < batchCount; i++) {
+			librdf_free_statement(batch[i]);
+		}
+		free(batch);
+		librdf_free_statement(statement);
+		RedlandSnapshotFreeTerms(nodes, termCount);
+		[[self descriptionCache] removeAllDescriptions];
+		[self bumpVersion];
+	}
+}
+
+/**
+ *  Adds all statements contained in the snapshot file at the given path to the receiver.
+ *
+ *  The file is memory mapped and read sequentially, it is never loaded into memory as a whole.
+ *  @warning Raises a RedlandException if the file cannot be read or is not a valid snapshot.
+ *  @param path The path of the snapshot file
+ */
+- (void)loadSnapshotFromFile:(NSString *)path
+{
+	NSParameterAssert(path != nil);
+
+	NSError *error = nil;
+	NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:&error];
+	if (nil == data) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:[NSString stringWithFormat:@"Could not read snapshot %@", path]
+										  userInfo:error ? @{ @"error": error } : nil];
+	}
+	[self loadSnapshotData:data];
+}
+
+
+@end
@@ -27,7 +27,13 @@
 #import <redland.h>
 #import "RedlandWrappedObject.h"
 
-@class RedlandStorage, RedlandStream, RedlandStatement, RedlandNode, RedlandIterator, RedlandIteratorEnumerator, RedlandStreamEnumerator;
+@class RedlandStorage, RedlandStream, RedlandStatement, RedlandNode, RedlandIterator, RedlandIteratorEnumerator, RedlandStreamEnumerator, RedlandDescriptionCache, RedlandChangeSet, RedlandCancellationToken, RedlandModel;
+
+typedef void (^RedlandModelChangeBlock)(RedlandModel *model, RedlandChangeSet *changes);
+typedef void (^RedlandContextCountBlock)(RedlandNode *context, NSUInteger count, BOOL *stop);
+
+extern int RedlandModelContainsStatement(librdf_model *model, librdf_statement *statement, librdf_node *context);
+extern int RedlandModelContainsStatementInContext(librdf_model *model, librdf_statement *statement, librdf_node *context);
 
 /**
  *  This class provides the RDF model support.
@@ -37,6 +43,11 @@
  */
 @interface RedlandModel : RedlandWrappedObject
 
+/// An optional cache answering lookups of outgoing arcs from memory; nil by default. See RedlandDescriptionCache.
+@property (nonatomic, strong) RedlandDescriptionCache *descriptionCache;
+
+/// Changes whenever statements are added or removed; versions are unique among all models. See RedlandQueryCache.
+@property (nonatomic, readonly, assign) uint64_t version;
 
 + (id)modelWithStorage:(RedlandStorage *)aStorage;
 - (id)initWithStorage:(RedlandStorage *)aStorage;
@@ -46,20 +57,28 @@
 - (int)size;
 - (void)sync;
 
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement;
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
+- (NSUInteger)estimatedCountOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
+
 - (RedlandStorage *)storage;
 
 - (void)addStatement:(RedlandStatement *)aStatement;
 - (void)addStatementsFromStream:(RedlandStream *)aStream;
 - (void)addStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
 - (void)addStatementsFromStream:(RedlandStream *)aStream withContext:(RedlandNode *)contextNode;
+- (void)addStatementsFromStream:(RedlandStream *)aStream withContext:(RedlandNode *)contextNode cancellationToken:(RedlandCancellationToken *)token;
 
 - (BOOL)containsStatement:(RedlandStatement *)aStatement;
 - (BOOL)removeStatement:(RedlandStatement *)aStatement;
 - (BOOL)removeStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
 - (void)removeStatementsLike:(RedlandStatement *)aStatement;
 - (void)removeAllStatementsWithContext:(RedlandNode *)contextNode;
+- (void)replaceContext:(RedlandNode *)contextNode withStream:(RedlandStream *)aStream;
 
 - (BOOL)containsContext:(RedlandNode *)contextNode;
+- (NSDictionary *)statementCountsByContext;
+- (void)enumerateContextsWithCountsUsingBlock:(RedlandContextCountBlock)block;
 
 - (RedlandModel *)submodelForSubject:(RedlandNode *)aSubject;
 - (BOOL)addSubmodel:(RedlandModel *)submodel;
@@ -86,6 +105,15 @@
 - (BOOL)node:(RedlandNode *)sourceNode hasOutgoingArc:(RedlandNode *)arcNode;
 
 
+- (void)bumpVersion;
+
+- (id)addChangeObserverWithQueue:(NSOperationQueue *)queue usingBlock:(RedlandModelChangeBlock)block;
+- (void)removeChangeObserver:(id)observer;
+- (BOOL)hasChangeObservers;
+- (void)performChanges:(void (^)(void))changes;
+- (void)didAddStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
+- (void)didRemoveStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode;
+
 - (RedlandNode *)valueOfFeature:(id)featureURI;
 - (void)setValue:(RedlandNode *)featureValue ofFeature:(id)featureURI;
 
@@ -36,6 +36,79 @@
 #import "RedlandSerializer.h"
 #import "RedlandModel-Convenience.h"
 #import "RedlandException.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandDescriptionCache.h"
+#import "RedlandChangeSet.h"
+#import "RedlandCancellationToken.h"
+
+/**
+ *  A block registered with addChangeObserverWithQueue:usingBlock:.
+ */
+@interface RedlandModelChangeObserver : NSObject
+
+@property (nonatomic, strong) NSOperationQueue *queue;
+@property (nonatomic, copy) RedlandModelChangeBlock block;
+
+@end
+
+@implementation RedlandModelChangeObserver
+@end
+
+
+@interface RedlandModel () {
+	NSMutableArray *changeObservers;					///< nil while no observer is registered, so unobserved mutations skip all bookkeeping
+	RedlandChangeSet *pendingChanges;					///< Changes not yet delivered
+	NSUInteger batchDepth;								///< Nesting level of performChanges:
+}
+
+@end
+
+
+/**
+ *  Whether the statement is in the model; in the given context if one is given, in any context otherwise.
+ *  @return 1 if it is, 0 if it is not and -1 if the storage could not be asked
+ */
+int RedlandModelContainsStatement(librdf_model *model, librdf_statement *statement, librdf_node *context)
+{
+	if (NULL == context) {
+		int result = librdf_model_contains_statement(model, statement);
+		return (result < 0) ? -1 : (0 != result);
+	}
+	librdf_stream *stream = librdf_model_find_statements_in_context(model, statement, context);
+	if (NULL == stream) {
+		return -1;
+	}
+	int found = !librdf_stream_end(stream);
+	librdf_free_stream(stream);
+	return found;
+}
+
+/**
+ *  Whether the model holds exactly this pair of statement and context; a NULL context stands for the statement without a context, copies of the statement
+ *  in named contexts do not count.
+ *  @return 1 if it does, 0 if it does not and -1 if the storage could not be asked
+ */
+int RedlandModelContainsStatementInContext(librdf_model *model, librdf_statement *statement, librdf_node *context)
+{
+	if (context) {
+		return RedlandModelContainsStatement(model, statement, context);
+	}
+	librdf_stream *stream = librdf_model_find_statements(model, statement);
+	if (NULL == stream) {
+		return -1;
+	}
+	int found = 0;
+	while (!found && !librdf_stream_end(stream)) {
+		found = (NULL == librdf_stream_get_context2(stream));
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+	return found;
+}
+
+
+static volatile uint64_t RedlandModelVersionCounter = 0;			///< The last version handed out to any model
+
 
 @implementation RedlandModel
 
@@ -67,6 +140,9 @@
 	if (self == nil) {
 		librdf_free_model(model);
 	}
+	else {
+		[self bumpVersion];
+	}
 	return self;
 }
 
@@ -104,13 +180,87 @@
 
 /**
  *  Returns the number of statements in the receiver.
- *  @return The number of statements in the model, or a negative value on failure.
- *  @warning Not all stores support this function. If you absolutely need an accurate size, you can enumerate the statements manually. Also, for submodels
- *  with the same store this still returns the size of the parent model.
+ *
+ *  Stores that can not report their size are counted with countOfStatementsLike:withContext: instead.
+ *  @return The number of statements in the model
+ *  @warning For submodels with the same store this still returns the size of the parent model.
  */
 - (int)size
 {
-	return librdf_model_size(wrappedObject);
+	int size = librdf_model_size(wrappedObject);
+	if (size < 0) {
+		NSUInteger count = [self countOfStatementsLike:nil withContext:nil];
+		size = (count > INT_MAX) ? INT_MAX : (int)count;
+	}
+	return size;
+}
+
+
+
+#pragma mark - Counting
+/**
+ *  Returns a stream of the statements matching the given statement and context; a NULL statement matches all statements.
+ */
+static librdf_stream *RedlandModelFindStatements(librdf_model *model, librdf_statement *statement, librdf_node *context)
+{
+	if (statement) {
+		return context ? librdf_model_find_statements_in_context(model, statement, context) : librdf_model_find_statements(model, statement);
+	}
+	return context ? librdf_model_context_as_stream(model, context) : librdf_model_as_stream(model);
+}
+
+/**
+ *  Returns the number of statements matching the given statement.
+ *  @param aStatement The statement to match, nil nodes act as wildcards; may be nil to count all statements
+ */
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement
+{
+	return [self countOfStatementsLike:aStatement withContext:nil];
+}
+
+/**
+ *  Returns the number of statements matching the given statement and context.
+ *
+ *  The statements are counted in C without creating any objects per match; the compact storage counts most patterns from its index sizes alone.
+ *  @param aStatement The statement to match, nil nodes act as wildcards; may be nil to count all statements
+ *  @param contextNode The context to count; may be nil to count statements in any context
+ */
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	librdf_storage *storage = librdf_model_get_storage(wrappedObject);
+	if (RedlandStorageIsCompact(storage)) {
+		return RedlandCompactStorageCount(storage, [aStatement wrappedStatement], [contextNode wrappedNode], NO);
+	}
+	
+	librdf_stream *stream = RedlandModelFindStatements(wrappedObject, [aStatement wrappedStatement], [contextNode wrappedNode]);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream to count statements"
+										  userInfo:nil];
+	}
+	NSUInteger count = 0;
+	while (!librdf_stream_end(stream)) {
+		count++;
+		librdf_stream_next(stream);
+	}
+	librdf_free_stream(stream);
+	return count;
+}
+
+/**
+ *  Returns an estimate of the number of statements matching the given statement and context.
+ *
+ *  Stores that can answer from their index sizes do so, which is at least as large as the exact count; all other stores return the exact count.
+ *  @param aStatement The statement to match, nil nodes act as wildcards; may be nil to count all statements
+ *  @param contextNode The context to count; may be nil to count statements in any context
+ */
+- (NSUInteger)estimatedCountOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	librdf_storage *storage = librdf_model_get_storage(wrappedObject);
+	if (RedlandStorageIsCompact(storage)) {
+		return RedlandCompactStorageCount(storage, [aStatement wrappedStatement], [contextNode wrappedNode], YES);
+	}
+	return [self countOfStatementsLike:aStatement withContext:contextNode];
 }
 
 
@@ -125,6 +275,7 @@
 {
 	librdf_statement *statement;
 	NSParameterAssert(aStatement != nil);
+	int contained = changeObservers ? RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], NULL) : 1;
 	statement = librdf_new_statement_from_statement([aStatement wrappedStatement]);
 	if (statement == NULL) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
@@ -137,6 +288,11 @@
 											reason:@"librdf_model_add_statement failed"
 										  userInfo:@{ @"statement": aStatement, @"model": self }];
 	}
+	[_descriptionCache removeDescriptionOfSubject:[aStatement subject]];
+	[self bumpVersion];
+	if (1 != contained && 0 != RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], NULL)) {
+		[self didAddStatement:aStatement withContext:nil];
+	}
 }
 
 /**
@@ -147,7 +303,14 @@
 - (void)addStatementsFromStream:(RedlandStream *)aStream
 {
 	NSParameterAssert(aStream != nil);
-	if (librdf_model_add_statements(wrappedObject, [aStream wrappedStream]) != 0) {
+	if (changeObservers) {
+		[self addObservedStatementsFromStream:aStream withContext:nil];
+		return;
+	}
+	int result = librdf_model_add_statements(wrappedObject, [aStream wrappedStream]);
+	[_descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+	if (result != 0) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
 											reason:@"librdf_model_add_statements failed"
 										  userInfo:nil];
@@ -163,6 +326,7 @@
 {
 	librdf_statement *statement;
 	NSParameterAssert(aStatement != nil);
+	int contained = changeObservers ? RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], [contextNode wrappedNode]) : 1;
 	statement = librdf_new_statement_from_statement([aStatement wrappedStatement]);
 	if (librdf_model_context_add_statement(wrappedObject,
 										   [contextNode wrappedNode],
@@ -172,6 +336,11 @@
 											reason:@"librdf_model_context_add_statement failed"
 										  userInfo:nil];
 	}
+	[_descriptionCache removeDescriptionOfSubject:[aStatement subject]];
+	[self bumpVersion];
+	if (1 != contained && 0 != RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], [contextNode wrappedNode])) {
+		[self didAddStatement:aStatement withContext:contextNode];
+	}
 }
 
 /**
@@ -182,13 +351,102 @@
 - (void)addStatementsFromStream:(RedlandStream *)aStream withContext:(RedlandNode *)contextNode
 {
 	NSParameterAssert(aStream != nil);
-	if (librdf_model_context_add_statements(wrappedObject, [contextNode wrappedNode], [aStream wrappedStream]) != 0) {
+	if (changeObservers) {
+		[self addObservedStatementsFromStream:aStream withContext:contextNode];
+		return;
+	}
+	int result = librdf_model_context_add_statements(wrappedObject, [contextNode wrappedNode], [aStream wrappedStream]);
+	[_descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+	if (result != 0) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
 											reason:@"librdf_model_context_add_statements failed"
 										  userInfo:nil];
 	}
 }
 
+/**
+ *  Adds a stream of statements to the receiver in the given context, checking the token before every statement.
+ *
+ *  If the token fires, adding fails or librdf reports an error while the stream is read (like a parse error of a parser's stream), the statements
+ *  added so far are rolled back (or removed again if the storage does not support transactions) before the exception is re-raised, so the receiver
+ *  is left unchanged. Observers learn about the added statements once all of them were added.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled, a RedlandException for errors reported by librdf.
+ *  @param aStream A stream of complete statements
+ *  @param contextNode The context to associate each statement with, may be nil
+ *  @param token The cancellation token; nil behaves like addStatementsFromStream:withContext:
+ */
+- (void)addStatementsFromStream:(RedlandStream *)aStream withContext:(RedlandNode *)contextNode cancellationToken:(RedlandCancellationToken *)token
+{
+	NSParameterAssert(aStream != nil);
+	if (nil == token) {
+		if (contextNode) {
+			[self addStatementsFromStream:aStream withContext:contextNode];
+		}
+		else {
+			[self addStatementsFromStream:aStream];
+		}
+		return;
+	}
+	
+	librdf_stream *stream = [aStream wrappedStream];
+	librdf_node *context = [contextNode wrappedNode];
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	NSMutableArray *added = [NSMutableArray array];
+	BOOL inTransaction = (0 == librdf_model_transaction_start(wrappedObject));
+	BOOL completed = NO;
+	@try {
+		while (!librdf_stream_end(stream)) {
+			[token throwIfCancelled];
+			librdf_statement *statement = librdf_stream_get_object(stream);
+			int contained = RedlandModelContainsStatementInContext(wrappedObject, statement, context);
+			if (contained < 0) {
+				@throw [RedlandException exceptionWithName:RedlandExceptionName
+													reason:@"Could not check whether the model contains a statement"
+												  userInfo:nil];
+			}
+			if (!contained) {
+				if (0 != librdf_model_context_add_statement(wrappedObject, context, statement)) {
+					@throw [RedlandException exceptionWithName:RedlandExceptionName
+														reason:@"librdf_model_context_add_statement failed"
+													  userInfo:nil];
+				}
+				[added addObject:[[RedlandStatement alloc] initWithWrappedObject:librdf_new_statement_from_statement(statement)]];
+			}
+			librdf_stream_next(stream);
+			[world handleStoredErrors];					// e.g. a parse error of a parser stream, raised before anything is committed
+		}
+		[world handleStoredErrors];						// the stream may end right away on an error
+		[token throwIfCancelled];
+		if (inTransaction) {
+			librdf_model_transaction_commit(wrappedObject);
+		}
+		completed = YES;
+	}
+	@finally {
+		if (!completed) {
+			if (inTransaction) {
+				librdf_model_transaction_rollback(wrappedObject);
+			}
+			else {
+				for (RedlandStatement *statement in added) {
+					librdf_model_context_remove_statement(wrappedObject, context, [statement wrappedStatement]);
+				}
+			}
+		}
+		[_descriptionCache removeAllDescriptions];
+		[self bumpVersion];
+	}
+	
+	if (changeObservers && [added count] > 0) {
+		[self performChanges:^{
+			for (RedlandStatement *statement in added) {
+				[self didAddStatement:statement withContext:contextNode];
+			}
+		}];
+	}
+}
+
 /**
  *  Returns YES if the receiver contains the given statement.
  *  @param aStatement A complete statement
@@ -197,7 +455,7 @@
 - (BOOL)containsStatement:(RedlandStatement *)aStatement
 {
 	NSParameterAssert(aStatement != nil);
-	return librdf_model_contains_statement(wrappedObject, [aStatement wrappedStatement]);
+	return (librdf_model_contains_statement(wrappedObject, [aStatement wrappedStatement]) > 0);
 }
 
 /**
@@ -208,7 +466,14 @@
 - (BOOL)removeStatement:(RedlandStatement *)aStatement
 {
 	NSParameterAssert(aStatement != nil);
-	return (0 == librdf_model_remove_statement(wrappedObject, [aStatement wrappedStatement]));
+	int contained = changeObservers ? RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], NULL) : 0;
+	int result = librdf_model_remove_statement(wrappedObject, [aStatement wrappedStatement]);
+	[_descriptionCache removeDescriptionOfSubject:[aStatement subject]];
+	[self bumpVersion];
+	if (0 != contained && 0 == result && 1 != RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], NULL)) {
+		[self didRemoveStatement:aStatement withContext:nil];
+	}
+	return (0 == result);
 }
 
 /**
@@ -221,9 +486,15 @@
 {
 	NSParameterAssert(aStatement != nil);
 	
+	int contained = changeObservers ? RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], [contextNode wrappedNode]) : 0;
 	int result = librdf_model_context_remove_statement(wrappedObject,
 													   [contextNode wrappedNode],
 													   [aStatement wrappedStatement]);
+	[_descriptionCache removeDescriptionOfSubject:[aStatement subject]];
+	[self bumpVersion];
+	if (0 != contained && 0 == result && 1 != RedlandModelContainsStatementInContext(wrappedObject, [aStatement wrappedStatement], [contextNode wrappedNode])) {
+		[self didRemoveStatement:aStatement withContext:contextNode];
+	}
 	return (0 == result);
 }
 
@@ -250,11 +521,189 @@
 - (void)removeAllStatementsWithContext:(RedlandNode *)contextNode
 {
 	NSParameterAssert(contextNode != nil);
-	if (librdf_model_context_remove_statements(wrappedObject, [contextNode wrappedNode]) != 0) {
+	
+	// observers are told which statements were removed, so collect them first
+	NSMutableArray *removed = nil;
+	if (changeObservers) {
+		removed = [NSMutableArray array];
+		librdf_stream *stream = librdf_model_context_as_stream(wrappedObject, [contextNode wrappedNode]);
+		while (stream && !librdf_stream_end(stream)) {
+			librdf_statement *statement = librdf_new_statement_from_statement(librdf_stream_get_object(stream));
+			[removed addObject:[[RedlandStatement alloc] initWithWrappedObject:statement]];
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+	}
+	
+	int result = librdf_model_context_remove_statements(wrappedObject, [contextNode wrappedNode]);
+	[_descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+	if (result != 0) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
 											reason:@"librdf_model_context_remove_statements failed"
 										  userInfo:nil];
 	}
+	if ([removed count] > 0) {
+		[self performChanges:^{
+			for (RedlandStatement *statement in removed) {
+				[self didRemoveStatement:statement withContext:contextNode];
+			}
+		}];
+	}
+}
+
+/**
+ *  Replaces all statements of a context with the statements of a stream, e.g. to refresh a named graph from its source.
+ *
+ *  The new statements are read from the stream first, then only the difference to the current statements of the context is applied.
+ *
+ *  The replacement is atomic only on the compact storage: there the difference is applied in one step under the storage's lock, so readers see either
+ *  the old or the new statements of the context but never an empty or partial context. Everywhere else it is not atomic. Storages that support
+ *  transactions apply the difference inside a transaction. Storages without transactions, like the hashes and memory storages, apply it one statement
+ *  at a time, so readers may see a partial context, and a failure is handled by a best-effort undo: the changes already applied are reverted one by one
+ *  before the exception is raised, which can itself fail and leave the context partly replaced.
+ *
+ *  Observers are told about the statements that were actually removed and added.
+ *  @param contextNode The context to replace
+ *  @param aStream A stream of the complete statements the context should contain
+ */
+- (void)replaceContext:(RedlandNode *)contextNode withStream:(RedlandStream *)aStream
+{
+	NSParameterAssert(contextNode != nil);
+	NSParameterAssert(aStream != nil);
+	
+	// build the new graph aside
+	NSMutableOrderedSet *incoming = [NSMutableOrderedSet orderedSet];
+	librdf_stream *stream = [aStream wrappedStream];
+	while (!librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_new_statement_from_statement(librdf_stream_get_object(stream));
+		[incoming addObject:[[RedlandStatement alloc] initWithWrappedObject:statement]];
+		librdf_stream_next(stream);
+	}
+	
+	librdf_node *context = [contextNode wrappedNode];
+	librdf_storage *storage = librdf_model_get_storage(wrappedObject);
+	NSMutableArray *removed = [NSMutableArray array];
+	NSMutableArray *added = [NSMutableArray array];
+	int result = 0;
+	if (RedlandStorageIsCompact(storage)) {
+		NSUInteger count = [incoming count];
+		librdf_statement **statements = malloc(MAX(count, (NSUInteger)1) * sizeof(librdf_statement *));
+		for (NSUInteger i = 0; i < count; i++) {
+			statements[i] = [[incoming objectAtIndex:i] wrappedStatement];
+		}
+		BOOL report = (nil != changeObservers);
+		librdf_statement **removedStatements = NULL;
+		librdf_statement **addedStatements = NULL;
+		size_t removedCount = 0;
+		size_t addedCount = 0;
+		result = RedlandCompactStorageReplaceContext(storage, context, statements, count,
+													 report ? &removedStatements : NULL, &removedCount, report ? &addedStatements : NULL, &addedCount);
+		free(statements);
+		for (size_t i = 0; i < removedCount; i++) {
+			[removed addObject:[[RedlandStatement alloc] initWithWrappedObject:removedStatements[i]]];
+		}
+		for (size_t i = 0; i < addedCount; i++) {
+			[added addObject:[[RedlandStatement alloc] initWithWrappedObject:addedStatements[i]]];
+		}
+		free(removedStatements);
+		free(addedStatements);
+	}
+	else {
+		NSMutableSet *existing = [NSMutableSet set];
+		stream = librdf_model_context_as_stream(wrappedObject, context);
+		while (stream && !librdf_stream_end(stream)) {
+			librdf_statement *statement = librdf_new_statement_from_statement(librdf_stream_get_object(stream));
+			[existing addObject:[[RedlandStatement alloc] initWithWrappedObject:statement]];
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		for (RedlandStatement *statement in existing) {
+			if (![incoming containsObject:statement]) {
+				[removed addObject:statement];
+			}
+		}
+		for (RedlandStatement *statement in incoming) {
+			if (![existing containsObject:statement]) {
+				[added addObject:statement];
+			}
+		}
+		
+		BOOL inTransaction = (0 == librdf_model_transaction_start(wrappedObject));
+		NSUInteger removedApplied = 0;
+		NSUInteger addedApplied = 0;
+		for (; 0 == result && removedApplied < [removed count]; removedApplied++) {
+			if (0 != (result = librdf_model_context_remove_statement(wrappedObject, context, [[removed objectAtIndex:removedApplied] wrappedStatement]))) {
+				break;
+			}
+		}
+		for (; 0 == result && addedApplied < [added count]; addedApplied++) {
+			if (0 != (result = librdf_model_context_add_statement(wrappedObject, context, [[added objectAtIndex:addedApplied] wrappedStatement]))) {
+				break;
+			}
+		}
+		if (inTransaction) {
+			if (0 == result) {
+				librdf_model_transaction_commit(wrappedObject);
+			}
+			else {
+				librdf_model_transaction_rollback(wrappedObject);
+			}
+		}
+		else if (0 != result) {
+			
+			// no transaction to roll back: undo what was applied, newest first
+			while (addedApplied > 0) {
+				librdf_model_context_remove_statement(wrappedObject, context, [[added objectAtIndex:--addedApplied] wrappedStatement]);
+			}
+			while (removedApplied > 0) {
+				librdf_model_context_add_statement(wrappedObject, context, [[removed objectAtIndex:--removedApplied] wrappedStatement]);
+			}
+		}
+	}
+	
+	[_descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+	if (result != 0) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to replace the statements of a context"
+										  userInfo:@{ @"context": contextNode }];
+	}
+	if (changeObservers && ([removed count] > 0 || [added count] > 0)) {
+		[self performChanges:^{
+			for (RedlandStatement *statement in removed) {
+				[self didRemoveStatement:statement withContext:contextNode];
+			}
+			for (RedlandStatement *statement in added) {
+				[self didAddStatement:statement withContext:contextNode];
+			}
+		}];
+	}
+}
+
+/**
+ *  Adds the statements of the stream one by one, so that observers learn about every statement actually added.
+ */
+- (void)addObservedStatementsFromStream:(RedlandStream *)aStream withContext:(RedlandNode *)contextNode
+{
+	librdf_stream *stream = [aStream wrappedStream];
+	[self performChanges:^{
+		while (!librdf_stream_end(stream)) {
+			librdf_statement *statement = librdf_new_statement_from_statement(librdf_stream_get_object(stream));
+			RedlandStatement *aStatement = [[RedlandStatement alloc] initWithWrappedObject:statement];
+			if (contextNode) {
+				[self addStatement:aStatement withContext:contextNode];
+			}
+			else {
+				[self addStatement:aStatement];
+			}
+			librdf_stream_next(stream);
+		}
+	}];
 }
 
 
@@ -294,15 +743,30 @@
 	NSParameterAssert(submodel != nil);
 //	return (0 == librdf_model_add_submodel(wrappedObject, [submodel wrappedModel]));
 	
+	NSMutableArray *changed = changeObservers ? [NSMutableArray array] : nil;
 	librdf_model_transaction_start(wrappedObject);
 	for (RedlandStatement *stmt in [submodel statementEnumerator]) {
-		if (0 != librdf_model_add_statement(wrappedObject, [stmt wrappedStatement])) {
+		BOOL existed = (changed && 1 == RedlandModelContainsStatementInContext(wrappedObject, [stmt wrappedStatement], NULL));
+		int result = librdf_model_add_statement(wrappedObject, [stmt wrappedStatement]);
+		[_descriptionCache removeDescriptionOfSubject:[stmt subject]];
+		[self bumpVersion];
+		if (0 != result) {
 			librdf_model_transaction_rollback(wrappedObject);
 			return NO;
 		}
+		if (changed && !existed) {
+			[changed addObject:stmt];
+		}
 	}
 	
 	librdf_model_transaction_commit(wrappedObject);
+	if ([changed count] > 0) {
+		[self performChanges:^{
+			for (RedlandStatement *stmt in changed) {
+				[self didAddStatement:stmt withContext:nil];
+			}
+		}];
+	}
 	return YES;
 }
 
@@ -320,15 +784,30 @@
 	NSParameterAssert(submodel != nil);
 //	return (0 == librdf_model_remove_submodel(wrappedObject, [submodel wrappedModel]));
 	
+	NSMutableArray *changed = changeObservers ? [NSMutableArray array] : nil;
 	librdf_model_transaction_start(wrappedObject);
 	for (RedlandStatement *stmt in [submodel statementEnumerator]) {
-		if (0 != librdf_model_remove_statement(wrappedObject, [stmt wrappedStatement])) {
+		BOOL existed = (changed && 0 != RedlandModelContainsStatementInContext(wrappedObject, [stmt wrappedStatement], NULL));
+		int result = librdf_model_remove_statement(wrappedObject, [stmt wrappedStatement]);
+		[_descriptionCache removeDescriptionOfSubject:[stmt subject]];
+		[self bumpVersion];
+		if (0 != result) {
 			librdf_model_transaction_rollback(wrappedObject);
 			return NO;
 		}
+		if (changed && existed) {
+			[changed addObject:stmt];
+		}
 	}
 	
 	librdf_model_transaction_commit(wrappedObject);
+	if ([changed count] > 0) {
+		[self performChanges:^{
+			for (RedlandStatement *stmt in changed) {
+				[self didRemoveStatement:stmt withContext:nil];
+			}
+		}];
+	}
 	return YES;
 }
 
@@ -509,6 +988,9 @@
 {
 	NSParameterAssert(sourceNode != nil);
 	NSParameterAssert(arcNode != nil);
+	if (_descriptionCache) {
+		return [_descriptionCache targetWithSource:sourceNode arc:arcNode inModel:self];
+	}
 	
 	librdf_node *node = librdf_model_get_target(wrappedObject, [sourceNode wrappedNode], [arcNode wrappedNode]);
 	if (node) {
@@ -540,6 +1022,9 @@
 {
 	NSParameterAssert(sourceNode != nil);
 	NSParameterAssert(arcNode != nil);
+	if (_descriptionCache) {
+		return [_descriptionCache source:sourceNode hasArc:arcNode inModel:self];
+	}
 	
 	return librdf_model_has_arc_out(wrappedObject, [sourceNode wrappedNode], [arcNode wrappedNode]);
 }
@@ -566,6 +1051,214 @@
 	return librdf_model_contains_context(wrappedObject, [contextNode wrappedNode]) != 0;
 }
 
+/**
+ *  Returns the number of statements in each context of the receiver.
+ *
+ *  Only the compact storage keeps these counts up to date as statements are added and removed; on other storages the counts are not incremental,
+ *  every call counts the statements of each context with a scan. See enumerateContextsWithCountsUsingBlock:.
+ *  @return A dictionary with the context RedlandNodes as keys and the numbers of statements as NSNumber values
+ */
+- (NSDictionary *)statementCountsByContext
+{
+	NSMutableDictionary *counts = [NSMutableDictionary dictionary];
+	[self enumerateContextsWithCountsUsingBlock:^(RedlandNode *context, NSUInteger count, BOOL *stop) {
+		[counts setObject:@(count) forKey:context];
+	}];
+	return counts;
+}
+
+/**
+ *  Calls the block with every context of the receiver and the number of statements in it, like contextIterator with counts.
+ *
+ *  On the compact storage the counts are kept up to date as statements are added and removed, so this takes time proportional to the number of
+ *  contexts. Other storages are not counted incrementally: each context's statements are counted with a scan right before the block is called for
+ *  it, so stopping early saves the scans of the remaining contexts.
+ *  @param block Called once per context; set *stop to YES to end the enumeration
+ */
+- (void)enumerateContextsWithCountsUsingBlock:(RedlandContextCountBlock)block
+{
+	NSParameterAssert(block != nil);
+	
+	BOOL stop = NO;
+	librdf_storage *storage = librdf_model_get_storage(wrappedObject);
+	if (RedlandStorageIsCompact(storage)) {
+		librdf_node **contexts = NULL;
+		size_t *contextCounts = NULL;
+		size_t count = RedlandCompactStorageCopyContextCounts(storage, &contexts, &contextCounts);
+		@try {
+			for (size_t i = 0; i < count; i++) {
+				RedlandNode *context = [[RedlandNode alloc] initWithWrappedObject:contexts[i]];
+				contexts[i] = NULL;
+				if (!stop) {
+					block(context, contextCounts[i], &stop);
+				}
+			}
+		}
+		@finally {
+			for (size_t i = 0; i < count; i++) {
+				if (contexts[i]) {
+					librdf_free_node(contexts[i]);
+				}
+			}
+			free(contexts);
+			free(contextCounts);
+		}
+		return;
+	}
+	
+	librdf_iterator *iterator = librdf_model_get_contexts(wrappedObject);
+	@try {
+		while (!stop && iterator && !librdf_iterator_end(iterator)) {
+			RedlandNode *context = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_iterator_get_object(iterator))];
+			block(context, [self countOfStatementsLike:nil withContext:context], &stop);
+			librdf_iterator_next(iterator);
+		}
+	}
+	@finally {
+		if (iterator) {
+			librdf_free_iterator(iterator);
+		}
+	}
+}
+
+
+
+#pragma mark - Versioning
+/**
+ *  Gives the receiver a new version.
+ *
+ *  The mutating methods of RedlandModel, its categories and RedlandParser call this themselves; call it after changing the librdf model directly.
+ *  Versions are drawn from a counter shared by all models, so a version identifies the state of one particular model.
+ */
+- (void)bumpVersion
+{
+	_version = __sync_add_and_fetch(&RedlandModelVersionCounter, 1);
+}
+
+
+
+#pragma mark - Change Observation
+/**
+ *  Registers a block to be called with a RedlandChangeSet after statements were added to or removed from the receiver.
+ *
+ *  Observers only see changes made through the receiver (RedlandModel, its categories and RedlandParser); while at least one observer is registered
+ *  bulk operations add and remove statements one by one to find out which ones actually changed. Mutations of a model without observers don't do any
+ *  additional work.
+ *  @param queue The queue to call the block on; nil to call it synchronously on the thread making the change
+ *  @param block The block to call
+ *  @return An opaque observer object to pass to removeChangeObserver:
+ */
+- (id)addChangeObserverWithQueue:(NSOperationQueue *)queue usingBlock:(RedlandModelChangeBlock)block
+{
+	NSParameterAssert(block != nil);
+	RedlandModelChangeObserver *observer = [RedlandModelChangeObserver new];
+	observer.queue = queue;
+	observer.block = block;
+	if (nil == changeObservers) {
+		changeObservers = [NSMutableArray new];
+	}
+	[changeObservers addObject:observer];
+	return observer;
+}
+
+/**
+ *  Unregisters an observer returned by addChangeObserverWithQueue:usingBlock:.
+ */
+- (void)removeChangeObserver:(id)observer
+{
+	[changeObservers removeObjectIdenticalTo:observer];
+	if (0 == [changeObservers count]) {
+		changeObservers = nil;
+	}
+}
+
+/**
+ *  @return YES if at least one change observer is registered
+ */
+- (BOOL)hasChangeObservers
+{
+	return (nil != changeObservers);
+}
+
+/**
+ *  Performs the given block, delivering all changes it makes to the observers as one change set when it returns.
+ *  Calls may be nested, the changes are delivered when the outermost call returns.
+ */
+- (void)performChanges:(void (^)(void))changes
+{
+	NSParameterAssert(changes != nil);
+	batchDepth++;
+	@try {
+		changes();
+	}
+	@finally {
+		batchDepth--;
+		if (0 == batchDepth) {
+			[self deliverPendingChanges];
+		}
+	}
+}
+
+/**
+ *  Records that the given statement was added.
+ *
+ *  The mutating methods call this themselves; call it only after changing the librdf model directly, for statements that were not present before.
+ *  Does nothing if no observer is registered.
+ */
+- (void)didAddStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	if (nil == changeObservers) {
+		return;
+	}
+	if (nil == pendingChanges) {
+		pendingChanges = [RedlandChangeSet new];
+	}
+	[pendingChanges addStatement:aStatement context:contextNode];
+	if (0 == batchDepth) {
+		[self deliverPendingChanges];
+	}
+}
+
+/**
+ *  Records that the given statement was removed.
+ *
+ *  The mutating methods call this themselves; call it only after changing the librdf model directly, for statements that were present before.
+ *  Does nothing if no observer is registered.
+ */
+- (void)didRemoveStatement:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	if (nil == changeObservers) {
+		return;
+	}
+	if (nil == pendingChanges) {
+		pendingChanges = [RedlandChangeSet new];
+	}
+	[pendingChanges removeStatement:aStatement context:contextNode];
+	if (0 == batchDepth) {
+		[self deliverPendingChanges];
+	}
+}
+
+- (void)deliverPendingChanges
+{
+	RedlandChangeSet *changes = pendingChanges;
+	pendingChanges = nil;
+	if (0 == [changes count]) {
+		return;
+	}
+	for (RedlandModelChangeObserver *observer in [changeObservers copy]) {
+		RedlandModelChangeBlock block = observer.block;
+		if (observer.queue) {
+			[observer.queue addOperationWithBlock:^{
+				block(self, changes);
+			}];
+		}
+		else {
+			block(self, changes);
+		}
+	}
+}
+
 
 
 #pragma mark - Features
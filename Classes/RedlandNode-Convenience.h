@@ -41,6 +41,7 @@
 + (RedlandNode *)nodeWithLiteralString:(NSString *)aString language:(NSString *)aLanguage;
 + (RedlandNode *)nodeWithLiteralDateTime:(NSDate *)aDate;
 + (RedlandNode *)nodeWithObject:(id)object;
++ (RedlandNode *)nodeWithVariableName:(NSString *)aName;
 
 - (int)intValue;
 - (float)floatValue;
@@ -52,6 +53,7 @@
 - (NSString *)URIStringValue;
 - (NSURL *)URLValue;
 - (NSDate *)dateTimeValue;
+- (NSString *)variableName;
 
 - (RedlandNode *)nodeValue;
 
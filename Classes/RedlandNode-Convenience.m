@@ -124,6 +124,16 @@
 	return [self nodeWithURIString:[aURL absoluteString]];
 }
 
+/**
+ *  Creates and returns a variable placeholder for graph patterns, a blank node whose ID is the variable name prefixed with "?".
+ *  @see -[RedlandModel bindingsMatchingPatterns:]
+ */
++ (RedlandNode *)nodeWithVariableName:(NSString *)aName
+{
+	NSParameterAssert([aName length] > 0);
+	return [self nodeWithBlankID:[@"?" stringByAppendingString:aName]];
+}
+
 
 
 #pragma mark - Accessors
@@ -241,6 +251,18 @@
 	return [[self URIValue] stringValue];
 }
 
+/**
+ *  @return the variable name of the receiver if it is a variable placeholder created with nodeWithVariableName:, nil otherwise.
+ */
+- (NSString *)variableName
+{
+	NSString *blankID = [self isBlank] ? [self blankID] : nil;
+	if ([blankID length] > 1 && [blankID hasPrefix:@"?"]) {
+		return [blankID substringFromIndex:1];
+	}
+	return nil;
+}
+
 /**
  *  @return the literal dateTime value of the receiver.
  *  @warning Raises a RedlandException if the datatype URI is not <tt>http://www.w3.org/2001/XMLSchema#dateTime</tt>.
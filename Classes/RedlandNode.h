@@ -77,3 +77,13 @@
 
 
 @end
+
+
+/**
+ *  C helpers to use plain librdf_node pointers as keys of CoreFoundation collections.
+ *
+ *  Keys are compared by node value (librdf_node_equals), retaining a key copies the node with librdf_new_node_from_node.
+ */
+extern NSUInteger RedlandNodeHash(librdf_node *node);
+extern const CFDictionaryKeyCallBacks RedlandNodeDictionaryKeyCallBacks;
+extern const CFSetCallBacks RedlandNodeSetCallBacks;
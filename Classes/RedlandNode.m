@@ -37,6 +37,49 @@
 #endif
 
 
+/**
+ *  Values decoded from the wrapped node are cached after the first access; nodes are immutable so the caches never need to be invalidated.
+ *
+ *  The caches hold retained CoreFoundation references so they can be filled with a compare-and-swap, which keeps nodes safe to share between threads
+ *  without any locking. A node without the respective value caches kCFNull.
+ */
+@interface RedlandNode () {
+	void * volatile cachedLiteralValue;
+	void * volatile cachedLiteralLanguage;
+	void * volatile cachedLiteralDataType;
+	void * volatile cachedURIValue;
+	void * volatile cachedBlankID;
+	NSUInteger cachedHash;
+}
+
+@end
+
+
+static inline id RedlandNodeCachedValue(void *value)
+{
+	return (kCFNull == value) ? nil : (__bridge id)value;
+}
+
+/**
+ *  Stores a lazily decoded value in the given cache slot, unless another thread got there first.
+ *  @return The value now in the cache
+ */
+static id RedlandNodeCacheValue(void * volatile *slot, id value)
+{
+	void *retained = (void *)(value ? CFBridgingRetain(value) : CFRetain(kCFNull));
+	if (!__sync_bool_compare_and_swap(slot, NULL, retained)) {
+		CFRelease(retained);
+	}
+	return RedlandNodeCachedValue(*slot);
+}
+
+static NSComparisonResult RedlandNodeCompareStrings(const unsigned char *string1, const unsigned char *string2)
+{
+	int result = strcmp(string1 ? (const char *)string1 : "", string2 ? (const char *)string2 : "");
+	return (result < 0) ? NSOrderedAscending : ((result > 0) ? NSOrderedDescending : NSOrderedSame);
+}
+
+
 @implementation RedlandNode
 
 /**
@@ -209,6 +252,12 @@
     if (isWrappedObjectOwner) {
         librdf_free_node(wrappedObject);
 	}
+	void *caches[] = { cachedLiteralValue, cachedLiteralLanguage, cachedLiteralDataType, cachedURIValue, cachedBlankID };
+	for (NSUInteger i = 0; i < sizeof(caches) / sizeof(void *); i++) {
+		if (caches[i]) {
+			CFRelease(caches[i]);
+		}
+	}
 }
 
 
@@ -320,11 +369,24 @@
 	return NO;
 }
 
+/**
+ *  The hash is computed from the node's value, so nodes that are equal have the same hash.
+ */
 - (NSUInteger)hash
 {
-	return (NSUInteger)wrappedObject;
+	if (0 == cachedHash) {
+		cachedHash = RedlandNodeHash(wrappedObject);
+	}
+	return cachedHash;
 }
 
+/**
+ *  Compares the receiver to another node.
+ *
+ *  Resources are ordered by URI and blank nodes by their ID. Literals with the same datatype and language are ordered by their value, all other
+ *  combinations are ordered by their description.
+ *  @param otherNode The node to compare the receiver to
+ */
 - (NSComparisonResult)compare:(id)otherNode
 {
 	if (![otherNode isKindOfClass:[self class]]) {
@@ -337,35 +399,34 @@
 									 userInfo:nil];
 	}
 	
-	// literal nodes
-	if ([self isLiteral]) {
-		if ([otherNode isLiteral]) {
+	librdf_node *other = [otherNode wrappedNode];
+	librdf_node_type type = librdf_node_get_type(wrappedObject);
+	if (type == librdf_node_get_type(other)) {
+		switch (type) {
+			case LIBRDF_NODE_TYPE_RESOURCE:
+				return RedlandNodeCompareStrings(librdf_uri_as_string(librdf_node_get_uri(wrappedObject)), librdf_uri_as_string(librdf_node_get_uri(other)));
 			
-			// compare data type
-			RedlandURI *mType = [self literalDataType];
-			RedlandURI *oType = [otherNode literalDataType];
-			if ((mType && [mType isEqual:oType]) || (!mType && !oType)) {
-				
-				// compare language
-				NSString *mLang = [self literalLanguage];
-				NSString *oLang = [otherNode literalLanguage];
-				if ((mLang && [mLang isEqualToString:oLang]) || (!mLang && !oLang)) {
-					return [[self literalValue] isEqualToString:[otherNode literalValue]];
+			case LIBRDF_NODE_TYPE_BLANK:
+				return RedlandNodeCompareStrings(librdf_node_get_blank_identifier(wrappedObject), librdf_node_get_blank_identifier(other));
+			
+			case LIBRDF_NODE_TYPE_LITERAL: {
+				librdf_uri *mType = librdf_node_get_literal_value_datatype_uri(wrappedObject);
+				librdf_uri *oType = librdf_node_get_literal_value_datatype_uri(other);
+				const char *mLang = librdf_node_get_literal_value_language(wrappedObject);
+				const char *oLang = librdf_node_get_literal_value_language(other);
+				BOOL sameType = (mType == oType) || (mType && oType && librdf_uri_equals(mType, oType));
+				BOOL sameLanguage = (!mLang && !oLang) || (mLang && oLang && 0 == strcmp(mLang, oLang));
+				if (sameType && sameLanguage) {
+					return [[self literalValue] compare:[otherNode literalValue]];
 				}
+				break;
 			}
+			
+			default:
+				break;
 		}
 	}
 	
-	// resource nodes
-	else if ([self isResource]) {
-		return [[self URIValue] isEqual:[otherNode URIValue]];
-	}
-	
-	// blank nodes
-	else if ([self isBlank]) {
-		return [[self blankID] isEqualToString:[otherNode blankID]];
-	}
-	
 	// fallback method
 	return [[self description] compare:[otherNode description]];
 }
@@ -428,15 +489,17 @@
  */
 - (NSString *)literalValue
 {
-	if (![self isLiteral]) {
-		return nil;
+	if (cachedLiteralValue) {
+		return RedlandNodeCachedValue(cachedLiteralValue);
 	}
 	
-	size_t length;
-	unsigned char *literal_value;
-	
-	literal_value = librdf_node_get_literal_value_as_counted_string(wrappedObject, &length);
-	return [[NSString alloc] initWithBytes:literal_value length:length encoding:NSUTF8StringEncoding];
+	NSString *value = nil;
+	if ([self isLiteral]) {
+		size_t length;
+		unsigned char *literal_value = librdf_node_get_literal_value_as_counted_string(wrappedObject, &length);
+		value = [[NSString alloc] initWithBytes:literal_value length:length encoding:NSUTF8StringEncoding];
+	}
+	return RedlandNodeCacheValue(&cachedLiteralValue, value);
 }
 
 /**
@@ -444,16 +507,19 @@
  */
 - (RedlandURI *)URIValue
 {
-	if (![self isResource]) {
-		return nil;
+	if (cachedURIValue) {
+		return RedlandNodeCachedValue(cachedURIValue);
 	}
 	
-	librdf_uri *uri_value;
-	uri_value = librdf_node_get_uri(wrappedObject);
-	if (uri_value != NULL) {
-		uri_value = librdf_new_uri_from_uri(uri_value);
+	RedlandURI *value = nil;
+	if ([self isResource]) {
+		librdf_uri *uri_value = librdf_node_get_uri(wrappedObject);
+		if (uri_value != NULL) {
+			uri_value = librdf_new_uri_from_uri(uri_value);
+		}
+		value = [[RedlandURI alloc] initWithWrappedObject:uri_value];
 	}
-	return [[RedlandURI alloc] initWithWrappedObject:uri_value];
+	return RedlandNodeCacheValue(&cachedURIValue, value);
 }
 
 /**
@@ -461,8 +527,13 @@
  */
 - (NSString *)blankID
 {
+	if (cachedBlankID) {
+		return RedlandNodeCachedValue(cachedBlankID);
+	}
+	
 	char *blank_id = (char *)librdf_node_get_blank_identifier(wrappedObject);
-	return [[NSString alloc] initWithUTF8String:blank_id];
+	NSString *value = blank_id ? [[NSString alloc] initWithUTF8String:blank_id] : nil;
+	return RedlandNodeCacheValue(&cachedBlankID, value);
 }
 
 /**
@@ -478,13 +549,17 @@
  */
 - (RedlandURI *)literalDataType
 {
-	librdf_uri *uri_value;
-	uri_value = librdf_node_get_literal_value_datatype_uri(wrappedObject);
+	if (cachedLiteralDataType) {
+		return RedlandNodeCachedValue(cachedLiteralDataType);
+	}
+	
+	RedlandURI *value = nil;
+	librdf_uri *uri_value = librdf_node_get_literal_value_datatype_uri(wrappedObject);
 	if (uri_value != NULL) {
 		uri_value = librdf_new_uri_from_uri(uri_value);
-		return [[RedlandURI alloc] initWithWrappedObject:uri_value];
+		value = [[RedlandURI alloc] initWithWrappedObject:uri_value];
 	}
-	return nil;
+	return RedlandNodeCacheValue(&cachedLiteralDataType, value);
 }
 
 /**
@@ -492,12 +567,91 @@
  */
 - (NSString *)literalLanguage
 {
-	char *language = librdf_node_get_literal_value_language(wrappedObject);
-	if (language) {
-		return [[NSString alloc] initWithUTF8String:language];
+	if (cachedLiteralLanguage) {
+		return RedlandNodeCachedValue(cachedLiteralLanguage);
 	}
-	return nil;
+	
+	char *language = librdf_node_get_literal_value_language(wrappedObject);
+	NSString *value = language ? [[NSString alloc] initWithUTF8String:language] : nil;
+	return RedlandNodeCacheValue(&cachedLiteralLanguage, value);
 }
 
 
 @end
+
+
+
+#pragma mark - CoreFoundation Callbacks
+/**
+ *  Returns a hash over the type and the string value of the node (URI, literal value or blank node ID). Nodes that are equal according to
+ *  librdf_node_equals() have the same hash.
+ */
+NSUInteger RedlandNodeHash(librdf_node *node)
+{
+	if (NULL == node) {
+		return 0;
+	}
+	
+	size_t length = 0;
+	const unsigned char *bytes = NULL;
+	librdf_node_type type = librdf_node_get_type(node);
+	switch (type) {
+		case LIBRDF_NODE_TYPE_RESOURCE:
+			bytes = librdf_uri_as_counted_string(librdf_node_get_uri(node), &length);
+			break;
+		case LIBRDF_NODE_TYPE_LITERAL:
+			bytes = librdf_node_get_literal_value_as_counted_string(node, &length);
+			break;
+		case LIBRDF_NODE_TYPE_BLANK:
+			bytes = librdf_node_get_blank_identifier(node);
+			length = bytes ? strlen((const char *)bytes) : 0;
+			break;
+		default:
+			break;
+	}
+	
+	// FNV-1a
+	NSUInteger hash = 2166136261U ^ (NSUInteger)type;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ bytes[i]) * 16777619U;
+	}
+	return hash;
+}
+
+static const void *RedlandNodeRetainCallBack(CFAllocatorRef allocator, const void *value)
+{
+	return librdf_new_node_from_node((librdf_node *)value);
+}
+
+static void RedlandNodeReleaseCallBack(CFAllocatorRef allocator, const void *value)
+{
+	librdf_free_node((librdf_node *)value);
+}
+
+static Boolean RedlandNodeEqualCallBack(const void *value1, const void *value2)
+{
+	return (0 != librdf_node_equals((librdf_node *)value1, (librdf_node *)value2));
+}
+
+static CFHashCode RedlandNodeHashCallBack(const void *value)
+{
+	return RedlandNodeHash((librdf_node *)value);
+}
+
+const CFDictionaryKeyCallBacks RedlandNodeDictionaryKeyCallBacks = {
+	0,
+	RedlandNodeRetainCallBack,
+	RedlandNodeReleaseCallBack,
+	NULL,
+	RedlandNodeEqualCallBack,
+	RedlandNodeHashCallBack
+};
+
+const CFSetCallBacks RedlandNodeSetCallBacks = {
+	0,
+	RedlandNodeRetainCallBack,
+	RedlandNodeReleaseCallBack,
+	NULL,
+	RedlandNodeEqualCallBack,
+	RedlandNodeHashCallBack
+};
@@ -27,7 +27,7 @@
 #import "RedlandWrappedObject.h"
 #import "RedlandModel.h"
 
-@class RedlandURI, RedlandStream;
+@class RedlandURI, RedlandStream, RedlandCancellationToken;
 
 extern NSString * const RedlandRDFXMLParserName;				///< The name of the built-in RDF/XML parser
 extern NSString * const RedlandNTriplesParserName;				///< The name of the built-in NTriples parser
@@ -60,9 +60,11 @@ extern NSString * const RedlandRelativeURIsFeature;
 - (librdf_parser *)wrappedParser;
 
 - (void)parseData:(NSData *)data intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI;
+- (void)parseData:(NSData *)data intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token;
 - (RedlandStream *)parseData:(NSData *)data asStreamWithBaseURI:(RedlandURI *)baseURI;
 
 - (void)parseString:(NSString *)aString intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI;
+- (void)parseString:(NSString *)aString intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token;
 - (RedlandStream *)parseString:(NSString *)aString asStreamWithBaseURI:(RedlandURI *)anURI;
 
 - (RedlandNode *)valueOfFeature:(id)featureURI;
@@ -26,10 +26,12 @@
 
 #import "RedlandWorld.h"
 #import "RedlandModel.h"
+#import "RedlandDescriptionCache.h"
 #import "RedlandURI.h"
 #import "RedlandStream.h"
 #import "RedlandException.h"
 #import "RedlandNode.h"
+#import "RedlandCancellationToken.h"
 
 NSString * const RedlandRDFXMLParserName = @"rdfxml";
 NSString * const RedlandNTriplesParserName = @"ntriples";
@@ -141,10 +143,24 @@ NSString * const RedlandRelativeURIsFeature = @"http://feature.librdf.org/raptor
 	NSParameterAssert(aModel != nil);
 	NSParameterAssert(uri != nil);
 	
+	// observed models add the parsed statements one by one so they can report them
+	if ([aModel hasChangeObservers]) {
+		RedlandStream *stream = [self parseString:aString asStreamWithBaseURI:uri];
+		if (nil == stream) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"librdf_parser_parse_string_as_stream failed"
+											  userInfo:nil];
+		}
+		[aModel addStatementsFromStream:stream];
+		return;
+	}
+	
 	int result = librdf_parser_parse_string_into_model(wrappedObject,
 													   (unsigned char *)[aString UTF8String],
 													   [uri wrappedURI],
 													   [aModel wrappedModel]);
+	[[aModel descriptionCache] removeAllDescriptions];
+	[aModel bumpVersion];
 	[[RedlandWorld defaultWorld] handleStoredErrors];
 	if (result != 0) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
@@ -153,6 +169,40 @@ NSString * const RedlandRelativeURIsFeature = @"http://feature.librdf.org/raptor
 	}
 }
 
+/**
+ *  Parses the specified string into aModel, stopping as soon as the token is cancelled or its deadline passes.
+ *
+ *  The statements are added one by one with -[RedlandModel addStatementsFromStream:withContext:cancellationToken:], which checks for parse errors
+ *  after every statement; when the parse is interrupted or fails no statement of it remains in the model.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled, a RedlandException if there is a parse error.
+ *  @param aString The string to parse
+ *  @param aModel The model to parse into; required
+ *  @param uri The base URI
+ *  @param token The cancellation token; nil behaves like parseString:intoModel:withBaseURI:
+ */
+- (void)parseString:(NSString *)aString intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)uri cancellationToken:(RedlandCancellationToken *)token
+{
+	if (nil == token) {
+		[self parseString:aString intoModel:aModel withBaseURI:uri];
+		return;
+	}
+	if ([aString length] < 1) {
+		return;
+	}
+	
+	NSParameterAssert(aModel != nil);
+	NSParameterAssert(uri != nil);
+	
+	[token throwIfCancelled];
+	RedlandStream *stream = [self parseString:aString asStreamWithBaseURI:uri];
+	if (nil == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"librdf_parser_parse_string_as_stream failed"
+										  userInfo:nil];
+	}
+	[aModel addStatementsFromStream:stream withContext:nil cancellationToken:token];
+}
+
 /**
  *  Tries to parse the specified string using baseURI as the base URI and returns a RedlandStream of statements.
  *  @warning Raises a RedlandException if there is a parse error.
@@ -188,11 +238,25 @@ NSString * const RedlandRelativeURIsFeature = @"http://feature.librdf.org/raptor
 	NSParameterAssert(aModel != nil);
 	NSParameterAssert(baseURI != nil);
 	
+	if ([aModel hasChangeObservers]) {
+		librdf_stream *stream = librdf_parser_parse_counted_string_as_stream(wrappedObject, [data bytes], [data length], [baseURI wrappedURI]);
+		[[RedlandWorld defaultWorld] handleStoredErrors];
+		if (NULL == stream) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"librdf_parser_parse_counted_string_as_stream failed"
+											  userInfo:nil];
+		}
+		[aModel addStatementsFromStream:[[RedlandStream alloc] initWithWrappedObject:stream]];
+		return;
+	}
+	
 	int result = librdf_parser_parse_counted_string_into_model(wrappedObject,
 															   [data bytes],
 															   [data length],
 															   [baseURI wrappedURI],
 															   [aModel wrappedModel]);
+	[[aModel descriptionCache] removeAllDescriptions];
+	[aModel bumpVersion];
 	if (result != 0) {
 		@throw [RedlandException exceptionWithName:RedlandExceptionName
 											reason:@"librdf_parser_parse_counted_string_into_model failed"
@@ -201,6 +265,37 @@ NSString * const RedlandRelativeURIsFeature = @"http://feature.librdf.org/raptor
 	[[RedlandWorld defaultWorld] handleStoredErrors];
 }
 
+/**
+ *  Parses data into a model, stopping as soon as the token is cancelled or its deadline passes.
+ *
+ *  Parse errors are checked after every statement like the token; when the parse is interrupted or fails no statement of it remains in the model.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled, a RedlandException if there is a parse error.
+ *  @param data The data to parse as NSData
+ *  @param aModel The model to parse into; required
+ *  @param baseURI The base URI
+ *  @param token The cancellation token; nil behaves like parseData:intoModel:withBaseURI:
+ */
+- (void)parseData:(NSData *)data intoModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token
+{
+	if (nil == token) {
+		[self parseData:data intoModel:aModel withBaseURI:baseURI];
+		return;
+	}
+	NSParameterAssert(data != nil);
+	NSParameterAssert(aModel != nil);
+	NSParameterAssert(baseURI != nil);
+	
+	[token throwIfCancelled];
+	librdf_stream *stream = librdf_parser_parse_counted_string_as_stream(wrappedObject, [data bytes], [data length], [baseURI wrappedURI]);
+	[[RedlandWorld defaultWorld] handleStoredErrors];
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"librdf_parser_parse_counted_string_as_stream failed"
+										  userInfo:nil];
+	}
+	[aModel addStatementsFromStream:[[RedlandStream alloc] initWithWrappedObject:stream] withContext:nil cancellationToken:token];
+}
+
 /**
  *  Tries to parse data using the given base URI and returns a RedlandStream of statements.
  *  @warning Raises a RedlandException if there is a parse error.
@@ -0,0 +1,64 @@
+//
+//  RedlandPropertyPath.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandNode;
+
+/// The kind of a RedlandPropertyPath
+typedef enum _RedlandPropertyPathType {
+	RedlandPropertyPathPredicate = 0,					///< A single predicate
+	RedlandPropertyPathSequence,						///< The subpaths one after the other (p1/p2)
+	RedlandPropertyPathAlternative,						///< Any of the subpaths (p1|p2)
+	RedlandPropertyPathInverse,							///< The subpath traversed from object to subject (^p)
+	RedlandPropertyPathZeroOrMore,						///< The subpath repeated any number of times (p*)
+	RedlandPropertyPathOneOrMore,						///< The subpath repeated at least once (p+)
+	RedlandPropertyPathZeroOrOne						///< The subpath or nothing (p?)
+} RedlandPropertyPathType;
+
+
+/**
+ *  An immutable SPARQL 1.1 style property path, evaluated with -[RedlandModel enumerateTargetsOfPath:fromSource:maximumDepth:limit:usingBlock:].
+ *
+ *  Paths are built from predicates with the class factory methods, e.g. <tt>foaf:knows/foaf:name</tt> is
+ *  <tt>[RedlandPropertyPath sequencePathWithPaths:@[knows, name]]</tt> and <tt>rdfs:subClassOf*</tt> is
+ *  <tt>[RedlandPropertyPath zeroOrMorePathWithPath:subClassOf]</tt>. Wherever a path is expected a RedlandNode may be given as well.
+ */
+@interface RedlandPropertyPath : NSObject <NSCopying>
+
+@property (nonatomic, readonly, assign) RedlandPropertyPathType type;		///< The kind of the path
+@property (nonatomic, readonly, strong) RedlandNode *predicate;				///< The predicate of a RedlandPropertyPathPredicate path, nil otherwise
+@property (nonatomic, readonly, copy) NSArray *subpaths;						///< The RedlandPropertyPath instances this path is composed of
+
++ (RedlandPropertyPath *)pathWithPredicate:(RedlandNode *)predicate;
++ (RedlandPropertyPath *)sequencePathWithPaths:(NSArray *)paths;
++ (RedlandPropertyPath *)alternativePathWithPaths:(NSArray *)paths;
++ (RedlandPropertyPath *)inversePathWithPath:(id)path;
++ (RedlandPropertyPath *)zeroOrMorePathWithPath:(id)path;
++ (RedlandPropertyPath *)oneOrMorePathWithPath:(id)path;
++ (RedlandPropertyPath *)zeroOrOnePathWithPath:(id)path;
+
+- (id)initWithType:(RedlandPropertyPathType)type predicate:(RedlandNode *)predicate subpaths:(NSArray *)subpaths;
+
+
+@end
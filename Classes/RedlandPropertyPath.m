@@ -0,0 +1,193 @@
+//
+//  RedlandPropertyPath.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandPropertyPath.h"
+#import "RedlandNode.h"
+
+
+/**
+ *  Returns the given path, or a predicate path if a RedlandNode was given.
+ */
+static RedlandPropertyPath *RedlandPropertyPathFromObject(id object)
+{
+	if ([object isKindOfClass:[RedlandPropertyPath class]]) {
+		return object;
+	}
+	if ([object isKindOfClass:[RedlandNode class]]) {
+		return [RedlandPropertyPath pathWithPredicate:object];
+	}
+	[NSException raise:NSInvalidArgumentException format:@"A property path must be built from RedlandPropertyPath or RedlandNode instances, not %@", object];
+	return nil;
+}
+
+static NSArray *RedlandPropertyPathsFromObjects(NSArray *objects)
+{
+	NSMutableArray *paths = [NSMutableArray arrayWithCapacity:[objects count]];
+	for (id object in objects) {
+		[paths addObject:RedlandPropertyPathFromObject(object)];
+	}
+	return paths;
+}
+
+
+@implementation RedlandPropertyPath
+
+
+/**
+ *  Returns a path following a single predicate.
+ */
++ (RedlandPropertyPath *)pathWithPredicate:(RedlandNode *)predicate
+{
+	NSParameterAssert(predicate != nil);
+	return [[self alloc] initWithType:RedlandPropertyPathPredicate predicate:predicate subpaths:nil];
+}
+
+/**
+ *  Returns a path following the given paths one after the other.
+ *  @param paths An array of RedlandPropertyPath or RedlandNode instances
+ */
++ (RedlandPropertyPath *)sequencePathWithPaths:(NSArray *)paths
+{
+	NSParameterAssert([paths count] > 0);
+	return [[self alloc] initWithType:RedlandPropertyPathSequence predicate:nil subpaths:RedlandPropertyPathsFromObjects(paths)];
+}
+
+/**
+ *  Returns a path following any one of the given paths.
+ *  @param paths An array of RedlandPropertyPath or RedlandNode instances
+ */
++ (RedlandPropertyPath *)alternativePathWithPaths:(NSArray *)paths
+{
+	NSParameterAssert([paths count] > 0);
+	return [[self alloc] initWithType:RedlandPropertyPathAlternative predicate:nil subpaths:RedlandPropertyPathsFromObjects(paths)];
+}
+
+/**
+ *  Returns a path following the given path backwards, from objects to subjects.
+ *  @param path A RedlandPropertyPath or RedlandNode instance
+ */
++ (RedlandPropertyPath *)inversePathWithPath:(id)path
+{
+	return [[self alloc] initWithType:RedlandPropertyPathInverse predicate:nil subpaths:@[RedlandPropertyPathFromObject(path)]];
+}
+
+/**
+ *  Returns a path following the given path zero or more times.
+ *  @param path A RedlandPropertyPath or RedlandNode instance
+ */
++ (RedlandPropertyPath *)zeroOrMorePathWithPath:(id)path
+{
+	return [[self alloc] initWithType:RedlandPropertyPathZeroOrMore predicate:nil subpaths:@[RedlandPropertyPathFromObject(path)]];
+}
+
+/**
+ *  Returns a path following the given path one or more times.
+ *  @param path A RedlandPropertyPath or RedlandNode instance
+ */
++ (RedlandPropertyPath *)oneOrMorePathWithPath:(id)path
+{
+	return [[self alloc] initWithType:RedlandPropertyPathOneOrMore predicate:nil subpaths:@[RedlandPropertyPathFromObject(path)]];
+}
+
+/**
+ *  Returns a path following the given path zero times or once.
+ *  @param path A RedlandPropertyPath or RedlandNode instance
+ */
++ (RedlandPropertyPath *)zeroOrOnePathWithPath:(id)path
+{
+	return [[self alloc] initWithType:RedlandPropertyPathZeroOrOne predicate:nil subpaths:@[RedlandPropertyPathFromObject(path)]];
+}
+
+/**
+ *  Designated initializer.
+ *  @param type The kind of path
+ *  @param predicate The predicate of a RedlandPropertyPathPredicate path, nil for all other kinds
+ *  @param subpaths The RedlandPropertyPath instances the path is composed of; exactly one for the inverse and repetition kinds
+ */
+- (id)initWithType:(RedlandPropertyPathType)type predicate:(RedlandNode *)predicate subpaths:(NSArray *)subpaths
+{
+	NSParameterAssert((RedlandPropertyPathPredicate == type) == (nil != predicate));
+	if ((self = [super init])) {
+		_type = type;
+		_predicate = predicate;
+		_subpaths = [subpaths copy] ?: @[];
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+
+
+#pragma mark - Comparison
+- (BOOL)isEqual:(id)object
+{
+	if (object == self) {
+		return YES;
+	}
+	if (![object isKindOfClass:[RedlandPropertyPath class]]) {
+		return NO;
+	}
+	RedlandPropertyPath *other = object;
+	return (_type == other.type
+			&& (_predicate == other.predicate || [_predicate isEqual:other.predicate])
+			&& [_subpaths isEqualToArray:other.subpaths]);
+}
+
+- (NSUInteger)hash
+{
+	return (_predicate ? [_predicate hash] : ((NSUInteger)_type * 31 + [_subpaths count]));
+}
+
+
+
+#pragma mark - Utilities
+/**
+ *  Returns the path in SPARQL property path syntax.
+ */
+- (NSString *)description
+{
+	switch (_type) {
+		case RedlandPropertyPathPredicate:
+			return [_predicate description];
+		case RedlandPropertyPathSequence:
+			return [NSString stringWithFormat:@"(%@)", [[_subpaths valueForKey:@"description"] componentsJoinedByString:@"/"]];
+		case RedlandPropertyPathAlternative:
+			return [NSString stringWithFormat:@"(%@)", [[_subpaths valueForKey:@"description"] componentsJoinedByString:@"|"]];
+		case RedlandPropertyPathInverse:
+			return [NSString stringWithFormat:@"^%@", [_subpaths objectAtIndex:0]];
+		case RedlandPropertyPathZeroOrMore:
+			return [NSString stringWithFormat:@"%@*", [_subpaths objectAtIndex:0]];
+		case RedlandPropertyPathOneOrMore:
+			return [NSString stringWithFormat:@"%@+", [_subpaths objectAtIndex:0]];
+		case RedlandPropertyPathZeroOrOne:
+			return [NSString stringWithFormat:@"%@?", [_subpaths objectAtIndex:0]];
+	}
+	return [super description];
+}
+
+
+@end
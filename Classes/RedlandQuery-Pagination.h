@@ -0,0 +1,46 @@
+//
+//  RedlandQuery-Pagination.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandQuery.h"
+
+@class RedlandModel, RedlandBindingTable;
+
+
+/**
+ *  Reading the variable bindings of a query one page at a time.
+ *
+ *  Every page comes with a cursor, an opaque string to pass in to get the following page; it is nil after the last page. The results of the query are
+ *  kept open between pages in a small process-wide table of cursors, so the next page continues where the previous one stopped instead of running the
+ *  query again. Only the most recently used cursors are kept open; when a cursor is no longer open, or the model has changed since its page was read,
+ *  the query is executed again and the rows already returned are skipped, which costs time proportional to their number and may shift the pages when
+ *  the model changed.
+ *
+ *  Only queries producing variable bindings can be paged.
+ */
+@interface RedlandQuery (Pagination)
+
+- (RedlandBindingTable *)rowsOnModel:(RedlandModel *)aModel limit:(NSUInteger)limit after:(NSString *)cursor nextCursor:(NSString * __autoreleasing *)nextCursor;
+
++ (void)closeAllCursors;
+
+
+@end
@@ -0,0 +1,159 @@
+//
+//  RedlandQuery-Pagination.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandQuery-Pagination.h"
+#import "RedlandModel.h"
+#import "RedlandQueryResults.h"
+#import "RedlandBindingTable.h"
+#import "RedlandException.h"
+
+/// The number of query results kept open between pages, the least recently used are closed first
+#define REDLAND_QUERY_CURSOR_LIMIT 16
+
+static NSString * const RedlandQueryCursorPrefix = @"q1";
+
+
+/**
+ *  The open results of a paged query, parked between two pages.
+ */
+@interface RedlandQueryCursor : NSObject
+
+@property (nonatomic, strong) RedlandQueryResults *results;
+@property (nonatomic, strong) RedlandModel *model;
+@property (nonatomic, assign) uint64_t modelVersion;				///< The version of the model when the results were opened
+@property (nonatomic, assign) unsigned long long rowOffset;			///< The number of rows read from the results so far
+
+@end
+
+@implementation RedlandQueryCursor
+@end
+
+
+static NSMutableDictionary *RedlandQueryCursors = nil;				///< Cursor ID -> RedlandQueryCursor
+static NSMutableArray *RedlandQueryCursorOrder = nil;				///< Cursor IDs, least recently used first
+static unsigned long long RedlandQueryCursorCounter = 0;
+
+
+@implementation RedlandQuery (Pagination)
+
+
+/**
+ *  Returns one page of the rows the receiver produces on the given model.
+ *  @param aModel The model to query
+ *  @param limit The maximum number of rows to return, must not be 0
+ *  @param cursor The cursor returned with the previous page, nil to start with the first page
+ *  @param nextCursor Receives the cursor to pass in for the next page, nil if there are no more rows
+ *  @return A RedlandBindingTable with at most limit rows
+ */
+- (RedlandBindingTable *)rowsOnModel:(RedlandModel *)aModel limit:(NSUInteger)limit after:(NSString *)cursor nextCursor:(NSString * __autoreleasing *)nextCursor
+{
+	NSParameterAssert(aModel != nil);
+	NSParameterAssert(limit > 0);
+	
+	NSUInteger queryHash = [self.queryString hash];
+	NSNumber *cursorID = nil;
+	unsigned long long rowOffset = 0;
+	if (cursor) {
+		NSArray *fields = [cursor componentsSeparatedByString:@":"];
+		if ([fields count] != 4 || ![fields[0] isEqualToString:RedlandQueryCursorPrefix] || (NSUInteger)strtoull([fields[1] UTF8String], NULL, 16) != queryHash) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"The cursor was not created for this query"
+											  userInfo:@{ @"cursor": cursor }];
+		}
+		cursorID = @(strtoull([fields[2] UTF8String], NULL, 16));
+		rowOffset = strtoull([fields[3] UTF8String], NULL, 16);
+	}
+	
+	// take the open results out of the table, so no other thread reads from them at the same time
+	RedlandQueryCursor *open = nil;
+	@synchronized([RedlandQueryCursor class]) {
+		if (nil == RedlandQueryCursors) {
+			RedlandQueryCursors = [NSMutableDictionary new];
+			RedlandQueryCursorOrder = [NSMutableArray new];
+		}
+		if (cursorID) {
+			open = RedlandQueryCursors[cursorID];
+			if (open && open.model == aModel && open.rowOffset == rowOffset && open.modelVersion == aModel.version) {
+				[RedlandQueryCursors removeObjectForKey:cursorID];
+				[RedlandQueryCursorOrder removeObject:cursorID];
+			}
+			else {
+				open = nil;
+			}
+		}
+		else {
+			cursorID = @(++RedlandQueryCursorCounter);
+		}
+	}
+	
+	if (nil == open) {
+		open = [RedlandQueryCursor new];
+		open.model = aModel;
+		open.modelVersion = aModel.version;
+		open.results = [self executeOnModel:aModel];
+		if (![open.results isBindings]) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"Only queries producing variable bindings can be paged"
+											  userInfo:nil];
+		}
+		for (unsigned long long i = 0; i < rowOffset && ![open.results finished]; i++) {
+			[open.results next];
+		}
+		open.rowOffset = rowOffset;
+	}
+	
+	RedlandBindingTable *rows = [open.results nextRowsWithLimit:limit];
+	open.rowOffset += rows.count;
+	
+	if (nextCursor) {
+		*nextCursor = nil;
+	}
+	if (![open.results finished]) {
+		@synchronized([RedlandQueryCursor class]) {
+			RedlandQueryCursors[cursorID] = open;
+			[RedlandQueryCursorOrder addObject:cursorID];
+			while ([RedlandQueryCursorOrder count] > REDLAND_QUERY_CURSOR_LIMIT) {
+				[RedlandQueryCursors removeObjectForKey:RedlandQueryCursorOrder[0]];
+				[RedlandQueryCursorOrder removeObjectAtIndex:0];
+			}
+		}
+		if (nextCursor) {
+			*nextCursor = [NSString stringWithFormat:@"%@:%lx:%llx:%llx", RedlandQueryCursorPrefix, (unsigned long)queryHash,
+						   [cursorID unsignedLongLongValue], open.rowOffset];
+		}
+	}
+	return rows;
+}
+
+/**
+ *  Closes the query results kept open for all cursors. Cursors stay valid, their next page executes the query again.
+ */
++ (void)closeAllCursors
+{
+	@synchronized([RedlandQueryCursor class]) {
+		[RedlandQueryCursors removeAllObjects];
+		[RedlandQueryCursorOrder removeAllObjects];
+	}
+}
+
+
+@end
@@ -25,11 +25,12 @@
 #import <Foundation/Foundation.h>
 #import <redland.h>
 #import "RedlandWrappedObject.h"
+#import "RedlandQueryExecutor.h"
 
 extern NSString * const RedlandRDQLLanguageName;				///< The name of the RDQL query language (no longer supported as of Jan 2013!)
 extern NSString * const RedlandSPARQLLanguageName;				///< The name of the SPARQL query language
 
-@class RedlandURI, RedlandQueryResults, RedlandModel;
+@class RedlandURI, RedlandQueryResults, RedlandModel, RedlandCancellationToken;
 
 
 /**
@@ -37,6 +38,7 @@ extern NSString * const RedlandSPARQLLanguageName;				///< The name of the SPARQ
  */
 @interface RedlandQuery : RedlandWrappedObject
 
+@property (nonatomic, readonly, copy) NSString *queryString;			///< The query text the receiver was created with
 @property (nonatomic, assign) int limit;
 @property (nonatomic, assign) int offset;
 
@@ -49,6 +51,12 @@ extern NSString * const RedlandSPARQLLanguageName;				///< The name of the SPARQ
 - (librdf_query *)wrappedQuery;
 
 - (RedlandQueryResults *)executeOnModel:(RedlandModel *)aModel;
+- (RedlandQueryResults *)executeOnModel:(RedlandModel *)aModel cancellationToken:(RedlandCancellationToken *)token;
+- (RedlandQueryExecution *)executeOnModel:(RedlandModel *)aModel
+								batchSize:(NSUInteger)batchSize
+									queue:(NSOperationQueue *)queue
+							  rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+						completionHandler:(RedlandQueryCompletionHandler)completionHandler;
 
 
 @end
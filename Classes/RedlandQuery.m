@@ -28,10 +28,19 @@
 #import "RedlandQueryResults.h"
 #import "RedlandModel.h"
 #import "RedlandException.h"
+#import "RedlandQueryProfile.h"
+#import "RedlandCancellationToken.h"
 
 NSString * const RedlandRDQLLanguageName = @"rdql";
 NSString * const RedlandSPARQLLanguageName = @"sparql";
 
+@interface RedlandQuery () {
+	NSTimeInterval parseTime;
+}
+
+@end
+
+
 @implementation RedlandQuery
 
 @dynamic limit, offset;
@@ -84,6 +93,7 @@ NSString * const RedlandSPARQLLanguageName = @"sparql";
 	NSParameterAssert(langName != nil || langURI != nil);
 	NSParameterAssert(queryString != nil);
 	
+	CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
 	librdf_query *newQuery = librdf_new_query([RedlandWorld defaultWrappedWorld],
 											  [langName UTF8String],
 											  [langURI wrappedURI],
@@ -96,7 +106,11 @@ NSString * const RedlandSPARQLLanguageName = @"sparql";
 	}
 	[[RedlandWorld defaultWorld] handleStoredErrors];
 	
-	return [self initWithWrappedObject:newQuery];
+	if ((self = [self initWithWrappedObject:newQuery])) {
+		_queryString = [queryString copy];
+		parseTime = CFAbsoluteTimeGetCurrent() - start;
+	}
+	return self;
 }
 
 - (void)dealloc
@@ -119,16 +133,79 @@ NSString * const RedlandSPARQLLanguageName = @"sparql";
 #pragma mark - Query Execution
 /**
  *  Run the query on the given model.
+ *
+ *  The results carry a RedlandQueryProfile of this execution.
  *  @param aModel The model against which to execute the query
  *  @return A RedlandQueryResults object
  */
 - (RedlandQueryResults *)executeOnModel:(RedlandModel *)aModel
+{
+	return [self executeOnModel:aModel cancellationToken:nil];
+}
+
+/**
+ *  Run the query on the given model, giving up once the token is cancelled or its deadline passes.
+ *
+ *  The token is checked before and after librdf executes the query and is handed to the results, which check it before advancing to the next row.
+ *  librdf executes the query with the lock of the default RedlandWorld held, so this may be called while a RedlandQueryExecutor is running queries.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled.
+ *  @param aModel The model against which to execute the query
+ *  @param token The cancellation token, may be nil
+ *  @return A RedlandQueryResults object
+ */
+- (RedlandQueryResults *)executeOnModel:(RedlandModel *)aModel cancellationToken:(RedlandCancellationToken *)token
 {
 	NSParameterAssert(aModel != nil);
 	
-	librdf_query_results *results = librdf_query_execute(wrappedObject, [aModel wrappedModel]);
-	[[RedlandWorld defaultWorld] handleStoredErrors];
-	return [[RedlandQueryResults alloc] initWithWrappedObject:results];
+	[token throwIfCancelled];
+	RedlandQueryProfile *profile = [[RedlandQueryProfile alloc] initWithQueryString:_queryString parseTime:parseTime];
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	librdf_query_results *results = NULL;
+	[world lock];
+	@try {
+		[profile beginExecutionOnModel:aModel limit:librdf_query_get_limit(wrappedObject) offset:librdf_query_get_offset(wrappedObject)];
+		results = librdf_query_execute(wrappedObject, [aModel wrappedModel]);
+		[profile endExecutionWithResults:results];
+		[world handleStoredErrors];
+	}
+	@finally {
+		[world unlock];
+	}
+	
+	RedlandQueryResults *queryResults = [[RedlandQueryResults alloc] initWithWrappedObject:results];
+	queryResults.profile = profile;
+	queryResults.cancellationToken = token;
+	if ([token isCancelled]) {
+		[profile finish];
+		[token throwIfCancelled];
+	}
+	return queryResults;
+}
+
+
+/**
+ *  Executes the query asynchronously on the shared RedlandQueryExecutor, delivering the rows in batches.
+ *
+ *  Only the first batch is delivered unasked; call -[RedlandQueryExecution requestBatches:] for more.
+ *  @param aModel The model against which to execute the query
+ *  @param batchSize The maximum number of rows per batch
+ *  @param queue The queue to call the handlers on, nil for the main queue
+ *  @param rowsHandler Called with every batch of rows
+ *  @param completionHandler Called once after the last batch, with an error if the execution failed or was cancelled
+ *  @return The execution
+ */
+- (RedlandQueryExecution *)executeOnModel:(RedlandModel *)aModel
+								batchSize:(NSUInteger)batchSize
+									queue:(NSOperationQueue *)queue
+							  rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+						completionHandler:(RedlandQueryCompletionHandler)completionHandler
+{
+	return [[RedlandQueryExecutor sharedExecutor] executeQuery:self
+													   onModel:aModel
+													 batchSize:batchSize
+														 queue:queue
+												   rowsHandler:rowsHandler
+											 completionHandler:completionHandler];
 }
 
 
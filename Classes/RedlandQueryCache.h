@@ -0,0 +1,60 @@
+//
+//  RedlandQueryCache.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandQuery, RedlandModel, RedlandBindingTable;
+
+
+/**
+ *  A cache of materialized query results, keyed by query text, limit, offset and model version.
+ *
+ *  A repeated query against an unchanged model is answered with a dictionary lookup: the first execution copies the variable bindings into a compact
+ *  RedlandBindingTable, later lookups return the same table as long as the version of the model (see -[RedlandModel version]) has not changed. Tables
+ *  of older versions of a model are dropped when a newer one is stored, the least recently used tables are evicted when either the number of tables or
+ *  their estimated size in bytes exceeds its limit.
+ *
+ *  Only queries producing variable bindings (SELECT) are cached. Changes made to the librdf model directly must be followed by -[RedlandModel
+ *  bumpVersion]. All methods are thread safe; queries are executed outside of the cache lock.
+ */
+@interface RedlandQueryCache : NSObject
+
+@property (nonatomic, assign) NSUInteger countLimit;					///< The maximum number of cached results, 0 for no limit
+@property (nonatomic, assign) NSUInteger costLimit;						///< The maximum estimated size of all cached results in bytes, 0 for no limit
+
+@property (nonatomic, readonly, assign) NSUInteger count;				///< The number of cached results
+@property (nonatomic, readonly, assign) NSUInteger totalCost;			///< The estimated size of all cached results in bytes
+@property (nonatomic, readonly, assign) NSUInteger hits;				///< Lookups answered from the cache
+@property (nonatomic, readonly, assign) NSUInteger misses;				///< Lookups that had to execute the query
+@property (nonatomic, readonly, assign) NSUInteger evictions;			///< Results evicted because of the limits
+@property (nonatomic, readonly, assign) double hitRate;				///< hits / (hits + misses), 0 before the first lookup
+
+- (id)initWithCountLimit:(NSUInteger)countLimit costLimit:(NSUInteger)costLimit;
+
+- (RedlandBindingTable *)bindingsOfQuery:(RedlandQuery *)query onModel:(RedlandModel *)model;
+
+- (void)removeAllResults;
+- (void)resetStatistics;
+
+
+@end
@@ -0,0 +1,301 @@
+//
+//  RedlandQueryCache.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+#import "RedlandQueryCache.h"
+#import <pthread.h>
+#import "RedlandQuery.h"
+#import "RedlandQueryResults.h"
+#import "RedlandModel.h"
+#import "RedlandBindingTable.h"
+
+/// One cached result, linked into the LRU list (most recently used first)
+typedef struct RedlandQueryCacheEntry {
+	CFStringRef key;
+	CFTypeRef table;									///< The retained RedlandBindingTable
+	const void *model;									///< Identifies the model, never dereferenced
+	uint64_t version;
+	NSUInteger cost;
+	struct RedlandQueryCacheEntry *previous;
+	struct RedlandQueryCacheEntry *next;
+} RedlandQueryCacheEntry;
+
+
+static void RedlandQueryCacheEntryFree(RedlandQueryCacheEntry *entry)
+{
+	CFRelease(entry->key);
+	CFRelease(entry->table);
+	free(entry);
+}
+
+/**
+ *  An estimate of the memory a node kept alive by a table uses.
+ */
+static NSUInteger RedlandQueryCacheNodeCost(librdf_node *node)
+{
+	size_t length = 0;
+	if (NULL == node) {
+		return 0;
+	}
+	if (librdf_node_is_literal(node)) {
+		librdf_node_get_literal_value_as_counted_string(node, &length);
+	}
+	else if (librdf_node_is_resource(node)) {
+		librdf_uri_as_counted_string(librdf_node_get_uri(node), &length);
+	}
+	else if (librdf_node_is_blank(node)) {
+		const char *identifier = (const char *)librdf_node_get_blank_identifier(node);
+		length = identifier ? strlen(identifier) : 0;
+	}
+	return 48 + length;
+}
+
+/**
+ *  An estimate of the memory a table uses, including the nodes it keeps alive.
+ */
+static NSUInteger RedlandQueryCacheTableCost(RedlandBindingTable *table)
+{
+	NSUInteger width = [table.variables count];
+	NSUInteger cost = 64 + 32 * width;
+	for (NSUInteger row = 0; row < table.count; row++) {
+		for (NSUInteger column = 0; column < width; column++) {
+			cost += sizeof(librdf_node *) + RedlandQueryCacheNodeCost([table wrappedNodeAtRow:row column:column]);
+		}
+	}
+	return cost;
+}
+
+
+@interface RedlandQueryCache () {
+	pthread_mutex_t lock;
+	CFMutableDictionaryRef entries;						///< key -> RedlandQueryCacheEntry
+	RedlandQueryCacheEntry *mostRecent;
+	RedlandQueryCacheEntry *leastRecent;
+}
+
+@end
+
+
+@implementation RedlandQueryCache
+
+
+- (id)init
+{
+	return [self initWithCountLimit:256 costLimit:16 * 1024 * 1024];
+}
+
+/**
+ *  Designated initializer.
+ *  @param countLimit The maximum number of cached results, 0 for no limit
+ *  @param costLimit The maximum estimated size of all cached results in bytes, 0 for no limit
+ */
+- (id)initWithCountLimit:(NSUInteger)countLimit costLimit:(NSUInteger)costLimit
+{
+	if ((self = [super init])) {
+		pthread_mutex_init(&lock, NULL);
+		entries = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+		_countLimit = countLimit;
+		_costLimit = costLimit;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self removeAllResults];
+	CFRelease(entries);
+	pthread_mutex_destroy(&lock);
+}
+
+
+
+#pragma mark - LRU List
+- (void)unlinkEntry:(RedlandQueryCacheEntry *)entry
+{
+	if (entry->previous) {
+		entry->previous->next = entry->next;
+	}
+	else {
+		mostRecent = entry->next;
+	}
+	if (entry->next) {
+		entry->next->previous = entry->previous;
+	}
+	else {
+		leastRecent = entry->previous;
+	}
+	entry->previous = entry->next = NULL;
+}
+
+- (void)linkEntry:(RedlandQueryCacheEntry *)entry
+{
+	entry->next = mostRecent;
+	if (mostRecent) {
+		mostRecent->previous = entry;
+	}
+	mostRecent = entry;
+	if (NULL == leastRecent) {
+		leastRecent = entry;
+	}
+}
+
+- (void)discardEntry:(RedlandQueryCacheEntry *)entry
+{
+	[self unlinkEntry:entry];
+	CFDictionaryRemoveValue(entries, entry->key);
+	_count--;
+	_totalCost -= entry->cost;
+	RedlandQueryCacheEntryFree(entry);
+}
+
+/**
+ *  Evicts the least recently used results until the limits are met. Must be called with the lock held.
+ */
+- (void)trim
+{
+	while (leastRecent && ((_countLimit > 0 && _count > _countLimit) || (_costLimit > 0 && _totalCost > _costLimit))) {
+		[self discardEntry:leastRecent];
+		_evictions++;
+	}
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit
+{
+	pthread_mutex_lock(&lock);
+	_countLimit = countLimit;
+	[self trim];
+	pthread_mutex_unlock(&lock);
+}
+
+- (void)setCostLimit:(NSUInteger)costLimit
+{
+	pthread_mutex_lock(&lock);
+	_costLimit = costLimit;
+	[self trim];
+	pthread_mutex_unlock(&lock);
+}
+
+
+
+#pragma mark - Lookup
+/**
+ *  Returns the bindings of the query on the model, executing it only if the cache has no result for the current version of the model.
+ *  @param query The query; its text, limit and offset are part of the cache key
+ *  @param model The model to run the query on
+ *  @return The materialized bindings, nil if the query does not produce variable bindings
+ */
+- (RedlandBindingTable *)bindingsOfQuery:(RedlandQuery *)query onModel:(RedlandModel *)model
+{
+	NSParameterAssert(query != nil);
+	NSParameterAssert(model != nil);
+	
+	uint64_t version = [model version];
+	NSString *key = [NSString stringWithFormat:@"%p|%llu|%d|%d|%@", model, (unsigned long long)version, [query limit], [query offset], [query queryString]];
+	
+	pthread_mutex_lock(&lock);
+	RedlandQueryCacheEntry *entry = (RedlandQueryCacheEntry *)CFDictionaryGetValue(entries, (__bridge CFStringRef)key);
+	RedlandBindingTable *table = nil;
+	if (entry) {
+		[self unlinkEntry:entry];
+		[self linkEntry:entry];
+		table = (__bridge RedlandBindingTable *)entry->table;
+		_hits++;
+	}
+	else {
+		_misses++;
+	}
+	pthread_mutex_unlock(&lock);
+	if (table) {
+		return table;
+	}
+	
+	RedlandQueryResults *results = [query executeOnModel:model];
+	if (nil == results || ![results isBindings]) {
+		return nil;
+	}
+	table = [results nextRowsWithLimit:NSUIntegerMax];
+	if (version != [model version]) {
+		return table;
+	}
+	NSUInteger cost = RedlandQueryCacheTableCost(table);
+	
+	pthread_mutex_lock(&lock);
+	if (NULL == CFDictionaryGetValue(entries, (__bridge CFStringRef)key)) {
+		
+		// results of older versions of the model can never be hit again
+		const void *modelID = (__bridge const void *)model;
+		for (RedlandQueryCacheEntry *stale = mostRecent; stale; ) {
+			RedlandQueryCacheEntry *next = stale->next;
+			if (stale->model == modelID && stale->version < version) {
+				[self discardEntry:stale];
+			}
+			stale = next;
+		}
+		
+		entry = calloc(1, sizeof(RedlandQueryCacheEntry));
+		entry->key = CFBridgingRetain([key copy]);
+		entry->table = CFBridgingRetain(table);
+		entry->model = modelID;
+		entry->version = version;
+		entry->cost = cost;
+		CFDictionarySetValue(entries, entry->key, entry);
+		[self linkEntry:entry];
+		_count++;
+		_totalCost += cost;
+		[self trim];
+	}
+	pthread_mutex_unlock(&lock);
+	return table;
+}
+
+
+
+#pragma mark - Invalidation
+- (void)removeAllResults
+{
+	pthread_mutex_lock(&lock);
+	while (mostRecent) {
+		[self discardEntry:mostRecent];
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+- (void)resetStatistics
+{
+	pthread_mutex_lock(&lock);
+	_hits = 0;
+	_misses = 0;
+	_evictions = 0;
+	pthread_mutex_unlock(&lock);
+}
+
+- (double)hitRate
+{
+	pthread_mutex_lock(&lock);
+	NSUInteger lookups = _hits + _misses;
+	double rate = (lookups > 0) ? (double)_hits / lookups : 0.0;
+	pthread_mutex_unlock(&lock);
+	return rate;
+}
+
+
+@end
@@ -0,0 +1,136 @@
+//
+//  RedlandQueryExecutor.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import <Foundation/Foundation.h>
+
+@class RedlandQuery, RedlandModel, RedlandBindingTable, RedlandQueryExecution;
+
+/// The codes of the errors in RedlandErrorDomain passed to a RedlandQueryCompletionHandler
+typedef enum {
+	RedlandQueryExecutionFailedError = 1,						///< librdf raised an error; the RedlandException is in the userInfo under "exception"
+	RedlandQueryExecutionCancelledError,						///< The execution was cancelled or ran past the deadline of its token
+	RedlandQueryExecutionUnsupportedResultsError,				///< The query does not produce variable bindings
+	RedlandQueryExecutionRejectedError							///< The execution was shed because its priority class was overloaded
+} RedlandQueryExecutionErrorCode;
+
+/// The priority classes of a RedlandQueryExecutor, each with its own queue and limits
+typedef enum {
+	RedlandQueryPriorityInteractive = 0,						///< Cheap queries someone is waiting for, like point lookups
+	RedlandQueryPriorityNormal,
+	RedlandQueryPriorityBackground								///< Heavy analytical queries, like report generation
+} RedlandQueryPriority;
+
+/// A snapshot of the load of one priority class
+typedef struct {
+	NSUInteger queued;											///< Batches waiting for the worker
+	NSUInteger running;											///< Executions in progress, each holding one of the slots
+	NSUInteger admitted;										///< Executions that got a slot
+	NSUInteger shed;											///< Executions rejected because the queue was too long or they waited too long
+	NSTimeInterval averageWaitTime;								///< Mean time admitted executions waited for their slot
+	NSTimeInterval maximumWaitTime;								///< Longest time an admitted execution waited for its slot
+} RedlandQueryPriorityStatistics;
+
+typedef void (^RedlandQueryRowsHandler)(RedlandQueryExecution *execution, RedlandBindingTable *rows);
+typedef void (^RedlandQueryCompletionHandler)(RedlandQueryExecution *execution, NSError *error);
+
+
+/**
+ *  Runs queries in the background, scheduled by priority, and streams their rows to a handler.
+ *
+ *  librdf is not thread-safe, so all executors produce rows on one serial worker each while holding the lock of the default RedlandWorld, which the
+ *  synchronous query methods take as well. An executor has maxConcurrentQueries slots: an execution takes a slot when its first batch is produced
+ *  and keeps it, with its open results, until it finished. The batches of the executions holding a slot are produced one at a time. Every batch is a task of its own that holds the world lock only while it runs and is queued again behind the tasks of
+ *  other executions, so an interactive query waits for at most one batch of a running report rather than for the whole report. Interactive batches
+ *  also run with a higher thread priority than background batches.
+ *
+ *  Rows are produced in batches of up to batchSize rows, one batch per unit of demand. Every execution starts with a demand of one batch; the consumer
+ *  asks for more with -[RedlandQueryExecution requestBatches:], typically from its rows handler. While there is no demand an execution does not occupy
+ *  the worker, so slow consumers do not hold up other queries.
+ *
+ *  Every priority class has its own queue and a weight. When the worker is free every class with a ready batch offers its oldest one; first batches
+ *  only count as ready while their class is below its slot limit. The worker is shared by a smooth weighted round robin, so while several classes
+ *  have work, each gets batches produced in proportion to its weight: interactive queries go first most of the time, but background queries are
+ *  never starved. By default background queries may hold at most half of the slots, so interactive queries find a free slot even while reports
+ *  are generated. When a class has a maximum queue length, new executions are rejected
+ *  while its queue is full; when it has a maximum wait time, executions that waited longer for their first batch are rejected instead of being
+ *  started. Rejected executions complete with a RedlandQueryExecutionRejectedError.
+ *
+ *  Rows and completion are delivered on the given queue, in order, with the completion handler always called last and exactly once. A model must not
+ *  be changed while queries are executing on it.
+ */
+@interface RedlandQueryExecutor : NSObject
+
+@property (nonatomic, readonly, assign) NSUInteger maxConcurrentQueries;		///< The maximum number of executions in progress at the same time
+
++ (RedlandQueryExecutor *)sharedExecutor;
+
+- (id)initWithMaxConcurrentQueries:(NSUInteger)maxConcurrentQueries;
+
+- (RedlandQueryExecution *)executeQuery:(RedlandQuery *)query
+								onModel:(RedlandModel *)model
+							  batchSize:(NSUInteger)batchSize
+								  queue:(NSOperationQueue *)queue
+							rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+					  completionHandler:(RedlandQueryCompletionHandler)completionHandler;
+- (RedlandQueryExecution *)executeQuery:(RedlandQuery *)query
+								onModel:(RedlandModel *)model
+							   priority:(RedlandQueryPriority)priority
+							  batchSize:(NSUInteger)batchSize
+								  queue:(NSOperationQueue *)queue
+							rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+					  completionHandler:(RedlandQueryCompletionHandler)completionHandler;
+
+- (void)cancelAllExecutions;
+
+- (NSUInteger)maxConcurrentQueriesForPriority:(RedlandQueryPriority)priority;
+- (void)setMaxConcurrentQueries:(NSUInteger)maxConcurrentQueries forPriority:(RedlandQueryPriority)priority;
+- (NSUInteger)weightForPriority:(RedlandQueryPriority)priority;
+- (void)setWeight:(NSUInteger)weight forPriority:(RedlandQueryPriority)priority;
+- (NSUInteger)maxQueueLengthForPriority:(RedlandQueryPriority)priority;
+- (void)setMaxQueueLength:(NSUInteger)maxQueueLength forPriority:(RedlandQueryPriority)priority;
+- (NSTimeInterval)maxWaitTimeForPriority:(RedlandQueryPriority)priority;
+- (void)setMaxWaitTime:(NSTimeInterval)maxWaitTime forPriority:(RedlandQueryPriority)priority;
+
+- (RedlandQueryPriorityStatistics)statisticsForPriority:(RedlandQueryPriority)priority;
+- (void)resetStatistics;
+
+
+@end
+
+
+/**
+ *  One asynchronous execution of a query, returned by RedlandQueryExecutor.
+ */
+@interface RedlandQueryExecution : NSObject
+
+@property (nonatomic, readonly, strong) RedlandQuery *query;
+@property (nonatomic, readonly, strong) RedlandModel *model;
+@property (nonatomic, readonly, assign) RedlandQueryPriority priority;
+@property (nonatomic, readonly, assign) NSUInteger batchSize;					///< The maximum number of rows per batch
+@property (nonatomic, readonly, assign) NSUInteger rowCount;					///< The number of rows produced so far
+@property (nonatomic, readonly, assign, getter=isFinished) BOOL finished;		///< YES once all rows were produced or the execution failed
+
+- (void)requestBatches:(NSUInteger)count;
+- (void)cancel;
+
+
+@end
@@ -0,0 +1,777 @@
+//
+//  RedlandQueryExecutor.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandQueryExecutor.h"
+#import <pthread.h>
+#import "RedlandQuery.h"
+#import "RedlandQueryResults.h"
+#import "RedlandModel.h"
+#import "RedlandWorld.h"
+#import "RedlandBindingTable.h"
+#import "RedlandCancellationToken.h"
+#import "RedlandException.h"
+
+
+static NSError *RedlandQueryExecutionError(RedlandQueryExecutionErrorCode code, NSString *reason, NSException *exception)
+{
+	NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:(reason ? reason : @"Query execution failed") forKey:NSLocalizedDescriptionKey];
+	if (exception) {
+		userInfo[@"exception"] = exception;
+	}
+	return [NSError errorWithDomain:RedlandErrorDomain code:code userInfo:userInfo];
+}
+
+#define RedlandQueryPriorityCount (RedlandQueryPriorityBackground + 1)
+
+/// The thread priority the worker produces a batch with, per class, so interactive batches are not slowed down by the rest of the process
+static const double RedlandQueryThreadPriority[RedlandQueryPriorityCount] = { 1.0, 0.5, 0.25 };
+
+/**
+ *  The production of one batch of an execution, preceded by executing the query for the first one, waiting in the queue of its priority class.
+ */
+@interface RedlandQueryExecutorTask : NSObject
+
+@property (nonatomic, strong) RedlandQueryExecution *execution;
+@property (nonatomic, assign) RedlandQueryPriority priority;
+@property (nonatomic, assign) CFAbsoluteTime enqueueTime;
+@property (nonatomic, assign) BOOL admission;					///< YES for the first task of an execution; only these take a slot and are subject to load shedding
+@property (nonatomic, copy) void (^work)(void);
+@property (nonatomic, copy) void (^reject)(void);
+
+@end
+
+@implementation RedlandQueryExecutorTask
+@end
+
+
+/// The limits, load and statistics of one priority class
+typedef struct {
+	NSUInteger maxConcurrent;									///< The number of slots the class may hold
+	NSUInteger maxQueueLength;									///< 0 for no limit
+	NSTimeInterval maxWaitTime;									///< 0 for no limit
+	NSUInteger weight;											///< The share of the worker the class gets while others have work, at least 1
+	NSInteger currentWeight;									///< The credit of the smooth weighted round robin, 0 while the class has nothing ready
+	NSUInteger running;											///< The number of slots the class holds
+	NSUInteger admitted;
+	NSUInteger shed;
+	NSTimeInterval totalWaitTime;
+	NSTimeInterval maximumWaitTime;
+} RedlandQueryPriorityClass;
+
+
+@interface RedlandQueryExecutor () {
+	pthread_mutex_t lock;
+	NSOperationQueue *worker;							///< Serial; only receives a task while it is idle, so the next batch is always picked by the scheduler
+	NSMutableSet *executions;							///< Executions that have not finished yet
+	NSMutableSet *activeExecutions;						///< Executions holding a slot
+	NSArray *pendingTasks;								///< One NSMutableArray of RedlandQueryExecutorTask per priority, oldest first
+	RedlandQueryPriorityClass classes[RedlandQueryPriorityCount];
+	NSUInteger running;									///< The number of slots held
+	BOOL busy;											///< YES while the worker runs a task
+}
+
+- (BOOL)submitTaskForExecution:(RedlandQueryExecution *)execution admission:(BOOL)admission work:(void (^)(void))work reject:(void (^)(void))reject;
+- (void)executionDidFinish:(RedlandQueryExecution *)execution;
+
+@end
+
+
+@interface RedlandQueryExecution () {
+	RedlandQueryExecutor *executor;						///< Keeps the receiver until it finished
+	NSOperationQueue *deliveryQueue;
+	RedlandQueryRowsHandler rowsHandler;
+	RedlandQueryCompletionHandler completionHandler;
+	RedlandCancellationToken *token;
+	RedlandQueryResults *results;						///< nil until the first batch is produced and again once finished
+	NSUInteger demand;									///< Batches requested but not yet produced
+	BOOL scheduled;										///< YES while a task producing rows is queued or running
+	BOOL admitted;										///< YES once the first task was submitted
+	NSMutableArray *pendingDeliveries;					///< Blocks calling the handlers, in order
+	BOOL delivering;									///< YES while an operation draining pendingDeliveries is queued or running
+}
+
+@property (nonatomic, readwrite, assign) NSUInteger rowCount;
+@property (nonatomic, readwrite, assign, getter=isFinished) BOOL finished;
+
+- (void)submitTaskWithAdmission:(BOOL)admission;
+
+- (id)initWithQuery:(RedlandQuery *)query
+			  model:(RedlandModel *)model
+		   priority:(RedlandQueryPriority)priority
+		  batchSize:(NSUInteger)batchSize
+		   executor:(RedlandQueryExecutor *)executor
+	  deliveryQueue:(NSOperationQueue *)deliveryQueue
+		rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+  completionHandler:(RedlandQueryCompletionHandler)completionHandler;
+
+@end
+
+
+@implementation RedlandQueryExecution
+
+
+- (id)initWithQuery:(RedlandQuery *)query
+			  model:(RedlandModel *)model
+		   priority:(RedlandQueryPriority)priority
+		  batchSize:(NSUInteger)batchSize
+		   executor:(RedlandQueryExecutor *)anExecutor
+	  deliveryQueue:(NSOperationQueue *)aDeliveryQueue
+		rowsHandler:(RedlandQueryRowsHandler)aRowsHandler
+  completionHandler:(RedlandQueryCompletionHandler)aCompletionHandler
+{
+	if ((self = [super init])) {
+		_query = query;
+		_model = model;
+		_priority = priority;
+		_batchSize = MAX(batchSize, (NSUInteger)1);
+		executor = anExecutor;
+		deliveryQueue = aDeliveryQueue;
+		rowsHandler = [aRowsHandler copy];
+		completionHandler = [aCompletionHandler copy];
+		token = [RedlandCancellationToken token];
+		pendingDeliveries = [NSMutableArray new];
+	}
+	return self;
+}
+
+
+
+#pragma mark - Demand
+/**
+ *  Asks for count more batches of rows; the rows handler is called once per batch until the demand is met or all rows were delivered.
+ */
+- (void)requestBatches:(NSUInteger)count
+{
+	BOOL schedule = NO;
+	BOOL admission = NO;
+	@synchronized(self) {
+		if (_finished || 0 == count) {
+			return;
+		}
+		demand = (demand > NSUIntegerMax - count) ? NSUIntegerMax : demand + count;
+		if (!scheduled) {
+			scheduled = YES;
+			schedule = YES;
+			admission = !admitted;
+			admitted = YES;
+		}
+	}
+	if (schedule) {
+		[self submitTaskWithAdmission:admission];
+	}
+}
+
+/**
+ *  Queues a task producing the next batch; only admissions can be rejected.
+ */
+- (void)submitTaskWithAdmission:(BOOL)admission
+{
+	BOOL accepted = [executor submitTaskForExecution:self admission:admission work:^{
+		[self produceRows];
+	} reject:^{
+		[self finishWithError:RedlandQueryExecutionError(RedlandQueryExecutionRejectedError, @"The query waited too long for a slot", nil)];
+	}];
+	if (!accepted) {
+		[self finishWithError:RedlandQueryExecutionError(RedlandQueryExecutionRejectedError, @"Too many queries of this priority are waiting", nil)];
+	}
+}
+
+/**
+ *  Stops the execution. Batches already produced are still delivered, the completion handler receives a RedlandQueryExecutionCancelledError.
+ */
+- (void)cancel
+{
+	[token cancel];
+	BOOL idle = NO;
+	@synchronized(self) {
+		if (!scheduled && !_finished) {
+			scheduled = YES;							// keeps requestBatches: from scheduling more work
+			idle = YES;
+		}
+	}
+	if (idle) {
+		[self finishWithError:RedlandQueryExecutionError(RedlandQueryExecutionCancelledError, @"The query execution was cancelled", nil)];
+	}
+}
+
+
+
+#pragma mark - Producing Rows
+/**
+ *  Runs on the executor's worker, with the world locked: executes the query if needed, then produces one batch. If more batches are wanted the next one
+ *  is queued as a task of its own, so the world lock is released and the worker can turn to other priority classes between batches.
+ */
+- (void)produceRows
+{
+	NSError *error = nil;
+	BOOL exhausted = NO;
+	@autoreleasepool {
+		@try {
+			if (nil == results) {
+				results = [_query executeOnModel:_model cancellationToken:token];
+				if (![results isBindings]) {
+					error = RedlandQueryExecutionError(RedlandQueryExecutionUnsupportedResultsError, @"Only queries producing variable bindings can be executed asynchronously", nil);
+				}
+			}
+			if (nil == error) {
+				@synchronized(self) {
+					demand--;
+				}
+				RedlandBindingTable *rows = [results nextRowsWithLimit:_batchSize];
+				exhausted = [results finished];
+				if ([rows count] > 0) {
+					@synchronized(self) {
+						_rowCount += [rows count];
+					}
+					[self enqueueDelivery:^{
+						if (rowsHandler) {
+							rowsHandler(self, rows);
+						}
+					}];
+				}
+			}
+		}
+		@catch (NSException *exception) {
+			BOOL cancelled = [[exception name] isEqualToString:RedlandCancellationExceptionName];
+			error = RedlandQueryExecutionError((cancelled ? RedlandQueryExecutionCancelledError : RedlandQueryExecutionFailedError), [exception reason], exception);
+		}
+	}
+	if (error || exhausted) {
+		[self finishWithError:error];
+		return;
+	}
+	
+	BOOL more = NO;
+	@synchronized(self) {
+		more = (demand > 0);
+		if (!more) {
+			scheduled = NO;
+		}
+	}
+	if (more) {
+		[self submitTaskWithAdmission:NO];
+	}
+}
+
+- (void)finishWithError:(NSError *)error
+{
+	RedlandQueryResults *finishedResults = nil;
+	@synchronized(self) {
+		if (_finished) {
+			return;
+		}
+		_finished = YES;
+		finishedResults = results;
+		results = nil;
+	}
+	if (finishedResults) {								// frees the librdf results here, not on the delivery queue
+		RedlandWorld *world = [RedlandWorld defaultWorld];
+		[world lock];
+		finishedResults = nil;
+		[world unlock];
+	}
+	
+	[self enqueueDelivery:^{
+		if (completionHandler) {
+			completionHandler(self, error);
+		}
+		rowsHandler = nil;								// the handlers may reference the receiver
+		completionHandler = nil;
+	}];
+	[executor executionDidFinish:self];
+}
+
+
+
+#pragma mark - Delivery
+/**
+ *  Queues a handler call. At most one operation drains the pending calls at any time, so handlers are called in order and never concurrently even if
+ *  the delivery queue is concurrent.
+ */
+- (void)enqueueDelivery:(void (^)(void))delivery
+{
+	BOOL drain = NO;
+	@synchronized(self) {
+		[pendingDeliveries addObject:[delivery copy]];
+		if (!delivering) {
+			delivering = YES;
+			drain = YES;
+		}
+	}
+	if (drain) {
+		[deliveryQueue addOperationWithBlock:^{
+			[self drainDeliveries];
+		}];
+	}
+}
+
+- (void)drainDeliveries
+{
+	while (YES) {
+		void (^delivery)(void) = nil;
+		@synchronized(self) {
+			if (0 == [pendingDeliveries count]) {
+				delivering = NO;
+				return;
+			}
+			delivery = [pendingDeliveries objectAtIndex:0];
+			[pendingDeliveries removeObjectAtIndex:0];
+		}
+		@autoreleasepool {
+			delivery();
+		}
+	}
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p> %lu rows, finished: %d, query: %@", NSStringFromClass([self class]), self,
+			(unsigned long)_rowCount, _finished, [_query queryString]];
+}
+
+
+@end
+
+
+
+@implementation RedlandQueryExecutor
+
+
+/**
+ *  Returns an executor with four slots.
+ */
++ (RedlandQueryExecutor *)sharedExecutor
+{
+	static RedlandQueryExecutor *sharedExecutor = nil;
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		sharedExecutor = [self new];
+	});
+	return sharedExecutor;
+}
+
+- (id)init
+{
+	return [self initWithMaxConcurrentQueries:4];
+}
+
+/**
+ *  Designated initializer.
+ *
+ *  Interactive and normal queries may hold all slots, background queries half of them. While several classes have batches ready, interactive,
+ *  normal and background batches are produced in a ratio of 4:2:1. No class has a queue length or wait time limit.
+ *  @param maxConcurrentQueries The number of slots, at least 1
+ */
+- (id)initWithMaxConcurrentQueries:(NSUInteger)maxConcurrentQueries
+{
+	if ((self = [super init])) {
+		_maxConcurrentQueries = MAX(maxConcurrentQueries, (NSUInteger)1);
+		pthread_mutex_init(&lock, NULL);
+		worker = [NSOperationQueue new];
+		[worker setName:@"org.librdf.RedlandQueryExecutor"];
+		[worker setMaxConcurrentOperationCount:1];
+		executions = [NSMutableSet new];
+		activeExecutions = [NSMutableSet new];
+		pendingTasks = @[ [NSMutableArray array], [NSMutableArray array], [NSMutableArray array] ];
+		for (NSUInteger i = 0; i < RedlandQueryPriorityCount; i++) {
+			classes[i].maxConcurrent = _maxConcurrentQueries;
+		}
+		classes[RedlandQueryPriorityBackground].maxConcurrent = MAX(_maxConcurrentQueries / 2, (NSUInteger)1);
+		classes[RedlandQueryPriorityInteractive].weight = 4;
+		classes[RedlandQueryPriorityNormal].weight = 2;
+		classes[RedlandQueryPriorityBackground].weight = 1;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	pthread_mutex_destroy(&lock);
+}
+
+
+
+#pragma mark - Executing
+/**
+ *  Starts executing the query with normal priority; see executeQuery:onModel:priority:batchSize:queue:rowsHandler:completionHandler:.
+ */
+- (RedlandQueryExecution *)executeQuery:(RedlandQuery *)query
+								onModel:(RedlandModel *)model
+							  batchSize:(NSUInteger)batchSize
+								  queue:(NSOperationQueue *)deliveryQueue
+							rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+					  completionHandler:(RedlandQueryCompletionHandler)completionHandler
+{
+	return [self executeQuery:query
+					  onModel:model
+					 priority:RedlandQueryPriorityNormal
+					batchSize:batchSize
+						queue:deliveryQueue
+				  rowsHandler:rowsHandler
+			completionHandler:completionHandler];
+}
+
+/**
+ *  Starts executing the query on a background thread and delivers its rows in batches.
+ *
+ *  The first batch is produced as soon as the priority class gets a slot and the worker is free, further batches only after requestBatches: was called on the returned
+ *  execution.
+ *  @param query The query to execute; it must produce variable bindings
+ *  @param model The model to execute the query on
+ *  @param priority The priority class whose queue and limits apply
+ *  @param batchSize The maximum number of rows per batch
+ *  @param deliveryQueue The queue to call the handlers on, nil for the main queue
+ *  @param rowsHandler Called with every batch of rows
+ *  @param completionHandler Called once after the last batch, with an error in RedlandErrorDomain if the execution failed, was cancelled or rejected
+ *  @return The execution, which can be used to request more rows or to cancel
+ */
+- (RedlandQueryExecution *)executeQuery:(RedlandQuery *)query
+								onModel:(RedlandModel *)model
+							   priority:(RedlandQueryPriority)priority
+							  batchSize:(NSUInteger)batchSize
+								  queue:(NSOperationQueue *)deliveryQueue
+							rowsHandler:(RedlandQueryRowsHandler)rowsHandler
+					  completionHandler:(RedlandQueryCompletionHandler)completionHandler
+{
+	NSParameterAssert(query != nil);
+	NSParameterAssert(model != nil);
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	
+	RedlandQueryExecution *execution = [[RedlandQueryExecution alloc] initWithQuery:query
+																			  model:model
+																		   priority:priority
+																		  batchSize:batchSize
+																		   executor:self
+																	  deliveryQueue:(deliveryQueue ? deliveryQueue : [NSOperationQueue mainQueue])
+																		rowsHandler:rowsHandler
+																  completionHandler:completionHandler];
+	pthread_mutex_lock(&lock);
+	[executions addObject:execution];
+	pthread_mutex_unlock(&lock);
+	[execution requestBatches:1];
+	return execution;
+}
+
+/**
+ *  Frees the slot of the execution, if it held one, and starts a task that was waiting for it.
+ */
+- (void)executionDidFinish:(RedlandQueryExecution *)execution
+{
+	NSMutableArray *startable = [NSMutableArray array];
+	NSMutableArray *rejected = [NSMutableArray array];
+	pthread_mutex_lock(&lock);
+	[executions removeObject:execution];
+	if ([activeExecutions containsObject:execution]) {
+		[activeExecutions removeObject:execution];
+		running--;
+		classes[execution.priority].running--;
+		[self dequeueTasks:startable rejecting:rejected];
+	}
+	pthread_mutex_unlock(&lock);
+	[self startTasks:startable rejecting:rejected];
+}
+
+/**
+ *  Cancels all executions that have not finished yet.
+ */
+- (void)cancelAllExecutions
+{
+	pthread_mutex_lock(&lock);
+	NSArray *running = [executions allObjects];
+	pthread_mutex_unlock(&lock);
+	for (RedlandQueryExecution *execution in running) {
+		[execution cancel];
+	}
+}
+
+
+
+#pragma mark - Scheduling
+/**
+ *  Queues a task in the queue of the execution's priority class and starts it if the worker is free.
+ *  @return NO if the task was an admission and the queue of its class is full
+ */
+- (BOOL)submitTaskForExecution:(RedlandQueryExecution *)execution admission:(BOOL)admission work:(void (^)(void))work reject:(void (^)(void))reject
+{
+	RedlandQueryPriority priority = execution.priority;
+	RedlandQueryExecutorTask *task = [RedlandQueryExecutorTask new];
+	task.execution = execution;
+	task.priority = priority;
+	task.admission = admission;
+	task.work = work;
+	task.reject = reject;
+	task.enqueueTime = CFAbsoluteTimeGetCurrent();
+	
+	NSMutableArray *startable = [NSMutableArray array];
+	NSMutableArray *rejected = [NSMutableArray array];
+	pthread_mutex_lock(&lock);
+	NSMutableArray *queue = [pendingTasks objectAtIndex:priority];
+	if (admission && classes[priority].maxQueueLength > 0 && [queue count] >= classes[priority].maxQueueLength) {
+		classes[priority].shed++;
+		pthread_mutex_unlock(&lock);
+		return NO;
+	}
+	[queue addObject:task];
+	[self dequeueTasks:startable rejecting:rejected];
+	pthread_mutex_unlock(&lock);
+	
+	[self startTasks:startable rejecting:rejected];
+	return YES;
+}
+
+/**
+ *  Takes the next task off the queues if the worker is idle.
+ *
+ *  Every class offers its oldest ready task: tasks of executions holding a slot are always ready, admissions only while their class and the executor
+ *  have a free slot. Among the classes offering a task, a smooth weighted round robin picks one, so each class gets a share of the worker proportional
+ *  to its weight and background work is not starved by a steady stream of interactive queries. Ties go to the more important class. Admissions that
+ *  waited longer than their class allows are collected in rejected. Must be called with the lock held.
+ */
+- (void)dequeueTasks:(NSMutableArray *)startable rejecting:(NSMutableArray *)rejected
+{
+	if (busy) {
+		return;
+	}
+	CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+	NSUInteger readyIndex[RedlandQueryPriorityCount];
+	NSInteger totalWeight = 0;
+	for (NSUInteger priority = 0; priority < RedlandQueryPriorityCount; priority++) {
+		RedlandQueryPriorityClass *priorityClass = &classes[priority];
+		NSMutableArray *queue = [pendingTasks objectAtIndex:priority];
+		BOOL admits = (running < _maxConcurrentQueries && priorityClass->running < priorityClass->maxConcurrent);
+		readyIndex[priority] = NSNotFound;
+		NSUInteger i = 0;
+		while (i < [queue count]) {
+			RedlandQueryExecutorTask *task = [queue objectAtIndex:i];
+			if (task.admission && priorityClass->maxWaitTime > 0 && now - task.enqueueTime > priorityClass->maxWaitTime) {
+				[queue removeObjectAtIndex:i];
+				priorityClass->shed++;
+				[rejected addObject:task];
+				continue;
+			}
+			if (!task.admission || admits) {
+				readyIndex[priority] = i;
+				break;
+			}
+			i++;
+		}
+		if (NSNotFound == readyIndex[priority]) {
+			priorityClass->currentWeight = 0;
+		}
+		else {
+			totalWeight += priorityClass->weight;
+		}
+	}
+	if (0 == totalWeight) {
+		return;
+	}
+	
+	NSUInteger chosen = NSNotFound;
+	for (NSUInteger priority = 0; priority < RedlandQueryPriorityCount; priority++) {
+		if (NSNotFound != readyIndex[priority]) {
+			classes[priority].currentWeight += classes[priority].weight;
+			if (NSNotFound == chosen || classes[priority].currentWeight > classes[chosen].currentWeight) {
+				chosen = priority;
+			}
+		}
+	}
+	RedlandQueryPriorityClass *priorityClass = &classes[chosen];
+	priorityClass->currentWeight -= totalWeight;
+	
+	NSMutableArray *queue = [pendingTasks objectAtIndex:chosen];
+	RedlandQueryExecutorTask *next = [queue objectAtIndex:readyIndex[chosen]];
+	[queue removeObjectAtIndex:readyIndex[chosen]];
+	if (next.admission) {
+		NSTimeInterval waited = now - next.enqueueTime;
+		priorityClass->admitted++;
+		priorityClass->totalWaitTime += waited;
+		priorityClass->maximumWaitTime = MAX(priorityClass->maximumWaitTime, waited);
+		priorityClass->running++;
+		running++;
+		[activeExecutions addObject:next.execution];
+	}
+	busy = YES;
+	[startable addObject:next];
+}
+
+- (void)startTasks:(NSArray *)startable rejecting:(NSArray *)rejected
+{
+	for (RedlandQueryExecutorTask *task in rejected) {
+		task.reject();
+	}
+	for (RedlandQueryExecutorTask *task in startable) {
+		NSOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+			RedlandWorld *world = [RedlandWorld defaultWorld];
+			[world lock];
+			@autoreleasepool {
+				task.work();
+			}
+			[world unlock];
+			[self taskDidFinish:task];
+		}];
+		[operation setThreadPriority:RedlandQueryThreadPriority[task.priority]];
+		[worker addOperation:operation];
+	}
+}
+
+- (void)taskDidFinish:(RedlandQueryExecutorTask *)task
+{
+	NSMutableArray *startable = [NSMutableArray array];
+	NSMutableArray *rejected = [NSMutableArray array];
+	pthread_mutex_lock(&lock);
+	busy = NO;
+	[self dequeueTasks:startable rejecting:rejected];
+	pthread_mutex_unlock(&lock);
+	[self startTasks:startable rejecting:rejected];
+}
+
+
+
+#pragma mark - Limits
+- (NSUInteger)maxConcurrentQueriesForPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	NSUInteger maxConcurrent = classes[priority].maxConcurrent;
+	pthread_mutex_unlock(&lock);
+	return maxConcurrent;
+}
+
+/**
+ *  Limits the number of slots the executions of a priority class may hold at the same time, which keeps the remaining slots free for other classes.
+ *  @param maxConcurrentQueries At least 1; values above maxConcurrentQueries have no additional effect
+ *  @param priority The priority class
+ */
+- (void)setMaxConcurrentQueries:(NSUInteger)maxConcurrentQueries forPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	NSMutableArray *startable = [NSMutableArray array];
+	NSMutableArray *rejected = [NSMutableArray array];
+	pthread_mutex_lock(&lock);
+	classes[priority].maxConcurrent = MAX(maxConcurrentQueries, (NSUInteger)1);
+	[self dequeueTasks:startable rejecting:rejected];
+	pthread_mutex_unlock(&lock);
+	[self startTasks:startable rejecting:rejected];
+}
+
+- (NSUInteger)weightForPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	NSUInteger weight = classes[priority].weight;
+	pthread_mutex_unlock(&lock);
+	return weight;
+}
+
+/**
+ *  Sets the share of the worker a priority class gets while other classes have batches ready as well.
+ *  @param weight At least 1; a class with weight 4 gets four batches produced for every batch of a class with weight 1
+ *  @param priority The priority class
+ */
+- (void)setWeight:(NSUInteger)weight forPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	classes[priority].weight = MAX(weight, (NSUInteger)1);
+	pthread_mutex_unlock(&lock);
+}
+
+- (NSUInteger)maxQueueLengthForPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	NSUInteger maxQueueLength = classes[priority].maxQueueLength;
+	pthread_mutex_unlock(&lock);
+	return maxQueueLength;
+}
+
+/**
+ *  Rejects new executions of a priority class while this many of its tasks are waiting for a worker.
+ *  @param maxQueueLength The maximum number of waiting tasks, 0 for no limit
+ *  @param priority The priority class
+ */
+- (void)setMaxQueueLength:(NSUInteger)maxQueueLength forPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	classes[priority].maxQueueLength = maxQueueLength;
+	pthread_mutex_unlock(&lock);
+}
+
+- (NSTimeInterval)maxWaitTimeForPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	NSTimeInterval maxWaitTime = classes[priority].maxWaitTime;
+	pthread_mutex_unlock(&lock);
+	return maxWaitTime;
+}
+
+/**
+ *  Rejects executions of a priority class that waited longer than this for their slot; their result would be too late to be useful.
+ *  @param maxWaitTime The maximum wait in seconds, 0 for no limit
+ *  @param priority The priority class
+ */
+- (void)setMaxWaitTime:(NSTimeInterval)maxWaitTime forPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	pthread_mutex_lock(&lock);
+	classes[priority].maxWaitTime = MAX(maxWaitTime, 0.0);
+	pthread_mutex_unlock(&lock);
+}
+
+
+
+#pragma mark - Statistics
+- (RedlandQueryPriorityStatistics)statisticsForPriority:(RedlandQueryPriority)priority
+{
+	NSParameterAssert(priority < RedlandQueryPriorityCount);
+	RedlandQueryPriorityStatistics statistics;
+	pthread_mutex_lock(&lock);
+	RedlandQueryPriorityClass *priorityClass = &classes[priority];
+	statistics.queued = [[pendingTasks objectAtIndex:priority] count];
+	statistics.running = priorityClass->running;
+	statistics.admitted = priorityClass->admitted;
+	statistics.shed = priorityClass->shed;
+	statistics.averageWaitTime = (priorityClass->admitted > 0) ? priorityClass->totalWaitTime / priorityClass->admitted : 0.0;
+	statistics.maximumWaitTime = priorityClass->maximumWaitTime;
+	pthread_mutex_unlock(&lock);
+	return statistics;
+}
+
+/**
+ *  Sets the admission, shedding and wait time counters of all priority classes back to zero.
+ */
+- (void)resetStatistics
+{
+	pthread_mutex_lock(&lock);
+	for (NSUInteger i = 0; i < RedlandQueryPriorityCount; i++) {
+		classes[i].admitted = 0;
+		classes[i].shed = 0;
+		classes[i].totalWaitTime = 0;
+		classes[i].maximumWaitTime = 0;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+
+@end
@@ -0,0 +1,75 @@
+//
+//  RedlandQueryProfile.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import <Foundation/Foundation.h>
+#import <redland.h>
+
+@class RedlandModel, RedlandQueryProfile;
+
+typedef void (^RedlandSlowQueryHandler)(RedlandQueryProfile *profile);
+
+
+/**
+ *  Where the time of one execution of a RedlandQuery went.
+ *
+ *  Every RedlandQueryResults carries a profile. It is complete once the results have been iterated to the end (or the results are deallocated); at that
+ *  point the total time is compared to the slow query threshold and, if it is exceeded, the profile is added to the slow query log and handed to the
+ *  slow query handler. The log is shared by all queries and keeps the most recent slowQueryLogCapacity profiles.
+ *
+ *  The number of statements scanned is only known for models backed by the compact storage. It is the difference of the storage's scan counter, see
+ *  RedlandCompactStorageScannedCount(), between the start of the execution and the completion of the profile; statements scanned in the meantime by
+ *  other queries or reads of the same storage are included, so the count is only exact for a query that ran alone.
+ */
+@interface RedlandQueryProfile : NSObject
+
+@property (nonatomic, readonly, copy) NSString *queryString;				///< The query text
+@property (nonatomic, readonly, assign) int limit;							///< The limit the query was executed with, < 0 if none
+@property (nonatomic, readonly, assign) int offset;							///< The offset the query was executed with, < 0 if none
+@property (nonatomic, readonly, copy) NSArray *bindingNames;				///< The names of the variables bound by the results
+@property (nonatomic, readonly, assign) NSTimeInterval parseTime;			///< Time spent parsing and preparing the query
+@property (nonatomic, readonly, assign) NSTimeInterval executionTime;		///< Time spent in librdf_query_execute
+@property (nonatomic, readonly, assign) NSTimeInterval firstResultTime;		///< Time from the end of librdf_query_execute to the first result being available, 0 if there was none; part of iterationTime
+@property (nonatomic, readonly, assign) NSTimeInterval iterationTime;		///< Time spent advancing through the results
+@property (nonatomic, readonly, assign) NSTimeInterval totalTime;			///< Parse, execution and iteration time
+@property (nonatomic, readonly, assign) NSUInteger rowCount;				///< The number of results produced
+@property (nonatomic, readonly, assign) NSUInteger triplesScanned;			///< The number of statements the storage scanned while the query ran, NSNotFound if the storage can't tell
+@property (nonatomic, readonly, assign, getter=isFinished) BOOL finished;	///< Whether the results have been consumed
+
+- (id)initWithQueryString:(NSString *)queryString parseTime:(NSTimeInterval)parseTime;
+
+- (void)beginExecutionOnModel:(RedlandModel *)aModel limit:(int)limit offset:(int)offset;
+- (void)endExecutionWithResults:(librdf_query_results *)results;
+- (void)addIterationTime:(NSTimeInterval)time producedRow:(BOOL)producedRow;
+- (void)finish;
+
++ (NSTimeInterval)slowQueryThreshold;
++ (void)setSlowQueryThreshold:(NSTimeInterval)threshold;
++ (NSUInteger)slowQueryLogCapacity;
++ (void)setSlowQueryLogCapacity:(NSUInteger)capacity;
++ (void)setSlowQueryHandler:(RedlandSlowQueryHandler)handler;
++ (NSArray *)slowQueries;
++ (void)removeAllSlowQueries;
+
+
+@end
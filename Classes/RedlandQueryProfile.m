@@ -0,0 +1,243 @@
+//
+//  RedlandQueryProfile.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import "RedlandQueryProfile.h"
+#import "RedlandModel.h"
+#import "RedlandStorage.h"
+#import "RedlandCompactStorage.h"
+
+static NSTimeInterval RedlandSlowQueryThreshold = 0;				///< 0 disables the slow query log
+static NSUInteger RedlandSlowQueryLogCapacity = 100;
+static NSMutableArray *RedlandSlowQueryLog = nil;
+static RedlandSlowQueryHandler RedlandSlowQueryLogHandler = nil;
+
+
+@interface RedlandQueryProfile () {
+	CFAbsoluteTime executionStart;
+	RedlandModel *model;											///< Only kept while the query runs
+	uint64_t scannedAtStart;
+}
+
+@end
+
+
+@implementation RedlandQueryProfile
+
+
+/**
+ *  Creates the profile of one execution of a query; RedlandQuery does this whenever it is executed.
+ *  @param queryString The query text
+ *  @param parseTime The time it took to parse the query
+ */
+- (id)initWithQueryString:(NSString *)queryString parseTime:(NSTimeInterval)parseTime
+{
+	if ((self = [super init])) {
+		_queryString = [queryString copy];
+		_parseTime = parseTime;
+		_limit = -1;
+		_offset = -1;
+		_triplesScanned = NSNotFound;
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	NSString *scanned = (NSNotFound == _triplesScanned) ? @"unknown" : [NSString stringWithFormat:@"%lu", (unsigned long)_triplesScanned];
+	return [NSString stringWithFormat:@"<%@ %p> %.1f ms total (parse %.1f, execute %.1f, first result %.1f, iterate %.1f), %lu rows, %@ triples scanned: %@",
+			NSStringFromClass([self class]), self, 1000 * _totalTime, 1000 * _parseTime, 1000 * _executionTime, 1000 * _firstResultTime, 1000 * _iterationTime,
+			(unsigned long)_rowCount, scanned, _queryString];
+}
+
+
+
+#pragma mark - Recording
+/**
+ *  Marks the start of the execution.
+ */
+- (void)beginExecutionOnModel:(RedlandModel *)aModel limit:(int)limit offset:(int)offset
+{
+	model = aModel;
+	_limit = limit;
+	_offset = offset;
+	librdf_storage *storage = [[aModel storage] wrappedStorage];
+	if (RedlandStorageIsCompact(storage)) {
+		scannedAtStart = RedlandCompactStorageScannedCount(storage);
+	}
+	executionStart = CFAbsoluteTimeGetCurrent();
+}
+
+/**
+ *  Marks the end of the execution and records when the first result became available.
+ */
+- (void)endExecutionWithResults:(librdf_query_results *)results
+{
+	CFAbsoluteTime executionEnd = CFAbsoluteTimeGetCurrent();
+	_executionTime = executionEnd - executionStart;
+	if (NULL == results) {
+		[self finish];
+		return;
+	}
+	
+	if (librdf_query_results_is_bindings(results)) {
+		int count = librdf_query_results_get_bindings_count(results);
+		NSMutableArray *names = [NSMutableArray arrayWithCapacity:count];
+		for (int i = 0; i < count; i++) {
+			const char *name = librdf_query_results_get_binding_name(results, i);
+			if (name) {
+				[names addObject:[NSString stringWithUTF8String:name]];
+			}
+		}
+		_bindingNames = [names copy];
+	}
+	
+	// rasqal may produce rows lazily, asking whether the results are finished makes it produce the first one
+	BOOL hasRow = !librdf_query_results_finished(results);
+	CFAbsoluteTime firstResult = CFAbsoluteTimeGetCurrent();
+	_iterationTime += firstResult - executionEnd;
+	if (hasRow) {
+		_rowCount = 1;
+		_firstResultTime = firstResult - executionEnd;
+	}
+}
+
+/**
+ *  Adds the time one advance of the results took.
+ */
+- (void)addIterationTime:(NSTimeInterval)time producedRow:(BOOL)producedRow
+{
+	if (_finished) {
+		return;
+	}
+	_iterationTime += time;
+	if (producedRow) {
+		_rowCount++;
+	}
+}
+
+/**
+ *  Completes the profile and reports it to the slow query log if it exceeds the threshold. Does nothing if called again.
+ */
+- (void)finish
+{
+	if (_finished) {
+		return;
+	}
+	_finished = YES;
+	_totalTime = _parseTime + _executionTime + _iterationTime;
+	
+	librdf_storage *storage = [[model storage] wrappedStorage];
+	if (storage && RedlandStorageIsCompact(storage)) {
+		_triplesScanned = (NSUInteger)(RedlandCompactStorageScannedCount(storage) - scannedAtStart);
+	}
+	model = nil;
+	
+	RedlandSlowQueryHandler handler = nil;
+	@synchronized([RedlandQueryProfile class]) {
+		if (RedlandSlowQueryThreshold <= 0 || _totalTime < RedlandSlowQueryThreshold) {
+			return;
+		}
+		if (nil == RedlandSlowQueryLog) {
+			RedlandSlowQueryLog = [NSMutableArray new];
+		}
+		[RedlandSlowQueryLog addObject:self];
+		if ([RedlandSlowQueryLog count] > RedlandSlowQueryLogCapacity) {
+			[RedlandSlowQueryLog removeObjectsInRange:NSMakeRange(0, [RedlandSlowQueryLog count] - RedlandSlowQueryLogCapacity)];
+		}
+		handler = RedlandSlowQueryLogHandler;
+	}
+	if (handler) {
+		handler(self);
+	}
+}
+
+
+
+#pragma mark - Slow Query Log
+/**
+ *  Queries taking at least this long in total are logged; 0 (the default) turns the slow query log off.
+ */
++ (NSTimeInterval)slowQueryThreshold
+{
+	@synchronized(self) {
+		return RedlandSlowQueryThreshold;
+	}
+}
+
++ (void)setSlowQueryThreshold:(NSTimeInterval)threshold
+{
+	@synchronized(self) {
+		RedlandSlowQueryThreshold = threshold;
+	}
+}
+
+/**
+ *  The number of slow query profiles kept, 100 by default.
+ */
++ (NSUInteger)slowQueryLogCapacity
+{
+	@synchronized(self) {
+		return RedlandSlowQueryLogCapacity;
+	}
+}
+
++ (void)setSlowQueryLogCapacity:(NSUInteger)capacity
+{
+	@synchronized(self) {
+		RedlandSlowQueryLogCapacity = capacity;
+		if ([RedlandSlowQueryLog count] > capacity) {
+			[RedlandSlowQueryLog removeObjectsInRange:NSMakeRange(0, [RedlandSlowQueryLog count] - capacity)];
+		}
+	}
+}
+
+/**
+ *  Sets a block that is called with the profile of every slow query, on the thread that finished iterating its results.
+ */
++ (void)setSlowQueryHandler:(RedlandSlowQueryHandler)handler
+{
+	@synchronized(self) {
+		RedlandSlowQueryLogHandler = [handler copy];
+	}
+}
+
+/**
+ *  @return The profiles of the most recent slow queries, oldest first
+ */
++ (NSArray *)slowQueries
+{
+	@synchronized(self) {
+		return RedlandSlowQueryLog ? [RedlandSlowQueryLog copy] : @[];
+	}
+}
+
++ (void)removeAllSlowQueries
+{
+	@synchronized(self) {
+		[RedlandSlowQueryLog removeAllObjects];
+	}
+}
+
+
+@end
@@ -31,7 +31,7 @@
 #import <redland.h>
 #import "RedlandWrappedObject.h"
 
-@class RedlandNode, RedlandStream, RedlandQueryResultsEnumerator, RedlandURI;
+@class RedlandNode, RedlandStream, RedlandQueryResultsEnumerator, RedlandURI, RedlandQueryProfile, RedlandCancellationToken, RedlandBindingTable;
 
 
 /**
@@ -44,6 +44,9 @@
 @interface RedlandQueryResults : RedlandWrappedObject {
 }
 
+@property (nonatomic, strong) RedlandQueryProfile *profile;				///< The profile of the execution that produced the receiver, updated while advancing
+@property (nonatomic, strong) RedlandCancellationToken *cancellationToken;	///< Checked before advancing; next raises once it is cancelled
+
 - (librdf_query_results *)wrappedQueryResults;
 
 - (int)count;
@@ -55,6 +58,7 @@
 - (RedlandNode *)valueOfBinding:(NSString *)aName;
 - (RedlandNode *)valueOfBindingAtIndex:(int)offset;
 - (NSString *)nameOfBindingAtIndex:(int)offset;
+- (RedlandBindingTable *)nextRowsWithLimit:(NSUInteger)limit;
 
 - (RedlandStream *)resultStream;
 - (RedlandQueryResultsEnumerator *)resultEnumerator;
@@ -27,6 +27,10 @@
 #import "RedlandNode.h"
 #import "RedlandQueryResultsEnumerator.h"
 #import "RedlandURI.h"
+#import "RedlandQueryProfile.h"
+#import "RedlandCancellationToken.h"
+#import "RedlandBindingTable.h"
+#import "RedlandWorld.h"
 
 /* SPARQL Variable Binding Results XML Format (see http://www.w3.org/TR/2004/WD-rdf-sparql-XMLres-20041221/) */
 RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
@@ -42,6 +46,7 @@ RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
 
 - (void)dealloc
 {
+	[_profile finish];
     if (isWrappedObjectOwner) {
         librdf_free_query_results(wrappedObject);
 	}
@@ -68,11 +73,32 @@ RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
 
 /**
  *  Advances to the next result.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName if the receiver's cancellationToken was cancelled.
  *  @return Returns YES if there is a next result, otherwise NO.
  */
 - (BOOL)next
 {
-    return librdf_query_results_next(wrappedObject) == 0;
+	if ([_cancellationToken isCancelled]) {
+		[_profile finish];
+		[_cancellationToken throwIfCancelled];
+	}
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	if (nil == _profile) {
+		[world lock];
+		BOOL advanced = (librdf_query_results_next(wrappedObject) == 0);
+		[world unlock];
+		return advanced;
+	}
+	CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+	[world lock];
+	BOOL advanced = (librdf_query_results_next(wrappedObject) == 0);
+	BOOL finished = (0 != librdf_query_results_finished(wrappedObject));
+	[world unlock];
+	[_profile addIterationTime:(CFAbsoluteTimeGetCurrent() - start) producedRow:(advanced && !finished)];
+	if (!advanced || finished) {
+		[_profile finish];
+	}
+	return advanced;
 }
 
 /**
@@ -80,7 +106,14 @@ RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
  */
 - (BOOL)finished
 {
-    return librdf_query_results_finished(wrappedObject);
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	[world lock];
+	BOOL finished = (0 != librdf_query_results_finished(wrappedObject));
+	[world unlock];
+	if (finished) {
+		[_profile finish];
+	}
+	return finished;
 }
 
 
@@ -134,6 +167,59 @@ RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
     return librdf_query_results_get_bindings_count(wrappedObject);
 }
 
+/**
+ *  Copies up to limit rows, starting with the current one, into a binding table and advances past them, holding the world lock for the whole batch.
+ *  @warning Only meaningful for variable binding results. Raises like next when the cancellation token fires.
+ *  @param limit The maximum number of rows to copy, NSUIntegerMax for all remaining rows
+ *  @return A RedlandBindingTable, empty once the receiver is finished
+ */
+- (RedlandBindingTable *)nextRowsWithLimit:(NSUInteger)limit
+{
+	int width = [self countOfBindings];
+	NSMutableArray *variables = [NSMutableArray arrayWithCapacity:width];
+	for (int i = 0; i < width; i++) {
+		[variables addObject:[self nameOfBindingAtIndex:i]];
+	}
+	
+	NSUInteger rows = 0;
+	NSUInteger capacity = 0;
+	librdf_node **nodes = NULL;
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	[world lock];
+	@try {
+		while (rows < limit && ![self finished]) {
+			if (rows == capacity) {
+				capacity = capacity ? 2 * capacity : MIN(limit, (NSUInteger)16);
+				librdf_node **grown = realloc(nodes, MAX(capacity * width, (NSUInteger)1) * sizeof(librdf_node *));
+				if (NULL == grown) {
+					[NSException raise:NSMallocException format:@"Out of memory copying query results"];
+				}
+				nodes = grown;
+			}
+			for (int i = 0; i < width; i++) {
+				librdf_node *node = librdf_query_results_get_binding_value(wrappedObject, i);
+				nodes[rows * width + i] = node ? librdf_new_node_from_node(node) : NULL;
+			}
+			rows++;
+			[self next];
+		}
+		[[RedlandWorld defaultWorld] handleStoredErrors];
+	}
+	@catch (NSException *exception) {
+		for (NSUInteger i = 0; i < rows * width; i++) {
+			if (nodes[i]) {
+				librdf_free_node(nodes[i]);
+			}
+		}
+		free(nodes);
+		@throw;
+	}
+	@finally {
+		[world unlock];
+	}
+	return [[RedlandBindingTable alloc] initWithVariables:variables nodes:nodes count:rows];
+}
+
 /**
  *  Returns an RDF graph of the results.
  *  @warning The return value is only meaningful if this is an RDF graph query result.
@@ -142,6 +228,9 @@ RedlandURI * RedlandSPARQLVariableBindingResultsXMLFormat = nil;
 - (RedlandStream *)resultStream
 {
 	librdf_stream *stream = librdf_query_results_as_stream(wrappedObject);
+	if (_cancellationToken) {
+		stream = RedlandNewCancellableStream(stream, _cancellationToken);
+	}
 	return [[RedlandStream alloc] initWithWrappedObject:stream];
 }
 
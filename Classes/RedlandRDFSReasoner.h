@@ -0,0 +1,53 @@
+//
+//  RedlandRDFSReasoner.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandModel, RedlandNode;
+
+
+/**
+ *  Materializes the RDFS entailments of a model into a dedicated context and keeps them up to date while the model changes.
+ *
+ *  The reasoner implements the RDFS rules that matter for querying: rdfs:subClassOf and rdfs:subPropertyOf transitivity (rdfs5, rdfs11), inheritance of
+ *  types and properties along them (rdfs7, rdfs9) and typing from rdfs:domain and rdfs:range (rdfs2, rdfs3). Entailed statements that are not asserted
+ *  are added to the inference context, a statement is never stored both asserted and inferred.
+ *
+ *  After the initial materialize the reasoner observes the model (see -[RedlandModel addChangeObserverWithQueue:usingBlock:]): added statements are
+ *  handled by semi-naive evaluation, which only joins the new statements against the model instead of re-running the whole closure. Removed statements
+ *  are handled by delete and rederive: everything that may have been derived from them is deleted, then the deleted statements that still have another
+ *  derivation are added back. Changes have to be made through the model for the reasoner to see them; the model's storage must support contexts.
+ */
+@interface RedlandRDFSReasoner : NSObject
+
+@property (nonatomic, readonly, strong) RedlandModel *model;					///< The model whose entailments are materialized
+@property (nonatomic, readonly, strong) RedlandNode *inferenceContext;			///< The context holding the inferred statements
+
+- (id)initWithModel:(RedlandModel *)aModel inferenceContext:(RedlandNode *)contextNode;
+
+- (void)materialize;
+- (void)invalidate;
+
+
+@end
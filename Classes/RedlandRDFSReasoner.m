@@ -0,0 +1,370 @@
+//
+//  RedlandRDFSReasoner.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import "RedlandRDFSReasoner.h"
+#import "RedlandModel.h"
+#import "RedlandModel-Convenience.h"
+#import "RedlandChangeSet.h"
+#import "RedlandStatement.h"
+#import "RedlandNode.h"
+#import "RedlandNamespace.h"
+#import "RedlandStreamEnumerator.h"
+
+
+typedef void (^RedlandRDFSConsequenceBlock)(RedlandNode *subject, RedlandNode *predicate, RedlandNode *object);
+
+
+@interface RedlandRDFSReasoner () {
+	RedlandNode *type;
+	RedlandNode *subClassOf;
+	RedlandNode *subPropertyOf;
+	RedlandNode *domain;
+	RedlandNode *range;
+	id observer;
+	BOOL updating;										///< YES while the reasoner changes the model itself
+}
+
+@end
+
+
+@implementation RedlandRDFSReasoner
+
+
+/**
+ *  Initializes a reasoner for the given model and starts maintaining the inferred statements.
+ *
+ *  The inference context is assumed to already hold the inferred statements of the model, which is the case for a model the reasoner was attached to
+ *  before (and that was changed only while it was attached). Call materialize to compute them from scratch.
+ *  @param aModel The model to reason over; its storage must support contexts
+ *  @param contextNode The context to keep the inferred statements in
+ */
+- (id)initWithModel:(RedlandModel *)aModel inferenceContext:(RedlandNode *)contextNode
+{
+	NSParameterAssert(aModel != nil);
+	NSParameterAssert(contextNode != nil);
+	
+	if ((self = [super init])) {
+		_model = aModel;
+		_inferenceContext = contextNode;
+		type = [RDFSyntaxNS node:@"type"];
+		subClassOf = [RDFSchemaNS node:@"subClassOf"];
+		subPropertyOf = [RDFSchemaNS node:@"subPropertyOf"];
+		domain = [RDFSchemaNS node:@"domain"];
+		range = [RDFSchemaNS node:@"range"];
+		
+		__weak RedlandRDFSReasoner *weakSelf = self;
+		observer = [aModel addChangeObserverWithQueue:nil usingBlock:^(RedlandModel *changedModel, RedlandChangeSet *changes) {
+			[weakSelf applyChanges:changes];
+		}];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self invalidate];
+}
+
+/**
+ *  Stops maintaining the inferred statements; they stay in the model as they are.
+ */
+- (void)invalidate
+{
+	if (observer) {
+		[_model removeChangeObserver:observer];
+		observer = nil;
+	}
+}
+
+
+
+#pragma mark - Materialization
+/**
+ *  Recomputes the inferred statements from scratch, replacing the contents of the inference context.
+ */
+- (void)materialize
+{
+	updating = YES;
+	@try {
+		[_model performChanges:^{
+			[_model removeAllStatementsWithContext:_inferenceContext];
+			[self insertConsequencesOfStatements:[[_model statementEnumerator] allObjects]];
+		}];
+	}
+	@finally {
+		updating = NO;
+	}
+}
+
+/**
+ *  Handles a change set of the model; changes to the inference context and changes the reasoner makes itself are ignored.
+ */
+- (void)applyChanges:(RedlandChangeSet *)changes
+{
+	if (updating || nil == observer) {
+		return;
+	}
+	
+	NSMutableArray *added = [NSMutableArray array];
+	NSMutableArray *removed = [NSMutableArray array];
+	[changes enumerateChangesUsingBlock:^(RedlandStatement *statement, RedlandNode *context, BOOL isAdded, BOOL *stop) {
+		if (![context isEqual:_inferenceContext]) {
+			[(isAdded ? added : removed) addObject:statement];
+		}
+	}];
+	if (0 == [added count] && 0 == [removed count]) {
+		return;
+	}
+	
+	updating = YES;
+	@try {
+		[_model performChanges:^{
+			if ([removed count] > 0) {
+				[self deleteAndRederiveConsequencesOfStatements:removed];
+			}
+			if ([added count] > 0) {
+				NSMutableArray *delta = [NSMutableArray arrayWithCapacity:[added count]];
+				for (RedlandStatement *statement in added) {
+					
+					// a statement that was inferred is now asserted, its consequences are already there
+					if (RedlandModelContainsStatement([_model wrappedModel], [statement wrappedStatement], [_inferenceContext wrappedNode])) {
+						[_model removeStatement:statement withContext:_inferenceContext];
+					}
+					else {
+						[delta addObject:statement];
+					}
+				}
+				[self insertConsequencesOfStatements:delta];
+			}
+		}];
+	}
+	@finally {
+		updating = NO;
+	}
+}
+
+/**
+ *  Semi-naive evaluation: each round joins only the statements derived in the previous round against the model.
+ */
+- (void)insertConsequencesOfStatements:(NSArray *)statements
+{
+	NSArray *delta = statements;
+	while ([delta count] > 0) {
+		NSMutableArray *next = [NSMutableArray array];
+		for (RedlandStatement *statement in delta) {
+			[self enumerateConsequencesOfStatement:statement extraStatements:nil usingBlock:^(RedlandNode *subject, RedlandNode *predicate, RedlandNode *object) {
+				RedlandStatement *derived = [RedlandStatement statementWithSubject:subject predicate:predicate object:object];
+				if (![_model containsStatement:derived]) {
+					[_model addStatement:derived withContext:_inferenceContext];
+					[next addObject:derived];
+				}
+			}];
+		}
+		delta = next;
+	}
+}
+
+/**
+ *  Delete and rederive for statements that were removed from the model.
+ */
+- (void)deleteAndRederiveConsequencesOfStatements:(NSArray *)statements
+{
+	NSMutableSet *deleted = [NSMutableSet set];
+	NSMutableArray *delta = [NSMutableArray array];
+	for (RedlandStatement *statement in statements) {
+		if (![deleted containsObject:statement] && ![_model containsStatement:statement]) {
+			[deleted addObject:statement];
+			[delta addObject:statement];
+		}
+	}
+	
+	// over-delete everything derivable from the deleted statements; joins see the deleted statements as if they were still there
+	librdf_node *context = [_inferenceContext wrappedNode];
+	while ([delta count] > 0) {
+		NSMutableArray *next = [NSMutableArray array];
+		for (RedlandStatement *statement in delta) {
+			[self enumerateConsequencesOfStatement:statement extraStatements:deleted usingBlock:^(RedlandNode *subject, RedlandNode *predicate, RedlandNode *object) {
+				RedlandStatement *derived = [RedlandStatement statementWithSubject:subject predicate:predicate object:object];
+				if (![deleted containsObject:derived] && RedlandModelContainsStatement([_model wrappedModel], [derived wrappedStatement], context)) {
+					[deleted addObject:derived];
+					[next addObject:derived];
+				}
+			}];
+		}
+		delta = next;
+	}
+	for (RedlandStatement *statement in deleted) {
+		if (RedlandModelContainsStatement([_model wrappedModel], [statement wrappedStatement], context)) {
+			[_model removeStatement:statement withContext:_inferenceContext];
+		}
+	}
+	
+	// rederive the deleted statements that have an alternative derivation, then propagate them
+	NSMutableArray *rederived = [NSMutableArray array];
+	for (RedlandStatement *statement in deleted) {
+		if (![_model containsStatement:statement] && [self isDerivableStatement:statement]) {
+			[_model addStatement:statement withContext:_inferenceContext];
+			[rederived addObject:statement];
+		}
+	}
+	[self insertConsequencesOfStatements:rederived];
+}
+
+
+
+#pragma mark - Rules
+/**
+ *  The statements of the model matching the pattern, plus the matching ones among the extra statements.
+ */
+- (NSArray *)statementsWithSubject:(RedlandNode *)subject predicate:(RedlandNode *)predicate object:(RedlandNode *)object extraStatements:(NSSet *)extra
+{
+	RedlandStatement *pattern = [RedlandStatement statementWithSubject:subject predicate:predicate object:object];
+	NSArray *matches = [[_model enumeratorOfStatementsLike:pattern] allObjects];
+	if ([extra count] > 0) {
+		NSMutableArray *all = [matches mutableCopy];
+		for (RedlandStatement *statement in extra) {
+			if ([statement matchesPartialStatement:pattern]) {
+				[all addObject:statement];
+			}
+		}
+		return all;
+	}
+	return matches;
+}
+
+/**
+ *  Calls the block with every statement that follows from the given one in a single rule application, joined against the model (and the extra
+ *  statements). Consequences that would not be valid statements, such as literal subjects, are skipped.
+ */
+- (void)enumerateConsequencesOfStatement:(RedlandStatement *)statement extraStatements:(NSSet *)extra usingBlock:(RedlandRDFSConsequenceBlock)block
+{
+	RedlandNode *s = [statement subject];
+	RedlandNode *p = [statement predicate];
+	RedlandNode *o = [statement object];
+	RedlandRDFSConsequenceBlock derive = ^(RedlandNode *subject, RedlandNode *predicate, RedlandNode *object) {
+		if (![subject isLiteral] && [predicate isResource]) {
+			block(subject, predicate, object);
+		}
+	};
+	
+	// the statement as instance data: rdfs2, rdfs3, rdfs7
+	for (RedlandStatement *schema in [self statementsWithSubject:p predicate:domain object:nil extraStatements:extra]) {
+		derive(s, type, [schema object]);
+	}
+	if (![o isLiteral]) {
+		for (RedlandStatement *schema in [self statementsWithSubject:p predicate:range object:nil extraStatements:extra]) {
+			derive(o, type, [schema object]);
+		}
+	}
+	for (RedlandStatement *schema in [self statementsWithSubject:p predicate:subPropertyOf object:nil extraStatements:extra]) {
+		derive(s, [schema object], o);
+	}
+	
+	// the statement as schema
+	if ([p isEqual:type]) {
+		for (RedlandStatement *schema in [self statementsWithSubject:o predicate:subClassOf object:nil extraStatements:extra]) {
+			derive(s, type, [schema object]);
+		}
+	}
+	else if ([p isEqual:subClassOf]) {
+		for (RedlandStatement *schema in [self statementsWithSubject:o predicate:subClassOf object:nil extraStatements:extra]) {
+			derive(s, subClassOf, [schema object]);
+		}
+		for (RedlandStatement *schema in [self statementsWithSubject:nil predicate:subClassOf object:s extraStatements:extra]) {
+			derive([schema subject], subClassOf, o);
+		}
+		for (RedlandStatement *instance in [self statementsWithSubject:nil predicate:type object:s extraStatements:extra]) {
+			derive([instance subject], type, o);
+		}
+	}
+	else if ([p isEqual:subPropertyOf]) {
+		for (RedlandStatement *schema in [self statementsWithSubject:o predicate:subPropertyOf object:nil extraStatements:extra]) {
+			derive(s, subPropertyOf, [schema object]);
+		}
+		for (RedlandStatement *schema in [self statementsWithSubject:nil predicate:subPropertyOf object:s extraStatements:extra]) {
+			derive([schema subject], subPropertyOf, o);
+		}
+		for (RedlandStatement *instance in [self statementsWithSubject:nil predicate:s object:nil extraStatements:extra]) {
+			derive([instance subject], o, [instance object]);
+		}
+	}
+	else if ([p isEqual:domain]) {
+		for (RedlandStatement *instance in [self statementsWithSubject:nil predicate:s object:nil extraStatements:extra]) {
+			derive([instance subject], type, o);
+		}
+	}
+	else if ([p isEqual:range]) {
+		for (RedlandStatement *instance in [self statementsWithSubject:nil predicate:s object:nil extraStatements:extra]) {
+			if (![[instance object] isLiteral]) {
+				derive([instance object], type, o);
+			}
+		}
+	}
+}
+
+/**
+ *  Whether the statement follows from the statements currently in the model in a single rule application.
+ */
+- (BOOL)isDerivableStatement:(RedlandStatement *)statement
+{
+	RedlandNode *s = [statement subject];
+	RedlandNode *p = [statement predicate];
+	RedlandNode *o = [statement object];
+	
+	// rdfs7
+	for (RedlandNode *arc in [[_model enumeratorOfArcsWithSource:s target:o] allObjects]) {
+		if ([_model containsStatement:[RedlandStatement statementWithSubject:arc predicate:subPropertyOf object:p]]) {
+			return YES;
+		}
+	}
+	
+	if ([p isEqual:type]) {
+		for (RedlandNode *property in [[_model enumeratorOfSourcesWithArc:domain target:o] allObjects]) {
+			if ([_model node:s hasOutgoingArc:property]) {
+				return YES;
+			}
+		}
+		for (RedlandNode *property in [[_model enumeratorOfSourcesWithArc:range target:o] allObjects]) {
+			if ([_model node:s hasIncomingArc:property]) {
+				return YES;
+			}
+		}
+		for (RedlandNode *instanceClass in [[_model enumeratorOfTargetsWithSource:s arc:type] allObjects]) {
+			if ([_model containsStatement:[RedlandStatement statementWithSubject:instanceClass predicate:subClassOf object:o]]) {
+				return YES;
+			}
+		}
+	}
+	else if ([p isEqual:subClassOf] || [p isEqual:subPropertyOf]) {
+		for (RedlandNode *between in [[_model enumeratorOfTargetsWithSource:s arc:p] allObjects]) {
+			if ([_model containsStatement:[RedlandStatement statementWithSubject:between predicate:p object:o]]) {
+				return YES;
+			}
+		}
+	}
+	return NO;
+}
+
+
+@end
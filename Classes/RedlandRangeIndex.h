@@ -0,0 +1,70 @@
+//
+//  RedlandRangeIndex.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandModel, RedlandNode;
+
+/// The kinds of literal values kept in a range index
+typedef enum _RedlandRangeValueType {
+	RedlandRangeValueNumeric = 0,			///< xsd:decimal, xsd:double, xsd:float, xsd:integer and the integer types derived from it
+	RedlandRangeValueDateTime				///< xsd:dateTime, keyed by seconds since the reference date (like -[NSDate timeIntervalSinceReferenceDate])
+} RedlandRangeValueType;
+
+typedef void (^RedlandRangeEnumerationBlock)(RedlandNode *subject, RedlandNode *literal, double value, BOOL *stop);
+
+
+/**
+ *  A sorted secondary index of the numeric and dateTime literals of a model, keyed by predicate and value.
+ *
+ *  For every predicate the index keeps the statements with typed literal objects in an array sorted by their decoded value, so a range of values is
+ *  found with two binary searches and read in order without decoding any literal. Literals are decoded once when indexed, dateTimes without going
+ *  through NSDateFormatter; dateTimes without a timezone are taken as UTC. Appending values larger than all others, as with timestamps of a feed,
+ *  doesn't move any entries.
+ *
+ *  The index registers itself as a change observer of the model and stays current with statements added and removed through it. Like the model, the
+ *  index must not be used from several threads at the same time.
+ */
+@interface RedlandRangeIndex : NSObject
+
+@property (nonatomic, readonly, strong) RedlandModel *model;				///< The indexed model
+@property (nonatomic, readonly, assign) NSUInteger count;					///< The number of indexed statements
+
+- (id)initWithModel:(RedlandModel *)aModel;
+- (void)invalidate;
+
+- (void)enumerateValuesWithPredicate:(RedlandNode *)predicate
+						   valueType:(RedlandRangeValueType)valueType
+						minimumValue:(double)minimum
+						maximumValue:(double)maximum
+						  descending:(BOOL)descending
+						  usingBlock:(RedlandRangeEnumerationBlock)block;
+- (NSUInteger)countOfValuesWithPredicate:(RedlandNode *)predicate valueType:(RedlandRangeValueType)valueType minimumValue:(double)minimum maximumValue:(double)maximum;
+
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate minimumValue:(double)minimum maximumValue:(double)maximum;
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate fromDate:(NSDate *)startDate toDate:(NSDate *)endDate;
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate valueType:(RedlandRangeValueType)valueType descending:(BOOL)descending limit:(NSUInteger)limit;
+
+
+@end
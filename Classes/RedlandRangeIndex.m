@@ -0,0 +1,697 @@
+//
+//  RedlandRangeIndex.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import "RedlandRangeIndex.h"
+#import "RedlandModel.h"
+#import "RedlandNode.h"
+#import "RedlandStatement.h"
+#import "RedlandChangeSet.h"
+
+#define REDLAND_RANGE_XSD "http://www.w3.org/2001/XMLSchema#"
+#define REDLAND_RANGE_VALUE_TYPES 2
+
+/// One indexed statement
+typedef struct {
+	double value;
+	librdf_statement *statement;
+} RedlandRangeEntry;
+
+
+/**
+ *  The days between 1970-01-01 and the given date of the proleptic Gregorian calendar.
+ */
+static int64_t RedlandRangeDaysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+	year -= (month <= 2);
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	unsigned yearOfEra = (unsigned)(year - era * 400);
+	unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + (int64_t)dayOfEra - 719468;
+}
+
+/**
+ *  Parses an xsd:dateTime lexical value into seconds since 2001-01-01T00:00:00Z.
+ */
+static BOOL RedlandRangeParseDateTime(const char *string, double *outValue)
+{
+	int year, month, day, hour, minute;
+	double second;
+	int length = 0;
+	if (6 != sscanf(string, "%d-%2d-%2dT%2d:%2d:%lf%n", &year, &month, &day, &hour, &minute, &second, &length)) {
+		return NO;
+	}
+	if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 24 || minute > 59 || second < 0.0 || second >= 61.0) {
+		return NO;
+	}
+	
+	// timezone
+	const char *zone = string + length;
+	int offset = 0;
+	if ('+' == zone[0] || '-' == zone[0]) {
+		int zoneHours, zoneMinutes;
+		if (2 != sscanf(zone + 1, "%2d:%2d", &zoneHours, &zoneMinutes)) {
+			return NO;
+		}
+		offset = (zoneHours * 60 + zoneMinutes) * 60 * ('-' == zone[0] ? -1 : 1);
+	}
+	else if ('Z' != zone[0] && '\0' != zone[0]) {
+		return NO;
+	}
+	
+	int64_t days = RedlandRangeDaysFromCivil(year, (unsigned)month, (unsigned)day);
+	*outValue = (double)(days * 86400 + hour * 3600 + minute * 60 - offset) + second - 978307200.0;
+	return YES;
+}
+
+/**
+ *  Decodes the literal if it has one of the datatypes kept in the index.
+ */
+static BOOL RedlandRangeDecodeLiteral(librdf_node *literal, RedlandRangeValueType *outType, double *outValue)
+{
+	static const char *numericTypes[] = {
+		"decimal", "double", "float", "integer", "int", "long", "short", "byte", "nonNegativeInteger", "nonPositiveInteger",
+		"positiveInteger", "negativeInteger", "unsignedLong", "unsignedInt", "unsignedShort", "unsignedByte", NULL
+	};
+	librdf_uri *datatype = librdf_node_get_literal_value_datatype_uri(literal);
+	const char *value = (const char *)librdf_node_get_literal_value(literal);
+	if (NULL == datatype || NULL == value) {
+		return NO;
+	}
+	const char *uri = (const char *)librdf_uri_as_string(datatype);
+	size_t prefixLength = strlen(REDLAND_RANGE_XSD);
+	if (0 != strncmp(uri, REDLAND_RANGE_XSD, prefixLength)) {
+		return NO;
+	}
+	const char *localName = uri + prefixLength;
+	
+	if (0 == strcmp(localName, "dateTime") || 0 == strcmp(localName, "dateTimeStamp")) {
+		*outType = RedlandRangeValueDateTime;
+		return RedlandRangeParseDateTime(value, outValue);
+	}
+	for (const char **type = numericTypes; *type; type++) {
+		if (0 == strcmp(localName, *type)) {
+			char *end = NULL;
+			double number = strtod(value, &end);
+			while (end && isspace((unsigned char)*end)) {
+				end++;
+			}
+			if (end == value || NULL == end || '\0' != *end || isnan(number)) {
+				return NO;
+			}
+			*outType = RedlandRangeValueNumeric;
+			*outValue = number;
+			return YES;
+		}
+	}
+	return NO;
+}
+
+
+/**
+ *  Orders two nodes by type and content; any total order will do, it only has to be the same every time.
+ */
+static int RedlandRangeCompareStrings(const unsigned char *string1, const unsigned char *string2)
+{
+	if (string1 == string2) {
+		return 0;
+	}
+	if (NULL == string1 || NULL == string2) {
+		return (NULL == string1) ? -1 : 1;
+	}
+	return strcmp((const char *)string1, (const char *)string2);
+}
+
+static int RedlandRangeCompareNodes(librdf_node *node1, librdf_node *node2)
+{
+	librdf_node_type type1 = librdf_node_get_type(node1);
+	librdf_node_type type2 = librdf_node_get_type(node2);
+	if (type1 != type2) {
+		return (type1 < type2) ? -1 : 1;
+	}
+	if (librdf_node_is_resource(node1)) {
+		return RedlandRangeCompareStrings(librdf_uri_as_string(librdf_node_get_uri(node1)), librdf_uri_as_string(librdf_node_get_uri(node2)));
+	}
+	if (librdf_node_is_blank(node1)) {
+		return RedlandRangeCompareStrings(librdf_node_get_blank_identifier(node1), librdf_node_get_blank_identifier(node2));
+	}
+	int order = RedlandRangeCompareStrings(librdf_node_get_literal_value(node1), librdf_node_get_literal_value(node2));
+	if (0 == order) {
+		order = RedlandRangeCompareStrings((const unsigned char *)librdf_node_get_literal_value_language(node1),
+										   (const unsigned char *)librdf_node_get_literal_value_language(node2));
+	}
+	if (0 == order) {
+		librdf_uri *datatype1 = librdf_node_get_literal_value_datatype_uri(node1);
+		librdf_uri *datatype2 = librdf_node_get_literal_value_datatype_uri(node2);
+		order = RedlandRangeCompareStrings(datatype1 ? librdf_uri_as_string(datatype1) : NULL, datatype2 ? librdf_uri_as_string(datatype2) : NULL);
+	}
+	return order;
+}
+
+/**
+ *  Orders entries by value, then by subject and object; all entries of a list share the predicate, so the key is unique per statement.
+ */
+static int RedlandRangeCompareKeys(double value1, librdf_statement *statement1, double value2, librdf_statement *statement2)
+{
+	if (value1 != value2) {
+		return (value1 < value2) ? -1 : 1;
+	}
+	int order = RedlandRangeCompareNodes(librdf_statement_get_subject(statement1), librdf_statement_get_subject(statement2));
+	if (0 == order) {
+		order = RedlandRangeCompareNodes(librdf_statement_get_object(statement1), librdf_statement_get_object(statement2));
+	}
+	return order;
+}
+
+static int RedlandRangeCompareEntries(const void *entry1, const void *entry2)
+{
+	const RedlandRangeEntry *range1 = entry1;
+	const RedlandRangeEntry *range2 = entry2;
+	return RedlandRangeCompareKeys(range1->value, range1->statement, range2->value, range2->statement);
+}
+
+
+/**
+ *  The entries of one predicate and value type, sorted by value; equal values are ordered by subject and object.
+ */
+@interface RedlandRangeList : NSObject {
+@public
+	RedlandRangeEntry *entries;
+	NSUInteger count;
+	NSUInteger capacity;
+}
+
+- (NSUInteger)lowerBound:(double)value;
+- (NSUInteger)upperBound:(double)value;
+- (NSUInteger)indexOfStatement:(librdf_statement *)statement value:(double)value;
+- (void)insertStatement:(librdf_statement *)statement value:(double)value;
+- (void)appendStatement:(librdf_statement *)statement value:(double)value;
+- (void)sortEntries;
+- (void)removeEntryAtIndex:(NSUInteger)index;
+
+@end
+
+
+@implementation RedlandRangeList
+
+- (void)dealloc
+{
+	for (NSUInteger i = 0; i < count; i++) {
+		librdf_free_statement(entries[i].statement);
+	}
+	free(entries);
+}
+
+/**
+ *  The index of the first entry not smaller than the value.
+ */
+- (NSUInteger)lowerBound:(double)value
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (entries[middle].value < value) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ *  The index of the first entry larger than the value.
+ */
+- (NSUInteger)upperBound:(double)value
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (entries[middle].value <= value) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ *  The index of the first entry not ordered before the given key.
+ */
+- (NSUInteger)lowerBoundOfStatement:(librdf_statement *)statement value:(double)value
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (RedlandRangeCompareKeys(entries[middle].value, entries[middle].statement, value, statement) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ *  @return The index of the entry of the statement, NSNotFound if there is none
+ */
+- (NSUInteger)indexOfStatement:(librdf_statement *)statement value:(double)value
+{
+	NSUInteger index = [self lowerBoundOfStatement:statement value:value];
+	if (index < count && 0 == RedlandRangeCompareKeys(entries[index].value, entries[index].statement, value, statement)) {
+		return index;
+	}
+	return NSNotFound;
+}
+
+- (void)growIfNeeded
+{
+	if (count == capacity) {
+		capacity = capacity ? 2 * capacity : 16;
+		entries = reallocf(entries, capacity * sizeof(RedlandRangeEntry));
+		if (NULL == entries) {
+			[NSException raise:NSMallocException format:@"Out of memory growing the range index"];
+		}
+	}
+}
+
+/**
+ *  Inserts the entry at its place in the order. Takes ownership of the statement.
+ */
+- (void)insertStatement:(librdf_statement *)statement value:(double)value
+{
+	[self growIfNeeded];
+	NSUInteger index = [self lowerBoundOfStatement:statement value:value];
+	memmove(entries + index + 1, entries + index, (count - index) * sizeof(RedlandRangeEntry));
+	entries[index].value = value;
+	entries[index].statement = statement;
+	count++;
+}
+
+/**
+ *  Adds the entry at the end, leaving the list unsorted until sortEntries is called. Takes ownership of the statement.
+ */
+- (void)appendStatement:(librdf_statement *)statement value:(double)value
+{
+	[self growIfNeeded];
+	entries[count].value = value;
+	entries[count].statement = statement;
+	count++;
+}
+
+/**
+ *  Sorts the appended entries and drops the duplicates of statements that were appended once per context.
+ */
+- (void)sortEntries
+{
+	if (count < 2) {
+		return;
+	}
+	qsort(entries, count, sizeof(RedlandRangeEntry), &RedlandRangeCompareEntries);
+	NSUInteger kept = 1;
+	for (NSUInteger i = 1; i < count; i++) {
+		if (0 == RedlandRangeCompareEntries(&entries[kept - 1], &entries[i])) {
+			librdf_free_statement(entries[i].statement);
+		}
+		else {
+			entries[kept++] = entries[i];
+		}
+	}
+	count = kept;
+}
+
+- (void)removeEntryAtIndex:(NSUInteger)index;
+
+@end
+
+
+@implementation RedlandRangeList
+
+- (void)dealloc
+{
+	for (NSUInteger i = 0; i < count; i++) {
+		librdf_free_statement(entries[i].statement);
+	}
+	free(entries);
+}
+
+/**
+ *  The index of the first entry not smaller than the value.
+ */
+- (NSUInteger)lowerBound:(double)value
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (entries[middle].value < value) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ *  The index of the first entry larger than the value.
+ */
+- (NSUInteger)upperBound:(double)value
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (entries[middle].value <= value) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ *  @return The index of the entry of the statement, NSNotFound if there is none
+ */
+- (NSUInteger)indexOfStatement:(librdf_statement *)statement value:(double)value
+{
+	NSUInteger end = [self upperBound:value];
+	for (NSUInteger i = [self lowerBound:value]; i < end; i++) {
+		if (librdf_statement_equals(entries[i].statement, statement)) {
+			return i;
+		}
+	}
+	return NSNotFound;
+}
+
+/**
+ *  Takes ownership of the statement.
+ */
+- (void)insertStatement:(librdf_statement *)statement value:(double)value
+{
+	if (count == capacity) {
+		capacity = capacity ? 2 * capacity : 16;
+		entries = reallocf(entries, capacity * sizeof(RedlandRangeEntry));
+		if (NULL == entries) {
+			[NSException raise:NSMallocException format:@"Out of memory growing the range index"];
+		}
+	}
+	NSUInteger index = (0 == count || entries[count - 1].value <= value) ? count : [self upperBound:value];
+	memmove(entries + index + 1, entries + index, (count - index) * sizeof(RedlandRangeEntry));
+	entries[index].value = value;
+	entries[index].statement = statement;
+	count++;
+}
+
+- (void)removeEntryAtIndex:(NSUInteger)index
+{
+	librdf_free_statement(entries[index].statement);
+	memmove(entries + index, entries + index + 1, (count - index - 1) * sizeof(RedlandRangeEntry));
+	count--;
+}
+
+@end
+
+
+@interface RedlandRangeIndex () {
+	CFMutableDictionaryRef lists[REDLAND_RANGE_VALUE_TYPES];		///< One per value type: predicate librdf_node -> RedlandRangeList
+	NSUInteger mutations;											///< Changes whenever an entry is added or removed
+	id observer;
+}
+
+@end
+
+
+@implementation RedlandRangeIndex
+
+
+/**
+ *  Indexes the numeric and dateTime literals of the model and starts observing it.
+ *  @param aModel The model to index
+ */
+- (id)initWithModel:(RedlandModel *)aModel
+{
+	NSParameterAssert(aModel != nil);
+	
+	if ((self = [super init])) {
+		_model = aModel;
+		for (int i = 0; i < REDLAND_RANGE_VALUE_TYPES; i++) {
+			lists[i] = CFDictionaryCreateMutable(NULL, 0, &RedlandNodeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+		}
+		
+		// append everything and sort each list once, inserting one by one would move the entries again for every statement
+		librdf_stream *stream = librdf_model_as_stream([aModel wrappedModel]);
+		while (stream && !librdf_stream_end(stream)) {
+			librdf_statement *statement = librdf_stream_get_object(stream);
+			double value;
+			RedlandRangeList *list = [self listForStatement:statement value:&value];
+			if (list) {
+				[list appendStatement:librdf_new_statement_from_statement(statement) value:value];
+			}
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		for (int i = 0; i < REDLAND_RANGE_VALUE_TYPES; i++) {
+			[(__bridge NSDictionary *)lists[i] enumerateKeysAndObjectsUsingBlock:^(id key, RedlandRangeList *list, BOOL *stop) {
+				[list sortEntries];
+			}];
+		}
+		
+		__weak RedlandRangeIndex *weakSelf = self;
+		observer = [aModel addChangeObserverWithQueue:nil usingBlock:^(RedlandModel *changedModel, RedlandChangeSet *changes) {
+			[weakSelf applyChanges:changes];
+		}];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self invalidate];
+	for (int i = 0; i < REDLAND_RANGE_VALUE_TYPES; i++) {
+		if (lists[i]) {
+			CFRelease(lists[i]);
+		}
+	}
+}
+
+/**
+ *  Stops observing the model; the index keeps answering queries for the statements indexed so far.
+ */
+- (void)invalidate
+{
+	if (observer) {
+		[_model removeChangeObserver:observer];
+		observer = nil;
+	}
+}
+
+- (NSUInteger)count
+{
+	__block NSUInteger count = 0;
+	for (int i = 0; i < REDLAND_RANGE_VALUE_TYPES; i++) {
+		[(__bridge NSDictionary *)lists[i] enumerateKeysAndObjectsUsingBlock:^(id key, RedlandRangeList *list, BOOL *stop) {
+			count += list->count;
+		}];
+	}
+	return count;
+}
+
+
+
+#pragma mark - Maintenance
+/**
+ *  Decodes the object of the statement and returns the list it belongs in, creating the list if needed.
+ *  @return nil if the object is not a literal kept in the index
+ */
+- (RedlandRangeList *)listForStatement:(librdf_statement *)statement value:(double *)outValue
+{
+	librdf_node *object = librdf_statement_get_object(statement);
+	RedlandRangeValueType valueType;
+	if (NULL == object || !librdf_node_is_literal(object) || !RedlandRangeDecodeLiteral(object, &valueType, outValue)) {
+		return nil;
+	}
+	
+	librdf_node *predicate = librdf_statement_get_predicate(statement);
+	RedlandRangeList *list = (__bridge RedlandRangeList *)CFDictionaryGetValue(lists[valueType], predicate);
+	if (nil == list) {
+		list = [RedlandRangeList new];
+		CFDictionarySetValue(lists[valueType], predicate, (__bridge const void *)list);
+	}
+	return list;
+}
+
+- (void)indexStatement:(librdf_statement *)statement
+{
+	double value;
+	RedlandRangeList *list = [self listForStatement:statement value:&value];
+	
+	// the statement may already be in the model in another context
+	if (list && NSNotFound == [list indexOfStatement:statement value:value]) {
+		[list insertStatement:librdf_new_statement_from_statement(statement) value:value];
+		mutations++;
+	}
+}
+
+- (void)unindexStatement:(librdf_statement *)statement
+{
+	librdf_node *object = librdf_statement_get_object(statement);
+	RedlandRangeValueType valueType;
+	double value;
+	if (NULL == object || !librdf_node_is_literal(object) || !RedlandRangeDecodeLiteral(object, &valueType, &value)) {
+		return;
+	}
+	RedlandRangeList *list = (__bridge RedlandRangeList *)CFDictionaryGetValue(lists[valueType], librdf_statement_get_predicate(statement));
+	NSUInteger index = [list indexOfStatement:statement value:value];
+	if (NSNotFound != index && !RedlandModelContainsStatement([_model wrappedModel], statement, NULL)) {
+		[list removeEntryAtIndex:index];
+		mutations++;
+	}
+}
+
+- (void)applyChanges:(RedlandChangeSet *)changes
+{
+	[changes enumerateChangesUsingBlock:^(RedlandStatement *statement, RedlandNode *context, BOOL added, BOOL *stop) {
+		if (added) {
+			[self indexStatement:[statement wrappedStatement]];
+		}
+		else {
+			[self unindexStatement:[statement wrappedStatement]];
+		}
+	}];
+}
+
+
+
+#pragma mark - Range Scans
+/**
+ *  Calls the block for every statement with the given predicate whose value lies in the closed range, in value order.
+ *
+ *  Pass -INFINITY or INFINITY for an open range. The model must not be changed from within the block.
+ *  @warning Raises an NSGenericException if the index changes during the enumeration
+ */
+- (void)enumerateValuesWithPredicate:(RedlandNode *)predicate
+						   valueType:(RedlandRangeValueType)valueType
+						minimumValue:(double)minimum
+						maximumValue:(double)maximum
+						  descending:(BOOL)descending
+						  usingBlock:(RedlandRangeEnumerationBlock)block
+{
+	NSParameterAssert(predicate != nil);
+	NSParameterAssert(block != nil);
+	
+	RedlandRangeList *list = (__bridge RedlandRangeList *)CFDictionaryGetValue(lists[valueType], [predicate wrappedNode]);
+	if (nil == list || minimum > maximum) {
+		return;
+	}
+	NSUInteger start = [list lowerBound:minimum];
+	NSUInteger end = [list upperBound:maximum];
+	NSUInteger expectedMutations = mutations;
+	BOOL stop = NO;
+	for (NSUInteger n = 0; n < end - start && !stop; n++) {
+		RedlandRangeEntry *entry = list->entries + (descending ? end - 1 - n : start + n);
+		RedlandNode *subject = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_statement_get_subject(entry->statement))];
+		RedlandNode *literal = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_statement_get_object(entry->statement))];
+		block(subject, literal, entry->value, &stop);
+		if (expectedMutations != mutations) {
+			[NSException raise:NSGenericException format:@"The range index was mutated while being enumerated"];
+		}
+	}
+}
+
+/**
+ *  The number of statements with the given predicate whose value lies in the closed range, found without reading them.
+ */
+- (NSUInteger)countOfValuesWithPredicate:(RedlandNode *)predicate valueType:(RedlandRangeValueType)valueType minimumValue:(double)minimum maximumValue:(double)maximum
+{
+	NSParameterAssert(predicate != nil);
+	RedlandRangeList *list = (__bridge RedlandRangeList *)CFDictionaryGetValue(lists[valueType], [predicate wrappedNode]);
+	if (nil == list || minimum > maximum) {
+		return 0;
+	}
+	return [list upperBound:maximum] - [list lowerBound:minimum];
+}
+
+/**
+ *  The distinct subjects having a numeric value for the predicate in the closed range, ordered by ascending value.
+ */
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate minimumValue:(double)minimum maximumValue:(double)maximum
+{
+	NSMutableOrderedSet *subjects = [NSMutableOrderedSet orderedSet];
+	[self enumerateValuesWithPredicate:predicate valueType:RedlandRangeValueNumeric minimumValue:minimum maximumValue:maximum descending:NO usingBlock:^(RedlandNode *subject, RedlandNode *literal, double value, BOOL *stop) {
+		[subjects addObject:subject];
+	}];
+	return [subjects array];
+}
+
+/**
+ *  The distinct subjects having a dateTime value for the predicate between the two dates (inclusive), ordered by ascending date.
+ *  @param startDate The earliest date, nil for no lower bound
+ *  @param endDate The latest date, nil for no upper bound
+ */
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate fromDate:(NSDate *)startDate toDate:(NSDate *)endDate
+{
+	NSMutableOrderedSet *subjects = [NSMutableOrderedSet orderedSet];
+	[self enumerateValuesWithPredicate:predicate
+							 valueType:RedlandRangeValueDateTime
+						  minimumValue:startDate ? [startDate timeIntervalSinceReferenceDate] : -INFINITY
+						  maximumValue:endDate ? [endDate timeIntervalSinceReferenceDate] : INFINITY
+							descending:NO
+							usingBlock:^(RedlandNode *subject, RedlandNode *literal, double value, BOOL *stop) {
+		[subjects addObject:subject];
+	}];
+	return [subjects array];
+}
+
+/**
+ *  The first distinct subjects in value order, such as the most recently modified ones.
+ *  @param descending YES to start with the largest (latest) value
+ *  @param limit The maximum number of subjects
+ */
+- (NSArray *)subjectsWithPredicate:(RedlandNode *)predicate valueType:(RedlandRangeValueType)valueType descending:(BOOL)descending limit:(NSUInteger)limit
+{
+	NSMutableOrderedSet *subjects = [NSMutableOrderedSet orderedSet];
+	if (limit > 0) {
+		[self enumerateValuesWithPredicate:predicate valueType:valueType minimumValue:-INFINITY maximumValue:INFINITY descending:descending usingBlock:^(RedlandNode *subject, RedlandNode *literal, double value, BOOL *stop) {
+			[subjects addObject:subject];
+			*stop = ([subjects count] >= limit);
+		}];
+	}
+	return [subjects array];
+}
+
+
+@end
@@ -31,7 +31,7 @@
  *  @header RedlandSerializer.h
  *  Defines the RedlandSerializer class and various serializer name constants.
  */
-@class RedlandURI;
+@class RedlandURI, RedlandCancellationToken;
 
 extern NSString * const RedlandRDFXMLSerializerName;				///< The name of the RDF/XML serializer
 extern NSString * const RedlandNTriplesSerializerName;				///< The name of the NTriples serializer
@@ -75,6 +75,8 @@ extern NSString * const RedlandRSS10Serializer;						///< The name of the RSS 1.
 
 - (NSString *)serializedStringFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI;
 - (NSData *)serializedDataFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI;
+- (NSString *)serializedStringFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token;
+- (NSData *)serializedDataFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token;
 
 @end
 
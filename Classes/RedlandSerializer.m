@@ -32,6 +32,7 @@
 #import "RedlandURI.h"
 #import "RedlandException.h"
 #import "RedlandNode.h"
+#import "RedlandCancellationToken.h"
 #include <stdio.h>
 
 NSString * const RedlandRDFXMLSerializerName = @"rdfxml";
@@ -303,6 +304,75 @@ NSString * const RedlandRSS10Serializer = @"rss-1.0";
 	return [[NSData alloc] initWithBytesNoCopy:result length:len freeWhenDone:YES];
 }
 
+/**
+ *  Serializes the statements of the model through a stream that ends early once the token fires.
+ *  @return The malloc'ed serialization; the caller frees it
+ */
+- (unsigned char *)serializeModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token length:(size_t *)length
+{
+	NSParameterAssert(aModel != nil);
+	NSParameterAssert(token != nil);
+	
+	[token throwIfCancelled];
+	librdf_stream *stream = RedlandNewCancellableStream(librdf_model_as_stream([aModel wrappedModel]), token);
+	if (NULL == stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"Failed to create a stream of the model"
+										  userInfo:nil];
+	}
+	unsigned char *result = librdf_serializer_serialize_stream_to_counted_string(wrappedObject, [baseURI wrappedURI], stream, length);
+	librdf_free_stream(stream);
+	[[RedlandWorld defaultWorld] handleStoredErrors];
+	
+	// the stream ends early when cancelled, so the output is incomplete
+	if ([token isCancelled]) {
+		free(result);
+		[token throwIfCancelled];
+	}
+	if (NULL == result) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName
+											reason:@"librdf_serializer_serialize_stream_to_counted_string failed"
+										  userInfo:nil];
+	}
+	return result;
+}
+
+/**
+ *  Returns a serialized string representation of a model, giving up once the token is cancelled or its deadline passes.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled.
+ *  @param aModel The model (RedlandModel instance) to serialize
+ *  @param baseURI The base-URI to use as RedlandURI
+ *  @param token The cancellation token; nil behaves like serializedStringFromModel:withBaseURI:
+ *  @return An NSString
+ */
+- (NSString *)serializedStringFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token
+{
+	if (nil == token) {
+		return [self serializedStringFromModel:aModel withBaseURI:baseURI];
+	}
+	size_t len = 0;
+	unsigned char *result = [self serializeModel:aModel withBaseURI:baseURI cancellationToken:token length:&len];
+	return [[NSString alloc] initWithBytesNoCopy:result length:len encoding:NSUTF8StringEncoding freeWhenDone:YES];
+}
+
+/**
+ *  Returns a serialized data representation of a model, giving up once the token is cancelled or its deadline passes.
+ *  @warning Raises a RedlandException named RedlandCancellationExceptionName when cancelled.
+ *  @param aModel The model (RedlandModel instance) to serialize
+ *  @param baseURI The base-URI to use as RedlandURI
+ *  @param token The cancellation token; nil behaves like serializedDataFromModel:withBaseURI:
+ *  @return NSData
+ */
+- (NSData *)serializedDataFromModel:(RedlandModel *)aModel withBaseURI:(RedlandURI *)baseURI cancellationToken:(RedlandCancellationToken *)token
+{
+	if (nil == token) {
+		return [self serializedDataFromModel:aModel withBaseURI:baseURI];
+	}
+	size_t len = 0;
+	unsigned char *result = [self serializeModel:aModel withBaseURI:baseURI cancellationToken:token length:&len];
+	return [[NSData alloc] initWithBytesNoCopy:result length:len freeWhenDone:YES];
+}
+
 
 @end
 
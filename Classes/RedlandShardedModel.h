@@ -0,0 +1,57 @@
+//
+//  RedlandShardedModel.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel.h"
+
+@class RedlandNode;
+
+extern NSString * const RedlandShardedStorageFactoryName;		///< The factory name of the storage behind RedlandShardedModel, "sharded"
+
+extern void RedlandShardedStorageRegisterFactory(librdf_world *world);
+
+
+/**
+ *  A model partitioning its statements across several storages by the hash of their subject.
+ *
+ *  Every statement is stored in exactly one shard, chosen from a hash of the subject's value, so all statements about a subject live in the same shard.
+ *  Adding, removing and looking up statements with a bound subject only touches that shard; finds, counts and node lookups with an unbound subject fan
+ *  out to all shards and merge the results. The shards are chosen by content, so shards backed by persistent storages find their statements again when
+ *  reopened with the same number of shards.
+ *
+ *  librdf is not thread safe, so only work that does not create or release nodes is spread over the cores: with compact shards (see
+ *  RedlandCompactStorage.h), scans with an unbound subject fetch the matching positions of all shards in parallel batches, counts are taken in parallel
+ *  and adding a stream of statements merges the new statements into the shards' indexes in parallel once all of them were added. Shards of other
+ *  storages are read one after the other.
+ *
+ *  The shards must only be changed through the sharded model.
+ */
+@interface RedlandShardedModel : RedlandModel
+
+@property (nonatomic, readonly, copy) NSArray *shards;					///< One RedlandModel per shard
+
+- (id)initWithShardCount:(NSUInteger)count;
+- (id)initWithStorages:(NSArray *)storages;
+
+- (RedlandModel *)shardForSubject:(RedlandNode *)subjectNode;
+
+
+@end
@@ -0,0 +1,846 @@
+//
+//  RedlandShardedModel.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandShardedModel.h"
+#import "RedlandWorld.h"
+#import "RedlandStorage.h"
+#import "RedlandNode.h"
+#import "RedlandStatement.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandException.h"
+
+NSString * const RedlandShardedStorageFactoryName = @"sharded";
+
+#define REDLAND_SHARDED_BATCH_SIZE 1024					// positions fetched from each compact shard per parallel round
+
+
+typedef struct {
+	CFTypeRef owner;									// the RedlandModel of the shard, retained so the librdf model stays alive
+	librdf_model *model;
+	librdf_storage *storage;
+} RedlandShard;
+
+typedef struct {
+	librdf_world *world;
+	RedlandShard *shards;								// set up once by RedlandShardedModel before the storage is used, never changed afterwards
+	size_t count;
+	BOOL compact;										// all shards are compact storages, which can be scanned and merged in parallel
+} RedlandShardedStorageInstance;
+
+typedef enum {
+	RedlandShardedSources,
+	RedlandShardedArcsIn,
+	RedlandShardedContexts
+} RedlandShardedNodeKind;
+
+
+#pragma mark - Shards
+static RedlandShardedStorageInstance *RedlandShardedInstance(librdf_storage *storage)
+{
+	return (RedlandShardedStorageInstance *)librdf_storage_get_instance(storage);
+}
+
+/**
+ *  Returns the index of the shard holding the statements about the given subject.
+ *
+ *  RedlandNodeHash is FNV-1a with 32-bit constants, so its lower 32 bits are the same whether NSUInteger has 32 or 64 bits; only those are used, which
+ *  keeps the placement of persistent shards stable across architectures.
+ */
+static size_t RedlandShardIndex(librdf_node *subject, size_t count)
+{
+	return (size_t)((uint32_t)RedlandNodeHash(subject) % (uint32_t)count);
+}
+
+/**
+ *  Returns the shard holding the statements about the given subject.
+ */
+static RedlandShard *RedlandShardForSubject(RedlandShardedStorageInstance *instance, librdf_node *subject)
+{
+	return &instance->shards[RedlandShardIndex(subject, instance->count)];
+}
+
+static dispatch_queue_t RedlandShardedQueue(void)
+{
+	return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+}
+
+
+
+#pragma mark - Statement Streams
+/// The position of a parallel scan in one compact shard
+typedef struct {
+	uint32_t (*positions)[4];							// the positions fetched in the current round
+	size_t count;
+	uint32_t after[4];									// the last position fetched, the next round continues behind it
+	BOOL started;
+	BOOL exhausted;
+} RedlandShardedCursor;
+
+/**
+ *  A stream reading the matching statements of one shard after the other.
+ *
+ *  With compact shards the stream fetches the positions of the next batch of matches from all shards at once, in parallel, and turns them into
+ *  statements on the reading thread; the batches continue behind the last position fetched, so changes in between are fine. Other shards are read
+ *  with their own streams.
+ */
+typedef struct {
+	RedlandShardedStorageInstance *instance;
+	librdf_statement *pattern;							// NULL for all statements
+	librdf_node *context;
+	size_t position;									// the shard currently read
+	librdf_stream *stream;								// the stream of that shard, unless scanning in parallel
+	RedlandShardedCursor *cursors;						// one per shard when scanning in parallel
+	size_t offset;										// the position in the current shard's batch
+	librdf_statement statement;							// embedded and set up with librdf_statement_init, so copies handed out are deep copies
+	BOOL statementIsCurrent;
+} RedlandShardedStream;
+
+/**
+ *  Fetches the next batch of positions from every shard that has not been exhausted yet.
+ *  @return NO if none of the shards had any positions left
+ */
+static BOOL RedlandShardedStreamFetch(RedlandShardedStream *reader)
+{
+	RedlandShardedStorageInstance *instance = reader->instance;
+	RedlandShardedCursor *cursors = reader->cursors;
+	librdf_statement *pattern = reader->pattern;
+	librdf_node *context = reader->context;
+	dispatch_apply(instance->count, RedlandShardedQueue(), ^(size_t i) {
+		RedlandShardedCursor *cursor = &cursors[i];
+		cursor->count = 0;
+		if (cursor->exhausted) {
+			return;
+		}
+		cursor->count = RedlandCompactStorageFindPositions(instance->shards[i].storage, pattern, context, (cursor->started ? cursor->after : NULL),
+														   cursor->positions, REDLAND_SHARDED_BATCH_SIZE);
+		if (cursor->count < REDLAND_SHARDED_BATCH_SIZE) {
+			cursor->exhausted = YES;
+		}
+		if (cursor->count > 0) {
+			memcpy(cursor->after, cursor->positions[cursor->count - 1], sizeof(cursor->after));
+			cursor->started = YES;
+		}
+	});
+	
+	for (size_t i = 0; i < instance->count; i++) {
+		if (cursors[i].count > 0) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+/**
+ *  Moves on to the next shard, or the next round of batches, until there is a statement to return.
+ */
+static void RedlandShardedStreamSettle(RedlandShardedStream *reader)
+{
+	RedlandShardedStorageInstance *instance = reader->instance;
+	if (reader->cursors) {
+		for (;;) {
+			while (reader->position < instance->count && reader->offset >= reader->cursors[reader->position].count) {
+				reader->position++;
+				reader->offset = 0;
+			}
+			if (reader->position < instance->count || !RedlandShardedStreamFetch(reader)) {
+				return;
+			}
+			reader->position = 0;
+		}
+	}
+	
+	while (reader->position < instance->count) {
+		if (!reader->stream) {
+			librdf_model *model = instance->shards[reader->position].model;
+			if (reader->context) {
+				reader->stream = librdf_model_find_statements_in_context(model, reader->pattern, reader->context);
+			}
+			else {
+				reader->stream = reader->pattern ? librdf_model_find_statements(model, reader->pattern) : librdf_model_as_stream(model);
+			}
+		}
+		if (reader->stream && !librdf_stream_end(reader->stream)) {
+			return;
+		}
+		if (reader->stream) {
+			librdf_free_stream(reader->stream);
+			reader->stream = NULL;
+		}
+		reader->position++;
+	}
+}
+
+static int RedlandShardedStreamIsEnd(void *context)
+{
+	RedlandShardedStream *reader = context;
+	return (reader->position >= reader->instance->count);
+}
+
+static int RedlandShardedStreamNext(void *context)
+{
+	RedlandShardedStream *reader = context;
+	if (RedlandShardedStreamIsEnd(context)) {
+		return 1;
+	}
+	if (reader->cursors) {
+		reader->offset++;
+		reader->statementIsCurrent = NO;
+	}
+	else {
+		librdf_stream_next(reader->stream);
+	}
+	RedlandShardedStreamSettle(reader);
+	return RedlandShardedStreamIsEnd(context);
+}
+
+static void *RedlandShardedStreamGet(void *context, int flags)
+{
+	RedlandShardedStream *reader = context;
+	if (RedlandShardedStreamIsEnd(context)) {
+		return NULL;
+	}
+	if (!reader->cursors) {
+		if (LIBRDF_STREAM_GET_METHOD_GET_OBJECT == flags) {
+			return librdf_stream_get_object(reader->stream);
+		}
+		if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags) {
+			return librdf_stream_get_context2(reader->stream);
+		}
+		return NULL;
+	}
+	
+	librdf_storage *storage = reader->instance->shards[reader->position].storage;
+	uint32_t *position = reader->cursors[reader->position].positions[reader->offset];
+	if (LIBRDF_STREAM_GET_METHOD_GET_OBJECT == flags) {
+		if (!reader->statementIsCurrent) {
+			librdf_statement_clear(&reader->statement);
+			librdf_statement_set_subject(&reader->statement, librdf_new_node_from_node(RedlandCompactStorageGetTerm(storage, position[0])));
+			librdf_statement_set_predicate(&reader->statement, librdf_new_node_from_node(RedlandCompactStorageGetTerm(storage, position[1])));
+			librdf_statement_set_object(&reader->statement, librdf_new_node_from_node(RedlandCompactStorageGetTerm(storage, position[2])));
+			reader->statementIsCurrent = YES;
+		}
+		return &reader->statement;
+	}
+	if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags) {
+		return RedlandCompactStorageGetTerm(storage, position[3]);
+	}
+	return NULL;
+}
+
+static void RedlandShardedStreamFree(void *context)
+{
+	RedlandShardedStream *reader = context;
+	if (reader->stream) {
+		librdf_free_stream(reader->stream);
+	}
+	if (reader->cursors) {
+		for (size_t i = 0; i < reader->instance->count; i++) {
+			free(reader->cursors[i].positions);
+		}
+		free(reader->cursors);
+	}
+	librdf_statement_clear(&reader->statement);
+	if (reader->pattern) {
+		librdf_free_statement(reader->pattern);
+	}
+	if (reader->context) {
+		librdf_free_node(reader->context);
+	}
+	free(reader);
+}
+
+/**
+ *  Creates a stream over the statements matching the pattern and context. A pattern with a subject is answered by the subject's shard alone.
+ */
+static librdf_stream *RedlandShardedNewStream(RedlandShardedStorageInstance *instance, librdf_statement *statement, librdf_node *context)
+{
+	librdf_node *subject = statement ? librdf_statement_get_subject(statement) : NULL;
+	if (subject) {
+		librdf_model *model = RedlandShardForSubject(instance, subject)->model;
+		return context ? librdf_model_find_statements_in_context(model, statement, context) : librdf_model_find_statements(model, statement);
+	}
+	
+	RedlandShardedStream *reader = calloc(1, sizeof(RedlandShardedStream));
+	if (!reader) {
+		return NULL;
+	}
+	reader->instance = instance;
+	reader->pattern = statement ? librdf_new_statement_from_statement(statement) : NULL;
+	reader->context = context ? librdf_new_node_from_node(context) : NULL;
+	if (instance->compact) {
+		librdf_statement_init(instance->world, &reader->statement);
+		reader->cursors = calloc(instance->count, sizeof(RedlandShardedCursor));
+		BOOL allocated = (NULL != reader->cursors);
+		for (size_t i = 0; allocated && i < instance->count; i++) {
+			reader->cursors[i].positions = malloc(REDLAND_SHARDED_BATCH_SIZE * sizeof(uint32_t[4]));
+			allocated = (NULL != reader->cursors[i].positions);
+		}
+		if (!allocated) {
+			RedlandShardedStreamFree(reader);
+			return NULL;
+		}
+		reader->position = instance->count;				// makes the first settle fetch the first round
+	}
+	RedlandShardedStreamSettle(reader);
+	
+	librdf_stream *stream = librdf_new_stream(instance->world, reader, &RedlandShardedStreamIsEnd, &RedlandShardedStreamNext, &RedlandShardedStreamGet, &RedlandShardedStreamFree);
+	if (!stream) {
+		RedlandShardedStreamFree(reader);
+	}
+	return stream;
+}
+
+
+
+#pragma mark - Node Iterators
+/// An iterator reading the matching nodes of one shard after the other
+typedef struct {
+	RedlandShardedStorageInstance *instance;
+	size_t position;
+	librdf_iterator *iterator;
+	RedlandShardedNodeKind kind;
+	librdf_node *nodes[2];								// the given nodes, in the order of the librdf_model call
+	CFMutableSetRef seen;								// nodes already returned, for kinds that can occur in several shards
+} RedlandShardedIterator;
+
+static librdf_iterator *RedlandShardedShardIterator(RedlandShardedIterator *reader, librdf_model *model)
+{
+	switch (reader->kind) {
+		case RedlandShardedSources:
+			return librdf_model_get_sources(model, reader->nodes[0], reader->nodes[1]);
+		case RedlandShardedArcsIn:
+			return librdf_model_get_arcs_in(model, reader->nodes[0]);
+		case RedlandShardedContexts:
+			return librdf_model_get_contexts(model);
+	}
+	return NULL;
+}
+
+static void RedlandShardedIteratorSettle(RedlandShardedIterator *reader)
+{
+	while (reader->position < reader->instance->count) {
+		if (!reader->iterator) {
+			reader->iterator = RedlandShardedShardIterator(reader, reader->instance->shards[reader->position].model);
+		}
+		while (reader->iterator && !librdf_iterator_end(reader->iterator)) {
+			librdf_node *node = librdf_iterator_get_object(reader->iterator);
+			if (!reader->seen || !CFSetContainsValue(reader->seen, node)) {
+				if (reader->seen) {
+					CFSetAddValue(reader->seen, node);
+				}
+				return;
+			}
+			librdf_iterator_next(reader->iterator);
+		}
+		if (reader->iterator) {
+			librdf_free_iterator(reader->iterator);
+			reader->iterator = NULL;
+		}
+		reader->position++;
+	}
+}
+
+static int RedlandShardedIteratorIsEnd(void *context)
+{
+	RedlandShardedIterator *reader = context;
+	return (reader->position >= reader->instance->count);
+}
+
+static int RedlandShardedIteratorNext(void *context)
+{
+	RedlandShardedIterator *reader = context;
+	if (reader->iterator) {
+		librdf_iterator_next(reader->iterator);
+		RedlandShardedIteratorSettle(reader);
+	}
+	return RedlandShardedIteratorIsEnd(context);
+}
+
+static void *RedlandShardedIteratorGet(void *context, int flags)
+{
+	RedlandShardedIterator *reader = context;
+	if (!reader->iterator || RedlandShardedIteratorIsEnd(context)) {
+		return NULL;
+	}
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT == flags) {
+		return librdf_iterator_get_object(reader->iterator);
+	}
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_CONTEXT == flags) {
+		return librdf_iterator_get_context(reader->iterator);
+	}
+	return NULL;
+}
+
+static void RedlandShardedIteratorFree(void *context)
+{
+	RedlandShardedIterator *reader = context;
+	if (reader->iterator) {
+		librdf_free_iterator(reader->iterator);
+	}
+	for (int i = 0; i < 2; i++) {
+		if (reader->nodes[i]) {
+			librdf_free_node(reader->nodes[i]);
+		}
+	}
+	if (reader->seen) {
+		CFRelease(reader->seen);
+	}
+	free(reader);
+}
+
+/**
+ *  Creates an iterator over the nodes of all shards. Sources are subjects and thus only found in one shard each, arcs and contexts can be found in
+ *  several shards and are returned once.
+ */
+static librdf_iterator *RedlandShardedNewIterator(RedlandShardedStorageInstance *instance, RedlandShardedNodeKind kind, librdf_node *first, librdf_node *second)
+{
+	RedlandShardedIterator *reader = calloc(1, sizeof(RedlandShardedIterator));
+	if (!reader) {
+		return NULL;
+	}
+	reader->instance = instance;
+	reader->kind = kind;
+	reader->nodes[0] = first ? librdf_new_node_from_node(first) : NULL;
+	reader->nodes[1] = second ? librdf_new_node_from_node(second) : NULL;
+	if (RedlandShardedSources != kind) {
+		reader->seen = CFSetCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeSetCallBacks);
+	}
+	RedlandShardedIteratorSettle(reader);
+	
+	librdf_iterator *iterator = librdf_new_iterator(instance->world, reader, &RedlandShardedIteratorIsEnd, &RedlandShardedIteratorNext, &RedlandShardedIteratorGet, &RedlandShardedIteratorFree);
+	if (!iterator) {
+		RedlandShardedIteratorFree(reader);
+	}
+	return iterator;
+}
+
+
+
+#pragma mark - Storage Module
+static int RedlandShardedInit(librdf_storage *storage, const char *name, librdf_hash *options)
+{
+	if (options) {
+		librdf_free_hash(options);
+	}
+	RedlandShardedStorageInstance *instance = calloc(1, sizeof(RedlandShardedStorageInstance));
+	if (!instance) {
+		return 1;
+	}
+	instance->world = [RedlandWorld defaultWrappedWorld];
+	librdf_storage_set_instance(storage, instance);
+	return 0;
+}
+
+static void RedlandShardedTerminate(librdf_storage *storage)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	if (!instance) {
+		return;
+	}
+	for (size_t i = 0; i < instance->count; i++) {
+		CFRelease(instance->shards[i].owner);
+	}
+	free(instance->shards);
+	free(instance);
+	librdf_storage_set_instance(storage, NULL);
+}
+
+static int RedlandShardedOpen(librdf_storage *storage, librdf_model *model)
+{
+	return 0;
+}
+
+static int RedlandShardedClose(librdf_storage *storage)
+{
+	return 0;
+}
+
+static int RedlandShardedSize(librdf_storage *storage)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	int size = 0;
+	for (size_t i = 0; i < instance->count; i++) {
+		int shardSize = librdf_model_size(instance->shards[i].model);
+		if (shardSize < 0) {
+			return -1;
+		}
+		size += shardSize;
+	}
+	return size;
+}
+
+static int RedlandShardedContextAddStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	librdf_node *subject = librdf_statement_get_subject(statement);
+	if (!subject) {
+		return 1;
+	}
+	librdf_model *model = RedlandShardForSubject(RedlandShardedInstance(storage), subject)->model;
+	return context ? librdf_model_context_add_statement(model, context, statement) : librdf_model_add_statement(model, statement);
+}
+
+static int RedlandShardedAddStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandShardedContextAddStatement(storage, NULL, statement);
+}
+
+/**
+ *  Adds a stream of statements. Compact shards defer merging the new statements into their indexes until the stream has been read and then merge in
+ *  parallel, which is where most of the time of a bulk load goes.
+ */
+static int RedlandShardedContextAddStatements(librdf_storage *storage, librdf_node *context, librdf_stream *stream)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	int result = 0;
+	while (0 == result && !librdf_stream_end(stream)) {
+		librdf_statement *statement = librdf_stream_get_object(stream);
+		if (instance->compact && librdf_statement_get_subject(statement)) {
+			librdf_storage *shardStorage = RedlandShardForSubject(instance, librdf_statement_get_subject(statement))->storage;
+			result = RedlandCompactStorageAddStatements(shardStorage, &statement, 1, context, NO);
+		}
+		else {
+			result = RedlandShardedContextAddStatement(storage, context, statement);
+		}
+		librdf_stream_next(stream);
+	}
+	
+	if (instance->compact) {
+		__block volatile int failed = 0;
+		dispatch_apply(instance->count, RedlandShardedQueue(), ^(size_t i) {
+			if (0 != librdf_model_sync(instance->shards[i].model)) {
+				failed = 1;
+			}
+		});
+		if (0 == result) {
+			result = failed;
+		}
+	}
+	return result;
+}
+
+static int RedlandShardedAddStatements(librdf_storage *storage, librdf_stream *stream)
+{
+	return RedlandShardedContextAddStatements(storage, NULL, stream);
+}
+
+static int RedlandShardedContextRemoveStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	librdf_node *subject = librdf_statement_get_subject(statement);
+	if (!subject) {
+		return 1;
+	}
+	librdf_model *model = RedlandShardForSubject(RedlandShardedInstance(storage), subject)->model;
+	return context ? librdf_model_context_remove_statement(model, context, statement) : librdf_model_remove_statement(model, statement);
+}
+
+static int RedlandShardedRemoveStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandShardedContextRemoveStatement(storage, NULL, statement);
+}
+
+static int RedlandShardedContextRemoveStatements(librdf_storage *storage, librdf_node *context)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	int result = 0;
+	for (size_t i = 0; i < instance->count; i++) {
+		if (0 != librdf_model_context_remove_statements(instance->shards[i].model, context)) {
+			result = 1;
+		}
+	}
+	return result;
+}
+
+static int RedlandShardedContainsStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	librdf_node *subject = librdf_statement_get_subject(statement);
+	if (!subject) {
+		return 0;
+	}
+	return (librdf_model_contains_statement(RedlandShardForSubject(RedlandShardedInstance(storage), subject)->model, statement) > 0);
+}
+
+static int RedlandShardedHasArcIn(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	int hasArc = 0;
+	for (size_t i = 0; i < instance->count && !hasArc; i++) {
+		hasArc = librdf_model_has_arc_in(instance->shards[i].model, node, property);
+	}
+	return hasArc;
+}
+
+static int RedlandShardedHasArcOut(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	return librdf_model_has_arc_out(RedlandShardForSubject(RedlandShardedInstance(storage), node)->model, node, property);
+}
+
+static librdf_stream *RedlandShardedSerialise(librdf_storage *storage)
+{
+	return RedlandShardedNewStream(RedlandShardedInstance(storage), NULL, NULL);
+}
+
+static librdf_stream *RedlandShardedFindStatements(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandShardedNewStream(RedlandShardedInstance(storage), statement, NULL);
+}
+
+static librdf_stream *RedlandShardedContextSerialise(librdf_storage *storage, librdf_node *context)
+{
+	return RedlandShardedNewStream(RedlandShardedInstance(storage), NULL, context);
+}
+
+static librdf_stream *RedlandShardedFindStatementsInContext(librdf_storage *storage, librdf_statement *statement, librdf_node *context)
+{
+	return RedlandShardedNewStream(RedlandShardedInstance(storage), statement, context);
+}
+
+static librdf_iterator *RedlandShardedFindSources(librdf_storage *storage, librdf_node *arc, librdf_node *target)
+{
+	return RedlandShardedNewIterator(RedlandShardedInstance(storage), RedlandShardedSources, arc, target);
+}
+
+static librdf_iterator *RedlandShardedFindArcs(librdf_storage *storage, librdf_node *source, librdf_node *target)
+{
+	return librdf_model_get_arcs(RedlandShardForSubject(RedlandShardedInstance(storage), source)->model, source, target);
+}
+
+static librdf_iterator *RedlandShardedFindTargets(librdf_storage *storage, librdf_node *source, librdf_node *arc)
+{
+	return librdf_model_get_targets(RedlandShardForSubject(RedlandShardedInstance(storage), source)->model, source, arc);
+}
+
+static librdf_iterator *RedlandShardedGetArcsIn(librdf_storage *storage, librdf_node *node)
+{
+	return RedlandShardedNewIterator(RedlandShardedInstance(storage), RedlandShardedArcsIn, node, NULL);
+}
+
+static librdf_iterator *RedlandShardedGetArcsOut(librdf_storage *storage, librdf_node *node)
+{
+	return librdf_model_get_arcs_out(RedlandShardForSubject(RedlandShardedInstance(storage), node)->model, node);
+}
+
+static librdf_iterator *RedlandShardedGetContexts(librdf_storage *storage)
+{
+	return RedlandShardedNewIterator(RedlandShardedInstance(storage), RedlandShardedContexts, NULL, NULL);
+}
+
+/**
+ *  Syncs all shards; compact shards merge their buffered statements in parallel.
+ */
+static int RedlandShardedSync(librdf_storage *storage)
+{
+	RedlandShardedStorageInstance *instance = RedlandShardedInstance(storage);
+	__block volatile int result = 0;
+	if (instance->compact) {
+		dispatch_apply(instance->count, RedlandShardedQueue(), ^(size_t i) {
+			if (0 != librdf_model_sync(instance->shards[i].model)) {
+				result = 1;
+			}
+		});
+	}
+	else {
+		for (size_t i = 0; i < instance->count; i++) {
+			if (0 != librdf_model_sync(instance->shards[i].model)) {
+				result = 1;
+			}
+		}
+	}
+	return result;
+}
+
+static void RedlandShardedStorageFactory(librdf_storage_factory *factory)
+{
+	factory->version = LIBRDF_STORAGE_INTERFACE_VERSION;
+	factory->init = &RedlandShardedInit;
+	factory->terminate = &RedlandShardedTerminate;
+	factory->open = &RedlandShardedOpen;
+	factory->close = &RedlandShardedClose;
+	factory->size = &RedlandShardedSize;
+	factory->add_statement = &RedlandShardedAddStatement;
+	factory->add_statements = &RedlandShardedAddStatements;
+	factory->remove_statement = &RedlandShardedRemoveStatement;
+	factory->contains_statement = &RedlandShardedContainsStatement;
+	factory->has_arc_in = &RedlandShardedHasArcIn;
+	factory->has_arc_out = &RedlandShardedHasArcOut;
+	factory->serialise = &RedlandShardedSerialise;
+	factory->find_statements = &RedlandShardedFindStatements;
+	factory->find_sources = &RedlandShardedFindSources;
+	factory->find_arcs = &RedlandShardedFindArcs;
+	factory->find_targets = &RedlandShardedFindTargets;
+	factory->get_arcs_in = &RedlandShardedGetArcsIn;
+	factory->get_arcs_out = &RedlandShardedGetArcsOut;
+	factory->context_add_statement = &RedlandShardedContextAddStatement;
+	factory->context_add_statements = &RedlandShardedContextAddStatements;
+	factory->context_remove_statement = &RedlandShardedContextRemoveStatement;
+	factory->context_remove_statements = &RedlandShardedContextRemoveStatements;
+	factory->context_serialise = &RedlandShardedContextSerialise;
+	factory->find_statements_in_context = &RedlandShardedFindStatementsInContext;
+	factory->get_contexts = &RedlandShardedGetContexts;
+	factory->sync = &RedlandShardedSync;
+}
+
+/**
+ *  Registers the sharded storage factory with the given world. The default world does this when it is created.
+ */
+void RedlandShardedStorageRegisterFactory(librdf_world *world)
+{
+	librdf_storage_register_factory(world, [RedlandShardedStorageFactoryName UTF8String], "Statements partitioned across other storages by subject", &RedlandShardedStorageFactory);
+}
+
+
+
+#pragma mark -
+@implementation RedlandShardedModel
+
+
+- (id)init
+{
+	return [self initWithShardCount:[[NSProcessInfo processInfo] activeProcessorCount]];
+}
+
+/**
+ *  Creates a model with the given number of compact in-memory shards.
+ *  @param count The number of shards, at least 1
+ */
+- (id)initWithShardCount:(NSUInteger)count
+{
+	NSMutableArray *storages = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++) {
+		RedlandStorage *storage = [[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil];
+		if (nil == [storage wrappedStorage]) {
+			return nil;
+		}
+		[storages addObject:storage];
+	}
+	return [self initWithStorages:storages];
+}
+
+/**
+ *  Designated initializer.
+ *
+ *  Each storage becomes one shard; the storages should be empty or hold statements that were added through a sharded model with the same number of
+ *  shards, and must not be used by another model.
+ *  @param storages An array of RedlandStorage instances, at least one
+ */
+- (id)initWithStorages:(NSArray *)storages
+{
+	if ([storages count] < 1) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName reason:@"A sharded model needs at least one storage" userInfo:nil];
+	}
+	NSMutableArray *models = [NSMutableArray arrayWithCapacity:[storages count]];
+	for (RedlandStorage *shardStorage in storages) {
+		RedlandModel *model = [[RedlandModel alloc] initWithStorage:shardStorage];
+		if (nil == model) {
+			return nil;
+		}
+		[models addObject:model];
+	}
+	
+	RedlandStorage *storage = [[RedlandStorage alloc] initWithFactoryName:RedlandShardedStorageFactoryName identifier:nil options:nil];
+	if (nil == [storage wrappedStorage]) {
+		return nil;
+	}
+	if ((self = [super initWithStorage:storage])) {
+		RedlandShardedStorageInstance *instance = [self shardedInstance];
+		instance->shards = calloc([models count], sizeof(RedlandShard));
+		if (!instance->shards) {
+			[NSException raise:NSMallocException format:@"Out of memory creating a sharded model"];
+		}
+		instance->compact = YES;
+		for (RedlandModel *model in models) {
+			RedlandShard *shard = &instance->shards[instance->count++];
+			shard->owner = CFBridgingRetain(model);
+			shard->model = [model wrappedModel];
+			shard->storage = librdf_model_get_storage(shard->model);
+			instance->compact = instance->compact && RedlandStorageIsCompact(shard->storage);
+		}
+		_shards = [models copy];
+	}
+	return self;
+}
+
+- (RedlandShardedStorageInstance *)shardedInstance
+{
+	return RedlandShardedInstance(librdf_model_get_storage([self wrappedModel]));
+}
+
+/**
+ *  Returns the shard holding the statements about the given subject. Read from it freely, but change it only through the receiver.
+ */
+- (RedlandModel *)shardForSubject:(RedlandNode *)subjectNode
+{
+	NSParameterAssert(subjectNode != nil);
+	return [_shards objectAtIndex:RedlandShardIndex([subjectNode wrappedNode], [_shards count])];
+}
+
+
+
+#pragma mark - Counting
+/**
+ *  Counts in the subject's shard if the subject is bound, otherwise sums the counts of all shards; compact shards are counted in parallel.
+ */
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode estimate:(BOOL)estimate
+{
+	if (aStatement.subject) {
+		RedlandModel *shard = [self shardForSubject:aStatement.subject];
+		return estimate ? [shard estimatedCountOfStatementsLike:aStatement withContext:contextNode] : [shard countOfStatementsLike:aStatement withContext:contextNode];
+	}
+	
+	NSArray *shards = _shards;
+	NSUInteger count = [shards count];
+	NSUInteger *counts = calloc(count, sizeof(NSUInteger));
+	if (!counts) {
+		[NSException raise:NSMallocException format:@"Out of memory counting statements"];
+	}
+	void (^countShard)(size_t) = ^(size_t i) {
+		RedlandModel *shard = [shards objectAtIndex:i];
+		counts[i] = estimate ? [shard estimatedCountOfStatementsLike:aStatement withContext:contextNode] : [shard countOfStatementsLike:aStatement withContext:contextNode];
+	};
+	if ([self shardedInstance]->compact) {
+		dispatch_apply(count, RedlandShardedQueue(), countShard);
+	}
+	else {
+		for (NSUInteger i = 0; i < count; i++) {
+			countShard(i);
+		}
+	}
+	
+	NSUInteger total = 0;
+	for (NSUInteger i = 0; i < count; i++) {
+		total += counts[i];
+	}
+	free(counts);
+	return total;
+}
+
+- (NSUInteger)countOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	return [self countOfStatementsLike:aStatement withContext:contextNode estimate:NO];
+}
+
+- (NSUInteger)estimatedCountOfStatementsLike:(RedlandStatement *)aStatement withContext:(RedlandNode *)contextNode
+{
+	return [self countOfStatementsLike:aStatement withContext:contextNode estimate:YES];
+}
+
+
+@end
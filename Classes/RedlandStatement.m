@@ -30,6 +30,44 @@
 #import "RedlandNamespace.h"
 
 
+/**
+ *  The node wrappers of the subject, predicate and object are created on first access and cached; statements are immutable so the caches never need
+ *  to be invalidated. Like RedlandNode, the caches are filled with a compare-and-swap so statements can be shared between threads.
+ */
+@interface RedlandStatement () {
+	void * volatile cachedSubject;
+	void * volatile cachedPredicate;
+	void * volatile cachedObject;
+	NSUInteger cachedHash;
+}
+
+@end
+
+
+/**
+ *  Returns the cached wrapper of a statement part, creating it if necessary.
+ */
+static RedlandNode *RedlandStatementCachedNode(void * volatile *slot, librdf_node *node)
+{
+	if (*slot) {
+		return (kCFNull == *slot) ? nil : (__bridge RedlandNode *)*slot;
+	}
+	
+	void *retained = (void *)CFRetain(kCFNull);
+	if (node) {
+		RedlandNode *wrapper = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(node)];
+		if (wrapper) {
+			CFRelease(retained);
+			retained = (void *)CFBridgingRetain(wrapper);
+		}
+	}
+	if (!__sync_bool_compare_and_swap(slot, NULL, retained)) {
+		CFRelease(retained);
+	}
+	return (kCFNull == *slot) ? nil : (__bridge RedlandNode *)*slot;
+}
+
+
 @implementation RedlandStatement
 
 @dynamic subject, predicate, object;
@@ -85,6 +123,12 @@
 	if (isWrappedObjectOwner) {
 		librdf_free_statement(wrappedObject);
 	}
+	void *caches[] = { cachedSubject, cachedPredicate, cachedObject };
+	for (NSUInteger i = 0; i < sizeof(caches) / sizeof(void *); i++) {
+		if (caches[i]) {
+			CFRelease(caches[i]);
+		}
+	}
 }
 
 
@@ -101,30 +145,17 @@
 
 - (RedlandNode *)subject
 {
-	/// @todo is it a good idea to cache these in an ivar?
-	librdf_node *node = librdf_statement_get_subject(wrappedObject);
-	if (node) {
-		node = librdf_new_node_from_node(node);
-	}
-	return [[RedlandNode alloc] initWithWrappedObject:node];
+	return RedlandStatementCachedNode(&cachedSubject, librdf_statement_get_subject(wrappedObject));
 }
 
 - (RedlandNode *)predicate
 {
-	librdf_node *node = librdf_statement_get_predicate(wrappedObject);
-	if (node) {
-		node = librdf_new_node_from_node(node);
-	}
-	return [[RedlandNode alloc] initWithWrappedObject:node];
+	return RedlandStatementCachedNode(&cachedPredicate, librdf_statement_get_predicate(wrappedObject));
 }
 
 - (RedlandNode *)object
 {
-	librdf_node *node = librdf_statement_get_object(wrappedObject);
-	if (node) {
-		node = librdf_new_node_from_node(node);
-	}
-	return [[RedlandNode alloc] initWithWrappedObject:node];
+	return RedlandStatementCachedNode(&cachedObject, librdf_statement_get_object(wrappedObject));
 }
 
 /**
@@ -165,9 +196,18 @@
 	return NO;
 }
 
+/**
+ *  The hash is computed from the values of the statement's nodes, so statements that are equal have the same hash.
+ */
 - (NSUInteger)hash
 {
-	return (NSUInteger)wrappedObject;
+	if (0 == cachedHash) {
+		NSUInteger hash = RedlandNodeHash(librdf_statement_get_subject(wrappedObject));
+		hash = hash * 31 + RedlandNodeHash(librdf_statement_get_predicate(wrappedObject));
+		hash = hash * 31 + RedlandNodeHash(librdf_statement_get_object(wrappedObject));
+		cachedHash = hash;
+	}
+	return cachedHash;
 }
 
 
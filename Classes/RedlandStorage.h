@@ -31,6 +31,9 @@
  *
  *  The interface of this class is currently incomplete, as most methods are simply duplicates of the RedlandModel methods. If direct manipulation of the
  *  storage is necessary, you can use the standard C API on the underlying librdf_storage instead.
+ *
+ *  Besides the storage modules that come with librdf, the framework registers a compact in-memory storage with the default world, see
+ *  RedlandCompactStorage.h.
  */
 @interface RedlandStorage : RedlandWrappedObject
 
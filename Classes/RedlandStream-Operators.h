@@ -0,0 +1,55 @@
+//
+//  RedlandStream-Operators.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandStream.h"
+
+@class RedlandURI;
+
+/// The parts of a statement, used to choose which parts stream operators test or keep
+typedef enum _RedlandStatementPart {
+	RedlandStatementSubject = 1 << 0,
+	RedlandStatementPredicate = 1 << 1,
+	RedlandStatementObject = 1 << 2
+} RedlandStatementPart;
+
+
+/**
+ *  Lazy operators on statement streams.
+ *
+ *  Each operator returns a new stream reading the receiver, and is evaluated in C as the new stream is read: filters and projections are librdf stream
+ *  maps, so statements that are dropped never become RedlandStatement objects. Operators can be chained, e.g. to read the first ten distinct English
+ *  labels of a model without wrapping any of the others. The receiver is consumed by the returned stream and should not be read on its own anymore.
+ */
+@interface RedlandStream (Operators)
+
++ (RedlandStream *)streamByConcatenatingStreams:(NSArray *)streams;
+
+- (RedlandStream *)streamByFilteringParts:(RedlandStatementPart)parts ofType:(librdf_node_type)type;
+- (RedlandStream *)streamByFilteringObjectLanguage:(NSString *)language;
+- (RedlandStream *)streamByFilteringObjectDatatype:(RedlandURI *)datatypeURI;
+- (RedlandStream *)streamByProjectingParts:(RedlandStatementPart)parts;
+- (RedlandStream *)streamByLimitingToCount:(NSUInteger)limit;
+- (RedlandStream *)streamByRemovingDuplicates;
+- (RedlandStream *)streamByAppendingStream:(RedlandStream *)aStream;
+
+
+@end
@@ -0,0 +1,425 @@
+//
+//  RedlandStream-Operators.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandStream-Operators.h"
+#import "RedlandWorld.h"
+#import "RedlandNode.h"
+#import "RedlandURI.h"
+#import "RedlandException.h"
+
+
+#pragma mark - Chain Stream
+/**
+ *  The context of the streams the operators create: reads its source streams one after the other, stopping after "limit" statements. The filters
+ *  and projections are added to it as librdf stream maps.
+ */
+typedef struct {
+	CFArrayRef sources;									// the RedlandStream instances to read
+	CFIndex position;									// the source currently read
+	NSUInteger limit;
+	NSUInteger count;									// statements passed on so far, including those dropped by maps
+} RedlandStreamChain;
+
+static librdf_stream *RedlandStreamChainCurrent(RedlandStreamChain *chain)
+{
+	return [(__bridge RedlandStream *)CFArrayGetValueAtIndex(chain->sources, chain->position) wrappedStream];
+}
+
+/**
+ *  Moves on to the next source until the current one has a statement to return.
+ */
+static void RedlandStreamChainSettle(RedlandStreamChain *chain)
+{
+	while (chain->position < CFArrayGetCount(chain->sources) && librdf_stream_end(RedlandStreamChainCurrent(chain))) {
+		chain->position++;
+	}
+}
+
+static int RedlandStreamChainIsEnd(void *context)
+{
+	RedlandStreamChain *chain = context;
+	return (chain->position >= CFArrayGetCount(chain->sources) || chain->count >= chain->limit);
+}
+
+static int RedlandStreamChainNext(void *context)
+{
+	RedlandStreamChain *chain = context;
+	if (RedlandStreamChainIsEnd(context)) {
+		return 1;
+	}
+	librdf_stream_next(RedlandStreamChainCurrent(chain));
+	chain->count++;
+	RedlandStreamChainSettle(chain);
+	return RedlandStreamChainIsEnd(context);
+}
+
+static void *RedlandStreamChainGet(void *context, int flags)
+{
+	RedlandStreamChain *chain = context;
+	if (RedlandStreamChainIsEnd(context)) {
+		return NULL;
+	}
+	if (LIBRDF_STREAM_GET_METHOD_GET_OBJECT == flags) {
+		return librdf_stream_get_object(RedlandStreamChainCurrent(chain));
+	}
+	if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags) {
+		return librdf_stream_get_context2(RedlandStreamChainCurrent(chain));
+	}
+	return NULL;
+}
+
+static void RedlandStreamChainFree(void *context)
+{
+	RedlandStreamChain *chain = context;
+	CFRelease(chain->sources);
+	free(chain);
+}
+
+/**
+ *  Creates a librdf stream reading the given RedlandStream instances one after the other.
+ */
+static librdf_stream *RedlandStreamChainCreate(NSArray *streams, NSUInteger limit)
+{
+	RedlandStreamChain *chain = calloc(1, sizeof(RedlandStreamChain));
+	if (!chain) {
+		return NULL;
+	}
+	chain->sources = CFBridgingRetain([streams copy]);
+	chain->limit = limit;
+	RedlandStreamChainSettle(chain);
+	
+	librdf_stream *stream = librdf_new_stream([RedlandWorld defaultWrappedWorld], chain, &RedlandStreamChainIsEnd, &RedlandStreamChainNext, &RedlandStreamChainGet, &RedlandStreamChainFree);
+	if (!stream) {
+		RedlandStreamChainFree(chain);
+	}
+	return stream;
+}
+
+
+
+#pragma mark - Maps
+/// The context of the filter maps
+typedef struct {
+	RedlandStatementPart parts;
+	librdf_node_type type;
+	char *language;
+	librdf_uri *datatype;
+} RedlandStreamFilter;
+
+static void RedlandStreamFilterFree(void *context)
+{
+	RedlandStreamFilter *filter = context;
+	free(filter->language);
+	if (filter->datatype) {
+		librdf_free_uri(filter->datatype);
+	}
+	free(filter);
+}
+
+static librdf_node *RedlandStreamStatementPart(librdf_statement *statement, RedlandStatementPart part)
+{
+	switch (part) {
+		case RedlandStatementSubject:
+			return librdf_statement_get_subject(statement);
+		case RedlandStatementPredicate:
+			return librdf_statement_get_predicate(statement);
+		case RedlandStatementObject:
+			return librdf_statement_get_object(statement);
+	}
+	return NULL;
+}
+
+static librdf_statement *RedlandStreamFilterType(librdf_stream *stream, void *context, librdf_statement *statement)
+{
+	RedlandStreamFilter *filter = context;
+	for (RedlandStatementPart part = RedlandStatementSubject; part <= RedlandStatementObject; part <<= 1) {
+		librdf_node *node = RedlandStreamStatementPart(statement, part);
+		if ((filter->parts & part) && (!node || librdf_node_get_type(node) != filter->type)) {
+			return NULL;
+		}
+	}
+	return statement;
+}
+
+static librdf_statement *RedlandStreamFilterLanguage(librdf_stream *stream, void *context, librdf_statement *statement)
+{
+	RedlandStreamFilter *filter = context;
+	librdf_node *object = librdf_statement_get_object(statement);
+	if (!object || !librdf_node_is_literal(object)) {
+		return NULL;
+	}
+	char *language = librdf_node_get_literal_value_language(object);
+	return (language && 0 == strcasecmp(language, filter->language)) ? statement : NULL;
+}
+
+static librdf_statement *RedlandStreamFilterDatatype(librdf_stream *stream, void *context, librdf_statement *statement)
+{
+	RedlandStreamFilter *filter = context;
+	librdf_node *object = librdf_statement_get_object(statement);
+	if (!object || !librdf_node_is_literal(object)) {
+		return NULL;
+	}
+	librdf_uri *datatype = librdf_node_get_literal_value_datatype_uri(object);
+	return (datatype && librdf_uri_equals(datatype, filter->datatype)) ? statement : NULL;
+}
+
+/// The context of the projection map, which returns its own statement with the dropped parts removed
+typedef struct {
+	RedlandStatementPart parts;
+	librdf_statement statement;							// embedded and set up with librdf_statement_init, so copies handed out are deep copies
+} RedlandStreamProjection;
+
+static librdf_statement *RedlandStreamProject(librdf_stream *stream, void *context, librdf_statement *statement)
+{
+	RedlandStreamProjection *projection = context;
+	librdf_node *subject = librdf_statement_get_subject(statement);
+	librdf_node *predicate = librdf_statement_get_predicate(statement);
+	librdf_node *object = librdf_statement_get_object(statement);
+	librdf_statement_clear(&projection->statement);
+	if ((projection->parts & RedlandStatementSubject) && subject) {
+		librdf_statement_set_subject(&projection->statement, librdf_new_node_from_node(subject));
+	}
+	if ((projection->parts & RedlandStatementPredicate) && predicate) {
+		librdf_statement_set_predicate(&projection->statement, librdf_new_node_from_node(predicate));
+	}
+	if ((projection->parts & RedlandStatementObject) && object) {
+		librdf_statement_set_object(&projection->statement, librdf_new_node_from_node(object));
+	}
+	return &projection->statement;
+}
+
+static void RedlandStreamProjectionFree(void *context)
+{
+	RedlandStreamProjection *projection = context;
+	librdf_statement_clear(&projection->statement);
+	free(projection);
+}
+
+/**
+ *  Statement set callbacks comparing all three parts, missing parts are equal to each other. Retaining builds a new statement from copies of the
+ *  nodes, as the statements added are usually the stream's current statement, which changes with every row.
+ */
+static const void *RedlandStatementRetainCallBack(CFAllocatorRef allocator, const void *value)
+{
+	librdf_node *nodes[3];
+	for (int i = 0; i < 3; i++) {
+		librdf_node *node = RedlandStreamStatementPart((librdf_statement *)value, (RedlandStatementPart)(1 << i));
+		nodes[i] = node ? librdf_new_node_from_node(node) : NULL;
+	}
+	return librdf_new_statement_from_nodes([RedlandWorld defaultWrappedWorld], nodes[0], nodes[1], nodes[2]);
+}
+
+static void RedlandStatementReleaseCallBack(CFAllocatorRef allocator, const void *value)
+{
+	librdf_free_statement((librdf_statement *)value);
+}
+
+static Boolean RedlandStatementEqualCallBack(const void *value1, const void *value2)
+{
+	for (RedlandStatementPart part = RedlandStatementSubject; part <= RedlandStatementObject; part <<= 1) {
+		librdf_node *node1 = RedlandStreamStatementPart((librdf_statement *)value1, part);
+		librdf_node *node2 = RedlandStreamStatementPart((librdf_statement *)value2, part);
+		if ((node1 || node2) && (!node1 || !node2 || !librdf_node_equals(node1, node2))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static CFHashCode RedlandStatementHashCallBack(const void *value)
+{
+	librdf_statement *statement = (librdf_statement *)value;
+	CFHashCode hash = RedlandNodeHash(librdf_statement_get_subject(statement));
+	hash = 31 * hash + RedlandNodeHash(librdf_statement_get_predicate(statement));
+	return 31 * hash + RedlandNodeHash(librdf_statement_get_object(statement));
+}
+
+static const CFSetCallBacks RedlandStatementSetCallBacks = {
+	0,
+	RedlandStatementRetainCallBack,
+	RedlandStatementReleaseCallBack,
+	NULL,
+	RedlandStatementEqualCallBack,
+	RedlandStatementHashCallBack
+};
+
+static librdf_statement *RedlandStreamDistinct(librdf_stream *stream, void *context, librdf_statement *statement)
+{
+	CFMutableSetRef seen = context;
+	if (CFSetContainsValue(seen, statement)) {
+		return NULL;
+	}
+	CFSetAddValue(seen, statement);
+	return statement;
+}
+
+static void RedlandStreamDistinctFree(void *context)
+{
+	CFRelease((CFMutableSetRef)context);
+}
+
+
+
+#pragma mark -
+@implementation RedlandStream (Operators)
+
+
+/**
+ *  Returns a stream of the statements of the given streams, one stream after the other.
+ *  @param streams An array of RedlandStream instances, which are consumed by the new stream
+ */
++ (RedlandStream *)streamByConcatenatingStreams:(NSArray *)streams
+{
+	librdf_stream *stream = RedlandStreamChainCreate(streams ?: @[], NSUIntegerMax);
+	if (!stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName reason:@"Failed to create a stream" userInfo:nil];
+	}
+	return [[RedlandStream alloc] initWithWrappedObject:stream];
+}
+
+/**
+ *  Adds the given map to a new stream reading the receiver.
+ */
+- (RedlandStream *)streamWithMap:(librdf_stream_map_handler)map context:(void *)context freeContext:(librdf_stream_map_free_context_handler)freeContext
+{
+	librdf_stream *stream = RedlandStreamChainCreate(@[self], NSUIntegerMax);
+	if (!stream || 0 != librdf_stream_add_map(stream, map, freeContext, context)) {
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		freeContext(context);
+		@throw [RedlandException exceptionWithName:RedlandExceptionName reason:@"Failed to create a stream" userInfo:nil];
+	}
+	return [[RedlandStream alloc] initWithWrappedObject:stream];
+}
+
+- (RedlandStream *)streamWithFilter:(RedlandStreamFilter *)filter map:(librdf_stream_map_handler)map
+{
+	if (!filter) {
+		[NSException raise:NSMallocException format:@"Out of memory creating a stream filter"];
+	}
+	return [self streamWithMap:map context:filter freeContext:&RedlandStreamFilterFree];
+}
+
+/**
+ *  Returns a stream of the statements whose given parts are all nodes of the given type.
+ *  @param parts The parts to test, e.g. RedlandStatementSubject | RedlandStatementObject
+ *  @param type The node type, e.g. LIBRDF_NODE_TYPE_LITERAL
+ */
+- (RedlandStream *)streamByFilteringParts:(RedlandStatementPart)parts ofType:(librdf_node_type)type
+{
+	RedlandStreamFilter *filter = calloc(1, sizeof(RedlandStreamFilter));
+	if (filter) {
+		filter->parts = parts;
+		filter->type = type;
+	}
+	return [self streamWithFilter:filter map:&RedlandStreamFilterType];
+}
+
+/**
+ *  Returns a stream of the statements whose object is a literal in the given language; language tags are compared case-insensitively.
+ *  @param language A language tag, e.g. "en"
+ */
+- (RedlandStream *)streamByFilteringObjectLanguage:(NSString *)language
+{
+	NSParameterAssert(language != nil);
+	RedlandStreamFilter *filter = calloc(1, sizeof(RedlandStreamFilter));
+	if (filter) {
+		filter->language = strdup([language UTF8String]);
+	}
+	if (filter && !filter->language) {
+		free(filter);
+		filter = NULL;
+	}
+	return [self streamWithFilter:filter map:&RedlandStreamFilterLanguage];
+}
+
+/**
+ *  Returns a stream of the statements whose object is a literal of the given datatype.
+ *  @param datatypeURI The datatype, e.g. http://www.w3.org/2001/XMLSchema#integer
+ */
+- (RedlandStream *)streamByFilteringObjectDatatype:(RedlandURI *)datatypeURI
+{
+	NSParameterAssert(datatypeURI != nil);
+	RedlandStreamFilter *filter = calloc(1, sizeof(RedlandStreamFilter));
+	if (filter) {
+		filter->datatype = librdf_new_uri_from_uri([datatypeURI wrappedURI]);
+	}
+	if (filter && !filter->datatype) {
+		free(filter);
+		filter = NULL;
+	}
+	return [self streamWithFilter:filter map:&RedlandStreamFilterDatatype];
+}
+
+/**
+ *  Returns a stream of the statements with all but the given parts removed. Combine with streamByRemovingDuplicates to read e.g. the distinct
+ *  subjects of a stream; the statements are incomplete and can thus not be added to a model.
+ *  @param parts The parts to keep
+ */
+- (RedlandStream *)streamByProjectingParts:(RedlandStatementPart)parts
+{
+	RedlandStreamProjection *projection = calloc(1, sizeof(RedlandStreamProjection));
+	if (!projection) {
+		[NSException raise:NSMallocException format:@"Out of memory creating a stream projection"];
+	}
+	projection->parts = parts;
+	librdf_statement_init([RedlandWorld defaultWrappedWorld], &projection->statement);
+	return [self streamWithMap:&RedlandStreamProject context:projection freeContext:&RedlandStreamProjectionFree];
+}
+
+/**
+ *  Returns a stream of at most the given number of statements; the receiver is not read any further once they have been returned.
+ */
+- (RedlandStream *)streamByLimitingToCount:(NSUInteger)limit
+{
+	librdf_stream *stream = RedlandStreamChainCreate(@[self], limit);
+	if (!stream) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName reason:@"Failed to create a stream" userInfo:nil];
+	}
+	return [[RedlandStream alloc] initWithWrappedObject:stream];
+}
+
+/**
+ *  Returns a stream returning each statement only once, the first time it occurs; contexts are not compared. Remembers a copy of every distinct
+ *  statement until the stream is freed.
+ */
+- (RedlandStream *)streamByRemovingDuplicates
+{
+	CFMutableSetRef seen = CFSetCreateMutable(kCFAllocatorDefault, 0, &RedlandStatementSetCallBacks);
+	if (!seen) {
+		[NSException raise:NSMallocException format:@"Out of memory creating a distinct stream"];
+	}
+	return [self streamWithMap:&RedlandStreamDistinct context:seen freeContext:&RedlandStreamDistinctFree];
+}
+
+/**
+ *  Returns a stream of the receiver's statements followed by those of the given stream.
+ */
+- (RedlandStream *)streamByAppendingStream:(RedlandStream *)aStream
+{
+	NSParameterAssert(aStream != nil);
+	return [[self class] streamByConcatenatingStreams:@[self, aStream]];
+}
+
+
+@end
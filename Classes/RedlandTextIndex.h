@@ -0,0 +1,74 @@
+//
+//  RedlandTextIndex.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import <Foundation/Foundation.h>
+
+@class RedlandModel, RedlandNode;
+
+/// The ways the words of a text query are matched
+typedef enum _RedlandTextQueryType {
+	RedlandTextQueryAllTerms = 0,			///< Every word must occur in the literal, in any order
+	RedlandTextQueryPrefix,					///< Like RedlandTextQueryAllTerms, but the last word may be the beginning of a word (type-ahead)
+	RedlandTextQueryPhrase					///< The words must occur in the literal in order and next to each other
+} RedlandTextQueryType;
+
+
+/**
+ *  A statement with a literal object found by a text index.
+ */
+@interface RedlandTextMatch : NSObject
+
+@property (nonatomic, readonly, strong) RedlandNode *subject;
+@property (nonatomic, readonly, strong) RedlandNode *predicate;
+@property (nonatomic, readonly, strong) RedlandNode *literal;
+@property (nonatomic, readonly, assign) double score;					///< The BM25 relevance of the literal, higher is better
+
+@end
+
+
+/**
+ *  An inverted index over the literal values of a model, for keyword, prefix and phrase searches that don't scan every literal.
+ *
+ *  Literals are split into words with CFStringTokenizer, using the locale of their language tag so that languages without spaces are segmented
+ *  correctly, and words are folded to ignore case, diacritics and width. Each word maps to a list of (literal, position) postings ordered by literal,
+ *  which makes multi-word queries a merge of sorted lists and phrase queries a check of adjacent positions. Prefix queries look the words up in a
+ *  sorted list of all words. Matches are ranked with BM25.
+ *
+ *  The index registers itself as a change observer of the model and stays current with statements added and removed through it. Removed literals are
+ *  only marked as such; the postings are compacted once more than half of the literals have been removed. Like the model, the index must not be used
+ *  from several threads at the same time.
+ */
+@interface RedlandTextIndex : NSObject
+
+@property (nonatomic, readonly, strong) RedlandModel *model;				///< The indexed model
+@property (nonatomic, readonly, assign) NSUInteger count;					///< The number of indexed literal statements
+@property (nonatomic, readonly, assign) NSUInteger termCount;				///< The number of distinct words
+
+- (id)initWithModel:(RedlandModel *)aModel;
+- (void)invalidate;
+
+- (NSArray *)matchesForQuery:(NSString *)query type:(RedlandTextQueryType)queryType language:(NSString *)language limit:(NSUInteger)limit;
+
+
+@end
@@ -0,0 +1,715 @@
+//
+//  RedlandTextIndex.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+
+
+#import "RedlandTextIndex.h"
+#import "RedlandModel.h"
+#import "RedlandNode.h"
+#import "RedlandStatement.h"
+#import "RedlandStream.h"
+#import "RedlandChangeSet.h"
+
+#define REDLAND_TEXT_PREFIX_EXPANSION_LIMIT 128			///< A prefix matches at most this many words, the shortest ones are used
+#define REDLAND_TEXT_COMPACTION_MINIMUM 1024				///< Postings are not compacted for fewer removed literals than this
+#define REDLAND_TEXT_BM25_K1 1.2
+#define REDLAND_TEXT_BM25_B 0.75
+
+/// One indexed literal statement
+typedef struct {
+	librdf_statement *statement;						///< NULL once the statement was removed
+	uint32_t length;									///< The number of words of the literal
+} RedlandTextDocument;
+
+/// A literal matching a query
+typedef struct {
+	uint32_t document;
+	double score;
+} RedlandTextHit;
+
+
+static Boolean RedlandTextStatementEqualCallBack(const void *value1, const void *value2)
+{
+	return (0 != librdf_statement_equals((librdf_statement *)value1, (librdf_statement *)value2));
+}
+
+static CFHashCode RedlandTextStatementHashCallBack(const void *value)
+{
+	librdf_statement *statement = (librdf_statement *)value;
+	NSUInteger hash = RedlandNodeHash(librdf_statement_get_subject(statement));
+	hash = hash * 31 + RedlandNodeHash(librdf_statement_get_predicate(statement));
+	return hash * 31 + RedlandNodeHash(librdf_statement_get_object(statement));
+}
+
+/// Statement keys are owned by the document table, the dictionary neither copies nor frees them
+static const CFDictionaryKeyCallBacks RedlandTextStatementKeyCallBacks = {
+	0,
+	NULL,
+	NULL,
+	NULL,
+	RedlandTextStatementEqualCallBack,
+	RedlandTextStatementHashCallBack
+};
+
+static int RedlandTextHitCompareDocuments(const void *a, const void *b)
+{
+	uint32_t documentA = ((const RedlandTextHit *)a)->document;
+	uint32_t documentB = ((const RedlandTextHit *)b)->document;
+	return (documentA < documentB) ? -1 : ((documentA > documentB) ? 1 : 0);
+}
+
+/// Orders by descending score, documents indexed earlier first among equal scores
+static int RedlandTextHitCompareScores(const void *a, const void *b)
+{
+	const RedlandTextHit *hitA = a;
+	const RedlandTextHit *hitB = b;
+	if (hitA->score != hitB->score) {
+		return (hitA->score > hitB->score) ? -1 : 1;
+	}
+	return RedlandTextHitCompareDocuments(a, b);
+}
+
+/**
+ *  Restores the heap below the given node; the root of the heap is the hit ranking last.
+ */
+static void RedlandTextHitSiftDown(RedlandTextHit *heap, NSUInteger node, NSUInteger count)
+{
+	while (2 * node + 1 < count) {
+		NSUInteger child = 2 * node + 1;
+		if (child + 1 < count && RedlandTextHitCompareScores(&heap[child + 1], &heap[child]) > 0) {
+			child++;
+		}
+		if (RedlandTextHitCompareScores(&heap[child], &heap[node]) <= 0) {
+			break;
+		}
+		RedlandTextHit swap = heap[node];
+		heap[node] = heap[child];
+		heap[child] = swap;
+		node = child;
+	}
+}
+
+/**
+ *  Whether the language tag of the literal is the given one or one of its subtags ("en" matches "en" and "en-US").
+ */
+static BOOL RedlandTextLanguageMatches(librdf_node *literal, const char *language)
+{
+	const char *literalLanguage = librdf_node_get_literal_value_language(literal);
+	if (NULL == literalLanguage) {
+		return NO;
+	}
+	size_t length = strlen(language);
+	return (0 == strncasecmp(literalLanguage, language, length) && ('\0' == literalLanguage[length] || '-' == literalLanguage[length]));
+}
+
+
+/**
+ *  The postings of one word.
+ */
+@interface RedlandTextPostings : NSObject {
+@public
+	uint32_t *entries;									///< (document, position) pairs, ordered by document and position
+	NSUInteger count;									///< The number of pairs
+	NSUInteger capacity;
+	NSUInteger documentFrequency;						///< The number of distinct documents, including removed ones until the next compaction
+}
+
+- (void)addDocument:(uint32_t)document position:(uint32_t)position;
+- (NSRange)rangeOfDocument:(uint32_t)document;
+
+@end
+
+
+@implementation RedlandTextPostings
+
+- (void)dealloc
+{
+	free(entries);
+}
+
+- (void)addDocument:(uint32_t)document position:(uint32_t)position
+{
+	if (count == capacity) {
+		capacity = capacity ? 2 * capacity : 4;
+		entries = reallocf(entries, 2 * capacity * sizeof(uint32_t));
+		if (NULL == entries) {
+			[NSException raise:NSMallocException format:@"Out of memory growing text index postings"];
+		}
+	}
+	if (0 == count || entries[2 * (count - 1)] != document) {
+		documentFrequency++;
+	}
+	entries[2 * count] = document;
+	entries[2 * count + 1] = position;
+	count++;
+}
+
+/**
+ *  The range of pairs belonging to the document, found by binary search; its length is 0 if the word does not occur in the document.
+ */
+- (NSRange)rangeOfDocument:(uint32_t)document
+{
+	NSUInteger low = 0;
+	NSUInteger high = count;
+	while (low < high) {
+		NSUInteger middle = low + (high - low) / 2;
+		if (entries[2 * middle] < document) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	NSUInteger end = low;
+	while (end < count && entries[2 * end] == document) {
+		end++;
+	}
+	return NSMakeRange(low, end - low);
+}
+
+@end
+
+
+@interface RedlandTextMatch ()
+
+- (id)initWithStatement:(librdf_statement *)statement score:(double)score;
+
+@end
+
+
+@implementation RedlandTextMatch
+
+- (id)initWithStatement:(librdf_statement *)statement score:(double)score
+{
+	if ((self = [super init])) {
+		_subject = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_statement_get_subject(statement))];
+		_predicate = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_statement_get_predicate(statement))];
+		_literal = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(librdf_statement_get_object(statement))];
+		_score = score;
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p> %@ %@ %@ (%.3f)", NSStringFromClass([self class]), self, _subject, _predicate, _literal, _score];
+}
+
+@end
+
+
+@interface RedlandTextIndex () {
+	RedlandTextDocument *documents;
+	NSUInteger documentCount;							///< Including removed documents until the next compaction
+	NSUInteger documentCapacity;
+	NSUInteger removedCount;
+	NSUInteger totalLength;								///< The summed length of all live documents
+	CFMutableDictionaryRef documentIDs;					///< librdf_statement -> document number
+	NSMutableDictionary *terms;							///< word -> RedlandTextPostings
+	NSMutableArray *sortedTerms;						///< All words, in literal order for prefix lookups
+	BOOL building;										///< YES while indexing the initial statements; sortedTerms is sorted afterwards
+	NSMutableDictionary *tokenizers;					///< language -> CFStringTokenizer
+	id observer;
+}
+
+@end
+
+
+@implementation RedlandTextIndex
+
+
+/**
+ *  Indexes all literal statements of the model and starts observing it.
+ *  @param aModel The model to index
+ */
+- (id)initWithModel:(RedlandModel *)aModel
+{
+	NSParameterAssert(aModel != nil);
+	
+	if ((self = [super init])) {
+		_model = aModel;
+		documentIDs = CFDictionaryCreateMutable(NULL, 0, &RedlandTextStatementKeyCallBacks, NULL);
+		terms = [NSMutableDictionary new];
+		sortedTerms = [NSMutableArray new];
+		tokenizers = [NSMutableDictionary new];
+		
+		building = YES;
+		librdf_stream *stream = librdf_model_as_stream([aModel wrappedModel]);
+		while (stream && !librdf_stream_end(stream)) {
+			[self indexStatement:librdf_stream_get_object(stream)];
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		[sortedTerms sortUsingSelector:@selector(compare:)];
+		building = NO;
+		
+		__weak RedlandTextIndex *weakSelf = self;
+		observer = [aModel addChangeObserverWithQueue:nil usingBlock:^(RedlandModel *changedModel, RedlandChangeSet *changes) {
+			[weakSelf applyChanges:changes];
+		}];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self invalidate];
+	for (NSUInteger i = 0; i < documentCount; i++) {
+		if (documents[i].statement) {
+			librdf_free_statement(documents[i].statement);
+		}
+	}
+	free(documents);
+	if (documentIDs) {
+		CFRelease(documentIDs);
+	}
+}
+
+/**
+ *  Stops observing the model; the index keeps answering queries for the statements indexed so far.
+ */
+- (void)invalidate
+{
+	if (observer) {
+		[_model removeChangeObserver:observer];
+		observer = nil;
+	}
+}
+
+- (NSUInteger)count
+{
+	return documentCount - removedCount;
+}
+
+- (NSUInteger)termCount
+{
+	return [terms count];
+}
+
+
+
+#pragma mark - Indexing
+/**
+ *  Calls the block with the folded words of the text, numbered by position.
+ */
+- (void)tokenizeString:(NSString *)text language:(NSString *)language usingBlock:(void (^)(NSString *word, uint32_t position))block
+{
+	NSString *key = language ? [language lowercaseString] : @"";
+	CFStringTokenizerRef tokenizer = (__bridge CFStringTokenizerRef)[tokenizers objectForKey:key];
+	if (NULL == tokenizer) {
+		CFLocaleRef locale = language ? CFLocaleCreate(NULL, (__bridge CFStringRef)language) : NULL;
+		tokenizer = CFStringTokenizerCreate(NULL, (__bridge CFStringRef)text, CFRangeMake(0, [text length]), kCFStringTokenizerUnitWord, locale);
+		if (locale) {
+			CFRelease(locale);
+		}
+		[tokenizers setObject:(__bridge_transfer id)tokenizer forKey:key];
+	}
+	else {
+		CFStringTokenizerSetString(tokenizer, (__bridge CFStringRef)text, CFRangeMake(0, [text length]));
+	}
+	
+	NSCharacterSet *alphanumerics = [NSCharacterSet alphanumericCharacterSet];
+	uint32_t position = 0;
+	while (kCFStringTokenizerTokenNone != CFStringTokenizerAdvanceToNextToken(tokenizer)) {
+		CFRange range = CFStringTokenizerGetCurrentTokenRange(tokenizer);
+		NSMutableString *word = [[text substringWithRange:NSMakeRange(range.location, range.length)] mutableCopy];
+		if (NSNotFound == [word rangeOfCharacterFromSet:alphanumerics].location) {
+			continue;
+		}
+		CFStringFold((__bridge CFMutableStringRef)word, kCFCompareCaseInsensitive | kCFCompareDiacriticInsensitive | kCFCompareWidthInsensitive, NULL);
+		block(word, position++);
+	}
+}
+
+- (void)indexStatement:(librdf_statement *)statement
+{
+	librdf_node *object = librdf_statement_get_object(statement);
+	if (NULL == object || !librdf_node_is_literal(object) || CFDictionaryContainsKey(documentIDs, statement)) {
+		return;
+	}
+	const char *value = (const char *)librdf_node_get_literal_value(object);
+	NSString *text = value ? [[NSString alloc] initWithUTF8String:value] : nil;
+	if (nil == text) {
+		return;
+	}
+	const char *language = librdf_node_get_literal_value_language(object);
+	
+	if (documentCount == documentCapacity) {
+		documentCapacity = documentCapacity ? 2 * documentCapacity : 64;
+		documents = reallocf(documents, documentCapacity * sizeof(RedlandTextDocument));
+		if (NULL == documents) {
+			[NSException raise:NSMallocException format:@"Out of memory growing the text index"];
+		}
+	}
+	uint32_t document = (uint32_t)documentCount++;
+	librdf_statement *copy = librdf_new_statement_from_statement(statement);
+	documents[document].statement = copy;
+	
+	__block uint32_t length = 0;
+	[self tokenizeString:text language:(language ? [NSString stringWithUTF8String:language] : nil) usingBlock:^(NSString *word, uint32_t position) {
+		RedlandTextPostings *postings = [terms objectForKey:word];
+		if (nil == postings) {
+			postings = [RedlandTextPostings new];
+			[terms setObject:postings forKey:word];
+			if (building) {
+				[sortedTerms addObject:word];
+			}
+			else {
+				NSUInteger index = [sortedTerms indexOfObject:word
+												inSortedRange:NSMakeRange(0, [sortedTerms count])
+													  options:NSBinarySearchingInsertionIndex
+											  usingComparator:^NSComparisonResult(NSString *a, NSString *b) { return [a compare:b]; }];
+				[sortedTerms insertObject:word atIndex:index];
+			}
+		}
+		[postings addDocument:document position:position];
+		length = position + 1;
+	}];
+	documents[document].length = length;
+	totalLength += length;
+	CFDictionarySetValue(documentIDs, copy, (const void *)(uintptr_t)document);
+}
+
+- (void)unindexStatement:(librdf_statement *)statement
+{
+	const void *value = NULL;
+	if (!CFDictionaryGetValueIfPresent(documentIDs, statement, &value)) {
+		return;
+	}
+	
+	// the statement may still be in the model in another context
+	if (RedlandModelContainsStatement([_model wrappedModel], statement, NULL)) {
+		return;
+	}
+	uint32_t document = (uint32_t)(uintptr_t)value;
+	CFDictionaryRemoveValue(documentIDs, statement);
+	librdf_free_statement(documents[document].statement);
+	documents[document].statement = NULL;
+	totalLength -= documents[document].length;
+	removedCount++;
+	
+	if (removedCount >= REDLAND_TEXT_COMPACTION_MINIMUM && removedCount > documentCount - removedCount) {
+		[self compact];
+	}
+}
+
+/**
+ *  Drops removed documents, renumbering the remaining ones in order so the postings stay sorted.
+ */
+- (void)compact
+{
+	uint32_t *numbers = malloc(documentCount * sizeof(uint32_t));
+	if (NULL == numbers) {
+		return;
+	}
+	NSUInteger live = 0;
+	for (NSUInteger i = 0; i < documentCount; i++) {
+		if (documents[i].statement) {
+			numbers[i] = (uint32_t)live;
+			documents[live] = documents[i];
+			CFDictionarySetValue(documentIDs, documents[live].statement, (const void *)(uintptr_t)live);
+			live++;
+		}
+		else {
+			numbers[i] = UINT32_MAX;
+		}
+	}
+	
+	NSMutableArray *unused = [NSMutableArray array];
+	[terms enumerateKeysAndObjectsUsingBlock:^(NSString *word, RedlandTextPostings *postings, BOOL *stop) {
+		NSUInteger kept = 0;
+		NSUInteger frequency = 0;
+		for (NSUInteger i = 0; i < postings->count; i++) {
+			uint32_t number = numbers[postings->entries[2 * i]];
+			if (UINT32_MAX != number) {
+				if (0 == kept || postings->entries[2 * (kept - 1)] != number) {
+					frequency++;
+				}
+				postings->entries[2 * kept] = number;
+				postings->entries[2 * kept + 1] = postings->entries[2 * i + 1];
+				kept++;
+			}
+		}
+		postings->count = kept;
+		postings->documentFrequency = frequency;
+		if (0 == kept) {
+			[unused addObject:word];
+		}
+	}];
+	free(numbers);
+	
+	if ([unused count] > 0) {
+		[terms removeObjectsForKeys:unused];
+		NSIndexSet *stale = [sortedTerms indexesOfObjectsPassingTest:^BOOL(NSString *word, NSUInteger idx, BOOL *stop) {
+			return (nil == [terms objectForKey:word]);
+		}];
+		[sortedTerms removeObjectsAtIndexes:stale];
+	}
+	documentCount = live;
+	removedCount = 0;
+}
+
+- (void)applyChanges:(RedlandChangeSet *)changes
+{
+	[changes enumerateChangesUsingBlock:^(RedlandStatement *statement, RedlandNode *context, BOOL added, BOOL *stop) {
+		if (added) {
+			[self indexStatement:[statement wrappedStatement]];
+		}
+		else {
+			[self unindexStatement:[statement wrappedStatement]];
+		}
+	}];
+}
+
+
+
+#pragma mark - Querying
+/**
+ *  Finds the literal statements matching a text query.
+ *  @param query The words to search for; it is tokenized and folded like the literals
+ *  @param queryType How the words are matched
+ *  @param language If given, only literals with this language tag or one of its subtags match
+ *  @param limit The maximum number of matches to return, 0 for all
+ *  @return An array of RedlandTextMatch instances, best match first
+ */
+- (NSArray *)matchesForQuery:(NSString *)query type:(RedlandTextQueryType)queryType language:(NSString *)language limit:(NSUInteger)limit
+{
+	NSParameterAssert(query != nil);
+	
+	NSMutableArray *words = [NSMutableArray array];
+	[self tokenizeString:query language:language usingBlock:^(NSString *word, uint32_t position) {
+		[words addObject:word];
+	}];
+	NSUInteger live = documentCount - removedCount;
+	if (0 == [words count] || 0 == live) {
+		return @[];
+	}
+	
+	// intersect the documents of all words, summing up their scores
+	double averageLength = (double)totalLength / live;
+	RedlandTextHit *hits = NULL;
+	NSUInteger hitCount = 0;
+	for (NSUInteger w = 0; w < [words count]; w++) {
+		NSString *word = [words objectAtIndex:w];
+		NSArray *expansion = nil;
+		if (RedlandTextQueryPrefix == queryType && w + 1 == [words count]) {
+			expansion = [self termsWithPrefix:word];
+		}
+		else {
+			expansion = [terms objectForKey:word] ? @[word] : @[];
+		}
+		
+		NSUInteger wordHitCount = 0;
+		RedlandTextHit *wordHits = [self hitsForTerms:expansion averageLength:averageLength count:&wordHitCount];
+		if (0 == w) {
+			hits = wordHits;
+			hitCount = wordHitCount;
+		}
+		else {
+			NSUInteger i = 0, j = 0, kept = 0;
+			while (i < hitCount && j < wordHitCount) {
+				if (hits[i].document < wordHits[j].document) {
+					i++;
+				}
+				else if (hits[i].document > wordHits[j].document) {
+					j++;
+				}
+				else {
+					hits[kept].document = hits[i].document;
+					hits[kept].score = hits[i].score + wordHits[j].score;
+					kept++; i++; j++;
+				}
+			}
+			hitCount = kept;
+			free(wordHits);
+		}
+		if (0 == hitCount) {
+			break;
+		}
+	}
+	
+	// drop removed documents, other languages and, for phrases, documents without the words in sequence
+	const char *languageTag = [language UTF8String];
+	NSUInteger kept = 0;
+	for (NSUInteger i = 0; i < hitCount; i++) {
+		librdf_statement *statement = documents[hits[i].document].statement;
+		if (NULL == statement
+			|| (languageTag && !RedlandTextLanguageMatches(librdf_statement_get_object(statement), languageTag))
+			|| (RedlandTextQueryPhrase == queryType && [words count] > 1 && ![self document:hits[i].document containsPhrase:words])) {
+			continue;
+		}
+		hits[kept++] = hits[i];
+	}
+	hitCount = kept;
+	
+	if (limit > 0 && limit < hitCount) {
+		[self selectBestHits:hits count:hitCount limit:limit];
+		hitCount = limit;
+	}
+	qsort(hits, hitCount, sizeof(RedlandTextHit), RedlandTextHitCompareScores);
+	
+	NSMutableArray *matches = [NSMutableArray arrayWithCapacity:hitCount];
+	for (NSUInteger i = 0; i < hitCount; i++) {
+		[matches addObject:[[RedlandTextMatch alloc] initWithStatement:documents[hits[i].document].statement score:hits[i].score]];
+	}
+	free(hits);
+	return matches;
+}
+
+/**
+ *  The indexed words starting with the prefix, at most REDLAND_TEXT_PREFIX_EXPANSION_LIMIT of them, shortest first.
+ */
+- (NSArray *)termsWithPrefix:(NSString *)prefix
+{
+	NSUInteger count = [sortedTerms count];
+	NSUInteger index = [sortedTerms indexOfObject:prefix
+									inSortedRange:NSMakeRange(0, count)
+										  options:NSBinarySearchingInsertionIndex | NSBinarySearchingFirstEqual
+								  usingComparator:^NSComparisonResult(NSString *a, NSString *b) { return [a compare:b]; }];
+	NSMutableArray *expansion = [NSMutableArray array];
+	for (; index < count; index++) {
+		NSString *word = [sortedTerms objectAtIndex:index];
+		if (![word hasPrefix:prefix]) {
+			break;
+		}
+		[expansion addObject:word];
+	}
+	if ([expansion count] > REDLAND_TEXT_PREFIX_EXPANSION_LIMIT) {
+		[expansion sortUsingComparator:^NSComparisonResult(NSString *a, NSString *b) {
+			return ([a length] < [b length]) ? NSOrderedAscending : (([a length] > [b length]) ? NSOrderedDescending : [a compare:b]);
+		}];
+		[expansion removeObjectsInRange:NSMakeRange(REDLAND_TEXT_PREFIX_EXPANSION_LIMIT, [expansion count] - REDLAND_TEXT_PREFIX_EXPANSION_LIMIT)];
+	}
+	return expansion;
+}
+
+/**
+ *  The documents containing any of the words, ordered by document, scored with BM25 for the best matching word.
+ *  @return A malloc'ed array the caller must free
+ */
+- (RedlandTextHit *)hitsForTerms:(NSArray *)words averageLength:(double)averageLength count:(NSUInteger *)outCount
+{
+	NSUInteger capacity = 0;
+	for (NSString *word in words) {
+		capacity += ((RedlandTextPostings *)[terms objectForKey:word])->documentFrequency;
+	}
+	RedlandTextHit *hits = malloc(MAX(capacity, 1) * sizeof(RedlandTextHit));
+	if (NULL == hits) {
+		[NSException raise:NSMallocException format:@"Out of memory evaluating a text query"];
+	}
+	
+	NSUInteger count = 0;
+	double documentTotal = (double)(documentCount - removedCount);
+	for (NSString *word in words) {
+		RedlandTextPostings *postings = [terms objectForKey:word];
+		double frequency = (double)postings->documentFrequency;
+		double idf = log(1.0 + (documentTotal - frequency + 0.5) / (frequency + 0.5));
+		NSUInteger i = 0;
+		while (i < postings->count) {
+			uint32_t document = postings->entries[2 * i];
+			NSUInteger occurrences = 0;
+			while (i < postings->count && postings->entries[2 * i] == document) {
+				occurrences++;
+				i++;
+			}
+			double tf = (double)occurrences;
+			double norm = REDLAND_TEXT_BM25_K1 * (1.0 - REDLAND_TEXT_BM25_B + REDLAND_TEXT_BM25_B * documents[document].length / averageLength);
+			hits[count].document = document;
+			hits[count].score = idf * tf * (REDLAND_TEXT_BM25_K1 + 1.0) / (tf + norm);
+			count++;
+		}
+	}
+	
+	// several words of a prefix may occur in the same document
+	if ([words count] > 1) {
+		qsort(hits, count, sizeof(RedlandTextHit), RedlandTextHitCompareDocuments);
+		NSUInteger unique = 0;
+		for (NSUInteger i = 0; i < count; i++) {
+			if (unique > 0 && hits[unique - 1].document == hits[i].document) {
+				hits[unique - 1].score = MAX(hits[unique - 1].score, hits[i].score);
+			}
+			else {
+				hits[unique++] = hits[i];
+			}
+		}
+		count = unique;
+	}
+	*outCount = count;
+	return hits;
+}
+
+/**
+ *  Whether the words occur in the document at consecutive positions.
+ */
+- (BOOL)document:(uint32_t)document containsPhrase:(NSArray *)words
+{
+	NSUInteger wordCount = [words count];
+	NSRange ranges[wordCount];
+	__unsafe_unretained RedlandTextPostings *postings[wordCount];
+	for (NSUInteger w = 0; w < wordCount; w++) {
+		postings[w] = [terms objectForKey:[words objectAtIndex:w]];
+		ranges[w] = [postings[w] rangeOfDocument:document];
+		if (0 == ranges[w].length) {
+			return NO;
+		}
+	}
+	
+	for (NSUInteger i = ranges[0].location; i < NSMaxRange(ranges[0]); i++) {
+		uint32_t start = postings[0]->entries[2 * i + 1];
+		BOOL found = YES;
+		for (NSUInteger w = 1; w < wordCount && found; w++) {
+			found = NO;
+			for (NSUInteger j = ranges[w].location; j < NSMaxRange(ranges[w]); j++) {
+				if (postings[w]->entries[2 * j + 1] == start + w) {
+					found = YES;
+					break;
+				}
+			}
+		}
+		if (found) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+/**
+ *  Moves the limit best hits to the front of the array, in no particular order, using a min-heap of the best hits seen so far.
+ */
+- (void)selectBestHits:(RedlandTextHit *)hits count:(NSUInteger)count limit:(NSUInteger)limit
+{
+	// the heap occupies hits[0..limit), its root is the worst of the best hits
+	for (NSUInteger i = limit / 2; i-- > 0; ) {
+		RedlandTextHitSiftDown(hits, i, limit);
+	}
+	for (NSUInteger i = limit; i < count; i++) {
+		if (RedlandTextHitCompareScores(&hits[i], &hits[0]) < 0) {
+			hits[0] = hits[i];
+			RedlandTextHitSiftDown(hits, 0, limit);
+		}
+	}
+}
+
+
+@end
@@ -0,0 +1,59 @@
+//
+//  RedlandUnionModel.h
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandModel.h"
+
+@class RedlandNode;
+
+extern NSString * const RedlandUnionStorageFactoryName;			///< The factory name of the storage behind RedlandUnionModel, "union"
+
+extern void RedlandUnionStorageRegisterFactory(librdf_world *world);
+
+
+/**
+ *  A read-only view of the union of several models, without copying any statements.
+ *
+ *  The union model is backed by a storage module that forwards every find, iterator and context lookup to the member models when it is read, one member
+ *  after the other, so SPARQL queries, graph patterns and enumerators work across all members just like on a single model. Each member is exposed as
+ *  a context of the union: finding statements in that context only asks the member, and the contexts of the members themselves are not visible.
+ *
+ *  With deduplicates set, a statement present in several members is returned once, for the first member containing it; this costs one lookup in each
+ *  earlier member per statement. Without it, which is the default, statements are returned once per member containing them and size is simply the sum
+ *  of the members' sizes.
+ *
+ *  The union cannot be modified directly, change the member models instead. The union's version changes whenever one of the member's versions does,
+ *  so RedlandQueryCache notices changes; a description cache of the union is not told about changes of the members, though.
+ */
+@interface RedlandUnionModel : RedlandModel
+
+@property (nonatomic, readonly, copy) NSArray *models;					///< The member models, in the order they are read
+@property (nonatomic, assign) BOOL deduplicates;						///< Whether statements in several members are returned only once, NO by default
+
+- (id)initWithModels:(NSArray *)models;
+
+- (void)addModel:(RedlandModel *)model withContext:(RedlandNode *)contextNode;
+- (void)removeModel:(RedlandModel *)model;
+- (RedlandNode *)contextOfModel:(RedlandModel *)model;
+- (RedlandModel *)modelWithContext:(RedlandNode *)contextNode;
+
+
+@end
@@ -0,0 +1,839 @@
+//
+//  RedlandUnionModel.m
+//  Redland Objective-C Bindings
+//
+//	Copyright 2012 Pascal Pfiffner <http://www.chip.org/>
+//
+//  This file is available under the following three licenses:
+//   1. GNU Lesser General Public License (LGPL), version 2.1
+//   2. GNU General Public License (GPL), version 2
+//   3. Apache License, version 2.0
+//
+//  You may not use this file except in compliance with at least one of
+//  the above three licenses. See LICENSE.txt at the top of this package
+//  for the complete terms and further details.
+//
+//  The most recent version of this software can be found here:
+//  <https://github.com/p2/Redland-ObjC>
+//
+//  For information about the Redland RDF Application Framework, including
+//  the most recent version, see <http://librdf.org/>.
+//
+
+#import "RedlandUnionModel.h"
+#import <pthread.h>
+#import "RedlandWorld.h"
+#import "RedlandStorage.h"
+#import "RedlandNode.h"
+#import "RedlandException.h"
+
+NSString * const RedlandUnionStorageFactoryName = @"union";
+
+
+typedef struct {
+	CFTypeRef owner;									// the RedlandModel, retained so the librdf model stays alive
+	librdf_model *model;
+	librdf_node *context;								// the context the member is exposed as
+} RedlandUnionMember;
+
+typedef struct {
+	pthread_mutex_t lock;								// guards the member list; readers copy the list and read the members without it
+	librdf_world *world;
+	RedlandUnionMember *members;
+	size_t count;
+	BOOL deduplicates;
+} RedlandUnionStorageInstance;
+
+typedef enum {
+	RedlandUnionSources,
+	RedlandUnionArcs,
+	RedlandUnionTargets,
+	RedlandUnionArcsIn,
+	RedlandUnionArcsOut
+} RedlandUnionNodeKind;
+
+
+#pragma mark - Members
+static RedlandUnionStorageInstance *RedlandUnionInstance(librdf_storage *storage)
+{
+	return (RedlandUnionStorageInstance *)librdf_storage_get_instance(storage);
+}
+
+static void RedlandUnionMembersFree(RedlandUnionMember *members, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		CFRelease(members[i].owner);
+		librdf_free_node(members[i].context);
+	}
+	free(members);
+}
+
+/**
+ *  Copies the member list, or only the member exposed as the given context, so it can be read without holding the lock.
+ *  @return The members, NULL if there are none
+ */
+static RedlandUnionMember *RedlandUnionMembersCopy(RedlandUnionStorageInstance *instance, librdf_node *context, size_t *count)
+{
+	*count = 0;
+	pthread_mutex_lock(&instance->lock);
+	RedlandUnionMember *members = calloc(MAX(instance->count, 1), sizeof(RedlandUnionMember));
+	for (size_t i = 0; members && i < instance->count; i++) {
+		if (context && !librdf_node_equals(context, instance->members[i].context)) {
+			continue;
+		}
+		members[*count] = instance->members[i];
+		CFRetain(members[*count].owner);
+		members[*count].context = librdf_new_node_from_node(members[*count].context);
+		(*count)++;
+	}
+	pthread_mutex_unlock(&instance->lock);
+	if (members && 0 == *count) {
+		free(members);
+		members = NULL;
+	}
+	return members;
+}
+
+/**
+ *  Whether a member before the given one contains the statement, in which case deduplicating streams skip it.
+ */
+static BOOL RedlandUnionEarlierMemberContains(RedlandUnionMember *members, size_t position, librdf_statement *statement)
+{
+	for (size_t i = 0; i < position; i++) {
+		if (librdf_model_contains_statement(members[i].model, statement) > 0) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+
+
+#pragma mark - Statement Streams
+/// A stream reading the matching statements of one member after the other
+typedef struct {
+	RedlandUnionMember *members;
+	size_t count;
+	size_t position;									// the member currently read
+	librdf_stream *stream;								// the stream of that member, opened when the previous one ends
+	librdf_statement *pattern;							// NULL for all statements
+	BOOL deduplicates;
+} RedlandUnionStream;
+
+/**
+ *  Moves on to the next member until the current stream has a statement to return.
+ */
+static void RedlandUnionStreamSettle(RedlandUnionStream *reader)
+{
+	while (reader->position < reader->count) {
+		if (!reader->stream) {
+			librdf_model *model = reader->members[reader->position].model;
+			reader->stream = reader->pattern ? librdf_model_find_statements(model, reader->pattern) : librdf_model_as_stream(model);
+		}
+		while (reader->stream && !librdf_stream_end(reader->stream)) {
+			if (!reader->deduplicates || 0 == reader->position
+				|| !RedlandUnionEarlierMemberContains(reader->members, reader->position, librdf_stream_get_object(reader->stream))) {
+				return;
+			}
+			librdf_stream_next(reader->stream);
+		}
+		if (reader->stream) {
+			librdf_free_stream(reader->stream);
+			reader->stream = NULL;
+		}
+		reader->position++;
+	}
+}
+
+static int RedlandUnionStreamIsEnd(void *context)
+{
+	return (((RedlandUnionStream *)context)->position >= ((RedlandUnionStream *)context)->count);
+}
+
+static int RedlandUnionStreamNext(void *context)
+{
+	RedlandUnionStream *reader = context;
+	if (reader->stream) {
+		librdf_stream_next(reader->stream);
+		RedlandUnionStreamSettle(reader);
+	}
+	return RedlandUnionStreamIsEnd(context);
+}
+
+static void *RedlandUnionStreamGet(void *context, int flags)
+{
+	RedlandUnionStream *reader = context;
+	if (!reader->stream || reader->position >= reader->count) {
+		return NULL;
+	}
+	if (LIBRDF_STREAM_GET_METHOD_GET_OBJECT == flags) {
+		return librdf_stream_get_object(reader->stream);
+	}
+	if (LIBRDF_STREAM_GET_METHOD_GET_CONTEXT == flags) {
+		return reader->members[reader->position].context;
+	}
+	return NULL;
+}
+
+static void RedlandUnionStreamFree(void *context)
+{
+	RedlandUnionStream *reader = context;
+	if (reader->stream) {
+		librdf_free_stream(reader->stream);
+	}
+	if (reader->pattern) {
+		librdf_free_statement(reader->pattern);
+	}
+	RedlandUnionMembersFree(reader->members, reader->count);
+	free(reader);
+}
+
+/**
+ *  Creates a stream over the statements matching the pattern in all members, or only in the member exposed as the given context.
+ */
+static librdf_stream *RedlandUnionNewStream(RedlandUnionStorageInstance *instance, librdf_statement *statement, librdf_node *context)
+{
+	size_t count = 0;
+	RedlandUnionMember *members = RedlandUnionMembersCopy(instance, context, &count);
+	if (!members) {
+		return librdf_new_empty_stream(instance->world);
+	}
+	RedlandUnionStream *reader = calloc(1, sizeof(RedlandUnionStream));
+	if (!reader) {
+		RedlandUnionMembersFree(members, count);
+		return NULL;
+	}
+	reader->members = members;
+	reader->count = count;
+	reader->deduplicates = instance->deduplicates && !context;
+	reader->pattern = statement ? librdf_new_statement_from_statement(statement) : NULL;
+	RedlandUnionStreamSettle(reader);
+	
+	librdf_stream *stream = librdf_new_stream(instance->world, reader, &RedlandUnionStreamIsEnd, &RedlandUnionStreamNext, &RedlandUnionStreamGet, &RedlandUnionStreamFree);
+	if (!stream) {
+		RedlandUnionStreamFree(reader);
+	}
+	return stream;
+}
+
+
+
+#pragma mark - Node Iterators
+/// An iterator reading the matching nodes of one member after the other
+typedef struct {
+	RedlandUnionMember *members;
+	size_t count;
+	size_t position;
+	librdf_iterator *iterator;
+	RedlandUnionNodeKind kind;
+	librdf_node *nodes[2];								// the given nodes, in the order of the librdf_model call
+	CFMutableSetRef seen;								// nodes already returned when deduplicating, NULL otherwise
+} RedlandUnionIterator;
+
+static librdf_iterator *RedlandUnionMemberIterator(RedlandUnionIterator *reader, librdf_model *model)
+{
+	switch (reader->kind) {
+		case RedlandUnionSources:
+			return librdf_model_get_sources(model, reader->nodes[0], reader->nodes[1]);
+		case RedlandUnionArcs:
+			return librdf_model_get_arcs(model, reader->nodes[0], reader->nodes[1]);
+		case RedlandUnionTargets:
+			return librdf_model_get_targets(model, reader->nodes[0], reader->nodes[1]);
+		case RedlandUnionArcsIn:
+			return librdf_model_get_arcs_in(model, reader->nodes[0]);
+		case RedlandUnionArcsOut:
+			return librdf_model_get_arcs_out(model, reader->nodes[0]);
+	}
+	return NULL;
+}
+
+static void RedlandUnionIteratorSettle(RedlandUnionIterator *reader)
+{
+	while (reader->position < reader->count) {
+		if (!reader->iterator) {
+			reader->iterator = RedlandUnionMemberIterator(reader, reader->members[reader->position].model);
+		}
+		while (reader->iterator && !librdf_iterator_end(reader->iterator)) {
+			librdf_node *node = librdf_iterator_get_object(reader->iterator);
+			if (!reader->seen || !CFSetContainsValue(reader->seen, node)) {
+				if (reader->seen) {
+					CFSetAddValue(reader->seen, node);
+				}
+				return;
+			}
+			librdf_iterator_next(reader->iterator);
+		}
+		if (reader->iterator) {
+			librdf_free_iterator(reader->iterator);
+			reader->iterator = NULL;
+		}
+		reader->position++;
+	}
+}
+
+static int RedlandUnionIteratorIsEnd(void *context)
+{
+	return (((RedlandUnionIterator *)context)->position >= ((RedlandUnionIterator *)context)->count);
+}
+
+static int RedlandUnionIteratorNext(void *context)
+{
+	RedlandUnionIterator *reader = context;
+	if (reader->iterator) {
+		librdf_iterator_next(reader->iterator);
+		RedlandUnionIteratorSettle(reader);
+	}
+	return RedlandUnionIteratorIsEnd(context);
+}
+
+static void *RedlandUnionIteratorGet(void *context, int flags)
+{
+	RedlandUnionIterator *reader = context;
+	if (!reader->iterator || reader->position >= reader->count) {
+		return NULL;
+	}
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT == flags) {
+		return librdf_iterator_get_object(reader->iterator);
+	}
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_CONTEXT == flags) {
+		return reader->members[reader->position].context;
+	}
+	return NULL;
+}
+
+static void RedlandUnionIteratorFree(void *context)
+{
+	RedlandUnionIterator *reader = context;
+	if (reader->iterator) {
+		librdf_free_iterator(reader->iterator);
+	}
+	for (int i = 0; i < 2; i++) {
+		if (reader->nodes[i]) {
+			librdf_free_node(reader->nodes[i]);
+		}
+	}
+	if (reader->seen) {
+		CFRelease(reader->seen);
+	}
+	RedlandUnionMembersFree(reader->members, reader->count);
+	free(reader);
+}
+
+static librdf_iterator *RedlandUnionNewIterator(RedlandUnionStorageInstance *instance, RedlandUnionNodeKind kind, librdf_node *first, librdf_node *second)
+{
+	size_t count = 0;
+	RedlandUnionMember *members = RedlandUnionMembersCopy(instance, NULL, &count);
+	if (!members) {
+		return librdf_new_empty_iterator(instance->world);
+	}
+	RedlandUnionIterator *reader = calloc(1, sizeof(RedlandUnionIterator));
+	if (!reader) {
+		RedlandUnionMembersFree(members, count);
+		return NULL;
+	}
+	reader->members = members;
+	reader->count = count;
+	reader->kind = kind;
+	reader->nodes[0] = first ? librdf_new_node_from_node(first) : NULL;
+	reader->nodes[1] = second ? librdf_new_node_from_node(second) : NULL;
+	if (instance->deduplicates) {
+		reader->seen = CFSetCreateMutable(kCFAllocatorDefault, 0, &RedlandNodeSetCallBacks);
+	}
+	RedlandUnionIteratorSettle(reader);
+	
+	librdf_iterator *iterator = librdf_new_iterator(instance->world, reader, &RedlandUnionIteratorIsEnd, &RedlandUnionIteratorNext, &RedlandUnionIteratorGet, &RedlandUnionIteratorFree);
+	if (!iterator) {
+		RedlandUnionIteratorFree(reader);
+	}
+	return iterator;
+}
+
+
+
+#pragma mark - Context Iterator
+typedef struct {
+	RedlandUnionMember *members;
+	size_t count;
+	size_t position;
+} RedlandUnionContextList;
+
+static int RedlandUnionContextListIsEnd(void *context)
+{
+	return (((RedlandUnionContextList *)context)->position >= ((RedlandUnionContextList *)context)->count);
+}
+
+static int RedlandUnionContextListNext(void *context)
+{
+	RedlandUnionContextList *list = context;
+	if (list->position < list->count) {
+		list->position++;
+	}
+	return RedlandUnionContextListIsEnd(context);
+}
+
+static void *RedlandUnionContextListGet(void *context, int flags)
+{
+	RedlandUnionContextList *list = context;
+	if (LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT != flags || list->position >= list->count) {
+		return NULL;
+	}
+	return list->members[list->position].context;
+}
+
+static void RedlandUnionContextListFree(void *context)
+{
+	RedlandUnionContextList *list = context;
+	RedlandUnionMembersFree(list->members, list->count);
+	free(list);
+}
+
+
+
+#pragma mark - Storage Module
+static int RedlandUnionInit(librdf_storage *storage, const char *name, librdf_hash *options)
+{
+	if (options) {
+		librdf_free_hash(options);
+	}
+	RedlandUnionStorageInstance *instance = calloc(1, sizeof(RedlandUnionStorageInstance));
+	if (!instance) {
+		return 1;
+	}
+	if (0 != pthread_mutex_init(&instance->lock, NULL)) {
+		free(instance);
+		return 1;
+	}
+	instance->world = [RedlandWorld defaultWrappedWorld];
+	librdf_storage_set_instance(storage, instance);
+	return 0;
+}
+
+static void RedlandUnionTerminate(librdf_storage *storage)
+{
+	RedlandUnionStorageInstance *instance = RedlandUnionInstance(storage);
+	if (!instance) {
+		return;
+	}
+	RedlandUnionMembersFree(instance->members, instance->count);
+	pthread_mutex_destroy(&instance->lock);
+	free(instance);
+	librdf_storage_set_instance(storage, NULL);
+}
+
+static int RedlandUnionOpen(librdf_storage *storage, librdf_model *model)
+{
+	return 0;
+}
+
+static int RedlandUnionClose(librdf_storage *storage)
+{
+	return 0;
+}
+
+static librdf_stream *RedlandUnionSerialise(librdf_storage *storage)
+{
+	return RedlandUnionNewStream(RedlandUnionInstance(storage), NULL, NULL);
+}
+
+static int RedlandUnionSize(librdf_storage *storage)
+{
+	RedlandUnionStorageInstance *instance = RedlandUnionInstance(storage);
+	if (instance->deduplicates) {
+		librdf_stream *stream = RedlandUnionSerialise(storage);
+		int size = 0;
+		while (stream && !librdf_stream_end(stream)) {
+			size++;
+			librdf_stream_next(stream);
+		}
+		if (stream) {
+			librdf_free_stream(stream);
+		}
+		return stream ? size : -1;
+	}
+	
+	size_t count = 0;
+	RedlandUnionMember *members = RedlandUnionMembersCopy(instance, NULL, &count);
+	int size = 0;
+	for (size_t i = 0; i < count; i++) {
+		int memberSize = librdf_model_size(members[i].model);
+		if (memberSize < 0) {
+			size = -1;
+			break;
+		}
+		size += memberSize;
+	}
+	if (members) {
+		RedlandUnionMembersFree(members, count);
+	}
+	return size;
+}
+
+/**
+ *  The union is read only, all changes fail.
+ */
+static int RedlandUnionAddStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return 1;
+}
+
+static int RedlandUnionRemoveStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	return 1;
+}
+
+static int RedlandUnionContextAddStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	return 1;
+}
+
+static int RedlandUnionContextRemoveStatement(librdf_storage *storage, librdf_node *context, librdf_statement *statement)
+{
+	return 1;
+}
+
+static int RedlandUnionContextRemoveStatements(librdf_storage *storage, librdf_node *context)
+{
+	return 1;
+}
+
+static int RedlandUnionContainsStatement(librdf_storage *storage, librdf_statement *statement)
+{
+	size_t count = 0;
+	RedlandUnionMember *members = RedlandUnionMembersCopy(RedlandUnionInstance(storage), NULL, &count);
+	int contains = 0;
+	for (size_t i = 0; i < count && !contains; i++) {
+		contains = (librdf_model_contains_statement(members[i].model, statement) > 0);
+	}
+	if (members) {
+		RedlandUnionMembersFree(members, count);
+	}
+	return contains;
+}
+
+static int RedlandUnionHasArc(librdf_storage *storage, librdf_node *node, librdf_node *property, BOOL incoming)
+{
+	size_t count = 0;
+	RedlandUnionMember *members = RedlandUnionMembersCopy(RedlandUnionInstance(storage), NULL, &count);
+	int hasArc = 0;
+	for (size_t i = 0; i < count && !hasArc; i++) {
+		hasArc = incoming ? librdf_model_has_arc_in(members[i].model, node, property) : librdf_model_has_arc_out(members[i].model, node, property);
+	}
+	if (members) {
+		RedlandUnionMembersFree(members, count);
+	}
+	return hasArc;
+}
+
+static int RedlandUnionHasArcIn(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	return RedlandUnionHasArc(storage, node, property, YES);
+}
+
+static int RedlandUnionHasArcOut(librdf_storage *storage, librdf_node *node, librdf_node *property)
+{
+	return RedlandUnionHasArc(storage, node, property, NO);
+}
+
+static librdf_stream *RedlandUnionFindStatements(librdf_storage *storage, librdf_statement *statement)
+{
+	return RedlandUnionNewStream(RedlandUnionInstance(storage), statement, NULL);
+}
+
+static librdf_stream *RedlandUnionContextSerialise(librdf_storage *storage, librdf_node *context)
+{
+	return RedlandUnionNewStream(RedlandUnionInstance(storage), NULL, context);
+}
+
+static librdf_stream *RedlandUnionFindStatementsInContext(librdf_storage *storage, librdf_statement *statement, librdf_node *context)
+{
+	return RedlandUnionNewStream(RedlandUnionInstance(storage), statement, context);
+}
+
+static librdf_iterator *RedlandUnionFindSources(librdf_storage *storage, librdf_node *arc, librdf_node *target)
+{
+	return RedlandUnionNewIterator(RedlandUnionInstance(storage), RedlandUnionSources, arc, target);
+}
+
+static librdf_iterator *RedlandUnionFindArcs(librdf_storage *storage, librdf_node *source, librdf_node *target)
+{
+	return RedlandUnionNewIterator(RedlandUnionInstance(storage), RedlandUnionArcs, source, target);
+}
+
+static librdf_iterator *RedlandUnionFindTargets(librdf_storage *storage, librdf_node *source, librdf_node *arc)
+{
+	return RedlandUnionNewIterator(RedlandUnionInstance(storage), RedlandUnionTargets, source, arc);
+}
+
+static librdf_iterator *RedlandUnionGetArcsIn(librdf_storage *storage, librdf_node *node)
+{
+	return RedlandUnionNewIterator(RedlandUnionInstance(storage), RedlandUnionArcsIn, node, NULL);
+}
+
+static librdf_iterator *RedlandUnionGetArcsOut(librdf_storage *storage, librdf_node *node)
+{
+	return RedlandUnionNewIterator(RedlandUnionInstance(storage), RedlandUnionArcsOut, node, NULL);
+}
+
+static librdf_iterator *RedlandUnionGetContexts(librdf_storage *storage)
+{
+	RedlandUnionStorageInstance *instance = RedlandUnionInstance(storage);
+	RedlandUnionContextList *list = calloc(1, sizeof(RedlandUnionContextList));
+	if (!list) {
+		return NULL;
+	}
+	list->members = RedlandUnionMembersCopy(instance, NULL, &list->count);
+	librdf_iterator *iterator = librdf_new_iterator(instance->world, list, &RedlandUnionContextListIsEnd, &RedlandUnionContextListNext, &RedlandUnionContextListGet, &RedlandUnionContextListFree);
+	if (!iterator) {
+		RedlandUnionContextListFree(list);
+	}
+	return iterator;
+}
+
+static int RedlandUnionSync(librdf_storage *storage)
+{
+	return 0;
+}
+
+static void RedlandUnionStorageFactory(librdf_storage_factory *factory)
+{
+	factory->version = LIBRDF_STORAGE_INTERFACE_VERSION;
+	factory->init = &RedlandUnionInit;
+	factory->terminate = &RedlandUnionTerminate;
+	factory->open = &RedlandUnionOpen;
+	factory->close = &RedlandUnionClose;
+	factory->size = &RedlandUnionSize;
+	factory->add_statement = &RedlandUnionAddStatement;
+	factory->remove_statement = &RedlandUnionRemoveStatement;
+	factory->contains_statement = &RedlandUnionContainsStatement;
+	factory->has_arc_in = &RedlandUnionHasArcIn;
+	factory->has_arc_out = &RedlandUnionHasArcOut;
+	factory->serialise = &RedlandUnionSerialise;
+	factory->find_statements = &RedlandUnionFindStatements;
+	factory->find_sources = &RedlandUnionFindSources;
+	factory->find_arcs = &RedlandUnionFindArcs;
+	factory->find_targets = &RedlandUnionFindTargets;
+	factory->get_arcs_in = &RedlandUnionGetArcsIn;
+	factory->get_arcs_out = &RedlandUnionGetArcsOut;
+	factory->context_add_statement = &RedlandUnionContextAddStatement;
+	factory->context_remove_statement = &RedlandUnionContextRemoveStatement;
+	factory->context_remove_statements = &RedlandUnionContextRemoveStatements;
+	factory->context_serialise = &RedlandUnionContextSerialise;
+	factory->find_statements_in_context = &RedlandUnionFindStatementsInContext;
+	factory->get_contexts = &RedlandUnionGetContexts;
+	factory->sync = &RedlandUnionSync;
+}
+
+/**
+ *  Registers the union storage factory with the given world. The default world does this when it is created.
+ */
+void RedlandUnionStorageRegisterFactory(librdf_world *world)
+{
+	librdf_storage_register_factory(world, [RedlandUnionStorageFactoryName UTF8String], "Read-only union of other models", &RedlandUnionStorageFactory);
+}
+
+
+
+#pragma mark -
+@interface RedlandUnionModel () {
+	NSMutableArray *models;
+	NSMutableArray *memberVersions;						///< The version of each member when the receiver last looked, as NSNumber
+}
+
+@end
+
+
+@implementation RedlandUnionModel
+
+
+- (id)init
+{
+	return [self initWithModels:nil];
+}
+
+/**
+ *  Designated initializer.
+ *
+ *  Each of the given models is exposed as a context identified by a new blank node, use addModel:withContext: to choose the context yourself.
+ *  @param someModels An array of RedlandModel instances, may be nil
+ */
+- (id)initWithModels:(NSArray *)someModels
+{
+	RedlandStorage *storage = [[RedlandStorage alloc] initWithFactoryName:RedlandUnionStorageFactoryName identifier:nil options:nil];
+	if (nil == [storage wrappedStorage]) {
+		return nil;
+	}
+	if ((self = [super initWithStorage:storage])) {
+		models = [NSMutableArray new];
+		memberVersions = [NSMutableArray new];
+		for (RedlandModel *model in someModels) {
+			[self addModel:model withContext:[RedlandNode nodeWithBlankID:nil]];
+		}
+	}
+	return self;
+}
+
+- (RedlandUnionStorageInstance *)unionInstance
+{
+	return RedlandUnionInstance(librdf_model_get_storage([self wrappedModel]));
+}
+
+
+
+#pragma mark - Members
+- (NSArray *)models
+{
+	@synchronized(self) {
+		return [models copy];
+	}
+}
+
+/**
+ *  Adds a member model, its statements are read after those of the members added before.
+ *  @param model The model to add, must not be a member already
+ *  @param contextNode The context the member is exposed as, must not be used by another member
+ */
+- (void)addModel:(RedlandModel *)model withContext:(RedlandNode *)contextNode
+{
+	NSParameterAssert(model != nil);
+	NSParameterAssert(contextNode != nil);
+	if (model == self) {
+		@throw [RedlandException exceptionWithName:RedlandExceptionName reason:@"A union model cannot be its own member" userInfo:nil];
+	}
+	
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	@synchronized(self) {
+		if ([models containsObject:model] || [self modelWithContext:contextNode]) {
+			@throw [RedlandException exceptionWithName:RedlandExceptionName
+												reason:@"The model or the context already is a member of the union"
+											  userInfo:@{ @"context": contextNode }];
+		}
+		
+		pthread_mutex_lock(&instance->lock);
+		RedlandUnionMember *members = realloc(instance->members, (instance->count + 1) * sizeof(RedlandUnionMember));
+		if (members) {
+			members[instance->count].owner = CFBridgingRetain(model);
+			members[instance->count].model = [model wrappedModel];
+			members[instance->count].context = librdf_new_node_from_node([contextNode wrappedNode]);
+			instance->members = members;
+			instance->count++;
+		}
+		pthread_mutex_unlock(&instance->lock);
+		if (!members) {
+			[NSException raise:NSMallocException format:@"Out of memory adding a model to a union"];
+		}
+		
+		[models addObject:model];
+		[memberVersions addObject:@(model.version)];
+	}
+	[self.descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+}
+
+/**
+ *  Removes a member model. Streams and iterators already created keep reading it.
+ */
+- (void)removeModel:(RedlandModel *)model
+{
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	@synchronized(self) {
+		NSUInteger index = [models indexOfObjectIdenticalTo:model];
+		if (NSNotFound == index) {
+			return;
+		}
+		pthread_mutex_lock(&instance->lock);
+		RedlandUnionMember removed = instance->members[index];
+		memmove(&instance->members[index], &instance->members[index + 1], (instance->count - index - 1) * sizeof(RedlandUnionMember));
+		instance->count--;
+		pthread_mutex_unlock(&instance->lock);
+		CFRelease(removed.owner);
+		librdf_free_node(removed.context);
+		
+		[models removeObjectAtIndex:index];
+		[memberVersions removeObjectAtIndex:index];
+	}
+	[self.descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+}
+
+/**
+ *  Returns the context the given member model is exposed as, nil if it is not a member.
+ */
+- (RedlandNode *)contextOfModel:(RedlandModel *)model
+{
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	RedlandNode *context = nil;
+	@synchronized(self) {
+		NSUInteger index = [models indexOfObjectIdenticalTo:model];
+		if (NSNotFound != index) {
+			pthread_mutex_lock(&instance->lock);
+			context = [[RedlandNode alloc] initWithWrappedObject:librdf_new_node_from_node(instance->members[index].context)];
+			pthread_mutex_unlock(&instance->lock);
+		}
+	}
+	return context;
+}
+
+/**
+ *  Returns the member model exposed as the given context, nil if there is none.
+ */
+- (RedlandModel *)modelWithContext:(RedlandNode *)contextNode
+{
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	RedlandModel *model = nil;
+	@synchronized(self) {
+		pthread_mutex_lock(&instance->lock);
+		for (size_t i = 0; i < instance->count && !model; i++) {
+			if (librdf_node_equals(instance->members[i].context, [contextNode wrappedNode])) {
+				model = [models objectAtIndex:i];
+			}
+		}
+		pthread_mutex_unlock(&instance->lock);
+	}
+	return model;
+}
+
+- (BOOL)deduplicates
+{
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	pthread_mutex_lock(&instance->lock);
+	BOOL deduplicates = instance->deduplicates;
+	pthread_mutex_unlock(&instance->lock);
+	return deduplicates;
+}
+
+- (void)setDeduplicates:(BOOL)deduplicates
+{
+	RedlandUnionStorageInstance *instance = [self unionInstance];
+	pthread_mutex_lock(&instance->lock);
+	instance->deduplicates = deduplicates;
+	pthread_mutex_unlock(&instance->lock);
+	[self.descriptionCache removeAllDescriptions];
+	[self bumpVersion];
+}
+
+
+
+#pragma mark - Versioning
+/**
+ *  Gives the receiver a new version if one of the members changed since the last call.
+ */
+- (uint64_t)version
+{
+	@synchronized(self) {
+		BOOL changed = NO;
+		for (NSUInteger i = 0; i < [models count]; i++) {
+			uint64_t memberVersion = [[models objectAtIndex:i] version];
+			if (memberVersion != [[memberVersions objectAtIndex:i] unsignedLongLongValue]) {
+				[memberVersions replaceObjectAtIndex:i withObject:@(memberVersion)];
+				changed = YES;
+			}
+		}
+		if (changed) {
+			[self bumpVersion];
+		}
+	}
+	return [super version];
+}
+
+
+@end
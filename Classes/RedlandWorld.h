@@ -34,8 +34,13 @@
  *
  *  Wraps librdf_world objects. This framework takes care of creating a RedlandWorld instance for you. There is currently no way to create an instance manually
  *  in this version of the framework, and all operations currently use the default instance.
+ *
+ *  librdf and its parsers and query engines are not thread-safe. RedlandQueryExecutor holds the world's lock while it uses librdf on its worker, and
+ *  -[RedlandQuery executeOnModel:] and the methods advancing RedlandQueryResults take it too, so synchronous and asynchronous queries can run at the
+ *  same time. Other framework calls do not take the lock; see -lock and -unlock, the lock is recursive. Errors reported by librdf are collected per
+ *  thread, so -handleStoredErrors only raises the errors of the calling thread.
  */
-@interface RedlandWorld : RedlandWrappedObject
+@interface RedlandWorld : RedlandWrappedObject <NSLocking>
 
 /// If YES, the receiver will log all Redland errors to the console (in addition to generating exceptions, where appropriate). NO by default.
 @property (nonatomic, assign) BOOL logsErrors;
@@ -45,6 +50,9 @@
 
 - (librdf_world *)wrappedWorld;
 
+- (void)lock;
+- (void)unlock;
+
 - (int)handleLogMessage:(librdf_log_message *)aMessage;
 - (void)handleStoredErrors;
 
@@ -27,6 +27,9 @@
 #import "RedlandException.h"
 #import "RedlandURI.h"
 #import "RedlandNode.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandUnionModel.h"
+#import "RedlandShardedModel.h"
 
 static int redland_log_handler(void *user_data, librdf_log_message *message)
 {
@@ -38,10 +41,12 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 }
 
 
-@interface RedlandWorld ()
+@interface RedlandWorld () {
+	NSRecursiveLock *worldLock;
+}
 
 @property (nonatomic, copy) NSError *lastError;							//< Most recent error
-@property (nonatomic, strong) NSMutableArray *storedErrors;				//< All so far unhandled errors
+@property (nonatomic, readonly) NSMutableArray *storedErrors;			//< All so far unhandled errors of the current thread
 
 @end
 
@@ -49,7 +54,7 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 @implementation RedlandWorld
 
 @synthesize logsErrors;
-@synthesize lastError, storedErrors = _storedErrors;
+@synthesize lastError;
 
 
 #pragma mark - Init and Cleanup
@@ -74,11 +79,23 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 		defaultInstance.logsErrors = YES;
 		
         librdf_world_open(world);
+        RedlandCompactStorageRegisterFactory(world);
+        RedlandUnionStorageRegisterFactory(world);
+        RedlandShardedStorageRegisterFactory(world);
         librdf_world_set_logger(world, (__bridge void *)(defaultInstance), &redland_log_handler);
     }
     return defaultInstance;
 }
 
+- (id)initWithWrappedObject:(void *)object owner:(BOOL)ownerFlag
+{
+	if ((self = [super initWithWrappedObject:object owner:ownerFlag])) {
+		worldLock = [NSRecursiveLock new];
+		[worldLock setName:@"org.librdf.RedlandWorld"];
+	}
+	return self;
+}
+
 - (void)dealloc
 {
     if (isWrappedObjectOwner) {
@@ -117,6 +134,22 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 
 
 
+#pragma mark - Locking
+/**
+ *  Acquires the lock serializing the use of librdf across threads; may be called again by the thread already holding it.
+ */
+- (void)lock
+{
+	[worldLock lock];
+}
+
+- (void)unlock
+{
+	[worldLock unlock];
+}
+
+
+
 #pragma mark - Features
 /**
  *  Returns the value of the world feature identified by featureURI.
@@ -174,7 +207,7 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 
 #pragma mark - Error Handling
 /**
- *  Adds an librdf_log_message to the internal storedErrors array.
+ *  Adds an librdf_log_message to the internal storedErrors array of the current thread, which is the thread librdf reported the error on.
  *  Errors are collected until -[RedlandWorld handleStoredErrors] is called, which then throws an exception with all collected errors.
  *  
  *  @param aMessage A librdf_log_message pointer.
@@ -191,43 +224,51 @@ static int redland_log_handler(void *user_data, librdf_log_message *message)
 	if ([self logsErrors]) {
 		NSLog(@"Redland Error %d: %@", aMessage->code, infoDict);
 	}
-    [self.storedErrors addObject:[NSError errorWithDomain:RedlandErrorDomain
-                                                code:aMessage->code 
-                                            userInfo:infoDict]];
+	[self.storedErrors addObject:[NSError errorWithDomain:RedlandErrorDomain
+													 code:aMessage->code
+												 userInfo:infoDict]];
     
     return 1;
 }
 
 /**
- *  Checks if there are any collected errors, in which case it throws an exception with the error array inside userInfo dictionary.
+ *  Checks if there are any errors collected on the current thread, in which case it throws an exception with the error array inside userInfo dictionary.
  *  @warning Behavior of this method is subject to change. Do not use.
  */
 - (void)handleStoredErrors
 {
     NSArray *errorArray;
     NSException *exception;
+    NSMutableArray *storedErrors = self.storedErrors;
     
-    if (0 == [_storedErrors count]) {
+    if (0 == [storedErrors count]) {
         return;
-	}
+    }
+    errorArray = [[NSArray alloc] initWithArray:storedErrors];
+    [storedErrors removeAllObjects];
     
-    errorArray = [[NSArray alloc] initWithArray:_storedErrors];
     exception = [RedlandException exceptionWithName:RedlandExceptionName
                                              reason:@"Redland Exception"
                                            userInfo:@{ @"storedErrors": errorArray }];
-    [_storedErrors removeAllObjects];
     [exception raise];
 }
 
 
 
 #pragma mark - KVC
+/**
+ *  The errors are kept in the thread dictionary, so an error reported while a RedlandQueryExecutor worker runs a query is not raised on another thread.
+ */
 - (NSMutableArray *)storedErrors
 {
-	if (!_storedErrors) {
-		self.storedErrors = [NSMutableArray new];
+	NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+	NSValue *key = [NSValue valueWithNonretainedObject:self];
+	NSMutableArray *storedErrors = [threadDictionary objectForKey:key];
+	if (!storedErrors) {
+		storedErrors = [NSMutableArray new];
+		[threadDictionary setObject:storedErrors forKey:key];
 	}
-	return _storedErrors;
+	return storedErrors;
 }
 
 
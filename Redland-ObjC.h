@@ -28,23 +28,45 @@
  */
 
 #import <redland.h>
+#import <RedlandBindingTable.h>
+#import <RedlandCancellationToken.h>
+#import <RedlandChangeSet.h>
+#import <RedlandCollectionEnumerator.h>
+#import <RedlandCompactStorage.h>
+#import <RedlandContainerEnumerator.h>
+#import <RedlandDescriptionCache.h>
 #import <RedlandException.h>
 #import <RedlandIterator.h>
 #import <RedlandIteratorEnumerator.h>
 #import <RedlandModel.h>
 #import <RedlandModel-Convenience.h>
+#import <RedlandModel-GraphPattern.h>
+#import <RedlandModel-Pagination.h>
+#import <RedlandModel-PropertyPath.h>
+#import <RedlandModel-Snapshot.h>
 #import <RedlandNamespace.h>
 #import <RedlandNode.h>
 #import <RedlandNode-Convenience.h>
 #import <RedlandParser.h>
+#import <RedlandPropertyPath.h>
 #import <RedlandQuery.h>
+#import <RedlandQuery-Pagination.h>
+#import <RedlandQueryCache.h>
+#import <RedlandQueryExecutor.h>
+#import <RedlandQueryProfile.h>
 #import <RedlandQueryResults.h>
 #import <RedlandQueryResultsEnumerator.h>
+#import <RedlandRDFSReasoner.h>
+#import <RedlandRangeIndex.h>
 #import <RedlandSerializer.h>
+#import <RedlandShardedModel.h>
 #import <RedlandStatement.h>
 #import <RedlandStorage.h>
 #import <RedlandStream.h>
+#import <RedlandStream-Operators.h>
 #import <RedlandStreamEnumerator.h>
+#import <RedlandTextIndex.h>
 #import <RedlandURI.h>
+#import <RedlandUnionModel.h>
 #import <RedlandWorld.h>
 #import <RedlandWrappedObject.h>
@@ -25,12 +25,43 @@
 #import "ModelTests.h"
 
 #import "RedlandModel-Convenience.h"
+#import "RedlandModel-Snapshot.h"
+#import "RedlandModel-Pagination.h"
 #import "RedlandNode-Convenience.h"
 #import "RedlandStatement.h"
 #import "RedlandStreamEnumerator.h"
+#import "RedlandStream-Operators.h"
+#import "RedlandURI.h"
+#import "RedlandIteratorEnumerator.h"
+#import "RedlandException.h"
+#import "RedlandStorage.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandNamespace.h"
+#import "RedlandModel-PropertyPath.h"
+#import "RedlandPropertyPath.h"
+#import "RedlandModel-GraphPattern.h"
+#import "RedlandBindingTable.h"
+#import "RedlandDescriptionCache.h"
+#import "RedlandChangeSet.h"
+#import "RedlandRDFSReasoner.h"
+#import "RedlandTextIndex.h"
+#import "RedlandRangeIndex.h"
+#import "RedlandUnionModel.h"
+#import "RedlandShardedModel.h"
+#import "RedlandQuery.h"
+#import "RedlandQueryResults.h"
 
 @implementation ModelTests
 
+/**
+ *  Returns an empty model on the default hashes storage followed by one on the compact storage, for tests that run against both.
+ */
+- (NSArray *)modelsForStorageTypes
+{
+	return @[[RedlandModel new],
+			 [[RedlandModel alloc] initWithStorage:[[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil]]];
+}
+
 - (void)testSimple
 {
     RedlandNode *subject = [RedlandNode nodeWithBlankID:@"foo"];
@@ -118,5 +149,769 @@
 	STAssertNoThrow([model addStatement:statement withContext:nil], nil);
 }
 
+- (void)testCounting
+{
+	RedlandStorage *compact = [[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil];
+	NSArray *models = @[[RedlandModel new], [RedlandModel modelWithStorage:compact]];
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	RedlandNode *context = [RedlandNode nodeWithURIString:@"http://example.org/graph"];
+	
+	for (RedlandModel *model in models) {
+		for (int i = 0; i < 20; i++) {
+			RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+			RedlandStatement *statement = [RedlandStatement statementWithSubject:person predicate:[RedlandNode typeNode] object:[RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/Person"]];
+			[model addStatement:statement];
+			statement = [RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]];
+			if (i < 5) {
+				[model addStatement:statement withContext:context];
+			}
+			else {
+				[model addStatement:statement];
+			}
+		}
+		
+		RedlandStatement *names = [RedlandStatement statementWithSubject:nil predicate:name object:nil];
+		STAssertEquals((NSUInteger)40, [model countOfStatementsLike:nil], nil);
+		STAssertEquals((NSUInteger)20, [model countOfStatementsLike:names], nil);
+		STAssertEquals((NSUInteger)5, [model countOfStatementsLike:names withContext:context], nil);
+		STAssertEquals((NSUInteger)5, [model countOfStatementsLike:nil withContext:context], nil);
+		STAssertTrue([model estimatedCountOfStatementsLike:names withContext:nil] >= 20, nil);
+		
+		RedlandStatement *unknown = [RedlandStatement statementWithSubject:[RedlandNode nodeWithURIString:@"http://example.org/nobody"] predicate:nil object:nil];
+		STAssertEquals((NSUInteger)0, [model countOfStatementsLike:unknown], nil);
+	}
+}
+
+- (void)testIteratorEnumeration
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *subject = [RedlandNode nodeWithURIString:@"http://example.org/list"];
+	RedlandNode *predicate = [RedlandNode nodeWithURIString:@"http://example.org/item"];
+	for (int i = 0; i < 50; i++) {
+		[model addStatement:[RedlandStatement statementWithSubject:subject predicate:predicate object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"%d", i]]]];
+	}
+	
+	NSMutableSet *targets = [NSMutableSet set];
+	for (RedlandNode *target in [model enumeratorOfTargetsWithSource:subject arc:predicate]) {
+		STAssertTrue([target isLiteral], nil);
+		[targets addObject:target];
+	}
+	STAssertEquals((NSUInteger)50, [targets count], nil);
+	STAssertEquals((NSUInteger)50, [[[model enumeratorOfTargetsWithSource:subject arc:predicate] allObjects] count], nil);
+	
+	RedlandIteratorEnumerator *enumerator = (RedlandIteratorEnumerator *)[model enumeratorOfTargetsWithSource:subject arc:predicate];
+	STAssertNotNil([enumerator nextObject], nil);
+	librdf_node *buffer[64];
+	NSUInteger count = [enumerator getWrappedObjects:(void **)buffer maxCount:64];
+	STAssertEquals((NSUInteger)49, count, nil);
+	for (NSUInteger i = 0; i < count; i++) {
+		STAssertTrue(librdf_node_is_literal(buffer[i]), nil);
+		librdf_free_node(buffer[i]);
+	}
+	STAssertNil([enumerator nextObject], nil);
+}
+
+- (void)testBlockEnumeration
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *predicate = [RedlandNode nodeWithURIString:@"http://example.org/value"];
+	RedlandNode *context = [RedlandNode nodeWithURIString:@"http://example.org/graph"];
+	for (int i = 0; i < 1000; i++) {
+		RedlandNode *subject = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/item/%d", i]];
+		RedlandStatement *statement = [RedlandStatement statementWithSubject:subject predicate:predicate object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"%d", i]]];
+		[model addStatement:statement withContext:context];
+	}
+	
+	__block NSUInteger count = 0;
+	[model enumerateStatementsLike:nil context:nil options:0 usingBlock:^(RedlandStatement *statement, RedlandNode *statementContext, BOOL *stop) {
+		STAssertEqualObjects(predicate, [statement predicate], nil);
+		STAssertEqualObjects(context, statementContext, nil);
+		count++;
+	}];
+	STAssertEquals((NSUInteger)1000, count, nil);
+	
+	count = 0;
+	RedlandStatement *pattern = [RedlandStatement statementWithSubject:nil predicate:predicate object:nil];
+	[model enumerateStatementsLike:pattern context:context options:0 usingBlock:^(RedlandStatement *statement, RedlandNode *statementContext, BOOL *stop) {
+		*stop = (++count == 10);
+	}];
+	STAssertEquals((NSUInteger)10, count, @"Enumeration should end when the stop flag is set");
+	
+	__block int32_t concurrentCount = 0;
+	__block int32_t valueSum = 0;
+	[model enumerateStatementsLike:pattern context:nil options:RedlandEnumerationConcurrent usingBlock:^(RedlandStatement *statement, RedlandNode *statementContext, BOOL *stop) {
+		__sync_fetch_and_add(&concurrentCount, 1);
+		__sync_fetch_and_add(&valueSum, [[[statement object] literalValue] intValue]);
+	}];
+	STAssertEquals((int32_t)1000, concurrentCount, nil);
+	STAssertEquals((int32_t)499500, valueSum, nil);
+}
+
+- (void)testCollections
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *list = [RedlandNode nodeWithBlankID:@"list"];
+	NSMutableArray *items = [NSMutableArray array];
+	for (int i = 0; i < 1000; i++) {
+		[items addObject:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"%d", i]]];
+	}
+	[model addCollectionNode:list withContents:items];
+	STAssertEquals(2000, [model size], nil);
+	STAssertEqualObjects(items, [model contentsOfCollectionNode:list], nil);
+	STAssertEqualObjects(items, [[model enumeratorOfCollectionNode:list] allObjects], nil);
+	STAssertEqualObjects(@[], [model contentsOfCollectionNode:[RDFSyntaxNS node:@"nil"]], nil);
+	
+	// container members are ordered by their ordinal, not by insertion order
+	RedlandNode *seq = [RedlandNode nodeWithBlankID:@"seq"];
+	int ordinals[5] = { 3, 1, 5, 2, 4 };
+	for (int i = 0; i < 5; i++) {
+		RedlandNode *arc = [RDFSyntaxNS node:[NSString stringWithFormat:@"_%d", ordinals[i]]];
+		[model addStatement:[RedlandStatement statementWithSubject:seq predicate:arc object:[items objectAtIndex:ordinals[i]]]];
+	}
+	[model addStatement:[RedlandStatement statementWithSubject:seq predicate:[RDFSyntaxNS node:@"type"] object:[RDFSyntaxNS node:@"Seq"]]];
+	NSArray *expected = [items subarrayWithRange:NSMakeRange(1, 5)];
+	STAssertEqualObjects(expected, [model contentsOfContainerNode:seq], nil);
+	STAssertEqualObjects(expected, [[model enumeratorOfContainerNode:seq] allObjects], nil);
+	
+	// a cyclic list must not loop forever
+	RedlandNode *cycle = [RedlandNode nodeWithBlankID:@"cycle"];
+	[model addStatement:[RedlandStatement statementWithSubject:cycle predicate:[RDFSyntaxNS node:@"first"] object:[items objectAtIndex:0]]];
+	[model addStatement:[RedlandStatement statementWithSubject:cycle predicate:[RDFSyntaxNS node:@"rest"] object:cycle]];
+	STAssertThrowsSpecificNamed([model contentsOfCollectionNode:cycle], RedlandException, RedlandExceptionName, nil);
+	
+	// a list read from a context only follows the statements of that context
+	RedlandNode *graph = [RedlandNode nodeWithURIString:@"http://example.org/graph"];
+	RedlandNode *scoped = [RedlandNode nodeWithBlankID:@"scoped"];
+	RedlandNode *tail = [RedlandNode nodeWithBlankID:@"scopedTail"];
+	[model addStatement:[RedlandStatement statementWithSubject:scoped predicate:[RDFSyntaxNS node:@"first"] object:[items objectAtIndex:0]] withContext:graph];
+	[model addStatement:[RedlandStatement statementWithSubject:scoped predicate:[RDFSyntaxNS node:@"rest"] object:tail] withContext:graph];
+	[model addStatement:[RedlandStatement statementWithSubject:tail predicate:[RDFSyntaxNS node:@"first"] object:[items objectAtIndex:1]]];
+	[model addStatement:[RedlandStatement statementWithSubject:tail predicate:[RDFSyntaxNS node:@"rest"] object:[RDFSyntaxNS node:@"nil"]]];
+	STAssertEqualObjects([items subarrayWithRange:NSMakeRange(0, 2)], [model contentsOfCollectionNode:scoped], nil);
+	STAssertEqualObjects(@[[items objectAtIndex:0]], [model contentsOfCollectionNode:scoped context:graph], nil);
+}
+
+- (void)testPropertyPaths
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	NSMutableArray *people = [NSMutableArray array];
+	for (int i = 0; i < 10; i++) {
+		RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+		[people addObject:person];
+		[model addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+	}
+	// a ring: 0 knows 1 knows 2 ... knows 9 knows 0
+	for (int i = 0; i < 10; i++) {
+		[model addStatement:[RedlandStatement statementWithSubject:[people objectAtIndex:i] predicate:knows object:[people objectAtIndex:(i + 1) % 10]]];
+	}
+	RedlandNode *first = [people objectAtIndex:0];
+	
+	RedlandPropertyPath *friendName = [RedlandPropertyPath sequencePathWithPaths:@[knows, name]];
+	STAssertEqualObjects(@[[RedlandNode nodeWithLiteral:@"Person 1"]], [model targetsOfPath:friendName fromSource:first], nil);
+	
+	NSArray *inverse = [model targetsOfPath:[RedlandPropertyPath inversePathWithPath:knows] fromSource:first];
+	STAssertEqualObjects(@[[people objectAtIndex:9]], inverse, nil);
+	
+	NSSet *closure = [NSSet setWithArray:[model targetsOfPath:[RedlandPropertyPath zeroOrMorePathWithPath:knows] fromSource:first]];
+	STAssertEqualObjects([NSSet setWithArray:people], closure, @"The ring must be traversed exactly once");
+	STAssertEquals((NSUInteger)10, [[model targetsOfPath:[RedlandPropertyPath oneOrMorePathWithPath:knows] fromSource:first] count], nil);
+	STAssertEquals((NSUInteger)2, [[model targetsOfPath:[RedlandPropertyPath zeroOrOnePathWithPath:knows] fromSource:first] count], nil);
+	
+	RedlandPropertyPath *either = [RedlandPropertyPath alternativePathWithPaths:@[knows, [RedlandPropertyPath inversePathWithPath:knows]]];
+	STAssertEquals((NSUInteger)2, [[model targetsOfPath:either fromSource:first] count], nil);
+	
+	__block NSUInteger count = 0;
+	[model enumerateTargetsOfPath:[RedlandPropertyPath oneOrMorePathWithPath:knows] fromSource:first maximumDepth:3 limit:0 usingBlock:^(RedlandNode *node, BOOL *stop) {
+		count++;
+	}];
+	STAssertEquals((NSUInteger)3, count, @"The depth limit must be honored");
+	
+	count = 0;
+	[model enumerateTargetsOfPath:[RedlandPropertyPath zeroOrMorePathWithPath:knows] fromSource:first maximumDepth:0 limit:4 usingBlock:^(RedlandNode *node, BOOL *stop) {
+		count++;
+	}];
+	STAssertEquals((NSUInteger)4, count, @"The result limit must be honored");
+}
+
+- (void)testGraphPatterns
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	NSMutableArray *people = [NSMutableArray array];
+	for (int i = 0; i < 100; i++) {
+		RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+		[people addObject:person];
+		[model addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+	}
+	for (int i = 0; i < 100; i++) {
+		[model addStatement:[RedlandStatement statementWithSubject:[people objectAtIndex:i] predicate:knows object:[people objectAtIndex:(i + 1) % 100]]];
+	}
+	
+	// who does "Person 5" know, and what is their name
+	RedlandNode *a = [RedlandNode nodeWithVariableName:@"a"];
+	RedlandNode *b = [RedlandNode nodeWithVariableName:@"b"];
+	RedlandNode *bName = [RedlandNode nodeWithVariableName:@"name"];
+	STAssertEqualObjects(@"a", [a variableName], nil);
+	STAssertNil([[RedlandNode nodeWithBlankID:@"a"] variableName], nil);
+	NSArray *patterns = @[[RedlandStatement statementWithSubject:a predicate:knows object:b],
+						  [RedlandStatement statementWithSubject:b predicate:name object:bName],
+						  [RedlandStatement statementWithSubject:a predicate:name object:[RedlandNode nodeWithLiteral:@"Person 5"]]];
+	RedlandBindingTable *bindings = [model bindingsMatchingPatterns:patterns];
+	STAssertEquals((NSUInteger)1, [bindings count], nil);
+	NSArray *variables = @[@"a", @"b", @"name"];
+	STAssertEqualObjects(variables, [bindings variables], nil);
+	STAssertEqualObjects([people objectAtIndex:5], [bindings nodeForVariable:@"a" atRow:0], nil);
+	STAssertEqualObjects([people objectAtIndex:6], [bindings nodeForVariable:@"b" atRow:0], nil);
+	STAssertEqualObjects([RedlandNode nodeWithLiteral:@"Person 6"], [[bindings dictionaryAtRow:0] objectForKey:@"name"], nil);
+	
+	// all pairs two steps apart
+	RedlandNode *c = [RedlandNode nodeWithVariableName:@"c"];
+	patterns = @[[RedlandStatement statementWithSubject:a predicate:knows object:b],
+				 [RedlandStatement statementWithSubject:b predicate:knows object:c]];
+	bindings = [model bindingsMatchingPatterns:patterns];
+	STAssertEquals((NSUInteger)100, [bindings count], nil);
+	for (NSUInteger row = 0; row < [bindings count]; row++) {
+		NSUInteger first = [people indexOfObject:[bindings nodeForVariable:@"a" atRow:row]];
+		STAssertEqualObjects([people objectAtIndex:(first + 2) % 100], [bindings nodeForVariable:@"c" atRow:row], nil);
+	}
+	STAssertEquals((NSUInteger)10, [[model bindingsMatchingPatterns:patterns context:nil limit:10] count], nil);
+	
+	// nobody knows themselves
+	patterns = @[[RedlandStatement statementWithSubject:a predicate:knows object:a]];
+	STAssertEquals((NSUInteger)0, [[model bindingsMatchingPatterns:patterns] count], nil);
+}
+
+- (void)testBatchedLookups
+{
+	for (RedlandModel *model in [self modelsForStorageTypes]) {
+		RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+		RedlandNode *nick = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/nick"];
+		RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+		NSMutableArray *people = [NSMutableArray array];
+		for (int i = 0; i < 50; i++) {
+			RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+			[people addObject:person];
+			[model addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+			if (0 == i % 2) {
+				[model addStatement:[RedlandStatement statementWithSubject:person predicate:nick object:[RedlandNode nodeWithLiteral:@"even"]]];
+				[model addStatement:[RedlandStatement statementWithSubject:person predicate:nick object:[RedlandNode nodeWithLiteral:@"two"]]];
+			}
+		}
+		
+		NSArray *sources = [people arrayByAddingObject:[people objectAtIndex:0]];
+		NSDictionary *targets = [model targetsForSources:sources arcs:@[name, nick, name]];
+		STAssertEquals((NSUInteger)50, [targets count], @"Duplicate sources must be looked up once");
+		for (int i = 0; i < 50; i++) {
+			NSDictionary *perArc = [targets objectForKey:[people objectAtIndex:i]];
+			STAssertEqualObjects(@[[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]], [perArc objectForKey:name], nil);
+			STAssertEquals((NSUInteger)((0 == i % 2) ? 2 : 0), [[perArc objectForKey:nick] count], nil);
+			STAssertNil([perArc objectForKey:knows], nil);
+		}
+		
+		NSDictionary *sourcesByTarget = [model sourcesForTargets:@[[RedlandNode nodeWithLiteral:@"even"]] arcs:@[nick]];
+		STAssertEquals((NSUInteger)25, [[[sourcesByTarget objectForKey:[RedlandNode nodeWithLiteral:@"even"]] objectForKey:nick] count], nil);
+	}
+}
+
+- (void)testDescriptionCache
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandDescriptionCache *cache = [[RedlandDescriptionCache alloc] initWithCountLimit:2 costLimit:0];
+	model.descriptionCache = cache;
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	RedlandNode *nick = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/nick"];
+	NSMutableArray *people = [NSMutableArray array];
+	for (int i = 0; i < 3; i++) {
+		RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+		[people addObject:person];
+		[model addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+	}
+	RedlandNode *first = [people objectAtIndex:0];
+	
+	STAssertEqualObjects([RedlandNode nodeWithLiteral:@"Person 0"], [model targetWithSource:first arc:name], nil);
+	STAssertTrue([model node:first hasOutgoingArc:name], nil);
+	STAssertFalse([model node:first hasOutgoingArc:nick], nil);
+	STAssertNil([model targetWithSource:first arc:nick], nil);
+	STAssertEqualObjects(@[name], [[model enumeratorOfArcsOut:first] allObjects], nil);
+	STAssertEquals((NSUInteger)1, cache.misses, nil);
+	STAssertEquals((NSUInteger)4, cache.hits, nil);
+	
+	// adding a statement about the subject invalidates its description
+	RedlandStatement *nickStatement = [RedlandStatement statementWithSubject:first predicate:nick object:[RedlandNode nodeWithLiteral:@"First"]];
+	[model addStatement:nickStatement];
+	STAssertEquals((NSUInteger)1, cache.invalidations, nil);
+	STAssertEqualObjects([RedlandNode nodeWithLiteral:@"First"], [model targetWithSource:first arc:nick], nil);
+	[model removeStatement:nickStatement];
+	STAssertNil([model targetWithSource:first arc:nick], nil);
+	STAssertEquals((NSUInteger)3, cache.misses, nil);
+	
+	// the least recently used description is evicted
+	[model targetWithSource:[people objectAtIndex:1] arc:name];
+	[model targetWithSource:[people objectAtIndex:2] arc:name];
+	STAssertEquals((NSUInteger)2, cache.count, nil);
+	STAssertEquals((NSUInteger)1, cache.evictions, nil);
+	[model targetWithSource:[people objectAtIndex:2] arc:name];
+	STAssertEquals((NSUInteger)5, cache.hits, nil);
+	STAssertEqualsWithAccuracy(5.0 / 10.0, cache.hitRate, 0.001, nil);
+}
+
+- (void)testChangeObservers
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *subject = [RedlandNode nodeWithURIString:@"http://example.org/subject"];
+	RedlandNode *predicate = [RedlandNode nodeWithURIString:@"http://example.org/predicate"];
+	RedlandStatement *first = [RedlandStatement statementWithSubject:subject predicate:predicate object:[RedlandNode nodeWithLiteral:@"one"]];
+	RedlandStatement *second = [RedlandStatement statementWithSubject:subject predicate:predicate object:[RedlandNode nodeWithLiteral:@"two"]];
+	[model addStatement:first];
+	
+	NSMutableArray *received = [NSMutableArray array];
+	id observer = [model addChangeObserverWithQueue:nil usingBlock:^(RedlandModel *changedModel, RedlandChangeSet *changes) {
+		[received addObject:changes];
+	}];
+	STAssertTrue([model hasChangeObservers], nil);
+	
+	// adding a statement already present is not a change
+	[model addStatement:first];
+	STAssertEquals((NSUInteger)0, [received count], nil);
+	[model addStatement:second];
+	STAssertEquals((NSUInteger)1, [received count], nil);
+	STAssertEqualObjects(@[second], [[received lastObject] addedStatements], nil);
+	
+	// batched changes arrive as one change set
+	[model performChanges:^{
+		[model removeStatement:first];
+		[model removeStatement:second];
+		[model removeStatement:second];
+	}];
+	STAssertEquals((NSUInteger)2, [received count], nil);
+	RedlandChangeSet *removal = [received lastObject];
+	STAssertEquals((NSUInteger)2, removal.count, nil);
+	STAssertEquals((NSUInteger)0, [[removal addedStatements] count], nil);
+	STAssertEqualObjects([NSSet setWithObject:subject], [removal affectedSubjects], nil);
+	
+	// statements added in a loop are reported individually, not as copies of the last one
+	[model addCollectionNode:[RedlandNode nodeWithBlankID:nil] withContents:@[[RedlandNode nodeWithLiteral:@"a"], [RedlandNode nodeWithLiteral:@"b"]]];
+	STAssertEquals((NSUInteger)3, [received count], nil);
+	NSArray *collectionStatements = [[received lastObject] addedStatements];
+	STAssertEquals((NSUInteger)4, [collectionStatements count], nil);
+	STAssertEquals((NSUInteger)4, [[NSSet setWithArray:collectionStatements] count], nil);
+	
+	// only the exact pair of statement and context counts, a copy in another context does not
+	RedlandNode *graph = [RedlandNode nodeWithURIString:@"http://example.org/graph"];
+	[model addStatement:second withContext:graph];
+	STAssertEquals((NSUInteger)4, [received count], nil);
+	[model removeStatement:second];
+	STAssertEquals((NSUInteger)4, [received count], @"Removing a statement without context must not report the copy in another context as removed");
+	[model removeStatement:second withContext:graph];
+	STAssertEquals((NSUInteger)5, [received count], nil);
+	STAssertEqualObjects(@[second], [[received lastObject] removedStatements], nil);
+	
+	[model removeChangeObserver:observer];
+	STAssertFalse([model hasChangeObservers], nil);
+	[model addStatement:first];
+	STAssertEquals((NSUInteger)5, [received count], nil);
+}
+
+- (void)testRDFSReasoner
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *inferred = [RedlandNode nodeWithURIString:@"http://example.org/inferred"];
+	RedlandNode *type = [RDFSyntaxNS node:@"type"];
+	RedlandNode *subClassOf = [RDFSchemaNS node:@"subClassOf"];
+	RedlandNode *dog = [RedlandNode nodeWithURIString:@"http://example.org/Dog"];
+	RedlandNode *animal = [RedlandNode nodeWithURIString:@"http://example.org/Animal"];
+	RedlandNode *thing = [RedlandNode nodeWithURIString:@"http://example.org/LivingThing"];
+	RedlandNode *person = [RedlandNode nodeWithURIString:@"http://example.org/Person"];
+	RedlandNode *owns = [RedlandNode nodeWithURIString:@"http://example.org/owns"];
+	RedlandNode *rex = [RedlandNode nodeWithURIString:@"http://example.org/rex"];
+	RedlandNode *alice = [RedlandNode nodeWithURIString:@"http://example.org/alice"];
+	
+	RedlandStatement *dogIsAnimal = [RedlandStatement statementWithSubject:dog predicate:subClassOf object:animal];
+	[model addStatement:dogIsAnimal];
+	[model addStatement:[RedlandStatement statementWithSubject:animal predicate:subClassOf object:thing]];
+	[model addStatement:[RedlandStatement statementWithSubject:rex predicate:type object:dog]];
+	
+	RedlandRDFSReasoner *reasoner = [[RedlandRDFSReasoner alloc] initWithModel:model inferenceContext:inferred];
+	[reasoner materialize];
+	RedlandStatement *rexIsThing = [RedlandStatement statementWithSubject:rex predicate:type object:thing];
+	STAssertTrue([model containsStatement:rexIsThing], nil);
+	STAssertEquals((NSUInteger)3, [[[model statementEnumeratorWithContext:inferred] allObjects] count], nil);
+	
+	// additions are maintained incrementally
+	[model addStatement:[RedlandStatement statementWithSubject:owns predicate:[RDFSchemaNS node:@"domain"] object:person]];
+	[model addStatement:[RedlandStatement statementWithSubject:alice predicate:owns object:rex]];
+	STAssertTrue([model containsStatement:[RedlandStatement statementWithSubject:alice predicate:type object:person]], nil);
+	
+	// removing the only derivation deletes the consequences, an alternative derivation keeps them
+	RedlandStatement *rexIsAnimal = [RedlandStatement statementWithSubject:rex predicate:type object:animal];
+	[model removeStatement:dogIsAnimal];
+	STAssertFalse([model containsStatement:rexIsAnimal], nil);
+	STAssertFalse([model containsStatement:rexIsThing], nil);
+	[model addStatement:rexIsAnimal];
+	STAssertTrue([model containsStatement:rexIsThing], nil);
+	[model addStatement:dogIsAnimal];
+	[model removeStatement:rexIsAnimal];
+	STAssertTrue([model containsStatement:rexIsAnimal], nil);
+	STAssertTrue([model containsStatement:rexIsThing], nil);
+	
+	[reasoner invalidate];
+}
+
+- (void)testTextIndex
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *label = [RDFSchemaNS node:@"label"];
+	NSArray *labels = @[@"New York City", @"York", @"New Amsterdam", @"Café de Flore"];
+	for (NSUInteger i = 0; i < [labels count]; i++) {
+		RedlandNode *place = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/place/%lu", (unsigned long)i]];
+		[model addStatement:[RedlandStatement statementWithSubject:place predicate:label object:[RedlandNode nodeWithLiteral:[labels objectAtIndex:i] language:@"en" type:nil]]];
+	}
+	
+	RedlandTextIndex *index = [[RedlandTextIndex alloc] initWithModel:model];
+	STAssertEquals((NSUInteger)4, index.count, nil);
+	NSArray *york = [index matchesForQuery:@"york" type:RedlandTextQueryAllTerms language:nil limit:0];
+	STAssertEquals((NSUInteger)2, [york count], nil);
+	STAssertEqualObjects(@"York", [[[york objectAtIndex:0] literal] literalValue], @"The shorter literal should rank first");
+	STAssertEquals((NSUInteger)1, [[index matchesForQuery:@"york new" type:RedlandTextQueryAllTerms language:nil limit:0] count], nil);
+	STAssertEquals((NSUInteger)0, [[index matchesForQuery:@"york new" type:RedlandTextQueryPhrase language:nil limit:0] count], nil);
+	STAssertEquals((NSUInteger)1, [[index matchesForQuery:@"New York" type:RedlandTextQueryPhrase language:nil limit:0] count], nil);
+	STAssertEquals((NSUInteger)2, [[index matchesForQuery:@"new" type:RedlandTextQueryPrefix language:@"en" limit:0] count], nil);
+	STAssertEquals((NSUInteger)1, [[index matchesForQuery:@"new am" type:RedlandTextQueryPrefix language:nil limit:0] count], nil);
+	STAssertEquals((NSUInteger)1, [[index matchesForQuery:@"cafe" type:RedlandTextQueryAllTerms language:nil limit:0] count], @"Diacritics should be ignored");
+	STAssertEquals((NSUInteger)0, [[index matchesForQuery:@"york" type:RedlandTextQueryAllTerms language:@"de" limit:0] count], nil);
+	STAssertEquals((NSUInteger)1, [[index matchesForQuery:@"york" type:RedlandTextQueryAllTerms language:nil limit:1] count], nil);
+	
+	// the index follows the model
+	RedlandNode *boston = [RedlandNode nodeWithURIString:@"http://example.org/place/boston"];
+	RedlandStatement *bostonLabel = [RedlandStatement statementWithSubject:boston predicate:label object:[RedlandNode nodeWithLiteral:@"Boston"]];
+	[model addStatement:bostonLabel];
+	NSArray *matches = [index matchesForQuery:@"bost" type:RedlandTextQueryPrefix language:nil limit:0];
+	STAssertEquals((NSUInteger)1, [matches count], nil);
+	STAssertEqualObjects(boston, [[matches objectAtIndex:0] subject], nil);
+	[model removeStatement:bostonLabel];
+	STAssertEquals((NSUInteger)0, [[index matchesForQuery:@"boston" type:RedlandTextQueryAllTerms language:nil limit:0] count], nil);
+	
+	[index invalidate];
+}
+
+- (void)testRangeIndex
+{
+	RedlandModel *model = [RedlandModel new];
+	RedlandNode *price = [RedlandNode nodeWithURIString:@"http://example.org/price"];
+	RedlandNode *modified = [RedlandNode nodeWithURIString:@"http://example.org/modified"];
+	NSDate *start = [NSDate dateWithTimeIntervalSinceReferenceDate:400000000];
+	NSMutableArray *items = [NSMutableArray array];
+	for (int i = 0; i < 10; i++) {
+		RedlandNode *item = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/item/%d", i]];
+		[items addObject:item];
+		[model addStatement:[RedlandStatement statementWithSubject:item predicate:price object:[RedlandNode nodeWithLiteralInt:(10 - i) * 10]]];
+		[model addStatement:[RedlandStatement statementWithSubject:item predicate:modified object:[RedlandNode nodeWithLiteralDateTime:[start dateByAddingTimeInterval:i * 3600]]]];
+	}
+	RedlandStatement *firstPrice = [RedlandStatement statementWithSubject:[items objectAtIndex:0] predicate:price object:[RedlandNode nodeWithLiteralInt:100]];
+	[model addStatement:firstPrice withContext:[RedlandNode nodeWithURIString:@"http://example.org/catalog"]];
+	
+	RedlandRangeIndex *index = [[RedlandRangeIndex alloc] initWithModel:model];
+	STAssertEquals((NSUInteger)20, index.count, @"A statement in several contexts is indexed once");
+	NSArray *cheap = [index subjectsWithPredicate:price minimumValue:20 maximumValue:40];
+	STAssertEqualObjects((@[[items objectAtIndex:8], [items objectAtIndex:7], [items objectAtIndex:6]]), cheap, nil);
+	STAssertEquals((NSUInteger)3, [index countOfValuesWithPredicate:price valueType:RedlandRangeValueNumeric minimumValue:20 maximumValue:40], nil);
+	
+	NSArray *recent = [index subjectsWithPredicate:modified fromDate:[start dateByAddingTimeInterval:7 * 3600] toDate:nil];
+	STAssertEqualObjects((@[[items objectAtIndex:7], [items objectAtIndex:8], [items objectAtIndex:9]]), recent, nil);
+	NSArray *latest = [index subjectsWithPredicate:modified valueType:RedlandRangeValueDateTime descending:YES limit:2];
+	STAssertEqualObjects((@[[items objectAtIndex:9], [items objectAtIndex:8]]), latest, nil);
+	
+	// the index follows the model
+	RedlandStatement *newest = [RedlandStatement statementWithSubject:[items objectAtIndex:0] predicate:modified object:[RedlandNode nodeWithLiteralDateTime:[start dateByAddingTimeInterval:86400]]];
+	[model addStatement:newest];
+	STAssertEqualObjects([items objectAtIndex:0], [[index subjectsWithPredicate:modified valueType:RedlandRangeValueDateTime descending:YES limit:1] lastObject], nil);
+	[model removeStatement:newest];
+	STAssertEqualObjects([items objectAtIndex:9], [[index subjectsWithPredicate:modified valueType:RedlandRangeValueDateTime descending:YES limit:1] lastObject], nil);
+	
+	// entries with equal values are found by their statement
+	RedlandStatement *samePrice = [RedlandStatement statementWithSubject:[items objectAtIndex:0] predicate:price object:[RedlandNode nodeWithLiteralInt:30]];
+	[model addStatement:samePrice];
+	STAssertEquals((NSUInteger)2, [index countOfValuesWithPredicate:price valueType:RedlandRangeValueNumeric minimumValue:30 maximumValue:30], nil);
+	[model removeStatement:samePrice];
+	STAssertEqualObjects(@[[items objectAtIndex:7]], [index subjectsWithPredicate:price minimumValue:30 maximumValue:30], nil);
+	
+	[index invalidate];
+}
+
+- (void)testSnapshot
+{
+	RedlandNode *subject = [RedlandNode nodeWithBlankID:@"foo"];
+	RedlandNode *predicate = [RedlandNode nodeWithURIString:@"foo:bar"];
+	RedlandNode *context = [RedlandNode nodeWithURIString:@"http://example.com/graph"];
+	RedlandStatement *plain = [RedlandStatement statementWithSubject:subject
+														   predicate:predicate
+															  object:[RedlandNode nodeWithLiteral:@"test" language:@"en" type:nil]];
+	RedlandStatement *typed = [RedlandStatement statementWithSubject:subject
+														   predicate:predicate
+															  object:[RedlandNode nodeWithLiteralInt:42]];
+	
+	RedlandModel *model = [RedlandModel new];
+	STAssertNoThrow([model addStatement:plain], nil);
+	STAssertNoThrow([model addStatement:typed withContext:context], nil);
+	
+	NSData *snapshot = [model snapshotData];
+	STAssertNotNil(snapshot, nil);
+	
+	RedlandModel *loaded = [RedlandModel new];
+	STAssertNoThrow([loaded loadSnapshotData:snapshot], nil);
+	STAssertEquals(2, [loaded size], nil);
+	STAssertTrue([loaded containsStatement:plain], nil);
+	STAssertTrue([loaded containsContext:context], nil);
+	STAssertEqualObjects([typed object], [[loaded enumeratorOfTargetsWithSource:subject arc:predicate context:context] nextObject], nil);
+	
+	// a corrupt snapshot must not touch the model
+	NSMutableData *corrupt = [snapshot mutableCopy];
+	((uint8_t *)[corrupt mutableBytes])[[corrupt length] - 1] ^= 0xFF;
+	RedlandModel *untouched = [RedlandModel new];
+	STAssertThrowsSpecific([untouched loadSnapshotData:corrupt], RedlandException, nil);
+	STAssertEquals(0, [untouched size], nil);
+	
+	// a compact storage takes the snapshot in bulk and merges it into its indexes, so a lookup does not have to filter an unsorted buffer
+	RedlandModel *source = [RedlandModel new];
+	for (int i = 0; i < 100; i++) {
+		[source addStatement:[RedlandStatement statementWithSubject:[RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/item/%d", i]]
+														  predicate:predicate
+															 object:[RedlandNode nodeWithLiteralInt:i]]];
+	}
+	RedlandModel *compact = [[RedlandModel alloc] initWithStorage:[[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil]];
+	STAssertNoThrow([compact loadSnapshotData:[source snapshotData]], nil);
+	STAssertEquals(100, [compact size], nil);
+	librdf_storage *storage = [[compact storage] wrappedStorage];
+	uint64_t scanned = RedlandCompactStorageScannedCount(storage);
+	RedlandStatement *pattern = [RedlandStatement statementWithSubject:[RedlandNode nodeWithURIString:@"http://example.org/item/42"] predicate:nil object:nil];
+	STAssertEquals((NSUInteger)1, [[[[compact streamOfStatementsLike:pattern] statementEnumerator] allObjects] count], nil);
+	STAssertTrue(RedlandCompactStorageScannedCount(storage) - scanned < 10, @"Loading a snapshot into a compact storage should go through the bulk add, which leaves no statements in the delta buffer");
+}
+
+
+- (void)testPagination
+{
+	NSArray *models = [self modelsForStorageTypes];
+	for (NSUInteger pass = 0; pass < [models count]; pass++) {
+		RedlandModel *model = models[pass];
+		RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+		for (int i = 0; i < 25; i++) {
+			RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+			[model addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+		}
+		
+		RedlandStatement *pattern = [RedlandStatement statementWithSubject:nil predicate:name object:nil];
+		NSMutableSet *seen = [NSMutableSet set];
+		NSString *cursor = nil;
+		NSUInteger pages = 0;
+		do {
+			NSArray *page = [model statementsLike:pattern withContext:nil limit:10 after:cursor nextCursor:&cursor];
+			STAssertTrue([page count] <= 10, nil);
+			for (RedlandStatement *statement in page) {
+				STAssertFalse([seen containsObject:statement], @"Pages must not overlap");
+				[seen addObject:statement];
+			}
+			pages++;
+			
+			// a closed offset cursor matches the pattern again and skips the statements already returned
+			if (0 == pass && 2 == pages) {
+				[RedlandModel closeAllCursors];
+			}
+			
+			// keyset cursors survive changes between pages
+			if (1 == pass && 1 == pages) {
+				[model addStatement:[RedlandStatement statementWithSubject:[RedlandNode nodeWithURIString:@"http://example.org/other"] predicate:name object:[RedlandNode nodeWithLiteral:@"Other"]]];
+			}
+		} while (cursor);
+		STAssertEquals((NSUInteger)3, pages, nil);
+		STAssertTrue([seen count] >= 25, nil);
+		
+		NSString *foreign = nil;
+		[model statementsLike:[RedlandStatement statementWithSubject:nil predicate:nil object:nil] withContext:nil limit:1 after:nil nextCursor:&foreign];
+		STAssertThrowsSpecific([model statementsLike:pattern withContext:nil limit:10 after:foreign nextCursor:NULL], RedlandException, @"A cursor is bound to its pattern");
+	}
+}
+
+
+- (void)testContextReplacement
+{
+	for (RedlandModel *model in [self modelsForStorageTypes]) {
+		RedlandNode *source = [RedlandNode nodeWithURIString:@"http://example.org/source"];
+		RedlandNode *other = [RedlandNode nodeWithURIString:@"http://example.org/other"];
+		RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+		NSMutableArray *people = [NSMutableArray array];
+		for (int i = 0; i < 4; i++) {
+			RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%d", i]];
+			[people addObject:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"Person %d", i]]]];
+		}
+		[model addStatement:people[0] withContext:source];
+		[model addStatement:people[1] withContext:source];
+		[model addStatement:people[2] withContext:other];
+		STAssertEqualObjects((@{ source: @2, other: @1 }), [model statementCountsByContext], nil);
+		__block NSUInteger visited = 0;
+		[model enumerateContextsWithCountsUsingBlock:^(RedlandNode *context, NSUInteger count, BOOL *stop) {
+			STAssertEquals([context isEqual:source] ? (NSUInteger)2 : (NSUInteger)1, count, nil);
+			visited++;
+			*stop = YES;
+		}];
+		STAssertEquals((NSUInteger)1, visited, @"Setting stop ends the enumeration of contexts");
+		
+		// the refreshed source keeps person 1, drops person 0 and gains person 3
+		RedlandModel *refresh = [RedlandModel new];
+		[refresh addStatement:people[1]];
+		[refresh addStatement:people[3]];
+		NSMutableArray *changes = [NSMutableArray array];
+		id observer = [model addChangeObserverWithQueue:nil usingBlock:^(RedlandModel *changedModel, RedlandChangeSet *changeSet) {
+			[changes addObject:changeSet];
+		}];
+		[model replaceContext:source withStream:[refresh statementStream]];
+		[model removeChangeObserver:observer];
+		
+		STAssertEquals((NSUInteger)2, [model countOfStatementsLike:nil withContext:source], nil);
+		STAssertFalse([model containsStatement:people[0]], nil);
+		STAssertTrue([model containsStatement:people[3]], nil);
+		STAssertEqualObjects((@{ source: @2, other: @1 }), [model statementCountsByContext], nil);
+		STAssertEquals((NSUInteger)1, [changes count], @"A replacement is one change");
+		STAssertEquals((NSUInteger)1, [[[changes lastObject] removedStatements] count], @"Statements kept are not reported");
+		STAssertEquals((NSUInteger)1, [[[changes lastObject] addedStatements] count], nil);
+	}
+}
+
+
+- (void)testUnionModel
+{
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+	RedlandNode *alice = [RedlandNode nodeWithURIString:@"http://example.org/alice"];
+	RedlandNode *bob = [RedlandNode nodeWithURIString:@"http://example.org/bob"];
+	RedlandStatement *aliceName = [RedlandStatement statementWithSubject:alice predicate:name object:[RedlandNode nodeWithLiteral:@"Alice"]];
+	
+	RedlandModel *people = [RedlandModel new];
+	[people addStatement:aliceName];
+	[people addStatement:[RedlandStatement statementWithSubject:bob predicate:name object:[RedlandNode nodeWithLiteral:@"Bob"]]];
+	RedlandModel *friends = [[RedlandModel alloc] initWithStorage:[[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil]];
+	[friends addStatement:[RedlandStatement statementWithSubject:alice predicate:knows object:bob]];
+	[friends addStatement:aliceName];
+	
+	RedlandUnionModel *model = [[RedlandUnionModel alloc] initWithModels:@[people]];
+	RedlandNode *friendsContext = [RedlandNode nodeWithURIString:@"http://example.org/friends"];
+	[model addModel:friends withContext:friendsContext];
+	STAssertEquals(4, [model size], nil);
+	STAssertEquals((NSUInteger)2, [model countOfStatementsLike:nil withContext:friendsContext], nil);
+	STAssertEqualObjects(friends, [model modelWithContext:friendsContext], nil);
+	STAssertEqualObjects((@[[model contextOfModel:people], friendsContext]), [[model contextEnumerator] allObjects], nil);
+	STAssertEqualObjects(bob, [model targetWithSource:alice arc:knows], nil);
+	STAssertThrowsSpecific([model addStatement:aliceName], RedlandException, @"The union is read only");
+	
+	// duplicates
+	STAssertEquals((NSUInteger)2, [[[model enumeratorOfStatementsLike:aliceName] allObjects] count], nil);
+	model.deduplicates = YES;
+	STAssertEquals((NSUInteger)1, [[[model enumeratorOfStatementsLike:aliceName] allObjects] count], nil);
+	STAssertEquals(3, [model size], nil);
+	
+	// SPARQL sees all members, and changes of a member change the union's version
+	NSString *queryString = @"SELECT ?name WHERE { ?a <http://xmlns.com/foaf/0.1/knows> ?b . ?b <http://xmlns.com/foaf/0.1/name> ?name }";
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:queryString baseURI:nil];
+	RedlandQueryResults *results = [query executeOnModel:model];
+	STAssertEqualObjects([RedlandNode nodeWithLiteral:@"Bob"], [results valueOfBinding:@"name"], nil);
+	uint64_t version = model.version;
+	[people addStatement:[RedlandStatement statementWithSubject:bob predicate:knows object:alice]];
+	STAssertTrue(model.version > version, nil);
+	
+	[model removeModel:people];
+	STAssertEquals(2, [model size], nil);
+	STAssertNil([model contextOfModel:people], nil);
+}
+
+- (void)testShardedModel
+{
+	RedlandNode *name = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/name"];
+	RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+	RedlandNode *people = [RedlandNode nodeWithURIString:@"http://example.org/people"];
+	RedlandModel *source = [RedlandModel new];
+	for (NSUInteger i = 0; i < 100; i++) {
+		NSString *personName = [NSString stringWithFormat:@"Person %lu", (unsigned long)i];
+		RedlandNode *person = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%lu", (unsigned long)i]];
+		RedlandNode *friend = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/person/%lu", (unsigned long)(i + 1) % 100]];
+		[source addStatement:[RedlandStatement statementWithSubject:person predicate:name object:[RedlandNode nodeWithLiteral:personName]]];
+		[source addStatement:[RedlandStatement statementWithSubject:person predicate:knows object:friend]];
+	}
+	
+	// compact shards are scanned, counted and bulk loaded in parallel, other shards one after the other
+	NSArray *storages = @[[RedlandStorage new],
+						  [[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil]];
+	for (RedlandShardedModel *model in @[[[RedlandShardedModel alloc] initWithShardCount:4], [[RedlandShardedModel alloc] initWithStorages:storages]]) {
+		[model addStatementsFromStream:[source statementStream] withContext:people];
+		STAssertEquals(200, [model size], nil);
+		NSUInteger shardTotal = 0;
+		for (RedlandModel *shard in model.shards) {
+			STAssertTrue([shard size] < 200, @"Statements should be spread across the shards");
+			shardTotal += [shard size];
+		}
+		STAssertEquals((NSUInteger)200, shardTotal, nil);
+		
+		RedlandNode *alice = [RedlandNode nodeWithURIString:@"http://example.org/person/7"];
+		RedlandNode *bob = [RedlandNode nodeWithURIString:@"http://example.org/person/8"];
+		STAssertEquals((NSUInteger)2, [[model shardForSubject:alice] countOfStatementsLike:[RedlandStatement statementWithSubject:alice predicate:nil object:nil]], nil);
+		STAssertEqualObjects(bob, [model targetWithSource:alice arc:knows], nil);
+		STAssertEqualObjects(alice, [model sourceWithArc:knows target:bob], nil);
+		STAssertEquals((NSUInteger)100, [model countOfStatementsLike:[RedlandStatement statementWithSubject:nil predicate:knows object:nil]], nil);
+		NSArray *all = [[model enumeratorOfStatementsLike:nil] allObjects];
+		STAssertEquals((NSUInteger)200, [all count], nil);
+		STAssertEquals((NSUInteger)200, [[NSSet setWithArray:all] count], @"Statements of parallel shard scans must stay distinct after the scans moved on");
+		STAssertEquals((NSUInteger)100, [[[model enumeratorOfStatementsLike:[RedlandStatement statementWithSubject:nil predicate:name object:nil]] allObjects] count], nil);
+		STAssertEqualObjects(@[people], [[model contextEnumerator] allObjects], nil);
+		STAssertEquals((NSUInteger)200, [model countOfStatementsLike:nil withContext:people], nil);
+		
+		[model removeStatement:[RedlandStatement statementWithSubject:alice predicate:knows object:bob] withContext:people];
+		STAssertNil([model targetWithSource:alice arc:knows], nil);
+		STAssertEquals(199, [model size], nil);
+		[model addStatement:[RedlandStatement statementWithSubject:bob predicate:knows object:alice]];
+		STAssertEquals((NSUInteger)100, [model countOfStatementsLike:[RedlandStatement statementWithSubject:nil predicate:knows object:nil]], nil);
+	}
+}
+
+- (void)testStreamOperators
+{
+	RedlandNode *label = [RedlandNode nodeWithURIString:@"http://www.w3.org/2000/01/rdf-schema#label"];
+	RedlandNode *age = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/age"];
+	RedlandNode *knows = [RedlandNode nodeWithURIString:@"http://xmlns.com/foaf/0.1/knows"];
+	RedlandNode *alice = [RedlandNode nodeWithURIString:@"http://example.org/alice"];
+	RedlandNode *bob = [RedlandNode nodeWithURIString:@"http://example.org/bob"];
+	RedlandURI *integer = [RedlandURI URIWithString:@"http://www.w3.org/2001/XMLSchema#integer"];
+	RedlandModel *model = [RedlandModel new];
+	[model addStatement:[RedlandStatement statementWithSubject:alice predicate:label object:[RedlandNode nodeWithLiteral:@"Alice" language:@"en" type:nil]]];
+	[model addStatement:[RedlandStatement statementWithSubject:alice predicate:label object:[RedlandNode nodeWithLiteral:@"Alicia" language:@"es" type:nil]]];
+	[model addStatement:[RedlandStatement statementWithSubject:bob predicate:label object:[RedlandNode nodeWithLiteral:@"Bob" language:@"EN" type:nil]]];
+	[model addStatement:[RedlandStatement statementWithSubject:alice predicate:age object:[RedlandNode nodeWithLiteral:@"42" language:nil type:integer]]];
+	[model addStatement:[RedlandStatement statementWithSubject:alice predicate:knows object:bob]];
+	
+	NSArray *english = [[[[model statementStream] streamByFilteringObjectLanguage:@"en"] statementEnumerator] allObjects];
+	STAssertEquals((NSUInteger)2, [english count], nil);
+	STAssertEquals((NSUInteger)1, [[[[[model statementStream] streamByFilteringObjectDatatype:integer] statementEnumerator] allObjects] count], nil);
+	STAssertEquals((NSUInteger)4, [[[[[model statementStream] streamByFilteringParts:RedlandStatementObject ofType:LIBRDF_NODE_TYPE_LITERAL] statementEnumerator] allObjects] count], nil);
+	STAssertEquals((NSUInteger)1, [[[[[model statementStream] streamByFilteringParts:(RedlandStatementSubject | RedlandStatementObject) ofType:LIBRDF_NODE_TYPE_RESOURCE] statementEnumerator] allObjects] count], nil);
+	
+	// chained: distinct subjects, limited
+	RedlandStream *subjects = [[[model statementStream] streamByProjectingParts:RedlandStatementSubject] streamByRemovingDuplicates];
+	NSArray *distinct = [[[subjects streamByLimitingToCount:5] statementEnumerator] allObjects];
+	STAssertEquals((NSUInteger)2, [distinct count], nil);
+	STAssertNil([[distinct objectAtIndex:0] predicate], @"Projection should drop the predicate");
+	STAssertEqualObjects([NSSet setWithObjects:alice, bob, nil], [NSSet setWithArray:[distinct valueForKey:@"subject"]], nil);
+	NSArray *objects = [[[[model statementStream] streamByProjectingParts:RedlandStatementObject] statementEnumerator] allObjects];
+	STAssertEquals((NSUInteger)5, [[NSSet setWithArray:[objects valueForKey:@"object"]] count], @"Projected statements must not alias each other");
+	STAssertEquals((NSUInteger)3, [[[[[model statementStream] streamByLimitingToCount:3] statementEnumerator] allObjects] count], nil);
+	STAssertEquals((NSUInteger)0, [[[[[model statementStream] streamByLimitingToCount:0] statementEnumerator] allObjects] count], nil);
+	
+	// concatenation
+	RedlandStream *both = [[model statementStream] streamByAppendingStream:[model statementStream]];
+	STAssertEquals((NSUInteger)10, [[[both statementEnumerator] allObjects] count], nil);
+	RedlandStream *once = [[RedlandStream streamByConcatenatingStreams:@[[model statementStream], [model statementStream]]] streamByRemovingDuplicates];
+	STAssertEquals((NSUInteger)5, [[[once statementEnumerator] allObjects] count], nil);
+}
+
 
 @end
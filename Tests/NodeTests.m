@@ -109,6 +109,42 @@
 	RedlandNode *node3 = [RedlandNode nodeWithURIString:url3];
 	STAssertFalse([node1 isEqual:node2], nil);
 	STAssertEqualObjects(node1, node3, nil);
+	STAssertEquals([node1 hash], [node3 hash], nil);
+	STAssertEquals((NSUInteger)1, [[NSSet setWithObjects:node1, node3, nil] count], nil);
+}
+
+- (void)testNodeComparison
+{
+	RedlandNode *first = [RedlandNode nodeWithURIString:@"http://foo.com/a"];
+	RedlandNode *second = [RedlandNode nodeWithURIString:@"http://foo.com/b"];
+	STAssertEquals(NSOrderedAscending, [first compare:second], nil);
+	STAssertEquals(NSOrderedDescending, [second compare:first], nil);
+	STAssertEquals(NSOrderedSame, [first compare:[RedlandNode nodeWithURIString:@"http://foo.com/a"]], nil);
+	
+	RedlandNode *apple = [RedlandNode nodeWithLiteral:@"apple"];
+	RedlandNode *pear = [RedlandNode nodeWithLiteral:@"pear"];
+	STAssertEquals(NSOrderedAscending, [apple compare:pear], nil);
+	STAssertEquals(NSOrderedSame, [apple compare:[RedlandNode nodeWithLiteral:@"apple"]], nil);
+	
+	NSArray *sorted = [@[pear, second, apple, first] sortedArrayUsingSelector:@selector(compare:)];
+	STAssertTrue([sorted indexOfObject:first] < [sorted indexOfObject:second], nil);
+	STAssertTrue([sorted indexOfObject:apple] < [sorted indexOfObject:pear], nil);
+}
+
+- (void)testCachedValues
+{
+	RedlandNode *literal = [RedlandNode nodeWithLiteral:@"value" language:@"en" isXML:NO];
+	STAssertEquals([literal literalValue], [literal literalValue], @"Decoded values should be cached");
+	STAssertEqualObjects(@"value", [literal literalValue], nil);
+	STAssertEqualObjects(@"en", [literal literalLanguage], nil);
+	STAssertNil([literal literalDataType], nil);
+	STAssertNil([literal literalDataType], @"Missing values should be cached as missing");
+	STAssertNil([literal URIValue], nil);
+	
+	RedlandNode *resource = [RedlandNode nodeWithURIString:@"http://foo.com/"];
+	STAssertEquals([resource URIValue], [resource URIValue], nil);
+	STAssertEqualObjects(@"http://foo.com/", [[resource URIValue] stringValue], nil);
+	STAssertNil([resource literalValue], nil);
 }
 
 - (void)testLiteralInt
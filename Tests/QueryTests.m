@@ -30,6 +30,16 @@
 #import "RedlandParser.h"
 #import "RedlandException.h"
 #import "RedlandURI.h"
+#import "RedlandQueryProfile.h"
+#import "RedlandQueryCache.h"
+#import "RedlandBindingTable.h"
+#import "RedlandNode.h"
+#import "RedlandStatement.h"
+#import "RedlandCancellationToken.h"
+#import "RedlandSerializer.h"
+#import "RedlandQueryExecutor.h"
+#import "RedlandWorld.h"
+#import "RedlandQuery-Pagination.h"
 
 static NSString *RDFXMLTestData = nil;
 static NSString * const RDFXMLTestDataLocation = @"http://www.w3.org/1999/02/22-rdf-syntax-ns";
@@ -113,5 +123,291 @@ static NSString * const RDFXMLTestDataLocation = @"http://www.w3.org/1999/02/22-
 	}
 }
 
+- (void)testQueryProfile
+{
+	NSString *queryString = @"SELECT ?s ?o WHERE { ?s a ?o }";
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:queryString baseURI:nil];
+	STAssertEqualObjects(queryString, query.queryString, nil);
+	
+	[RedlandQueryProfile removeAllSlowQueries];
+	[RedlandQueryProfile setSlowQueryThreshold:DBL_MIN];
+	__block RedlandQueryProfile *handled = nil;
+	[RedlandQueryProfile setSlowQueryHandler:^(RedlandQueryProfile *slowProfile) {
+		handled = slowProfile;
+	}];
+	
+	RedlandQueryResults *results = [query executeOnModel:model];
+	RedlandQueryProfile *profile = results.profile;
+	STAssertNotNil(profile, nil);
+	STAssertFalse(profile.finished, nil);
+	STAssertEqualObjects((@[@"s", @"o"]), profile.bindingNames, nil);
+	
+	NSArray *allResults = [[results resultEnumerator] allObjects];
+	STAssertTrue(profile.finished, nil);
+	STAssertEquals([allResults count], profile.rowCount, nil);
+	STAssertEquals(NSNotFound, profile.triplesScanned, @"The default storage can't report scanned triples");
+	STAssertTrue(profile.totalTime >= profile.executionTime + profile.iterationTime, nil);
+	STAssertTrue([allResults count] > 0 && profile.firstResultTime <= profile.iterationTime, @"Producing the first result is timed separately from librdf_query_execute");
+	STAssertEquals(profile, handled, nil);
+	STAssertEqualObjects(@[profile], [RedlandQueryProfile slowQueries], nil);
+	
+	[RedlandQueryProfile setSlowQueryThreshold:0];
+	[RedlandQueryProfile setSlowQueryHandler:nil];
+	[RedlandQueryProfile removeAllSlowQueries];
+}
+
+
+- (void)testQueryCache
+{
+	RedlandQueryCache *cache = [[RedlandQueryCache alloc] initWithCountLimit:2 costLimit:0];
+	NSString *queryString = @"SELECT ?s ?o WHERE { ?s a ?o }";
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:queryString baseURI:nil];
+	
+	RedlandBindingTable *table = [cache bindingsOfQuery:query onModel:model];
+	STAssertNotNil(table, nil);
+	STAssertEqualObjects((@[@"s", @"o"]), table.variables, nil);
+	NSUInteger rows = [[[query executeOnModel:model] resultEnumerator] allObjects].count;
+	STAssertEquals(rows, table.count, nil);
+	STAssertEquals(table, [cache bindingsOfQuery:query onModel:model], @"Unchanged model must hit the cache");
+	STAssertEquals((NSUInteger)1, cache.hits, nil);
+	STAssertEquals((NSUInteger)1, cache.misses, nil);
+	
+	// changing the model invalidates
+	uint64_t version = model.version;
+	RedlandNode *subject = [RedlandNode nodeWithURIString:@"http://example.org/cached"];
+	RedlandNode *type = [RedlandNode nodeWithURIString:@"http://www.w3.org/1999/02/22-rdf-syntax-ns#type"];
+	RedlandNode *exampleClass = [RedlandNode nodeWithURIString:@"http://example.org/Class"];
+	[model addStatement:[RedlandStatement statementWithSubject:subject predicate:type object:exampleClass]];
+	STAssertTrue(model.version > version, nil);
+	RedlandBindingTable *newTable = [cache bindingsOfQuery:query onModel:model];
+	STAssertFalse(table == newTable, nil);
+	STAssertEquals(rows + 1, newTable.count, nil);
+	STAssertEquals((NSUInteger)1, cache.count, @"The result of the old version must be dropped");
+	
+	// limit is part of the key, the count limit evicts
+	query.limit = 1;
+	STAssertEquals((NSUInteger)1, [cache bindingsOfQuery:query onModel:model].count, nil);
+	query.limit = 2;
+	[cache bindingsOfQuery:query onModel:model];
+	STAssertEquals((NSUInteger)2, cache.count, nil);
+	STAssertEquals((NSUInteger)1, cache.evictions, nil);
+	
+	RedlandQuery *ask = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"ASK { ?s ?p ?o }" baseURI:nil];
+	STAssertNil([cache bindingsOfQuery:ask onModel:model], @"Only bindings are cached");
+	
+	[cache removeAllResults];
+	STAssertEquals((NSUInteger)0, cache.count, nil);
+	STAssertEquals((NSUInteger)0, cache.totalCost, nil);
+}
+
+
+- (void)testCancellation
+{
+	RedlandCancellationToken *token = [RedlandCancellationToken token];
+	STAssertFalse(token.isCancelled, nil);
+	STAssertNoThrow([token throwIfCancelled], nil);
+	[token cancel];
+	STAssertTrue(token.isCancelled, nil);
+	STAssertThrowsSpecificNamed([token throwIfCancelled], RedlandException, RedlandCancellationExceptionName, nil);
+	
+	RedlandCancellationToken *expired = [RedlandCancellationToken tokenWithTimeout:-1];
+	STAssertTrue(expired.isDeadlineExceeded, nil);
+	STAssertTrue(expired.isCancelled, nil);
+	STAssertFalse([[RedlandCancellationToken tokenWithTimeout:3600] isCancelled], nil);
+	STAssertTrue([[[RedlandCancellationToken alloc] initWithDeadline:[NSDate distantPast]] isCancelled], @"Deadlines before 2001 have passed as well");
+	STAssertFalse([[RedlandCancellationToken token] isDeadlineExceeded], nil);
+	
+	// queries
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"SELECT ?s ?p ?o WHERE { ?s ?p ?o }" baseURI:nil];
+	STAssertThrowsSpecificNamed([query executeOnModel:model cancellationToken:expired], RedlandException, RedlandCancellationExceptionName, nil);
+	RedlandCancellationToken *iterationToken = [RedlandCancellationToken token];
+	RedlandQueryResults *results = [query executeOnModel:model cancellationToken:iterationToken];
+	STAssertTrue([results next], nil);
+	[iterationToken cancel];
+	STAssertThrowsSpecificNamed([results next], RedlandException, RedlandCancellationExceptionName, nil);
+	STAssertTrue(results.profile.finished, nil);
+	
+	// parsing leaves the model untouched
+	RedlandModel *target = [RedlandModel new];
+	RedlandParser *parser = [RedlandParser parserWithName:RedlandRDFXMLParserName];
+	STAssertThrowsSpecificNamed([parser parseString:RDFXMLTestData intoModel:target withBaseURI:uri cancellationToken:expired], RedlandException, RedlandCancellationExceptionName, nil);
+	STAssertEquals(0, [target size], nil);
+	[parser parseString:RDFXMLTestData intoModel:target withBaseURI:uri cancellationToken:[RedlandCancellationToken tokenWithTimeout:3600]];
+	STAssertEquals([model size], [target size], nil);
+	RedlandModel *broken = [RedlandModel new];
+	NSString *malformed = @"<http://example.org/a> <http://example.org/b> <http://example.org/c> .\n<http://example.org/a> <http://example.org/b> \"unterminated .\n";
+	STAssertThrowsSpecificNamed([[RedlandParser parserWithName:RedlandNTriplesParserName] parseString:malformed intoModel:broken withBaseURI:uri cancellationToken:[RedlandCancellationToken token]], RedlandException, RedlandExceptionName, nil);
+	STAssertEquals(0, [broken size], @"A parse error must not leave the statements before it in the model");
+	
+	// serializing
+	RedlandSerializer *serializer = [RedlandSerializer serializerWithName:RedlandNTriplesSerializerName];
+	STAssertThrowsSpecificNamed([serializer serializedStringFromModel:model withBaseURI:uri cancellationToken:expired], RedlandException, RedlandCancellationExceptionName, nil);
+	NSString *serialized = [serializer serializedStringFromModel:model withBaseURI:uri cancellationToken:[RedlandCancellationToken token]];
+	STAssertTrue([serialized length] > 0, nil);
+}
+
+
+- (void)testAsynchronousExecution
+{
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"SELECT ?s ?p ?o WHERE { ?s ?p ?o }" baseURI:nil];
+	NSUInteger expected = [[[query executeOnModel:model] resultEnumerator] allObjects].count;
+	NSOperationQueue *queue = [NSOperationQueue new];
+	RedlandQueryExecutor *executor = [[RedlandQueryExecutor alloc] initWithMaxConcurrentQueries:2];
+	
+	// the consumer asks for the next batch after every batch
+	__block NSUInteger received = 0;
+	__block NSUInteger batches = 0;
+	__block BOOL completed = NO;
+	__block NSError *completionError = nil;
+	[executor executeQuery:query onModel:model batchSize:5 queue:queue rowsHandler:^(RedlandQueryExecution *execution, RedlandBindingTable *rows) {
+		STAssertTrue([rows count] <= 5, nil);
+		received += [rows count];
+		batches++;
+		[execution requestBatches:1];
+	} completionHandler:^(RedlandQueryExecution *execution, NSError *error) {
+		completionError = error;
+		completed = YES;
+	}];
+	NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:10];
+	while (!completed && [timeout timeIntervalSinceNow] > 0) {
+		[[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+	}
+	STAssertTrue(completed, nil);
+	STAssertNil(completionError, nil);
+	STAssertEquals(expected, received, nil);
+	STAssertEquals((expected + 4) / 5, batches, nil);
+	
+	// without demand only the first batch arrives, cancelling completes with an error
+	__block NSUInteger idleBatches = 0;
+	dispatch_semaphore_t firstBatch = dispatch_semaphore_create(0);
+	dispatch_semaphore_t cancelled = dispatch_semaphore_create(0);
+	RedlandQueryExecution *idle = [executor executeQuery:query onModel:model batchSize:1 queue:queue rowsHandler:^(RedlandQueryExecution *execution, RedlandBindingTable *rows) {
+		idleBatches++;
+		dispatch_semaphore_signal(firstBatch);
+	} completionHandler:^(RedlandQueryExecution *execution, NSError *error) {
+		completionError = error;
+		dispatch_semaphore_signal(cancelled);
+	}];
+	STAssertEquals(0L, dispatch_semaphore_wait(firstBatch, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), nil);
+	STAssertEquals((NSUInteger)1, idle.rowCount, nil);
+	STAssertFalse(idle.isFinished, nil);
+	[idle cancel];
+	STAssertEquals(0L, dispatch_semaphore_wait(cancelled, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), nil);
+	STAssertEquals((NSUInteger)1, idleBatches, nil);
+	STAssertEquals((NSInteger)RedlandQueryExecutionCancelledError, [completionError code], nil);
+	STAssertEqualObjects(RedlandErrorDomain, [completionError domain], nil);
+}
+
+
+- (void)testQueryAdmission
+{
+	RedlandQueryExecutor *executor = [[RedlandQueryExecutor alloc] initWithMaxConcurrentQueries:1];
+	STAssertEquals((NSUInteger)1, [executor maxConcurrentQueriesForPriority:RedlandQueryPriorityBackground], nil);
+	STAssertEquals((NSUInteger)1, [executor maxConcurrentQueriesForPriority:RedlandQueryPriorityInteractive], nil);
+	[executor setMaxQueueLength:1 forPriority:RedlandQueryPriorityBackground];
+	STAssertEquals((NSUInteger)1, [executor maxQueueLengthForPriority:RedlandQueryPriorityBackground], nil);
+	STAssertEquals((NSUInteger)0, [executor maxQueueLengthForPriority:RedlandQueryPriorityInteractive], nil);
+	STAssertEquals((NSUInteger)4, [executor weightForPriority:RedlandQueryPriorityInteractive], nil);
+	STAssertEquals((NSUInteger)1, [executor weightForPriority:RedlandQueryPriorityBackground], nil);
+	
+	// a burst of background queries overflows the queue, interactive queries are never shed
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"SELECT ?s ?p ?o WHERE { ?s ?p ?o }" baseURI:nil];
+	NSOperationQueue *queue = [NSOperationQueue new];
+	[queue setMaxConcurrentOperationCount:1];
+	__block NSUInteger rejected = 0;
+	NSMutableArray *order = [NSMutableArray array];
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	RedlandQueryCompletionHandler completion = ^(RedlandQueryExecution *execution, NSError *error) {
+		if (RedlandQueryExecutionRejectedError == [error code]) {
+			rejected++;
+		}
+		else {
+			[order addObject:@(execution.priority)];
+		}
+		dispatch_semaphore_signal(done);
+	};
+	
+	// while the world is locked the first background query holds the worker, so exactly one more fits the background queue
+	RedlandWorld *world = [RedlandWorld defaultWorld];
+	[world lock];
+	for (NSUInteger i = 0; i < 20; i++) {
+		[executor executeQuery:query onModel:model priority:RedlandQueryPriorityBackground batchSize:1000 queue:queue rowsHandler:nil completionHandler:completion];
+	}
+	for (NSUInteger i = 0; i < 5; i++) {
+		[executor executeQuery:query onModel:model priority:RedlandQueryPriorityInteractive batchSize:1000 queue:queue rowsHandler:nil completionHandler:completion];
+	}
+	STAssertEquals((NSUInteger)1, [executor statisticsForPriority:RedlandQueryPriorityBackground].queued, nil);
+	STAssertEquals((NSUInteger)5, [executor statisticsForPriority:RedlandQueryPriorityInteractive].queued, nil);
+	[world unlock];
+	for (NSUInteger i = 0; i < 25; i++) {
+		STAssertEquals(0L, dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 20 * NSEC_PER_SEC)), nil);
+	}
+	
+	// interactive queries get four turns for every background turn, so the queued background query is not starved
+	NSArray *expectedOrder = @[ @(RedlandQueryPriorityBackground), @(RedlandQueryPriorityInteractive), @(RedlandQueryPriorityInteractive),
+								@(RedlandQueryPriorityBackground), @(RedlandQueryPriorityInteractive), @(RedlandQueryPriorityInteractive),
+								@(RedlandQueryPriorityInteractive) ];
+	STAssertEqualObjects(expectedOrder, order, nil);
+	
+	RedlandQueryPriorityStatistics background = [executor statisticsForPriority:RedlandQueryPriorityBackground];
+	RedlandQueryPriorityStatistics interactive = [executor statisticsForPriority:RedlandQueryPriorityInteractive];
+	STAssertEquals((NSUInteger)18, background.shed, @"The background queue holds one query while another runs");
+	STAssertEquals((NSUInteger)2, background.admitted, nil);
+	STAssertEquals((NSUInteger)5, interactive.admitted, nil);
+	STAssertEquals((NSUInteger)0, interactive.shed, nil);
+	STAssertEquals(background.shed, rejected, nil);
+	STAssertEquals((NSUInteger)0, background.queued, nil);
+	STAssertTrue(background.maximumWaitTime >= background.averageWaitTime, nil);
+	
+	[executor resetStatistics];
+	STAssertEquals((NSUInteger)0, [executor statisticsForPriority:RedlandQueryPriorityBackground].admitted, nil);
+	
+	// every batch is scheduled on its own, so an interactive query does not wait for all batches of a long background query
+	RedlandQueryExecutor *interleaving = [[RedlandQueryExecutor alloc] initWithMaxConcurrentQueries:2];
+	__block NSUInteger backgroundRowsWhenInteractiveFinished = NSNotFound;
+	[world lock];
+	RedlandQueryExecution *report = [interleaving executeQuery:query onModel:model priority:RedlandQueryPriorityBackground batchSize:1 queue:queue rowsHandler:nil completionHandler:^(RedlandQueryExecution *execution, NSError *error) {
+		dispatch_semaphore_signal(done);
+	}];
+	[report requestBatches:NSUIntegerMax];
+	[interleaving executeQuery:query onModel:model priority:RedlandQueryPriorityInteractive batchSize:1000 queue:[NSOperationQueue new] rowsHandler:nil completionHandler:^(RedlandQueryExecution *execution, NSError *error) {
+		backgroundRowsWhenInteractiveFinished = report.rowCount;
+		dispatch_semaphore_signal(done);
+	}];
+	[world unlock];
+	for (NSUInteger i = 0; i < 2; i++) {
+		STAssertEquals(0L, dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 20 * NSEC_PER_SEC)), nil);
+	}
+	STAssertTrue(backgroundRowsWhenInteractiveFinished < report.rowCount, @"The interactive query should run between two batches of the background query");
+}
+
+
+- (void)testQueryPagination
+{
+	RedlandQuery *query = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"SELECT ?s ?p ?o WHERE { ?s ?p ?o }" baseURI:nil];
+	NSUInteger total = [[[query executeOnModel:model] resultEnumerator] allObjects].count;
+	STAssertTrue(total > 2, nil);
+	
+	NSString *cursor = nil;
+	NSUInteger rows = 0;
+	RedlandBindingTable *page = [query rowsOnModel:model limit:2 after:nil nextCursor:&cursor];
+	STAssertEquals((NSUInteger)2, page.count, nil);
+	STAssertNotNil(cursor, nil);
+	rows += page.count;
+	
+	// a closed cursor executes the query again and skips the rows already returned
+	[RedlandQuery closeAllCursors];
+	while (cursor) {
+		page = [query rowsOnModel:model limit:2 after:cursor nextCursor:&cursor];
+		STAssertTrue(page.count <= 2, nil);
+		rows += page.count;
+	}
+	STAssertEquals(total, rows, nil);
+	
+	RedlandQuery *other = [RedlandQuery queryWithLanguageName:RedlandSPARQLLanguageName queryString:@"SELECT ?s WHERE { ?s ?p ?o }" baseURI:nil];
+	[query rowsOnModel:model limit:1 after:nil nextCursor:&cursor];
+	STAssertThrowsSpecific([other rowsOnModel:model limit:1 after:cursor nextCursor:NULL], RedlandException, @"A cursor is bound to its query");
+}
+
 
 @end
@@ -70,6 +70,8 @@
 											  predicate:predicate
 												 object:object1];
 	STAssertEqualObjects(statement1, statement2, nil);
+	STAssertEquals([statement1 hash], [statement2 hash], nil);
+	STAssertEquals([statement1 object], [statement1 object], @"Nodes should be cached");
 	statement1 = [RedlandStatement statementWithSubject:subject
 											  predicate:predicate
 												 object:nil];
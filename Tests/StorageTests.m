@@ -25,6 +25,11 @@
 #import "StorageTests.h"
 
 #import "RedlandStorage.h"
+#import "RedlandCompactStorage.h"
+#import "RedlandModel-Convenience.h"
+#import "RedlandNode-Convenience.h"
+#import "RedlandStatement.h"
+#import "RedlandStreamEnumerator.h"
 
 @implementation StorageTests
 
@@ -36,4 +41,54 @@
     STAssertNotNil(storage, nil);
 }
 
+- (void)testCompact
+{
+	RedlandStorage *storage = [[RedlandStorage alloc] initWithFactoryName:RedlandCompactStorageFactoryName identifier:nil options:nil];
+	STAssertNotNil(storage, nil);
+	STAssertTrue(RedlandStorageIsCompact([storage wrappedStorage]), nil);
+	STAssertFalse(RedlandStorageIsCompact([[RedlandStorage new] wrappedStorage]), nil);
+	
+	RedlandModel *model = [RedlandModel modelWithStorage:storage];
+	RedlandNode *predicate = [RedlandNode nodeWithURIString:@"http://example.org/value"];
+	RedlandNode *context = [RedlandNode nodeWithURIString:@"http://example.org/graph"];
+	
+	// enough statements to go through several merges of the delta buffer
+	for (int i = 0; i < 10000; i++) {
+		RedlandNode *subject = [RedlandNode nodeWithURIString:[NSString stringWithFormat:@"http://example.org/item/%d", i % 1000]];
+		RedlandStatement *statement = [RedlandStatement statementWithSubject:subject predicate:predicate object:[RedlandNode nodeWithLiteral:[NSString stringWithFormat:@"%d", i]]];
+		if (0 == i % 10) {
+			[model addStatement:statement withContext:context];
+		}
+		else {
+			[model addStatement:statement];
+		}
+	}
+	STAssertEquals(10000, [model size], nil);
+	[model addStatement:[RedlandStatement statementWithSubject:[RedlandNode nodeWithURIString:@"http://example.org/item/1"]
+													 predicate:predicate
+														object:[RedlandNode nodeWithLiteral:@"1"]]];
+	STAssertEquals(10000, [model size], @"Duplicate statements must not be stored twice");
+	
+	RedlandNode *item = [RedlandNode nodeWithURIString:@"http://example.org/item/7"];
+	NSArray *targets = [[model enumeratorOfTargetsWithSource:item arc:predicate] allObjects];
+	STAssertEquals((NSUInteger)10, [targets count], nil);
+	
+	// the compact stream reuses one statement buffer, the statements it hands out must be copies of it
+	NSArray *itemStatements = [[model enumeratorOfStatementsLike:[RedlandStatement statementWithSubject:item predicate:predicate object:nil]] allObjects];
+	STAssertEquals((NSUInteger)10, [[NSSet setWithArray:[itemStatements valueForKey:@"object"]] count], @"Statements of a compact stream must keep their objects after the stream moved on");
+	
+	STAssertEquals((NSUInteger)1000, [[[model statementEnumeratorWithContext:context] allObjects] count], nil);
+	STAssertEqualObjects(context, [[model contextEnumerator] nextObject], nil);
+	
+	// removing without a context leaves the statements in the context alone
+	RedlandStatement *pattern = [RedlandStatement statementWithSubject:nil predicate:predicate object:nil];
+	for (RedlandStatement *statement in [[model enumeratorOfStatementsLike:pattern] allObjects]) {
+		[model removeStatement:statement];
+	}
+	STAssertEquals(1000, [model size], @"Only the statements in a context should remain");
+	[model removeAllStatementsWithContext:context];
+	STAssertEquals(0, [model size], nil);
+	STAssertNil([[model contextEnumerator] nextObject], nil);
+}
+
 @end